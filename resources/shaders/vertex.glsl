@@ -3,6 +3,10 @@
 layout (location = 0) in vec3 position;
 layout (location = 1) in vec3 color;
 layout (location = 2) in vec3 normal;
+layout (location = 3) in vec3 instance_offset;
+layout (location = 4) in vec3 instance_scale;
+// indirect irradiance in rgb and ambient occlusion in a, see GL::Mesh::baked_lighting
+layout (location = 5) in vec4 baked_lighting;
 out vec3 vertex_color;
 
 struct Material
@@ -18,13 +22,19 @@ uniform mat4 view_projection;
 uniform mat4 normal_transform;
 uniform bool color_per_vertex;
 uniform bool use_global_color;
+uniform bool use_instance_transform;
+uniform bool use_baked_lighting;
 uniform vec3 global_color;
 uniform Material material;
 uniform vec3 camera_position;
 
 void main()
 {
-    gl_Position = view_projection * model * vec4(position, 1.0);
+    vec3 model_position = position;
+    if (use_instance_transform) {
+        model_position = position * instance_scale + instance_offset;
+    }
+    gl_Position = view_projection * model * vec4(model_position, 1.0);
 
     if (color_per_vertex) {
         vertex_color = color;
@@ -34,13 +44,19 @@ void main()
         vertex_color = global_color;
         return;
     }
-    vec3 world_position = (model * vec4(position, 1.0)).xyz;
+    vec3 world_position = (model * vec4(model_position, 1.0)).xyz;
     vec3 world_normal = normalize((normal_transform * vec4(normal, 0.0)).xyz);
     vec3 V = normalize(camera_position - world_position);
     vec3 H = V;
     float N_dot_V = max(0.0, dot(world_normal, V));
     float N_dot_H = pow(max(0.0, dot(world_normal, H)), material.shininess);
-    vertex_color = 0.1 * material.ambient
-                 + material.diffuse * (0.5 * N_dot_V + 0.5)
+    float occlusion = 1.0;
+    vec3 indirect = vec3(0.0);
+    if (use_baked_lighting) {
+        occlusion = baked_lighting.a;
+        indirect = material.diffuse * baked_lighting.rgb;
+    }
+    vertex_color = occlusion * (0.1 * material.ambient + material.diffuse * (0.5 * N_dot_V + 0.5))
+                 + indirect
                  + material.specular * N_dot_H;
 }
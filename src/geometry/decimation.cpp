@@ -0,0 +1,424 @@
+#include "halfedge.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "../utils/logger.h"
+#include "../utils/parallel.hpp"
+#include "../utils/quadric.hpp"
+
+using Eigen::Vector3f;
+using Eigen::Vector4f;
+using std::optional;
+using std::pair;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+using std::chrono::steady_clock;
+using duration   = std::chrono::duration<float>;
+using time_point = std::chrono::time_point<steady_clock, duration>;
+
+namespace {
+
+constexpr uint32_t REMOVED = std::numeric_limits<uint32_t>::max();
+
+// Each round only considers the cheapest part of the candidate edges, so that the collapses
+// follow roughly the same order as the sequential simplifier.
+constexpr size_t ROUND_FRACTION = 8;
+
+// The priority of a candidate edge: lower cost first, ties are broken by the edge's endpoints
+// so that every thread sees the same total order.
+struct Priority
+{
+    float    cost;
+    uint64_t key;
+
+    bool operator<(const Priority& other) const
+    {
+        return cost < other.cost || (cost == other.cost && key < other.key);
+    }
+    bool operator==(const Priority& other) const
+    {
+        return key == other.key && cost == other.cost;
+    }
+};
+
+constexpr Priority NO_PRIORITY = {
+    std::numeric_limits<float>::infinity(), std::numeric_limits<uint64_t>::max()
+};
+
+// An indexed triangle mesh being decimated. A removed face has all its corners set to REMOVED.
+struct DecimationMesh
+{
+    vector<Vector3f> positions;
+    vector<Quadric>  quadrics;
+    vector<uint32_t> corners;
+    // the faces around vertex v are faces[offsets[v]] ... faces[offsets[v + 1] - 1]
+    vector<uint32_t> offsets;
+    vector<uint32_t> faces;
+};
+
+// Rebuilds the vertex-to-face adjacency of the remaining faces. The faces around each vertex are
+// sorted, so the result does not depend on the order in which threads fill them.
+void build_adjacency(DecimationMesh& mesh)
+{
+    const size_t n_vertices = mesh.positions.size();
+    const size_t n_faces    = mesh.corners.size() / 3;
+    vector<std::atomic<uint32_t>> counts(n_vertices);
+    parallel_for(0, n_faces, [&](size_t f) {
+        if (mesh.corners[3 * f] == REMOVED) {
+            return;
+        }
+        for (size_t k = 0; k < 3; ++k) {
+            counts[mesh.corners[3 * f + k]].fetch_add(1, std::memory_order_relaxed);
+        }
+    });
+    mesh.offsets.resize(n_vertices + 1);
+    mesh.offsets[0] = 0;
+    for (size_t v = 0; v < n_vertices; ++v) {
+        mesh.offsets[v + 1] = mesh.offsets[v] + counts[v].load(std::memory_order_relaxed);
+        counts[v].store(mesh.offsets[v], std::memory_order_relaxed);
+    }
+    mesh.faces.resize(mesh.offsets[n_vertices]);
+    parallel_for(0, n_faces, [&](size_t f) {
+        if (mesh.corners[3 * f] == REMOVED) {
+            return;
+        }
+        for (size_t k = 0; k < 3; ++k) {
+            const uint32_t slot = counts[mesh.corners[3 * f + k]].fetch_add(1);
+            mesh.faces[slot]    = static_cast<uint32_t>(f);
+        }
+    });
+    parallel_for(0, n_vertices, [&](size_t v) {
+        std::sort(
+            mesh.faces.begin() + mesh.offsets[v], mesh.faces.begin() + mesh.offsets[v + 1]
+        );
+    });
+}
+
+// Collects the neighbors of v, each with the number of faces it shares with v. An edge shared by
+// only one face lies on the boundary.
+void one_ring(const DecimationMesh& mesh, uint32_t v, vector<pair<uint32_t, uint32_t>>& ring)
+{
+    ring.clear();
+    for (uint32_t i = mesh.offsets[v]; i < mesh.offsets[v + 1]; ++i) {
+        const uint32_t f = mesh.faces[i];
+        for (uint32_t k = 0; k < 3; ++k) {
+            const uint32_t w = mesh.corners[3 * f + k];
+            if (w == v) {
+                continue;
+            }
+            auto it = std::find_if(ring.begin(), ring.end(), [w](const auto& neighbor) {
+                return neighbor.first == w;
+            });
+            if (it == ring.end()) {
+                ring.emplace_back(w, 1);
+            } else {
+                ++it->second;
+            }
+        }
+    }
+}
+
+bool on_boundary(const vector<pair<uint32_t, uint32_t>>& ring)
+{
+    return std::any_of(ring.begin(), ring.end(), [](const auto& neighbor) {
+        return neighbor.second == 1;
+    });
+}
+
+Vector3f face_normal(const DecimationMesh& mesh, uint32_t f, uint32_t moved, const Vector3f& pos)
+{
+    Vector3f p[3];
+    for (uint32_t k = 0; k < 3; ++k) {
+        const uint32_t v = mesh.corners[3 * f + k];
+        p[k]             = v == moved ? pos : mesh.positions[v];
+    }
+    return (p[1] - p[0]).cross(p[2] - p[0]);
+}
+
+// Whether collapsing the edge between u and w into the given position keeps the mesh manifold
+// and flips no face over. The one-rings are scratch buffers reused between calls.
+bool collapsible(
+    const DecimationMesh& mesh, uint32_t u, uint32_t w, const Vector3f& pos,
+    vector<pair<uint32_t, uint32_t>>& ring_u, vector<pair<uint32_t, uint32_t>>& ring_w
+)
+{
+    one_ring(mesh, u, ring_u);
+    one_ring(mesh, w, ring_w);
+    // The link condition: the endpoints may only share the neighbors opposite to the edge.
+    uint32_t n_shared_faces     = 0;
+    uint32_t n_shared_neighbors = 0;
+    for (const auto& [x, count]: ring_u) {
+        if (x == w) {
+            n_shared_faces = count;
+            continue;
+        }
+        for (const auto& [y, unused]: ring_w) {
+            if (x == y) {
+                ++n_shared_neighbors;
+            }
+        }
+    }
+    if (n_shared_faces == 0 || n_shared_neighbors != n_shared_faces) {
+        return false;
+    }
+    // An interior edge joining two boundary vertices would pinch the surface into a non-manifold
+    // vertex.
+    if (n_shared_faces == 2 && on_boundary(ring_u) && on_boundary(ring_w)) {
+        return false;
+    }
+    // Faces that survive the collapse must not flip or degenerate.
+    for (const uint32_t v: {u, w}) {
+        for (uint32_t i = mesh.offsets[v]; i < mesh.offsets[v + 1]; ++i) {
+            const uint32_t  f = mesh.faces[i];
+            const uint32_t* c = &mesh.corners[3 * f];
+            if ((c[0] == u || c[1] == u || c[2] == u) && (c[0] == w || c[1] == w || c[2] == w)) {
+                continue;
+            }
+            const Vector3f before = face_normal(mesh, f, v, mesh.positions[v]);
+            const Vector3f after  = face_normal(mesh, f, v, pos);
+            if (before.dot(after) <= 0.0f) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Collapses the edge from w into u at the given position. Only the faces around u and w and the
+// two vertices are written, so edges far enough apart can be collapsed concurrently. Returns the
+// number of removed faces.
+uint32_t collapse(DecimationMesh& mesh, uint32_t u, uint32_t w, const Vector3f& pos)
+{
+    uint32_t n_removed = 0;
+    for (const uint32_t v: {u, w}) {
+        for (uint32_t i = mesh.offsets[v]; i < mesh.offsets[v + 1]; ++i) {
+            uint32_t* c = &mesh.corners[3 * mesh.faces[i]];
+            if (c[0] == REMOVED) {
+                continue;
+            }
+            const bool has_u = c[0] == u || c[1] == u || c[2] == u;
+            const bool has_w = c[0] == w || c[1] == w || c[2] == w;
+            if (has_u && has_w) {
+                c[0] = c[1] = c[2] = REMOVED;
+                ++n_removed;
+            } else if (has_w) {
+                std::replace(c, c + 3, w, u);
+            }
+        }
+    }
+    mesh.positions[u] = pos;
+    mesh.quadrics[u] += mesh.quadrics[w];
+    return n_removed;
+}
+
+} // namespace
+
+void HalfedgeMesh::parallel_simplify(size_t target_faces, float max_error)
+{
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
+    if (check_result.has_value()) {
+        return;
+    }
+    time_point begin_time = steady_clock::now();
+    logger->info("simplify object {} (ID: {}) in parallel", object.name, object.id);
+    logger->info("original mesh: {} vertices, {} faces", vertices.size, faces.size);
+
+    // Copy the mesh into flat arrays.
+    DecimationMesh   mesh;
+    vector<uint32_t> vertex_map(vertices.capacity());
+    for (Vertex* v: vertices) {
+        vertex_map[v->index] = static_cast<uint32_t>(mesh.positions.size());
+        mesh.positions.push_back(v->pos);
+    }
+    for (Face* f: faces) {
+        if (f->is_boundary) {
+            continue;
+        }
+        const Halfedge* h = f->halfedge;
+        if (h->next->next->next != h) {
+            logger->warn(
+                "face {} is not a triangle, parallel simplification is not applicable", f->id
+            );
+            return;
+        }
+        for (size_t k = 0; k < 3; ++k) {
+            mesh.corners.push_back(vertex_map[h->from->index]);
+            h = h->next;
+        }
+    }
+    const size_t n_vertices = mesh.positions.size();
+    size_t       n_faces    = mesh.corners.size() / 3;
+    if (target_faces == 0) {
+        target_faces = n_faces / 4;
+    }
+
+    // Compute the initial quadric of each vertex from the planes of its faces.
+    build_adjacency(mesh);
+    mesh.quadrics.resize(n_vertices);
+    parallel_for(0, n_vertices, [&](size_t v) {
+        for (uint32_t i = mesh.offsets[v]; i < mesh.offsets[v + 1]; ++i) {
+            Vector3f normal = face_normal(mesh, mesh.faces[i], REMOVED, Vector3f::Zero());
+            // Degenerate faces have no plane and are skipped.
+            if (normal.squaredNorm() > 0.0f) {
+                normal.normalize();
+                mesh.quadrics[v] += Quadric(Vector4f(
+                    normal.x(), normal.y(), normal.z(), -normal.dot(mesh.positions[v])
+                ));
+            }
+        }
+    });
+
+    vector<Priority> best(n_vertices);
+    vector<uint32_t> best_target(n_vertices);
+    vector<Vector3f> best_pos(n_vertices);
+    vector<Priority> near_best(n_vertices);
+    vector<Priority> ring_best(n_vertices);
+    vector<float>    costs;
+    const size_t     n_chunks = parallel_chunk_count(n_vertices, 0);
+    size_t           n_rounds = 0;
+    while (n_faces > target_faces) {
+        ++n_rounds;
+        if (n_rounds > 1) {
+            build_adjacency(mesh);
+        }
+        // 1. Every vertex finds its cheapest edge that can be collapsed.
+        parallel_for_chunks(0, n_vertices, [&](size_t first, size_t last, size_t) {
+            vector<pair<uint32_t, uint32_t>> ring;
+            vector<pair<uint32_t, uint32_t>> ring_v;
+            vector<pair<uint32_t, uint32_t>> ring_w;
+            for (size_t index = first; index < last; ++index) {
+                const uint32_t v = static_cast<uint32_t>(index);
+                best[v]          = NO_PRIORITY;
+                one_ring(mesh, v, ring);
+                for (const auto& [w, count]: ring) {
+                    const uint32_t a   = std::min(v, w);
+                    const uint32_t b   = std::max(v, w);
+                    const Quadric  q   = mesh.quadrics[a] + mesh.quadrics[b];
+                    const Vector3f pos = q.optimal_point(mesh.positions[a], mesh.positions[b]);
+                    // Ties between equal costs are common on flat regions. Scrambling the edge
+                    // key breaks them in a pseudo-random rather than spatially coherent order,
+                    // otherwise the lowest-numbered vertices would block the whole neighborhood
+                    // and each round would select very few edges.
+                    const Priority priority{q.error(pos), mix_bits(edge_key(a, b))};
+                    if (priority < best[v] && collapsible(mesh, v, w, pos, ring_v, ring_w)) {
+                        best[v]        = priority;
+                        best_target[v] = w;
+                        best_pos[v]    = pos;
+                    }
+                }
+            }
+        });
+        // 2. Only the cheapest candidates within the error bound take part in this round.
+        costs.clear();
+        for (size_t v = 0; v < n_vertices; ++v) {
+            if (best[v].cost <= max_error) {
+                costs.push_back(best[v].cost);
+            }
+        }
+        if (costs.empty()) {
+            break;
+        }
+        const size_t n_needed = (n_faces - target_faces + 1) / 2;
+        const size_t n_taken  = std::min(n_needed, costs.size() / ROUND_FRACTION + 1);
+        std::nth_element(costs.begin(), costs.begin() + (n_taken - 1), costs.end());
+        const float threshold = costs[n_taken - 1];
+        // 3. Select an independent set: a candidate wins if no other candidate touching the
+        // one-rings of its endpoints is cheaper, hence the winners share neither faces nor
+        // neighbors whose connectivity they change.
+        parallel_for(0, n_vertices, [&](size_t v) {
+            near_best[v] = best[v].cost <= threshold ? best[v] : NO_PRIORITY;
+        });
+        parallel_for(0, n_vertices, [&](size_t v) {
+            Priority result = near_best[v];
+            for (uint32_t i = mesh.offsets[v]; i < mesh.offsets[v + 1]; ++i) {
+                for (uint32_t k = 0; k < 3; ++k) {
+                    const uint32_t x = mesh.corners[3 * mesh.faces[i] + k];
+                    if (best_target[x] == v && near_best[x] < result) {
+                        result = near_best[x];
+                    }
+                }
+            }
+            ring_best[v] = result;
+        });
+        parallel_for(0, n_vertices, [&](size_t v) {
+            Priority result = ring_best[v];
+            for (uint32_t i = mesh.offsets[v]; i < mesh.offsets[v + 1]; ++i) {
+                for (uint32_t k = 0; k < 3; ++k) {
+                    result = std::min(result, ring_best[mesh.corners[3 * mesh.faces[i] + k]]);
+                }
+            }
+            near_best[v] = result;
+        });
+        // 4. Collapse the winners concurrently, each by the endpoint that proposed it. Nothing
+        // around a winner has changed since it was checked in step 1.
+        vector<size_t> removed(n_chunks, 0);
+        parallel_for_chunks(0, n_vertices, [&](size_t first, size_t last, size_t chunk) {
+            for (size_t index = first; index < last; ++index) {
+                const uint32_t u = static_cast<uint32_t>(index);
+                const uint32_t w = best_target[u];
+                if (best[u] == NO_PRIORITY || best[u].cost > threshold
+                    || !(best[u] == near_best[u]) || !(best[u] == near_best[w])) {
+                    continue;
+                }
+                // Both endpoints may have proposed the same edge, the smaller one collapses it.
+                if (best_target[w] == u && best[w] == best[u] && w < u) {
+                    continue;
+                }
+                removed[chunk] += collapse(mesh, u, w, best_pos[u]);
+            }
+        });
+        size_t n_removed = 0;
+        for (const size_t count: removed) {
+            n_removed += count;
+        }
+        logger->debug("round {}: {} faces removed", n_rounds, n_removed);
+        if (n_removed == 0) {
+            break;
+        }
+        n_faces -= n_removed;
+    }
+
+    // Keep the vertices still referenced by some face and rebuild the halfedge mesh.
+    vector<uint32_t>     new_indices(n_vertices, REMOVED);
+    vector<float>        positions;
+    vector<unsigned int> indices;
+    indices.reserve(3 * n_faces);
+    for (const uint32_t v: mesh.corners) {
+        if (v == REMOVED) {
+            continue;
+        }
+        if (new_indices[v] == REMOVED) {
+            new_indices[v] = static_cast<uint32_t>(positions.size() / 3);
+            const float* position = mesh.positions[v].data();
+            positions.insert(positions.end(), position, position + 3);
+        }
+        indices.push_back(new_indices[v]);
+    }
+    record_rebuild();
+    halfedges.clear();
+    vertices.clear();
+    edges.clear();
+    faces.clear();
+    build(positions, indices);
+    global_inconsistent = true;
+
+    const duration simplification_duration = steady_clock::now() - begin_time;
+    logger->info(
+        "simplified mesh: {} vertices, {} faces in {} rounds ({:.3f} seconds)", vertices.size,
+        faces.size, n_rounds, simplification_duration.count()
+    );
+    logger->info("parallel simplification done");
+    logger->info("");
+    validate_by_level();
+}
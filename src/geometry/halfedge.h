@@ -2,19 +2,24 @@
 #define DANDELION_GEOMETRY_HALFEDGE_H
 
 #include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <limits>
 #include <set>
 #include <memory>
 #include <optional>
 #include <variant>
 #include <tuple>
+#include <vector>
 #include <unordered_map>
+#include <unordered_set>
 
 #include <Eigen/Core>
 #include <spdlog/spdlog.h>
 
 #include "../platform/gl.hpp"
 #include "../platform/shader.hpp"
-#include "../utils/linked_list.hpp"
+#include "../utils/element_pool.hpp"
 #include "../scene/object.h"
 
 /*!
@@ -42,7 +47,7 @@ struct Face;
  * 半边网格中，所有几何元素都通过半边相互连接。Halfedge 类维护了每条半边的起点、所属的边和面片、
  * 在整个半边网格上的下一条（前一条、反向）半边，从而将所有的几何基本元素联系在一起。
  */
-struct Halfedge : LinkedListNode<Halfedge>
+struct Halfedge : PoolElement
 {
     /*! \~chinese 仅供 `HalfedgeMesh::new_halfedge` 调用，其他任何情况下都不应该直接使用。 */
     Halfedge(std::size_t halfedge_id);
@@ -82,7 +87,7 @@ struct Halfedge : LinkedListNode<Halfedge>
  *
  * 半边网格中，每个顶点只维护自身的坐标和某一条从自身发出的半边。
  */
-struct Vertex : LinkedListNode<Vertex>
+struct Vertex : PoolElement
 {
     /*! \~chinese 仅供 `HalfedgeMesh::new_vertex` 调用，其他任何情况下都不应该直接使用。 */
     Vertex(std::size_t vertex_id);
@@ -114,7 +119,7 @@ struct Vertex : LinkedListNode<Vertex>
  *
  * 半边网格中，每条边只维护属于自身的某一条半边。
  */
-struct Edge : LinkedListNode<Edge>
+struct Edge : PoolElement
 {
     /*! \~chinese 仅供 `HalfedgeMesh::new_edge` 调用，其他任何情况下都不应该直接使用。 */
     Edge(std::size_t edge_id);
@@ -147,7 +152,7 @@ struct Edge : LinkedListNode<Edge>
  *
  * 半边网格中，每个面片只维护属于自身的某一条半边。
  */
-struct Face : LinkedListNode<Face>
+struct Face : PoolElement
 {
     /*! \~chinese 仅供 `HalfedgeMesh::new_face` 调用，其他任何情况下都不应该直接使用。 */
     Face(std::size_t face_id, bool is_boundary = false);
@@ -205,6 +210,26 @@ enum class HalfedgeMeshFailure
     POOR_HALFEDGE_ACCESSIBILITY
 };
 
+/*!
+ * \ingroup geometry
+ * \~chinese
+ * \brief 半边网格在各种操作前后接受检查的程度。
+ *
+ * - FULL 调用完整的 `HalfedgeMesh::validate` ，它需要为所有元素建立可访问性集合，适合调试。
+ * - LOCAL 只检查操作涉及的元素：局部操作之后只检查被修改的一环邻域；全局操作涉及所有元素，
+ *   对它们逐个做同样的局部检查，不需要任何集合，并且可以并行执行。
+ * - OFF 不做任何检查。
+ *
+ * 局部检查能发现悬垂指针、错误的 `next` / `prev` / `inv` 关系、元素与半边的连接错误和
+ * 无法访问的半边，但不能发现与检查范围无关的错误。
+ */
+enum class ValidationLevel
+{
+    FULL,
+    LOCAL,
+    OFF
+};
+
 /*!
  * \ingroup geometry
  * \~chinese
@@ -214,8 +239,13 @@ enum class HalfedgeMeshFailure
  * 从而支持各种基于半边网格的几何算法。当几何操作完成后，需要将半边网格的几何信息
  * （坐标、连接关系等）同步到原先的 mesh，这样才能显示操作带来的变化。
  *
- * 各种全局操作往往需要频繁增删几何元素，为了保证 \f$O(1)\f$ 的增删效率，
- * 所有的几何元素都存储于双向链表 (`LinkedList`) 中。
+ * 各种全局操作往往需要频繁增删几何元素，为了在保证 \f$O(1)\f$ 增删效率的同时让遍历保持缓存友好，
+ * 每种几何元素都存储于连续的元素池 (`ElementPool`) 中：删除的元素在下一次检查（见 `validate`
+ * 和 `validation_level` ）之后进入空闲链表供新元素复用，全局同步时则压缩元素池，
+ * 使遍历始终是一次线性扫描。
+ * 元素的 `index` 是它在所属元素池中的 32 位句柄，可以用作数组下标来存放逐元素的数据。
+ *
+ * 每次编辑操作修改过的元素被记录在操作日志中（见 `begin_edit` ），从而支持撤销和重做。
  */
 class HalfedgeMesh
 {
@@ -225,14 +255,52 @@ public:
     HalfedgeMesh(Object& object);
     /*! \~chinese 全局只有一个半边网格实例，因此不允许复制构造。 */
     HalfedgeMesh(HalfedgeMesh& other) = delete;
-    /*! \~chinese 析构时会调用 `clear_erasure_records` 释放所有已删除元素占据的内存。 */
+    /*! \~chinese 所有元素占据的内存都由元素池释放。 */
     ~HalfedgeMesh();
-    /*! \~chinese 将当前半边网格的几何结构同步到数据源 mesh。 */
+    /*!
+     * \~chinese
+     * \brief 将当前半边网格的几何结构同步到数据源 mesh。
+     *
+     * 没有全局修改时，只有被选中元素移动过的顶点会被标记为脏顶点（见 `mark_dirty` ），
+     * 随后只重新计算受影响的顶点法线和半边箭头，并把改动合并成若干段连续的区间上传显存。
+     *
+     * 全局同步时，如果没有选中任何元素，会先压缩所有元素池（见 `compact` ）；
+     * 然后在内存中重建 mesh 和半边箭头的全部数据，与同步前的数据比较后只上传发生变化的区间，
+     * 数据长度改变的缓冲区才会整体上传。
+     */
     void sync();
     /*! \~chinese 渲染所有的半边（不负责渲染顶点、边和面片）。 */
     void render(const Shader& shader);
     /*! \~chinese 返回绘制半边时的起点和终点坐标。 */
     static std::tuple<Eigen::Vector3f, Eigen::Vector3f> halfedge_arrow_endpoints(const Halfedge* h);
+    /*!
+     * \~chinese
+     * \brief 检查半边网格的状态。
+     *
+     * 这个函数可以检查半边网格中的连接关系是否正确、指针是否悬垂，有助于及时发现错误。
+     * 错误信息会被输出到日志，并返回一个错误枚举值（参考 `HalfedgeMeshFailure` 类的说明）。
+     * 无论 `validation_level` 为何值，这个函数总是检查整个网格。
+     * \returns 如果发现错误，返回相应的错误枚举值；反之为 `std::nullopt`
+     */
+    std::optional<HalfedgeMeshFailure> validate();
+    /*!
+     * \~chinese
+     * \brief 在修改了 `v` 的一环邻域的局部操作之后，按 `validation_level` 检查半边网格。
+     *
+     * 级别为 LOCAL 时只检查包含 `v` 的面片、这些面片上的半边和边，以及这些面片的所有顶点，
+     * 这已经覆盖了分裂边和坍缩边修改的全部元素。
+     *
+     * \param v 分裂边得到的新顶点或坍缩边后保留的顶点
+     * \returns 与 `validate` 相同，级别为 OFF 时总是 `std::nullopt`
+     */
+    std::optional<HalfedgeMeshFailure> validate_around(Vertex* v);
+    /*!
+     * \~chinese
+     * \brief 在修改了边 `e` 两侧面片的局部操作之后，按 `validation_level` 检查半边网格。
+     *
+     * 级别为 LOCAL 时检查 `e` 的两个端点的一环邻域，翻转边修改的元素都在其中。
+     */
+    std::optional<HalfedgeMeshFailure> validate_around(Edge* e);
     /*!
      * \~chinese
      * \brief 翻转一条边。
@@ -279,6 +347,17 @@ public:
      * 等 API 来判断 mesh 边界并进行处理。
      */
     void loop_subdivide();
+    /*!
+     * \~chinese
+     * \brief 并行地执行 `n_levels` 次 Loop 曲面细分。
+     *
+     * 与 `loop_subdivide` 在网格上逐条分裂、翻转边不同，这个函数把网格复制到扁平数组中，
+     * 并行计算每一层新旧顶点的位置，再按照每个三角形一分为四的固定模式直接写出下一层的连接关系
+     * （对偶半边和边的编号都可以由上一层推出，不需要查找），最后一次性重建整个半边网格。
+     *
+     * 重建会销毁所有原有元素，因此调用前应该取消选中。只能细分三角网格。
+     */
+    void parallel_loop_subdivide(std::size_t n_levels = 1);
     /*!
      * \~chinese
      * \brief 执行一次曲面简化。
@@ -288,6 +367,39 @@ public:
      * 或找不到可以坍缩的边为止。
      */
     void simplify();
+    /*!
+     * \~chinese
+     * \brief 用可按编号更新的堆执行曲面简化。
+     *
+     * 与 `simplify` 一样根据 QEM 确定损失最小的边并用 `collapse_edge` 坍缩它，
+     * 直至面数不超过 `target_faces` 、损失最小的边的误差超过 `max_error` 或找不到可以坍缩的边为止。
+     * 边界边额外贡献一个经过它且垂直于所在面片的平面，使边界顶点留在原来的边界上。
+     *
+     * 顶点的二次误差矩阵按句柄存放在连续数组中，所有边的坍缩记录放在以边的句柄为编号的
+     * `IndexedHeap` 中，每次坍缩后只需原地更新新顶点周围的边，整个过程的时间复杂度为
+     * \f$O(n\log n)\f$ 。坍缩可能删除被选中的元素，因此调用前应该取消选中。
+     *
+     * \param target_faces 目标面数，为 0 表示简化前面数的 1/4
+     * \param max_error 允许的最大坍缩误差（到原始平面的距离平方和）
+     */
+    void heap_simplify(
+        std::size_t target_faces = 0, float max_error = std::numeric_limits<float>::infinity()
+    );
+    /*!
+     * \~chinese
+     * \brief 按轮次并行地执行曲面简化。
+     *
+     * 每一轮中每个顶点先在满足连接条件 (link condition) 且坍缩后不会翻转面片的边中，
+     * 按 QEM 误差选出与它相连的最佳边，再只保留误差最小的一部分候选边，从中选出一个独立集：
+     * 一条边只有在它的两个端点的一环邻域内没有更优的候选边时才被选中，
+     * 因此被选中的边互不影响，可以同时坍缩。
+     *
+     * 简化在扁平的三角形数组上进行，最后一次性重建整个半边网格，因此调用前应该取消选中。
+     * 只能简化三角网格，参数含义与 `heap_simplify` 相同。
+     */
+    void parallel_simplify(
+        std::size_t target_faces = 0, float max_error = std::numeric_limits<float>::infinity()
+    );
     /*!
      * \~chinese
      * \brief 执行一次重网格化。
@@ -302,14 +414,99 @@ public:
      * 各向同性重网格化只能应用于三角形网格。
      */
     void isotropic_remesh();
+    /*!
+     * \~chinese
+     * \brief 并行地执行各向同性重网格化。
+     *
+     * 每次迭代的步骤与 `isotropic_remesh` 相同，但都在扁平的三角形数组上进行：
+     * 过长和过短的边由各线程并行收集，再按轮次选出互不相邻的独立集同时分裂或坍缩；
+     * 翻转边和切向平滑则先对顶点着色（翻转时距离 2 以内、平滑时相邻的顶点颜色不同），
+     * 再逐个颜色并行处理，因此任意两个线程都不会同时修改同一个一环邻域。
+     * 边界顶点保持不动。
+     *
+     * 最后一次性重建整个半边网格，因此调用前应该取消选中。只能处理三角网格。
+     *
+     * \param n_iterations 迭代次数
+     * \param target_length 目标边长，为 0 表示使用当前的平均边长；
+     * 长于它的 4/3 的边会被分裂，短于它的 4/5 的边会被坍缩
+     */
+    void parallel_isotropic_remesh(std::size_t n_iterations = 5, float target_length = 0.0f);
+    /*!
+     * \~chinese
+     * \brief 开始记录一次编辑操作。
+     *
+     * 从此时到 `end_edit` 之间，被创建、删除或修改的元素在第一次被触及时保存修改前的状态，
+     * 因此一条记录占用的内存只与操作涉及的元素数量成正比，而不是整个网格的大小。
+     * 创建和删除元素由 `new_halfedge` 、`erase` 等函数自动记录；直接修改元素的属性之前，
+     * 则需要先调用 `record_around` （只修改顶点坐标时调用 `record_position` ）保存相关元素。
+     * 全局操作会自行记录：逐条坍缩边的 `heap_simplify` 只记录每次坍缩涉及的元素，
+     * 修改几乎所有元素或整体重建网格的操作只保存操作前的顶点坐标和三角形索引。
+     *
+     * 所有修改网格的操作都应该位于 `begin_edit` 和 `end_edit` 之间，
+     * 否则撤销时恢复的状态与网格的实际状态不符，这时应当调用 `clear_history` 。
+     * `max_history` 为 0 时不做任何记录。
+     */
+    void begin_edit();
+    /*!
+     * \~chinese
+     * \brief 在记录编辑操作时，保存边 `e` 的两个端点周围所有元素的当前状态。
+     *
+     * 保存的范围是包含任意一个端点的面片、这些面片上的半边和边，以及这些面片的所有顶点，
+     * 翻转、分裂和坍缩 `e` 修改的元素都在其中。没有正在记录的操作时什么也不做。
+     */
+    void record_around(Edge* e);
+    /*!
+     * \~chinese
+     * \brief 在记录编辑操作时，保存顶点 `v` 的当前状态，直接修改顶点坐标之前调用。
+     *
+     * 没有正在记录的操作时什么也不做。
+     */
+    void record_position(Vertex* v);
+    /*!
+     * \~chinese
+     * \brief 结束记录，把这次操作加入撤销历史并清空重做历史。
+     *
+     * 只有操作结束时状态确实改变了的元素会被留在记录中；没有改变任何元素的操作不会留下记录。
+     * 历史中的记录超过 `max_history` 条时，最早的记录被丢弃。
+     */
+    void end_edit();
+    /*!
+     * \~chinese
+     * \brief 放弃正在记录的操作，把网格恢复到 `begin_edit` 时的状态。
+     *
+     * 用于局部操作之后检查失败的情况：被修改的元素恢复原状，新建的元素被删除，
+     * 撤销和重做历史保持不变。没有正在记录的操作（例如 `max_history` 为 0）时无法恢复。
+     * \returns 是否恢复了网格
+     */
+    bool cancel_edit();
+    /*!
+     * \~chinese
+     * \brief 撤销最近一次记录的操作。
+     *
+     * 撤销和重做都是把记录中保存的状态与元素的当前状态互换：已删除的元素在原来的槽位上恢复，
+     * 新建的元素被删除，修改过的元素恢复原来的连接关系和坐标。整体重建网格的操作则会用保存的
+     * 顶点坐标和三角形索引再次重建网格，这会销毁所有元素，因此另一个方向上的历史都被丢弃。
+     *
+     * 被恢复的元素可能已被删除，调用前应该取消选中。
+     * \returns 是否有可以撤销的操作
+     */
+    bool undo();
+    /*! \~chinese 重做最近一次被撤销的操作，与 `undo` 对称。 */
+    bool redo();
+    /*! \~chinese 是否有可以撤销的操作。 */
+    bool can_undo() const;
+    /*! \~chinese 是否有可以重做的操作。 */
+    bool can_redo() const;
+    /*! \~chinese 丢弃所有撤销和重做历史。 */
+    void clear_history();
     /*! \~chinese 所有半边。 */
-    LinkedList<Halfedge> halfedges;
+    ElementPool<Halfedge> halfedges;
     /*! \~chinese 所有顶点。 */
-    LinkedList<Vertex> vertices;
+    ElementPool<Vertex> vertices;
     /*! \~chinese 所有边。 */
-    LinkedList<Edge> edges;
+    ElementPool<Edge> edges;
     /*! \~chinese 所有面片。 */
-    LinkedList<Face> faces;
+    ElementPool<Face> faces;
     /*! \~chinese 将 `GL::Mesh` 使用的顶点索引映射为半边网格中的顶点指针。 */
     std::vector<Vertex*> v_pointers;
     /*!
@@ -318,12 +515,23 @@ public:
      *
      * 在 GUI 上选中了半边网格中的某个元素后，控制器将设置该属性，`sync`
      * 函数根据该属性的值在每一帧更新数据源 mesh 中的顶点坐标，让建模模式下可以实时预览形变效果。
+     * 选中半边不会改变任何坐标，记录它只是为了在选中期间推迟压缩元素池，以免控制器持有的指针失效。
      */
-    std::variant<std::monostate, Vertex*, Edge*, Face*> inconsistent_element;
+    std::variant<std::monostate, const Halfedge*, Vertex*, Edge*, Face*> inconsistent_element;
     /*! \~chinese 全局一致性。成功完成一次全局操作后，此变量将置为真，表示需要同步到参照 mesh。 */
     bool global_inconsistent;
     /*! \~chinese 在创建半边网格时设置，如果创建正常则为 `std::nullopt`。 */
     std::optional<HalfedgeMeshFailure> error_info;
+    /*!
+     * \~chinese
+     * \brief 所有半边网格的检查级别，可以在运行时修改。
+     *
+     * Debug 构建默认为 FULL，其他构建默认为 LOCAL，
+     * 这样编辑巨大的网格时每次操作不必付出一次完整检查的代价。
+     */
+    static ValidationLevel validation_level;
+    /*! \~chinese 所有半边网格最多保留的撤销记录数，为 0 时不记录任何操作。 */
+    static std::size_t max_history;
 
 private:
 
@@ -347,6 +555,43 @@ private:
         float cost;
     };
 
+    /*!
+     * \~chinese
+     * \brief 操作日志中一个元素在某一时刻的状态。
+     *
+     * 元素由它的槽位地址标识，因为删除的元素在撤销时还要回到原来的槽位上。
+     */
+    template<typename Node>
+    struct Snapshot
+    {
+        /*! \~chinese 元素所在的槽位。 */
+        Node* node;
+        /*! \~chinese 元素在这一时刻是否存活。 */
+        bool alive;
+        /*! \~chinese 元素在这一时刻的内容，元素不存活时没有意义。 */
+        Node content;
+    };
+
+    /*!
+     * \~chinese
+     * \brief 操作日志中的一条记录，保存一次操作所修改元素的另一个状态。
+     *
+     * 位于撤销历史中时保存操作之前的状态，位于重做历史中时保存操作之后的状态。
+     */
+    struct JournalEntry
+    {
+        std::vector<Snapshot<Halfedge>> halfedges;
+        std::vector<Snapshot<Vertex>>   vertices;
+        std::vector<Snapshot<Edge>>     edges;
+        std::vector<Snapshot<Face>>     faces;
+        /*! \~chinese 这次操作是否整体重建了网格，此时只保存下面的顶点坐标和三角形索引。 */
+        bool rebuilt = false;
+        /*! \~chinese 依次存放的顶点坐标。 */
+        std::vector<float> positions;
+        /*! \~chinese 依次存放的三角形顶点索引。 */
+        std::vector<unsigned int> indices;
+    };
+
     /*! \~chinese 排序 `EdgeRecord` 所需的比较运算符重载。 */
     friend bool operator<(const EdgeRecord& a, const EdgeRecord& b);
     /*! \~chinese 创建一条半边。 */
@@ -357,8 +602,37 @@ private:
     Edge* new_edge();
     /*! \~chinese 创建一个面片，可以是真实存在的面片也可以是代表边界的虚拟面片。 */
     Face* new_face(bool is_boundary = false);
+    /*!
+     * \~chinese
+     * \brief 从顶点坐标和三角形索引创建所有元素，构造函数和需要整体重建网格的操作都使用它。
+     *
+     * 调用前所有元素池都应为空。创建失败时 `error_info` 记录失败原因。
+     *
+     * \param positions 依次存放的顶点坐标，每个顶点 3 个数
+     * \param indices 依次存放的三角形顶点索引，每个面片 3 个数
+     */
+    void build(const std::vector<float>& positions, const std::vector<unsigned int>& indices);
     /*! \~chinese 重新生成所有半边对应的箭头，在更新绘制数据时使用。 */
     void regenerate_halfedge_arrows();
+    /*!
+     * \~chinese
+     * \brief 为所有边界环创建虚拟面片。
+     *
+     * 调用前，所有真实面片的半边都应已连接好，只有边界上的半边没有对偶半边 ( `inv` 为空)。
+     * 这个函数先把每个边界顶点的 `halfedge` 调整为边界上的半边，再沿每个边界环创建对偶半边、
+     * 代表边界环的虚拟面片，以及还不存在的边。
+     */
+    void create_boundary_loops();
+    /*!
+     * \~chinese
+     * \brief 将一个顶点标记为脏顶点。
+     *
+     * 顶点本身、以及所有包含它的面片（包括虚拟的边界面）都会被记录下来，
+     * 这些面片决定了需要重新计算法线的顶点和需要更新的半边箭头。
+     */
+    void mark_dirty(Vertex* v);
+    /*! \~chinese 同步所有脏顶点及其影响到的法线和半边箭头，然后清空脏元素记录。 */
+    void sync_dirty_elements();
     /*! \~chinese 删除一条半边。 */
     void erase(Halfedge* h);
     /*! \~chinese 删除一个顶点。 */
@@ -369,20 +643,72 @@ private:
     void erase(Face* f);
     /*!
      * \~chinese
-     * \brief 释放内存并清除已删除元素的记录。
+     * \brief 清除已删除元素的记录。
      *
-     * 这个函数执行 `delete` 释放内存，并清空各 `erased_[elements]` 容器中存储的删除记录。
+     * 这个函数将各元素池中已删除元素的槽位放入空闲链表，此后这些槽位可能被新元素复用，
+     * 指向已删除元素的悬垂指针将无法再被 `validate` 检测出来。
      */
     void clear_erasure_records();
     /*!
      * \~chinese
-     * \brief 检查半边网格的状态。
+     * \brief 压缩所有元素池。
      *
-     * 这个函数可以检查半边网格中的连接关系是否正确、指针是否悬垂，有助于及时发现错误。
-     * 错误信息会被输出到日志，并返回一个错误枚举值（参考 `HalfedgeMeshFailure` 类的说明）。
-     * \returns 如果发现错误，返回相应的错误枚举值；反之为 `std::nullopt`
+     * 存活元素按原有顺序移动到各元素池最前面的槽位，元素之间的指针随之更新；
+     * `v_pointers` 和半边网格之外持有的元素指针则会失效，因此只应在全局同步开始、
+     * 没有选中任何元素时调用。操作日志中的指针同样会被更新，日志中仍然引用的已删除槽位
+     * 会被保留下来，以便撤销时恢复。
      */
-    std::optional<HalfedgeMeshFailure> validate();
+    void compact();
+    /*!
+     * \~chinese
+     * \brief 在全局操作开始和结束时按 `validation_level` 检查整个半边网格。
+     *
+     * 级别为 LOCAL 时并行地对每个顶点和面片做局部检查，发现错误后再逐个检查出错的元素，
+     * 把错误信息输出到日志。
+     */
+    std::optional<HalfedgeMeshFailure> validate_by_level();
+    /*!
+     * \~chinese
+     * \brief 检查给定顶点周围的所有面片、这些面片上的半边和边，以及这些面片的所有顶点。
+     *
+     * 检查通过后与 `validate` 一样回收已删除元素的槽位。
+     */
+    std::optional<HalfedgeMeshFailure> validate_locally(const std::vector<Vertex*>& seeds);
+    /*!
+     * \~chinese
+     * \brief 在记录编辑操作时，保存一个元素在这次操作中第一次被触及之前的状态。
+     *
+     * \param created 元素是否刚刚被创建，此时它之前的状态是不存活
+     */
+    void record(Halfedge* h, bool created = false);
+    /*! \~chinese 同上。 */
+    void record(Vertex* v, bool created = false);
+    /*! \~chinese 同上。 */
+    void record(Edge* e, bool created = false);
+    /*! \~chinese 同上。 */
+    void record(Face* f, bool created = false);
+    /*!
+     * \~chinese
+     * \brief 在整体重建网格或修改几乎所有元素之前调用，保存当前的顶点坐标和三角形索引。
+     *
+     * 撤销这样的操作时会用保存的数据重建网格，这会销毁所有元素，之前的记录都无法再使用，
+     * 因此撤销历史会被清空；没有正在记录的操作时也是如此。
+     */
+    void record_rebuild();
+    /*! \~chinese 把记录与元素的当前状态互换，撤销和重做都使用它。 */
+    void apply(JournalEntry& entry);
+    /*! \~chinese 把当前网格导出为顶点坐标和三角形索引，顶点按遍历顺序编号。 */
+    void flatten(std::vector<float>& positions, std::vector<unsigned int>& indices) const;
+    /*! \~chinese 列出日志中仍然引用的已删除槽位，压缩时需要保留它们。 */
+    void journal_dead_slots(
+        std::vector<std::uint32_t>& h_kept, std::vector<std::uint32_t>& v_kept,
+        std::vector<std::uint32_t>& e_kept, std::vector<std::uint32_t>& f_kept
+    ) const;
+    /*! \~chinese 压缩元素池之前，按照各元素池的压缩映射修正日志中的所有指针。 */
+    void relocate_journal(
+        const std::vector<std::uint32_t>& h_map, const std::vector<std::uint32_t>& v_map,
+        const std::vector<std::uint32_t>& e_map, const std::vector<std::uint32_t>& f_map
+    );
 
     /*! \~chinese 用于构造半边网格几何元素时分配新的唯一 ID。 */
     static std::size_t next_available_id;
@@ -390,21 +716,24 @@ private:
     Object& object;
     /*! \~chinese 数据源 mesh，用于构造半边网格，需要同步修改。 */
     GL::Mesh& mesh;
-    /*! \~chinese 已删除的半边。 */
-    std::unordered_map<size_t, Halfedge*> erased_halfedges;
-    /*! \~chinese 已删除的顶点。 */
-    std::unordered_map<size_t, Vertex*> erased_vertices;
-    /*! \~chinese 已删除的边。 */
-    std::unordered_map<size_t, Edge*> erased_edges;
-    /*! \~chinese 已删除的面。 */
-    std::unordered_map<size_t, Face*> erased_faces;
-
-    /*! \~chinese 将半边网格中的顶点指针映射为 `GL::Mesh` 使用的顶点索引。 */
-    std::unordered_map<const Vertex*, size_t> v_indices;
-    /*! \~chinese 将半边网格的半边指针映射为 `GL::LineSet` 中的箭头索引。 */
-    std::unordered_map<const Halfedge*, size_t> h_indices;
+    /*! \~chinese 以顶点句柄为下标，记录每个顶点在 `GL::Mesh` 中的顶点索引。 */
+    std::vector<std::uint32_t> v_indices;
+    /*! \~chinese 以半边句柄为下标，记录每条半边在 `GL::LineSet` 中的箭头索引。 */
+    std::vector<std::uint32_t> h_indices;
+    /*! \~chinese 自上次同步以来移动过的顶点的句柄。 */
+    std::vector<std::uint32_t> dirty_vertices;
+    /*! \~chinese 包含脏顶点的面片的句柄，可能重复。 */
+    std::vector<std::uint32_t> dirty_faces;
     /*! \~chinese 用于渲染半边的 `LineSet` 对象。 */
     GL::LineSet halfedge_arrows;
+    /*! \~chinese 撤销历史，最近的操作在末尾。 */
+    std::deque<JournalEntry> undo_history;
+    /*! \~chinese 重做历史，最近被撤销的操作在末尾。 */
+    std::vector<JournalEntry> redo_history;
+    /*! \~chinese 正在记录的操作。 */
+    std::optional<JournalEntry> current_edit;
+    /*! \~chinese 正在记录的操作已经保存过的元素。 */
+    std::unordered_set<const void*> recorded_elements;
     /*! \~chinese 日志记录器。 */
     std::shared_ptr<spdlog::logger> logger;
 };
@@ -1,6 +1,7 @@
 #include "halfedge.h"
 
-#include <map>
+#include <algorithm>
+#include <atomic>
 #include <unordered_map>
 #include <array>
 #include <vector>
@@ -12,12 +13,11 @@
 
 #include "../utils/logger.h"
 #include "../utils/math.hpp"
+#include "../utils/parallel.hpp"
 
 using Eigen::Matrix4f;
 using Eigen::Vector3f;
 using std::array;
-using std::make_pair;
-using std::map;
 using std::monostate;
 using std::optional;
 using std::pair;
@@ -25,11 +25,18 @@ using std::set;
 using std::size_t;
 using std::string;
 using std::tuple;
+using std::uint32_t;
+using std::uint64_t;
 using std::unordered_map;
 using std::vector;
 using std::visit;
 
 size_t HalfedgeMesh::next_available_id = 0;
+#ifdef DEBUG
+ValidationLevel HalfedgeMesh::validation_level = ValidationLevel::FULL;
+#else
+ValidationLevel HalfedgeMesh::validation_level = ValidationLevel::LOCAL;
+#endif
 
 template<class... Ts>
 struct overloaded : Ts...
@@ -39,117 +46,263 @@ struct overloaded : Ts...
 template<class... Ts>
 overloaded(Ts...) -> overloaded<Ts...>;
 
+namespace {
+
+// The ID of an element for diagnostics. Compacting a pool nulls pointers to erased elements, so
+// the pointer that failed a liveness check may be null.
+template<typename Element>
+string id_or_null(const Element* element)
+{
+    return element == nullptr ? string("null") : std::to_string(element->id);
+}
+
+// The longest run of unchanged elements between two changed ones that is still uploaded along
+// with them, trading a little bandwidth for fewer glBufferSubData calls.
+constexpr size_t MAX_UPLOAD_GAP = 16;
+
+// Adds an element to sorted [first, last) runs of elements to upload, merging it into the last
+// run when the gap between them is small enough.
+void extend_runs(vector<pair<size_t, size_t>>& runs, size_t index)
+{
+    if (!runs.empty() && index <= runs.back().second + MAX_UPLOAD_GAP) {
+        runs.back().second = std::max(runs.back().second, index + 1);
+    } else {
+        runs.emplace_back(index, index + 1);
+    }
+}
+
+// Coalesces a set of element indices (possibly unsorted, with duplicates) into runs.
+vector<pair<size_t, size_t>> coalesce(vector<uint32_t>& indices)
+{
+    std::sort(indices.begin(), indices.end());
+    vector<pair<size_t, size_t>> runs;
+    for (const uint32_t index: indices) {
+        extend_runs(runs, index);
+    }
+    return runs;
+}
+
+// Uploads a GL buffer whose data just replaced `old_data`, which is what the GPU still holds.
+// If the length is unchanged only the runs of changed elements are uploaded, otherwise the
+// whole buffer is. Returns the number of uploads.
+template<typename Buffer, typename T>
+size_t upload_changed_ranges(Buffer& buffer, const vector<T>& old_data)
+{
+    const vector<T>& data = buffer.data;
+    if (data.size() != old_data.size()) {
+        buffer.to_gpu();
+        return 1;
+    }
+    const size_t                 size = data.size() / std::max<size_t>(buffer.count(), 1);
+    vector<pair<size_t, size_t>> runs;
+    for (size_t i = 0; i < buffer.count(); ++i) {
+        const auto first = data.begin() + i * size;
+        if (!std::equal(first, first + size, old_data.begin() + i * size)) {
+            extend_runs(runs, i);
+        }
+    }
+    for (const auto& [first, last]: runs) {
+        buffer.update_range(first, last - first);
+    }
+    return runs.size();
+}
+
+} // namespace
+
 HalfedgeMesh::HalfedgeMesh(Object& object) :
     inconsistent_element(monostate()), global_inconsistent(false), object(object),
     mesh(object.mesh), halfedge_arrows("Halfedge Mesh")
 {
-    logger                  = get_logger("Halfedge Mesh");
-    const size_t n_vertices = mesh.vertices.count();
-    const size_t n_faces    = mesh.faces.count();
-    // Map vertex's index in GL::Mesh to pointer.
-    unordered_map<size_t, Vertex*> index_to_vertex;
-    // The degree of each vertex (i.e. the number of faces that contains it).
-    unordered_map<size_t, size_t> v_degree;
-    // Map face's index in GL::Mesh to pointer.
-    unordered_map<size_t, Face*> index_to_face;
-    // Map a pair (from , to) to a pointer pointing the corresponding halfedge, where `from` and
-    // `to` are both indices in GL::Mesh.
-    map<pair<size_t, size_t>, Halfedge*> endpoints_to_halfedge;
-
-    // Create the vertices and record them in vid_to_vertex.
-    v_pointers.reserve(n_vertices);
+    logger = get_logger("Halfedge Mesh");
+    build(mesh.vertices.data, mesh.faces.data);
+}
+
+void HalfedgeMesh::build(const vector<float>& positions, const vector<unsigned int>& indices)
+{
+    const size_t n_vertices  = positions.size() / 3;
+    const size_t n_faces     = indices.size() / 3;
+    const size_t n_halfedges = 3 * n_faces;
+
+    // The element pools are not thread-safe, so all elements are created here first and the
+    // passes below, which only write disjoint elements, run in parallel. The pools are empty,
+    // hence vertex i and face f of the input get the handles i and f, and halfedge 3f + i goes
+    // from the i-th corner of face f to the next corner.
     v_pointers.resize(n_vertices);
+    v_indices.resize(n_vertices);
     for (size_t index = 0; index < n_vertices; ++index) {
-        Vertex* v         = new_vertex();
-        v->pos            = mesh.vertex(index);
-        v_indices[v]      = index;
-        v_pointers[index] = v;
-        index_to_vertex.emplace(index, v);
-        v_degree[index] = 0;
+        v_pointers[index] = new_vertex();
+    }
+    for (size_t index = 0; index < n_faces; ++index) {
+        new_face();
     }
+    for (size_t index = 0; index < n_halfedges; ++index) {
+        new_halfedge();
+    }
+    // The endpoints (indices in the input) of a halfedge created for a face.
+    const auto endpoints = [&indices](size_t h) {
+        return pair<unsigned int, unsigned int>(indices[h], indices[h - h % 3 + (h + 1) % 3]);
+    };
+    parallel_for(0, n_vertices, [&](size_t index) {
+        Vertex* v           = v_pointers[index];
+        v->pos              = Eigen::Map<const Vector3f>(positions.data() + 3 * index);
+        v_indices[v->index] = static_cast<uint32_t>(index);
+    });
     logger->debug("vertices are recorded");
 
-    // Create the faces and record them in fid_to_face. Also, count each vertex's
-    // degree.
-    for (size_t index = 0; index < n_faces; ++index) {
-        Face* f = new_face();
-        index_to_face.emplace(index, f);
+    // Link halfedges along each face loop and count each vertex's degree (i.e. the number of
+    // faces that contains it). The first face reaching a vertex also sets its halfedge.
+    vector<std::atomic<uint32_t>> v_degree(n_vertices);
+    parallel_for(0, n_faces, [&](size_t index) {
+        Face* f     = faces[static_cast<uint32_t>(index)];
+        f->halfedge = halfedges[static_cast<uint32_t>(3 * index)];
+        for (size_t i = 0; i < 3; ++i) {
+            Halfedge*          h = halfedges[static_cast<uint32_t>(3 * index + i)];
+            const unsigned int v = indices[3 * index + i];
+            h->next              = halfedges[static_cast<uint32_t>(3 * index + (i + 1) % 3)];
+            h->prev              = halfedges[static_cast<uint32_t>(3 * index + (i + 2) % 3)];
+            h->face              = f;
+            h->from              = v_pointers[v];
+            if (v_degree[v].fetch_add(1, std::memory_order_relaxed) == 0) {
+                h->from->halfedge = h;
+            }
+        }
+    });
+    logger->debug("faces are recorded");
 
-        array<size_t, 3> v = mesh.face(index);
-        for (size_t vid: v) {
-            ++v_degree[vid];
+    // Match opposite halfedges by sorting all halfedges by their undirected edges: the two
+    // halfedges of an interior edge become neighbors, while a halfedge that sits along the
+    // domain boundary (on boundary, but still inside the mesh) is left alone without inversion.
+    vector<uint64_t> keys(n_halfedges);
+    vector<uint32_t> order(n_halfedges);
+    parallel_for(0, n_halfedges, [&](size_t h) {
+        const auto [a, b] = endpoints(h);
+        keys[h]           = edge_key(a, b);
+        order[h]          = static_cast<uint32_t>(h);
+    });
+    radix_sort(keys, order, 64);
+    for (size_t first = 0; first < n_halfedges;) {
+        size_t last = first + 1;
+        while (last < n_halfedges && keys[last] == keys[first]) {
+            ++last;
+        }
+        if (last - first == 1) {
+            first = last;
+            continue;
         }
+        // If two halfedges along this edge have the same direction, we have a problem.
+        pair<unsigned int, unsigned int> ab         = endpoints(order[first]);
+        bool                             duplicated = false;
+        for (size_t k = first + 1; k < last; ++k) {
+            duplicated = duplicated || endpoints(order[k]) == ab;
+        }
+        if (!duplicated && last - first > 2) {
+            ab         = {ab.second, ab.first};
+            duplicated = true;
+        }
+        if (duplicated) {
+            error_info = HalfedgeMeshFailure::MULTIPLE_ORIENTED_EDGES;
+            logger->warn(
+                "found multiple oriented edges connecting vertices ({}, {})", ab.first, ab.second
+            );
+            logger->warn("This means either");
+            logger->warn(
+                "1) more than two faces contain this edge (hance the surface is "
+                "non-manifold), or"
+            );
+            logger->warn(
+                "2) there are exactly two faces containing this edge, but they have the same "
+                "orientation (hence the surface is not consistently oriented"
+            );
+            return;
+        }
+        // Link the two halfedges together and create their shared edge.
+        Halfedge* h_ab = halfedges[order[first]];
+        Halfedge* h_ba = halfedges[order[first + 1]];
+        h_ab->inv      = h_ba;
+        h_ba->inv      = h_ab;
+        Edge* edge     = new_edge();
+        h_ab->edge     = edge;
+        h_ba->edge     = edge;
+        edge->halfedge = h_ab;
+        first          = last;
     }
-    logger->debug("faces are recorded");
+    logger->debug("halfedges' basic connectivity are built");
 
-    // Iterate over faces to build halfedge connectivity.
-    // By the end of this pass, the only halfedges that will not have a inversion
-    // will be those that sit along the domain boundary (on boundary, but still
-    // inside the mesh).
-    for (size_t index = 0; index < n_faces; ++index) {
-        array<size_t, 3>    v = mesh.face(index);
-        array<Halfedge*, 3> face_halfedges;
-        // For each pair of vertices, try to create a halfedge.
-        for (size_t i = 0; i < 3; ++i) {
-            size_t               a  = v[i];
-            size_t               b  = v[(i + 1) % 3];
-            pair<size_t, size_t> ab = make_pair(a, b);
-            Halfedge*            h_ab;
-            if (endpoints_to_halfedge.find(ab) != endpoints_to_halfedge.end()) {
-                // If the halfedge has already been created, we have a problem.
-                error_info = HalfedgeMeshFailure::MULTIPLE_ORIENTED_EDGES;
-                logger->warn(
-                    "found multiple oriented edges connecting vertices ({}, {})", ab.first,
-                    ab.second
-                );
-                logger->warn("This means either");
-                logger->warn(
-                    "1) more than two faces contain this edge (hance the surface is "
-                    "non-manifold), or"
-                );
-                logger->warn(
-                    "2) there are exactly two faces containing this edge, but they have the same "
-                    "orientation (hence the surface is not consistently oriented"
-                );
+    create_boundary_loops();
+    logger->debug("virtual faces representing boundary loops are created");
+
+    // Check if all vertices are manifold. Each chunk stops at its first non-manifold vertex and
+    // the first one overall is reported, so the result does not depend on the thread count.
+    const size_t                   n_chunks = parallel_chunk_count(n_vertices, 0);
+    vector<pair<size_t, uint32_t>> failures(n_chunks, {n_vertices, 0});
+    parallel_for_chunks(0, n_vertices, [&](size_t begin, size_t end, size_t chunk) {
+        for (size_t vid = begin; vid < end; ++vid) {
+            Vertex* v = v_pointers[vid];
+            // There should not be any "floating" vertex in a 2-manifold mesh.
+            if (v->halfedge == nullptr) {
+                failures[chunk] = {vid, 0};
                 return;
-            } else {
-                h_ab                      = new_halfedge();
-                endpoints_to_halfedge[ab] = h_ab;
-                h_ab->face                = index_to_face[index];
-                h_ab->face->halfedge      = h_ab;
-                h_ab->from                = index_to_vertex[a];
-                h_ab->from->halfedge      = h_ab;
-                face_halfedges[i]         = h_ab;
             }
-            // Check if the inversion of this halfedge has been created. If so,
-            // link them together and create their shared edge.
-            pair<size_t, size_t> ba = make_pair(b, a);
-            if (endpoints_to_halfedge.find(ba) != endpoints_to_halfedge.end()) {
-                Halfedge* h_ba = endpoints_to_halfedge[ba];
-                h_ab->inv      = h_ba;
-                h_ba->inv      = h_ab;
-                Edge* edge     = new_edge();
-                h_ab->edge     = edge;
-                h_ba->edge     = edge;
-                edge->halfedge = h_ab;
-            } else {
-                h_ab->inv = nullptr;
+            // Each vertex should be a "fan" of faces, indicating the number of halfedges
+            // emanating from the vertex is equal as the number of faces containing the
+            // vertex.
+            uint32_t  count = 0;
+            Halfedge* h     = v->halfedge;
+            do {
+                if (!(h->face->is_boundary)) {
+                    ++count;
+                }
+                h = h->inv->next;
+            } while (h != v->halfedge);
+            if (count != v_degree[vid].load(std::memory_order_relaxed)) {
+                failures[chunk] = {vid, count};
+                return;
             }
         }
-        // Link halfedges along the face loop via `next` and `prev`.
-        for (size_t i = 0; i < 3; ++i) {
-            const size_t next_id          = (i + 1) % 3;
-            face_halfedges[i]->next       = face_halfedges[next_id];
-            face_halfedges[next_id]->prev = face_halfedges[i];
+    });
+    for (const auto& [vid, count]: failures) {
+        if (vid == n_vertices) {
+            continue;
         }
+        const Vertex* v = v_pointers[vid];
+        error_info      = HalfedgeMeshFailure::NON_MANIFOLD_VERTEX;
+        if (v->halfedge == nullptr) {
+            logger->warn("vertex {} is not referenced by any polygon", v->id);
+        } else {
+            logger->warn(
+                "vertex {} is non-manifold (contained by {} non-boundary faces, but "
+                "only {} can be accessed via halfedges",
+                v->id, v_degree[vid].load(std::memory_order_relaxed), count
+            );
+        }
+        return;
     }
-    logger->debug("halfedges' basic connectivity are built");
+    logger->debug("all vertices are manifold");
+
+    regenerate_halfedge_arrows();
+    logger->debug("the line set is initialized");
+    optional<HalfedgeMeshFailure> validation_result = validate_by_level();
+    if (!validation_result.has_value()) {
+        logger->debug("validation passed");
+    }
+    error_info = std::nullopt;
+    logger->debug("done");
+}
+
+HalfedgeMesh::~HalfedgeMesh()
+{
+}
 
+void HalfedgeMesh::create_boundary_loops()
+{
     // Find vertices on the boundary of mesh, advance its halfedge pointer to a halfedge
     // which is also on the boundary.
-    for (size_t vid = 0; vid < n_vertices; ++vid) {
-        Vertex*   v = index_to_vertex[vid];
+    parallel_for(0, v_pointers.size(), [&](size_t vid) {
+        Vertex*   v = v_pointers[vid];
         Halfedge* h = v->halfedge;
+        if (h == nullptr) {
+            return;
+        }
         do {
             if (h->inv == nullptr) {
                 v->halfedge = h;
@@ -157,10 +310,10 @@ HalfedgeMesh::HalfedgeMesh(Object& object) :
             }
             h = h->inv->next;
         } while (h != v->halfedge);
-    }
+    });
 
     // Connect all halfedges along each boundary loop and create virtual faces.
-    for (Halfedge* h = halfedges.head; h != nullptr; h = h->next_node) {
+    for (Halfedge* h: halfedges) {
         // A halfedge whose inversion does not exist is a halfedge along the boundary.
         // (But "inside" the domain boundary)
         if (h->inv == nullptr) {
@@ -172,14 +325,16 @@ HalfedgeMesh::HalfedgeMesh(Object& object) :
             Halfedge*         i = h;
             do {
                 Halfedge* boundary_halfedge = new_halfedge();
-                Edge*     e                 = new_edge();
-                e->halfedge                 = i;
+                // The edge may have been created along with the halfedge inside the boundary.
+                if (i->edge == nullptr) {
+                    i->edge           = new_edge();
+                    i->edge->halfedge = i;
+                }
                 boundary_halfedges.push_back(boundary_halfedge);
                 i->inv                  = boundary_halfedge;
-                i->edge                 = e;
                 boundary_halfedge->inv  = i;
                 boundary_halfedge->from = i->next->from;
-                boundary_halfedge->edge = e;
+                boundary_halfedge->edge = i->edge;
                 boundary_halfedge->face = virtual_face;
 
                 // Find the next halfedge along the boundary loop.
@@ -202,77 +357,17 @@ HalfedgeMesh::HalfedgeMesh(Object& object) :
             }
         }
     }
-    logger->debug("virtual faces representing boundary loops are created");
-
-    // Check if all vertices are manifold.
-    for (size_t vid = 0; vid < n_vertices; ++vid) {
-        Vertex* v = index_to_vertex[vid];
-        // There should not be any "floating" vertex in a 2-manifold mesh.
-        if (v->halfedge == nullptr) {
-            error_info = HalfedgeMeshFailure::NON_MANIFOLD_VERTEX;
-            logger->warn("vertex {} is not referenced by any polygon", v->id);
-            return;
-        }
-        // Each vertex should be a "fan" of faces, indicating the number of halfedges
-        // emanating from the vertex is equal as the number of faces containing the
-        // vertex.
-        size_t    count = 0;
-        Halfedge* h     = v->halfedge;
-        do {
-            if (!(h->face->is_boundary)) {
-                ++count;
-            }
-            h = h->inv->next;
-        } while (h != v->halfedge);
-        if (count != v_degree[vid]) {
-            error_info = HalfedgeMeshFailure::NON_MANIFOLD_VERTEX;
-            logger->warn(
-                "vertex {} is non-manifold (contained by {} non-boundary faces, but "
-                "only {} can be accessed via halfedges",
-                v->id, v_degree[vid], count
-            );
-            return;
-        }
-    }
-    logger->debug("all vertices are manifold");
-
-    regenerate_halfedge_arrows();
-    logger->debug("the line set is initialized");
-    optional<HalfedgeMeshFailure> validation_result = validate();
-    if (!validation_result.has_value()) {
-        logger->debug("validation passed");
-    }
-    error_info = std::nullopt;
-    logger->debug("done");
-}
-
-HalfedgeMesh::~HalfedgeMesh()
-{
-    clear_erasure_records();
 }
 
 void HalfedgeMesh::sync()
 {
     if (!global_inconsistent) {
-        // Synchronize the inconsistent element
+        // Mark the vertices of the inconsistent element that moved since the last sync.
         const auto sync_vertex = [this](Vertex* vertex) {
-            mesh.VAO.bind();
-            mesh.vertices.update(v_indices[vertex], vertex->pos);
-            mesh.VAO.release();
-            const Halfedge* h = vertex->halfedge;
-            halfedge_arrows.VAO.bind();
-            do {
-                if (!(h->is_boundary())) {
-                    auto [from, to] = halfedge_arrow_endpoints(h);
-                    halfedge_arrows.update_arrow(h_indices[h], from, to);
-                }
-                if (!(h->inv->is_boundary())) {
-                    auto [from, to] = halfedge_arrow_endpoints(h->inv);
-                    halfedge_arrows.update_arrow(h_indices[h->inv], from, to);
-                }
-                h = h->inv->next;
-            } while (h != vertex->halfedge);
-            halfedge_arrows.VAO.release();
+            const float* synced = mesh.vertices.data.data() + 3 * v_indices[vertex->index];
+            if (vertex->pos != Vector3f(synced[0], synced[1], synced[2])) {
+                mark_dirty(vertex);
+            }
         };
         const auto sync_edge = [&sync_vertex](Edge* edge) {
             Vertex* v1 = edge->halfedge->from;
@@ -291,65 +386,102 @@ void HalfedgeMesh::sync()
             overloaded{
                 []([[maybe_unused]]
                    monostate empty) {},
+                []([[maybe_unused]]
+                   const Halfedge* halfedge) {},
                 sync_vertex, sync_edge, sync_face
             },
             inconsistent_element
         );
+        sync_dirty_elements();
         return;
     }
 
     logger->info("synchronize halfedge mesh to object {} (ID: {})", object.name, object.id);
-    vector<unsigned int>& mesh_faces = mesh.faces.data;
-
-    unordered_map<Vertex*, unsigned int> vertex_to_index;
-    unsigned int                         counter = 0;
+    // Pointers held outside the halfedge mesh would dangle after compaction, so the pools are
+    // only compacted when nothing is selected.
+    if (std::holds_alternative<monostate>(inconsistent_element)) {
+        compact();
+        logger->debug("element pools are compacted");
+    }
+    dirty_vertices.clear();
+    dirty_faces.clear();
+    // Keep the data on the GPU so that only the changed ranges are uploaded. If the object still
+    // has a pending full upload, the GPU copy is stale and the object uploads everything anyway.
+    const bool                 upload_changes = !object.modified;
+    const vector<float>        old_vertices   = std::move(mesh.vertices.data);
+    const vector<float>        old_normals    = std::move(mesh.normals.data);
+    const vector<unsigned int> old_edges      = std::move(mesh.edges.data);
+    const vector<unsigned int> old_faces      = std::move(mesh.faces.data);
     mesh.clear();
-    // Copy the vertices in HalfedgeMesh to GL::Mesh, use area weighted normal
-    // as estimation of vertex normal.
-    v_pointers.reserve(vertices.size);
+
+    // Assign the vertex indices in GL::Mesh in iteration order.
+    uint32_t counter = 0;
     v_pointers.resize(vertices.size);
-    for (Vertex* v = vertices.head; v != nullptr; v = v->next_node) {
-        mesh.vertices.append(v->pos.x(), v->pos.y(), v->pos.z());
-        vertex_to_index[v]  = counter;
-        v_indices[v]        = static_cast<size_t>(counter);
+    v_indices.assign(vertices.capacity(), ElementPool<Vertex>::invalid_index);
+    for (Vertex* v: vertices) {
+        v_indices[v->index] = counter;
         v_pointers[counter] = v;
         ++counter;
-
-        // Traverse all adjacent faces to calculate a weighted average normal.
-        Halfedge* h = v->halfedge;
-        Vector3f  normal(0.0f, 0.0f, 0.0f);
+    }
+    // Copy the vertices in HalfedgeMesh to GL::Mesh, use area weighted normal as estimation of
+    // vertex normal. Each face's area weighted normal is computed once and then gathered by the
+    // vertices around it.
+    vector<Vector3f> face_normals(faces.capacity());
+    parallel_for(0, faces.capacity(), [&](size_t index) {
+        if (faces.is_alive(static_cast<uint32_t>(index))) {
+            face_normals[index] = faces[static_cast<uint32_t>(index)]->area_weighted_normal();
+        }
+    });
+    vector<float>& positions = mesh.vertices.data;
+    vector<float>& normals   = mesh.normals.data;
+    positions.resize(3 * v_pointers.size());
+    normals.resize(3 * v_pointers.size());
+    parallel_for(0, v_pointers.size(), [&](size_t index) {
+        const Vertex* v = v_pointers[index];
+        Halfedge*     h = v->halfedge;
+        Vector3f      normal(0.0f, 0.0f, 0.0f);
         do {
-            Vector3f area_weighted_normal = h->face->area_weighted_normal();
-            normal += area_weighted_normal;
+            normal += face_normals[h->face->index];
             h = h->inv->next;
         } while (h != v->halfedge);
         normal.normalize();
-        mesh.normals.append(normal.x(), normal.y(), normal.z());
-    }
+        std::copy(v->pos.data(), v->pos.data() + 3, positions.begin() + 3 * index);
+        std::copy(normal.data(), normal.data() + 3, normals.begin() + 3 * index);
+    });
     logger->debug("vertex data is synchronized");
-    for (Edge* e = edges.head; e != nullptr; e = e->next_node) {
-        unsigned int v1 = vertex_to_index[e->halfedge->from];
-        unsigned int v2 = vertex_to_index[e->halfedge->inv->from];
+    for (Edge* e: edges) {
+        unsigned int v1 = v_indices[e->halfedge->from->index];
+        unsigned int v2 = v_indices[e->halfedge->inv->from->index];
         mesh.edges.append(v1, v2);
     }
     logger->debug("edge data is synchronized");
-    for (Face* f = faces.head; f != nullptr; f = f->next_node) {
+    vector<unsigned int>& mesh_faces = mesh.faces.data;
+    for (Face* f: faces) {
         if (f->is_boundary) {
             // This is a virtual face representing a boundary loop, which should
             // not be synced back to the original mesh.
             continue;
         }
-        Halfedge*            h = f->halfedge;
-        vector<unsigned int> vertices;
+        Halfedge* h = f->halfedge;
         do {
-            mesh_faces.push_back(vertex_to_index[h->from]);
-            vertices.push_back(vertex_to_index[h->from]);
+            mesh_faces.push_back(v_indices[h->from->index]);
             h = h->next;
         } while (h != f->halfedge);
     }
     logger->debug("face data is synchronized");
-    object.modified = true;
-    logger->debug("all data is synchronized, the object's dirty flag is set");
+    if (upload_changes) {
+        mesh.VAO.bind();
+        size_t n_uploads = upload_changed_ranges(mesh.vertices, old_vertices);
+        n_uploads += upload_changed_ranges(mesh.normals, old_normals);
+        n_uploads += upload_changed_ranges(mesh.edges, old_edges);
+        mesh.edges.release();
+        n_uploads += upload_changed_ranges(mesh.faces, old_faces);
+        mesh.faces.release();
+        mesh.VAO.release();
+        logger->debug("all data is synchronized with {} uploads", n_uploads);
+    } else {
+        logger->debug("all data is synchronized, the object's dirty flag is kept");
+    }
     regenerate_halfedge_arrows();
     logger->debug("halfedge arrows are regenerated");
     global_inconsistent = false;
@@ -377,93 +509,477 @@ tuple<Vector3f, Vector3f> HalfedgeMesh::halfedge_arrow_endpoints(const Halfedge*
 
 Halfedge* HalfedgeMesh::new_halfedge()
 {
-    Halfedge* h = halfedges.append(next_available_id);
+    Halfedge* h = halfedges.emplace(next_available_id);
     ++next_available_id;
+    record(h, true);
     return h;
 }
 
 Vertex* HalfedgeMesh::new_vertex()
 {
-    Vertex* v = vertices.append(next_available_id);
+    Vertex* v = vertices.emplace(next_available_id);
     ++next_available_id;
+    record(v, true);
     return v;
 }
 
 Edge* HalfedgeMesh::new_edge()
 {
-    Edge* e = edges.append(next_available_id);
+    Edge* e = edges.emplace(next_available_id);
     ++next_available_id;
+    record(e, true);
     return e;
 }
 
 Face* HalfedgeMesh::new_face(bool is_boundary)
 {
-    Face* f = faces.append(next_available_id, is_boundary);
+    Face* f = faces.emplace(next_available_id, is_boundary);
     ++next_available_id;
+    record(f, true);
     return f;
 }
 
 void HalfedgeMesh::regenerate_halfedge_arrows()
 {
+    const vector<float>        old_vertices = std::move(halfedge_arrows.vertices.data);
+    const vector<unsigned int> old_lines    = std::move(halfedge_arrows.lines.data);
     halfedge_arrows.clear();
-    h_indices.clear();
-    size_t counter = 0;
-    for (Halfedge* h = halfedges.head; h != nullptr; h = h->next_node) {
+    h_indices.assign(halfedges.capacity(), ElementPool<Halfedge>::invalid_index);
+    uint32_t counter = 0;
+    for (Halfedge* h: halfedges) {
         // Do not draw the boundary halfedges on the virtual faces.
         if (h->face->is_boundary) {
             continue;
         }
         auto [from, to] = halfedge_arrow_endpoints(h);
         halfedge_arrows.add_arrow(from, to);
-        h_indices[h] = counter;
+        h_indices[h->index] = counter;
         ++counter;
     }
-    halfedge_arrows.to_gpu();
+    halfedge_arrows.VAO.bind();
+    upload_changed_ranges(halfedge_arrows.vertices, old_vertices);
+    upload_changed_ranges(halfedge_arrows.lines, old_lines);
+    halfedge_arrows.VAO.release();
+}
+
+void HalfedgeMesh::mark_dirty(Vertex* v)
+{
+    dirty_vertices.push_back(v->index);
+    const Halfedge* h = v->halfedge;
+    do {
+        dirty_faces.push_back(h->face->index);
+        h = h->inv->next;
+    } while (h != v->halfedge);
+}
+
+void HalfedgeMesh::sync_dirty_elements()
+{
+    if (dirty_vertices.empty()) {
+        return;
+    }
+    vector<uint32_t> position_indices;
+    for (const uint32_t v: dirty_vertices) {
+        const Vector3f& pos = vertices[v]->pos;
+        std::copy(pos.data(), pos.data() + 3, mesh.vertices.data.begin() + 3 * v_indices[v]);
+        position_indices.push_back(v_indices[v]);
+    }
+    // The normal of every vertex on a face around a dirty vertex may change, and so may the
+    // arrows of all halfedges on these faces, since each arrow is lifted along its face normal.
+    std::sort(dirty_faces.begin(), dirty_faces.end());
+    dirty_faces.erase(std::unique(dirty_faces.begin(), dirty_faces.end()), dirty_faces.end());
+    vector<uint32_t> normal_indices;
+    vector<uint32_t> arrow_indices;
+    for (const uint32_t f: dirty_faces) {
+        const Halfedge* h = faces[f]->halfedge;
+        do {
+            normal_indices.push_back(v_indices[h->from->index]);
+            if (!h->face->is_boundary) {
+                auto [from, to] = halfedge_arrow_endpoints(h);
+                halfedge_arrows.set_arrow(h_indices[h->index], from, to);
+                arrow_indices.push_back(h_indices[h->index]);
+            }
+            h = h->next;
+        } while (h != faces[f]->halfedge);
+    }
+    const vector<pair<size_t, size_t>> normal_runs = coalesce(normal_indices);
+    for (const auto& [first, last]: normal_runs) {
+        for (size_t i = first; i < last; ++i) {
+            const Vector3f normal = v_pointers[i]->normal();
+            std::copy(normal.data(), normal.data() + 3, mesh.normals.data.begin() + 3 * i);
+        }
+    }
+
+    mesh.VAO.bind();
+    for (const auto& [first, last]: coalesce(position_indices)) {
+        mesh.vertices.update_range(first, last - first);
+    }
+    for (const auto& [first, last]: normal_runs) {
+        mesh.normals.update_range(first, last - first);
+    }
+    mesh.VAO.release();
+    halfedge_arrows.VAO.bind();
+    for (const auto& [first, last]: coalesce(arrow_indices)) {
+        halfedge_arrows.vertices.update_range(
+            first * GL::LineSet::n_arrow_vertices, (last - first) * GL::LineSet::n_arrow_vertices
+        );
+    }
+    halfedge_arrows.VAO.release();
+    dirty_vertices.clear();
+    dirty_faces.clear();
 }
 
 void HalfedgeMesh::erase(Halfedge* h)
 {
-    erased_halfedges[h->id] = halfedges.release(h);
+    record(h);
+    halfedges.erase(h);
 }
 
 void HalfedgeMesh::erase(Vertex* v)
 {
-    erased_vertices[v->id] = vertices.release(v);
+    record(v);
+    vertices.erase(v);
 }
 
 void HalfedgeMesh::erase(Edge* e)
 {
-    erased_edges[e->id] = edges.release(e);
+    record(e);
+    edges.erase(e);
 }
 
 void HalfedgeMesh::erase(Face* f)
 {
-    erased_faces[f->id] = faces.release(f);
+    record(f);
+    faces.erase(f);
 }
 
 void HalfedgeMesh::clear_erasure_records()
 {
-    for (auto& p: erased_halfedges) {
-        delete p.second;
+    halfedges.recycle();
+    vertices.recycle();
+    edges.recycle();
+    faces.recycle();
+}
+
+void HalfedgeMesh::compact()
+{
+    // Erased elements that the journal may restore keep their slots.
+    vector<uint32_t> h_kept;
+    vector<uint32_t> v_kept;
+    vector<uint32_t> e_kept;
+    vector<uint32_t> f_kept;
+    journal_dead_slots(h_kept, v_kept, e_kept, f_kept);
+    const vector<uint32_t> h_map = halfedges.compaction_map(h_kept);
+    const vector<uint32_t> v_map = vertices.compaction_map(v_kept);
+    const vector<uint32_t> e_map = edges.compaction_map(e_kept);
+    const vector<uint32_t> f_map = faces.compaction_map(f_kept);
+    // Redirect every pointer to the slot its target will occupy before anything moves, while
+    // the old handles can still be read from the targets. With validation off a live element may
+    // still point to an erased one, whose slot is freed, so such pointers become null.
+    const auto relocate = [](auto*& element, const vector<uint32_t>& map, const auto& pool) {
+        element = pool.contains(element) ? pool[map[element->index]] : nullptr;
+    };
+    for (Halfedge* h: halfedges) {
+        relocate(h->next, h_map, halfedges);
+        relocate(h->prev, h_map, halfedges);
+        relocate(h->inv, h_map, halfedges);
+        relocate(h->from, v_map, vertices);
+        relocate(h->edge, e_map, edges);
+        relocate(h->face, f_map, faces);
+    }
+    for (Vertex* v: vertices) {
+        relocate(v->halfedge, h_map, halfedges);
+    }
+    for (Edge* e: edges) {
+        relocate(e->halfedge, h_map, halfedges);
+    }
+    for (Face* f: faces) {
+        relocate(f->halfedge, h_map, halfedges);
+    }
+    relocate_journal(h_map, v_map, e_map, f_map);
+    halfedges.compact(h_map);
+    vertices.compact(v_map);
+    edges.compact(e_map);
+    faces.compact(f_map);
+}
+
+namespace {
+
+// The local checks below apply the rules of HalfedgeMesh::validate to the elements around one
+// vertex or face only. They log the error only if `logger` is not null, so that they can run in
+// parallel and be repeated with logging on the element that failed. Every walk is bounded by the
+// number of halfedges, since a broken permutation may never lead back to where it started.
+
+template<typename... Args>
+optional<HalfedgeMeshFailure> report(
+    spdlog::logger* logger, HalfedgeMeshFailure failure, spdlog::format_string_t<Args...> format,
+    Args&&... args
+)
+{
+    if (logger != nullptr) {
+        logger->error(format, std::forward<Args>(args)...);
+    }
+    return failure;
+}
+
+// Checks the connections of a live halfedge and whether it can be accessed from its from, edge
+// and face.
+optional<HalfedgeMeshFailure>
+check_halfedge(const HalfedgeMesh& mesh, const Halfedge* h, spdlog::logger* logger)
+{
+    const ElementPool<Halfedge>& halfedges = mesh.halfedges;
+    const bool                   all_alive =
+        halfedges.contains(h->next) && halfedges.contains(h->prev) && halfedges.contains(h->inv)
+        && mesh.vertices.contains(h->from) && mesh.edges.contains(h->edge)
+        && mesh.faces.contains(h->face);
+    if (!all_alive) {
+        return report(
+            logger, HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION,
+            "a live halfedge ({}) refers to an erased element", h->id
+        );
+    }
+    // next and prev are permutations exactly when they are inverse to each other everywhere
+    if (h->next->prev != h || h->prev->next != h) {
+        return report(
+            logger, HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION,
+            "a halfedge ({})'s next and prev are not inverse to each other", h->id
+        );
+    }
+    if (h->inv == h) {
+        return report(
+            logger, HalfedgeMeshFailure::ILL_FORMED_HALFEDGE_INVERSION,
+            "a halfedge ({})'s inv is itself", h->id
+        );
+    }
+    if (h->inv->inv != h) {
+        return report(
+            logger, HalfedgeMeshFailure::ILL_FORMED_HALFEDGE_INVERSION,
+            "a halfedge ({})'s inv's inv ({}) is not itself", h->id, h->inv->inv->id
+        );
+    }
+    const Edge* e = h->edge;
+    if (h->inv->edge != e) {
+        return report(
+            logger, HalfedgeMeshFailure::INVALID_EDGE_CONNECTIVITY,
+            "an edge ({})'s halfedge ({}) does not pointing to that edge", e->id, h->inv->id
+        );
+    }
+    if (e->halfedge != h && e->halfedge != h->inv) {
+        return report(
+            logger, HalfedgeMeshFailure::POOR_HALFEDGE_ACCESSIBILITY,
+            "a halfedge ({}) is not accessible from its edge ({})", h->id, e->id
+        );
+    }
+    // Rotate around the from vertex until reaching its halfedge.
+    const Halfedge* k       = h;
+    size_t          n_steps = 0;
+    while (k != h->from->halfedge) {
+        if (++n_steps > halfedges.size || !halfedges.contains(k->inv)
+            || !halfedges.contains(k->inv->next)) {
+            return report(
+                logger, HalfedgeMeshFailure::POOR_HALFEDGE_ACCESSIBILITY,
+                "a halfedge ({}) is not accessible from its from ({})", h->id, h->from->id
+            );
+        }
+        k = k->inv->next;
+    }
+    return std::nullopt;
+}
+
+optional<HalfedgeMeshFailure>
+check_vertex(const HalfedgeMesh& mesh, const Vertex* v, spdlog::logger* logger)
+{
+    bool is_finite =
+        std::isfinite(v->pos.x()) && std::isfinite(v->pos.y()) && std::isfinite(v->pos.z());
+    if (!is_finite) {
+        return report(
+            logger, HalfedgeMeshFailure::INIFINITE_POSITION_VALUE,
+            "vertex {}'s position was set to a non-finite value", v->id
+        );
+    }
+    const Halfedge* h       = v->halfedge;
+    size_t          n_steps = 0;
+    do {
+        if (!mesh.halfedges.contains(h)) {
+            return report(
+                logger, HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY,
+                "the halfedges around a vertex ({}) include an erased one", v->id
+            );
+        }
+        if (h->from != v) {
+            return report(
+                logger, HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY,
+                "a vertex ({})'s halfedge ({}) does not pointing to that vertex", v->id, h->id
+            );
+        }
+        if (++n_steps > mesh.halfedges.size || !mesh.halfedges.contains(h->inv)) {
+            return report(
+                logger, HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY,
+                "the halfedges around a vertex ({}) do not form a loop", v->id
+            );
+        }
+        h = h->inv->next;
+    } while (h != v->halfedge);
+    return std::nullopt;
+}
+
+// Checks a face together with all its halfedges.
+optional<HalfedgeMeshFailure>
+check_face(const HalfedgeMesh& mesh, const Face* f, spdlog::logger* logger)
+{
+    if (!mesh.faces.contains(f)) {
+        return report(
+            logger, HalfedgeMeshFailure::INVALID_FACE_CONNECTIVITY, "face {} was erased", f->id
+        );
+    }
+    const Halfedge* h       = f->halfedge;
+    size_t          n_steps = 0;
+    do {
+        if (!mesh.halfedges.contains(h)) {
+            return report(
+                logger, HalfedgeMeshFailure::INVALID_FACE_CONNECTIVITY,
+                "the halfedges of a face ({}) include an erased one", f->id
+            );
+        }
+        if (h->face != f) {
+            return report(
+                logger, HalfedgeMeshFailure::INVALID_FACE_CONNECTIVITY,
+                "a face ({})'s halfedge ({}) does not pointing to that face", f->id, h->id
+            );
+        }
+        if (optional<HalfedgeMeshFailure> failure = check_halfedge(mesh, h, logger)) {
+            return failure;
+        }
+        if (++n_steps > mesh.halfedges.size) {
+            return report(
+                logger, HalfedgeMeshFailure::INVALID_FACE_CONNECTIVITY,
+                "the halfedges of a face ({}) do not form a loop", f->id
+            );
+        }
+        h = h->next;
+    } while (h != f->halfedge);
+    return std::nullopt;
+}
+
+// Returns the smallest handle of a live element failing `check`, checking all elements in
+// parallel.
+template<typename Node, typename Check>
+optional<uint32_t> find_failure(const ElementPool<Node>& pool, Check&& check)
+{
+    const uint32_t             n_slots = pool.capacity();
+    vector<optional<uint32_t>> failures(parallel_chunk_count(n_slots, 0));
+    parallel_for_chunks(0, n_slots, [&](size_t first, size_t last, size_t chunk) {
+        for (uint32_t index = static_cast<uint32_t>(first); index < last; ++index) {
+            if (pool.is_alive(index) && check(pool[index]).has_value()) {
+                failures[chunk] = index;
+                return;
+            }
+        }
+    });
+    for (const optional<uint32_t>& failure: failures) {
+        if (failure.has_value()) {
+            return failure;
+        }
     }
-    for (auto& p: erased_vertices) {
-        delete p.second;
+    return std::nullopt;
+}
+
+} // namespace
+
+optional<HalfedgeMeshFailure> HalfedgeMesh::validate_around(Vertex* v)
+{
+    switch (validation_level) {
+    case ValidationLevel::FULL: return validate();
+    case ValidationLevel::LOCAL: return validate_locally({v});
+    default: clear_erasure_records(); return std::nullopt;
+    }
+}
+
+optional<HalfedgeMeshFailure> HalfedgeMesh::validate_around(Edge* e)
+{
+    switch (validation_level) {
+    case ValidationLevel::FULL: return validate();
+    case ValidationLevel::LOCAL: break;
+    default: clear_erasure_records(); return std::nullopt;
+    }
+    if (!edges.contains(e) || !halfedges.contains(e->halfedge)
+        || !halfedges.contains(e->halfedge->inv)) {
+        logger->error("an edge ({}) or its halfedges were erased", e->id);
+        return HalfedgeMeshFailure::INVALID_EDGE_CONNECTIVITY;
+    }
+    return validate_locally({e->halfedge->from, e->halfedge->inv->from});
+}
+
+optional<HalfedgeMeshFailure> HalfedgeMesh::validate_by_level()
+{
+    switch (validation_level) {
+    case ValidationLevel::FULL: return validate();
+    case ValidationLevel::LOCAL: break;
+    default: clear_erasure_records(); return std::nullopt;
+    }
+    // Check every element silently first, and then only the failed one with logging.
+    const optional<uint32_t> failed_vertex = find_failure(vertices, [this](const Vertex* v) {
+        return check_vertex(*this, v, nullptr);
+    });
+    if (failed_vertex.has_value()) {
+        return check_vertex(*this, vertices[failed_vertex.value()], logger.get());
+    }
+    const optional<uint32_t> failed_face = find_failure(faces, [this](const Face* f) {
+        return check_face(*this, f, nullptr);
+    });
+    if (failed_face.has_value()) {
+        return check_face(*this, faces[failed_face.value()], logger.get());
+    }
+    clear_erasure_records();
+    return std::nullopt;
+}
+
+optional<HalfedgeMeshFailure> HalfedgeMesh::validate_locally(const vector<Vertex*>& seeds)
+{
+    vector<Face*>   region_faces;
+    vector<Vertex*> region_vertices;
+    for (Vertex* v: seeds) {
+        if (!vertices.contains(v)) {
+            logger->error("vertex {} was erased", v->id);
+            return HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY;
+        }
+        if (optional<HalfedgeMeshFailure> failure = check_vertex(*this, v, logger.get())) {
+            return failure;
+        }
+        // The walk is safe once the vertex passed its check.
+        Halfedge* h = v->halfedge;
+        do {
+            region_faces.push_back(h->face);
+            h = h->inv->next;
+        } while (h != v->halfedge);
     }
-    for (auto& p: erased_edges) {
-        delete p.second;
+    std::sort(region_faces.begin(), region_faces.end());
+    region_faces.erase(std::unique(region_faces.begin(), region_faces.end()), region_faces.end());
+    for (Face* f: region_faces) {
+        if (optional<HalfedgeMeshFailure> failure = check_face(*this, f, logger.get())) {
+            return failure;
+        }
+        Halfedge* h = f->halfedge;
+        do {
+            region_vertices.push_back(h->from);
+            h = h->next;
+        } while (h != f->halfedge);
     }
-    for (auto& p: erased_faces) {
-        delete p.second;
+    std::sort(region_vertices.begin(), region_vertices.end());
+    region_vertices.erase(
+        std::unique(region_vertices.begin(), region_vertices.end()), region_vertices.end()
+    );
+    for (const Vertex* v: region_vertices) {
+        if (optional<HalfedgeMeshFailure> failure = check_vertex(*this, v, logger.get())) {
+            return failure;
+        }
     }
-    erased_halfedges.clear();
-    erased_vertices.clear();
-    erased_edges.clear();
-    erased_faces.clear();
+    clear_erasure_records();
+    return std::nullopt;
 }
 
 optional<HalfedgeMeshFailure> HalfedgeMesh::validate()
 {
-    for (Vertex* v = vertices.head; v != nullptr; v = v->next_node) {
+    for (Vertex* v: vertices) {
         bool is_finite =
             std::isfinite(v->pos.x()) && std::isfinite(v->pos.y()) && std::isfinite(v->pos.z());
         if (!is_finite) {
@@ -478,33 +994,39 @@ optional<HalfedgeMeshFailure> HalfedgeMesh::validate()
     set<Halfedge*>                         permutation_next, permutation_prev;
 
     // Check valid halfedge permutation
-    for (Halfedge* h = halfedges.head; h != nullptr; h = h->next_node) {
-        if (erased_halfedges.find(h->id) != erased_halfedges.end()) {
-            logger->error("an erased halfedge is still in the linked list");
-            continue;
-        }
-        if (erased_halfedges.find(h->next->id) != erased_halfedges.end()) {
-            logger->error("a live halfedge ({})'s next ({}) was erased", h->id, h->next->id);
+    for (Halfedge* h: halfedges) {
+        if (!halfedges.contains(h->next)) {
+            logger->error(
+                "a live halfedge ({})'s next ({}) was erased", h->id, id_or_null(h->next)
+            );
             return HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION;
         }
-        if (erased_halfedges.find(h->prev->id) != erased_halfedges.end()) {
-            logger->error("a live halfedge ({})'s prev ({}) was erased", h->id, h->prev->id);
+        if (!halfedges.contains(h->prev)) {
+            logger->error(
+                "a live halfedge ({})'s prev ({}) was erased", h->id, id_or_null(h->prev)
+            );
             return HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION;
         }
-        if (erased_halfedges.find(h->inv->id) != erased_halfedges.end()) {
-            logger->error("a live halfedge ({})'s inv ({}) was erased", h->id, h->inv->id);
+        if (!halfedges.contains(h->inv)) {
+            logger->error("a live halfedge ({})'s inv ({}) was erased", h->id, id_or_null(h->inv));
             return HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION;
         }
-        if (erased_vertices.find(h->from->id) != erased_vertices.end()) {
-            logger->error("a live halfedge ({})'s from ({}) was erased", h->id, h->from->id);
+        if (!vertices.contains(h->from)) {
+            logger->error(
+                "a live halfedge ({})'s from ({}) was erased", h->id, id_or_null(h->from)
+            );
             return HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION;
         }
-        if (erased_edges.find(h->edge->id) != erased_edges.end()) {
-            logger->error("a live halfedge ({})'s edge ({}) was erased", h->id, h->edge->id);
+        if (!edges.contains(h->edge)) {
+            logger->error(
+                "a live halfedge ({})'s edge ({}) was erased", h->id, id_or_null(h->edge)
+            );
             return HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION;
         }
-        if (erased_faces.find(h->face->id) != erased_faces.end()) {
-            logger->error("a live halfface ({})'s face ({}) was erased", h->id, h->face->id);
+        if (!faces.contains(h->face)) {
+            logger->error(
+                "a live halfface ({})'s face ({}) was erased", h->id, id_or_null(h->face)
+            );
             return HalfedgeMeshFailure::INVALID_HALFEDGE_PERMUTATION;
         }
 
@@ -524,14 +1046,10 @@ optional<HalfedgeMeshFailure> HalfedgeMesh::validate()
     }
 
     // Check whether each halfedge incident on a vertex points to that vertex
-    for (Vertex* v = vertices.head; v != nullptr; v = v->next_node) {
-        if (erased_vertices.find(v->id) != erased_vertices.end()) {
-            logger->error("an erased vertex is still in the linked list");
-            continue;
-        }
+    for (Vertex* v: vertices) {
         Halfedge* h = v->halfedge;
-        if (erased_halfedges.find(h->id) != erased_halfedges.end()) {
-            logger->error("a vertex ({})'s halfedge ({}) is erased", v->id, h->id);
+        if (!halfedges.contains(h)) {
+            logger->error("a vertex ({})'s halfedge ({}) is erased", v->id, id_or_null(h));
             return HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY;
         }
         set<Halfedge*> accessible;
@@ -549,14 +1067,10 @@ optional<HalfedgeMeshFailure> HalfedgeMesh::validate()
     }
 
     // Check whether each halfedge incident on an edge points to that edge
-    for (Edge* e = edges.head; e != nullptr; e = e->next_node) {
-        if (erased_edges.find(e->id) != erased_edges.end()) {
-            logger->error("an erased edge is still in the linked list");
-            continue;
-        }
+    for (Edge* e: edges) {
         Halfedge* h = e->halfedge;
-        if (erased_halfedges.find(h->id) != erased_halfedges.end()) {
-            logger->error("an edge ({})'s halfedge ({}) is erased", e->id, h->id);
+        if (!halfedges.contains(h)) {
+            logger->error("an edge ({})'s halfedge ({}) is erased", e->id, id_or_null(h));
             return HalfedgeMeshFailure::INVALID_EDGE_CONNECTIVITY;
         }
         set<Halfedge*> accessible;
@@ -574,14 +1088,10 @@ optional<HalfedgeMeshFailure> HalfedgeMesh::validate()
     }
 
     // Check whether each halfedge incident on an face points to that face
-    for (Face* f = faces.head; f != nullptr; f = f->next_node) {
-        if (erased_faces.find(f->id) != erased_faces.end()) {
-            logger->error("an erased face is still in the linked list");
-            continue;
-        }
+    for (Face* f: faces) {
         Halfedge* h = f->halfedge;
-        if (erased_halfedges.find(h->id) != erased_halfedges.end()) {
-            logger->error("a face ({})'s halfedge ({}) is erased", f->id, h->id);
+        if (!halfedges.contains(h)) {
+            logger->error("a face ({})'s halfedge ({}) is erased", f->id, id_or_null(h));
             return HalfedgeMeshFailure::INVALID_FACE_CONNECTIVITY;
         }
         set<Halfedge*> accessible;
@@ -598,11 +1108,7 @@ optional<HalfedgeMeshFailure> HalfedgeMesh::validate()
         f_accessible[f] = std::move(accessible);
     }
 
-    for (Halfedge* h = halfedges.head; h != nullptr; h = h->next_node) {
-        if (erased_halfedges.find(h->id) != erased_halfedges.end()) {
-            // This halfedge has been erased, do not check it
-            continue;
-        }
+    for (Halfedge* h: halfedges) {
         // Check whether this halfedge was pointed by a halfedge
         if (permutation_next.find(h) == permutation_next.end()) {
             logger->error("a halfedge ({}) is next of zero halfedge", h->id);
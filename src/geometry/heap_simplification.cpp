@@ -0,0 +1,183 @@
+#include "halfedge.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "../utils/indexed_heap.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/quadric.hpp"
+
+using Eigen::Vector3f;
+using Eigen::Vector4f;
+using std::optional;
+using std::pair;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+namespace {
+
+// The collapse of an edge: the optimal position of the merged vertex and the error it brings.
+struct CollapseRecord
+{
+    CollapseRecord() = default;
+    CollapseRecord(const vector<Quadric>& vertex_quadrics, Edge* e) : edge(e)
+    {
+        const Vertex* v1 = e->halfedge->from;
+        const Vertex* v2 = e->halfedge->inv->from;
+        const Quadric q  = vertex_quadrics[v1->index] + vertex_quadrics[v2->index];
+        optimal_pos      = q.optimal_point(v1->pos, v2->pos);
+        cost             = q.error(optimal_pos);
+    }
+
+    bool operator<(const CollapseRecord& other) const
+    {
+        if (cost == other.cost) {
+            // Sort by edge id if cost are the same
+            return edge->id < other.edge->id;
+        }
+        return cost < other.cost;
+    }
+
+    Edge*    edge;
+    Vector3f optimal_pos;
+    float    cost;
+};
+
+} // namespace
+
+void HalfedgeMesh::heap_simplify(size_t target_faces, float max_error)
+{
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
+    if (check_result.has_value()) {
+        return;
+    }
+    logger->info("simplify object {} (ID: {}) with an indexed heap", object.name, object.id);
+    logger->info("original mesh: {} vertices, {} faces", vertices.size, faces.size);
+    size_t n_virtual_faces = 0;
+    for (const Face* f: faces) {
+        if (f->is_boundary) {
+            ++n_virtual_faces;
+        }
+    }
+    if (target_faces == 0) {
+        target_faces = (faces.size - n_virtual_faces) / 4;
+    }
+
+    // Compute an initial quadric for each vertex as the sum of the quadrics of the planes of its
+    // incident faces. A boundary edge also adds the plane through it perpendicular to its face,
+    // which keeps boundary vertices on the boundary. Each vertex only writes its own quadric, so
+    // the vertices are processed in parallel.
+    vector<Quadric> vertex_quadrics(vertices.capacity());
+    parallel_for(0, vertices.capacity(), [&](size_t index) {
+        if (!vertices.is_alive(static_cast<uint32_t>(index))) {
+            return;
+        }
+        const Vertex*   v = vertices[static_cast<uint32_t>(index)];
+        const Halfedge* h = v->halfedge;
+        do {
+            Vector3f normal = h->face->area_weighted_normal();
+            // Degenerate faces have no plane and are skipped.
+            if (!h->face->is_boundary && normal.squaredNorm() > 0.0f) {
+                normal.normalize();
+                vertex_quadrics[index] +=
+                    Quadric(Vector4f(normal.x(), normal.y(), normal.z(), -normal.dot(v->pos)));
+            }
+            if (h->is_boundary() != h->inv->is_boundary()) {
+                const Halfedge* inner     = h->is_boundary() ? h->inv : h;
+                const Vector3f  direction = h->inv->from->pos - v->pos;
+                Vector3f        side = direction.cross(inner->face->area_weighted_normal());
+                if (side.squaredNorm() > 0.0f) {
+                    side.normalize();
+                    vertex_quadrics[index] +=
+                        Quadric(Vector4f(side.x(), side.y(), side.z(), -side.dot(v->pos)));
+                }
+            }
+            h = h->inv->next;
+        } while (h != v->halfedge);
+    });
+
+    // Build a priority queue of edges according to their quadric error cost, indexed by the
+    // edge handles so that the records can be updated in place.
+    vector<CollapseRecord> records(edges.capacity());
+    vector<uint32_t>       edge_handles;
+    edge_handles.reserve(edges.size);
+    for (const Edge* e: edges) {
+        edge_handles.push_back(e->index);
+    }
+    parallel_for(0, edge_handles.size(), [&](size_t i) {
+        records[edge_handles[i]] = CollapseRecord(vertex_quadrics, edges[edge_handles[i]]);
+    });
+    IndexedHeap<CollapseRecord> edge_queue;
+    edge_queue.assign(std::move(edge_handles), std::move(records));
+
+    // Until we reach the target face budget or the error bound, collapse the best edge.
+    vector<uint32_t>                       neighbors;
+    vector<pair<uint32_t, CollapseRecord>> removed;
+    size_t                                 n_collapses = 0;
+    while (faces.size - n_virtual_faces > target_faces && !edge_queue.empty()) {
+        const uint32_t       handle = edge_queue.top();
+        const CollapseRecord record = edge_queue.value(handle);
+        if (record.cost > max_error) {
+            break;
+        }
+        edge_queue.pop();
+        // Remove from the queue every edge touching the collapsing edge before it gets
+        // collapsed, since these edges either disappear or get a new endpoint.
+        Vertex*       v1 = record.edge->halfedge->from;
+        Vertex*       v2 = record.edge->halfedge->inv->from;
+        const Quadric q  = vertex_quadrics[v1->index] + vertex_quadrics[v2->index];
+        neighbors.clear();
+        for (const Vertex* v: {v1, v2}) {
+            const Halfedge* h = v->halfedge;
+            do {
+                if (h->edge != record.edge) {
+                    neighbors.push_back(h->edge->index);
+                }
+                h = h->inv->next;
+            } while (h != v->halfedge);
+        }
+        removed.clear();
+        for (const uint32_t neighbor: neighbors) {
+            if (edge_queue.contains(neighbor)) {
+                removed.emplace_back(neighbor, edge_queue.value(neighbor));
+                edge_queue.erase(neighbor);
+            }
+        }
+        record_around(record.edge);
+        optional<Vertex*> result = collapse_edge(record.edge);
+        if (!result.has_value()) {
+            // The edge cannot be collapsed, leave it out of the queue and restore its neighbors.
+            for (const auto& [neighbor, neighbor_record]: removed) {
+                edge_queue.push(neighbor, neighbor_record);
+            }
+            continue;
+        }
+        ++n_collapses;
+        // Assign the quadric and the optimal position to the collapsed vertex, and add back
+        // into the queue every edge touching it.
+        Vertex* v = result.value();
+        v->pos    = record.optimal_pos;
+        if (v->index >= vertex_quadrics.size()) {
+            vertex_quadrics.resize(vertices.capacity());
+        }
+        vertex_quadrics[v->index] = q;
+
+        const Halfedge* h = v->halfedge;
+        do {
+            edge_queue.push(h->edge->index, CollapseRecord(vertex_quadrics, h->edge));
+            h = h->inv->next;
+        } while (h != v->halfedge);
+    }
+
+    logger->info(
+        "simplified mesh: {} vertices, {} faces ({} edges collapsed)", vertices.size, faces.size,
+        n_collapses
+    );
+    logger->info("simplification done\n");
+    global_inconsistent = true;
+    validate_by_level();
+}
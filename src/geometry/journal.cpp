@@ -0,0 +1,413 @@
+#include "halfedge.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <Eigen/Core>
+
+using std::size_t;
+using std::uint32_t;
+using std::unordered_set;
+using std::vector;
+
+size_t HalfedgeMesh::max_history = 64;
+
+namespace {
+
+// Whether two states of an element have the same connectivity and position. The scratch fields
+// of global operations (is_new and new_pos) are not compared.
+bool same_state(const Halfedge& a, const Halfedge& b)
+{
+    return a.next == b.next && a.prev == b.prev && a.inv == b.inv && a.from == b.from
+        && a.edge == b.edge && a.face == b.face;
+}
+
+bool same_state(const Vertex& a, const Vertex& b)
+{
+    return a.halfedge == b.halfedge && a.pos == b.pos;
+}
+
+bool same_state(const Edge& a, const Edge& b)
+{
+    return a.halfedge == b.halfedge;
+}
+
+bool same_state(const Face& a, const Face& b)
+{
+    return a.halfedge == b.halfedge;
+}
+
+// Saves the state of an element the first time the current edit touches it. A created element
+// was not alive before, and its content is never read.
+template<typename Snapshots, typename Node>
+void save(
+    Snapshots& snapshots, unordered_set<const void*>& recorded, const ElementPool<Node>& pool,
+    Node* node, bool created
+)
+{
+    if (recorded.insert(node).second) {
+        snapshots.push_back({node, !created && pool.contains(node), *node});
+    }
+}
+
+// Keeps only the snapshots of elements whose state changed during the edit.
+template<typename Snapshots, typename Node>
+void drop_unchanged(Snapshots& snapshots, const ElementPool<Node>& pool)
+{
+    Snapshots changed;
+    for (auto& snapshot: snapshots) {
+        const bool alive = pool.contains(snapshot.node);
+        if (alive != snapshot.alive || (alive && !same_state(snapshot.content, *snapshot.node))) {
+            changed.push_back(std::move(snapshot));
+        }
+    }
+    snapshots = std::move(changed);
+}
+
+// Puts the saved states into the pool and keeps the replaced states instead, so the same call
+// undoes and redoes an edit.
+template<typename Snapshots, typename Node>
+void exchange(Snapshots& snapshots, ElementPool<Node>& pool)
+{
+    Snapshots current;
+    current.reserve(snapshots.size());
+    for (const auto& snapshot: snapshots) {
+        current.push_back({snapshot.node, pool.contains(snapshot.node), *snapshot.node});
+    }
+    for (const auto& snapshot: snapshots) {
+        if (snapshot.alive) {
+            pool.restore(snapshot.node, snapshot.content);
+        } else {
+            pool.erase(snapshot.node);
+        }
+    }
+    snapshots = std::move(current);
+}
+
+// Lists the slots of saved elements that are erased now, compaction has to keep them.
+template<typename Snapshots, typename Node>
+void list_dead_slots(
+    const Snapshots& snapshots, const ElementPool<Node>& pool, vector<uint32_t>& kept
+)
+{
+    for (const auto& snapshot: snapshots) {
+        if (!pool.contains(snapshot.node)) {
+            kept.push_back(snapshot.node->index);
+        }
+    }
+}
+
+// Redirects a pointer to the slot its target will occupy after compaction. The handle is read
+// from the target, so this has to happen before the pool moves anything. A target that is
+// neither alive nor kept loses its slot, and the pointer becomes null rather than pointing to
+// whichever element moves into the slot.
+template<typename Node>
+void relocate(Node*& element, const vector<uint32_t>& map, const ElementPool<Node>& pool)
+{
+    if (element == nullptr) {
+        return;
+    }
+    const uint32_t index    = element->index;
+    const bool     has_slot = index < map.size() && pool[index] == element
+                        && map[index] != ElementPool<Node>::invalid_index;
+    element = has_slot ? pool[map[index]] : nullptr;
+}
+
+} // namespace
+
+void HalfedgeMesh::begin_edit()
+{
+    if (max_history == 0) {
+        return;
+    }
+    current_edit.emplace();
+    recorded_elements.clear();
+}
+
+void HalfedgeMesh::record_around(Edge* e)
+{
+    if (!current_edit.has_value() || current_edit->rebuilt) {
+        return;
+    }
+    vector<Face*> region_faces;
+    for (Vertex* v: {e->halfedge->from, e->halfedge->inv->from}) {
+        Halfedge* h = v->halfedge;
+        do {
+            region_faces.push_back(h->face);
+            h = h->inv->next;
+        } while (h != v->halfedge);
+    }
+    for (Face* f: region_faces) {
+        record(f);
+        Halfedge* h = f->halfedge;
+        do {
+            record(h);
+            record(h->edge);
+            record(h->from);
+            h = h->next;
+        } while (h != f->halfedge);
+    }
+}
+
+void HalfedgeMesh::record_position(Vertex* v)
+{
+    record(v);
+}
+
+void HalfedgeMesh::end_edit()
+{
+    if (!current_edit.has_value()) {
+        return;
+    }
+    JournalEntry& entry = current_edit.value();
+    if (!entry.rebuilt) {
+        drop_unchanged(entry.halfedges, halfedges);
+        drop_unchanged(entry.vertices, vertices);
+        drop_unchanged(entry.edges, edges);
+        drop_unchanged(entry.faces, faces);
+    }
+    recorded_elements.clear();
+    const bool changed = entry.rebuilt || !entry.halfedges.empty() || !entry.vertices.empty()
+                      || !entry.edges.empty() || !entry.faces.empty();
+    if (changed) {
+        logger->debug(
+            "journal entry: {} halfedges, {} vertices, {} edges, {} faces, {} triangles",
+            entry.halfedges.size(), entry.vertices.size(), entry.edges.size(),
+            entry.faces.size(), entry.indices.size() / 3
+        );
+        undo_history.push_back(std::move(entry));
+        redo_history.clear();
+        while (undo_history.size() > max_history) {
+            undo_history.pop_front();
+        }
+    }
+    current_edit.reset();
+}
+
+bool HalfedgeMesh::cancel_edit()
+{
+    if (!current_edit.has_value()) {
+        return false;
+    }
+    JournalEntry entry = std::move(current_edit.value());
+    current_edit.reset();
+    recorded_elements.clear();
+    apply(entry);
+    logger->info("the current edit is canceled");
+    return true;
+}
+
+bool HalfedgeMesh::undo()
+{
+    if (undo_history.empty()) {
+        return false;
+    }
+    JournalEntry entry = std::move(undo_history.back());
+    undo_history.pop_back();
+    // Rebuilding destroys every element the operations undone before refer to.
+    if (entry.rebuilt) {
+        redo_history.clear();
+    }
+    apply(entry);
+    redo_history.push_back(std::move(entry));
+    logger->info("undo: {} operations left", undo_history.size());
+    return true;
+}
+
+bool HalfedgeMesh::redo()
+{
+    if (redo_history.empty()) {
+        return false;
+    }
+    JournalEntry entry = std::move(redo_history.back());
+    redo_history.pop_back();
+    if (entry.rebuilt) {
+        undo_history.clear();
+    }
+    apply(entry);
+    undo_history.push_back(std::move(entry));
+    logger->info("redo: {} operations left", redo_history.size());
+    return true;
+}
+
+bool HalfedgeMesh::can_undo() const
+{
+    return !undo_history.empty();
+}
+
+bool HalfedgeMesh::can_redo() const
+{
+    return !redo_history.empty();
+}
+
+void HalfedgeMesh::clear_history()
+{
+    undo_history.clear();
+    redo_history.clear();
+}
+
+void HalfedgeMesh::record(Halfedge* h, bool created)
+{
+    if (current_edit.has_value() && !current_edit->rebuilt) {
+        save(current_edit->halfedges, recorded_elements, halfedges, h, created);
+    }
+}
+
+void HalfedgeMesh::record(Vertex* v, bool created)
+{
+    if (current_edit.has_value() && !current_edit->rebuilt) {
+        save(current_edit->vertices, recorded_elements, vertices, v, created);
+    }
+}
+
+void HalfedgeMesh::record(Edge* e, bool created)
+{
+    if (current_edit.has_value() && !current_edit->rebuilt) {
+        save(current_edit->edges, recorded_elements, edges, e, created);
+    }
+}
+
+void HalfedgeMesh::record(Face* f, bool created)
+{
+    if (current_edit.has_value() && !current_edit->rebuilt) {
+        save(current_edit->faces, recorded_elements, faces, f, created);
+    }
+}
+
+void HalfedgeMesh::record_rebuild()
+{
+    undo_history.clear();
+    redo_history.clear();
+    if (!current_edit.has_value()) {
+        return;
+    }
+    JournalEntry entry;
+    entry.rebuilt = true;
+    flatten(entry.positions, entry.indices);
+    current_edit = std::move(entry);
+    recorded_elements.clear();
+}
+
+void HalfedgeMesh::apply(JournalEntry& entry)
+{
+    global_inconsistent = true;
+    if (entry.rebuilt) {
+        vector<float>        positions;
+        vector<unsigned int> indices;
+        flatten(positions, indices);
+        halfedges.clear();
+        vertices.clear();
+        edges.clear();
+        faces.clear();
+        build(entry.positions, entry.indices);
+        entry.positions = std::move(positions);
+        entry.indices   = std::move(indices);
+        return;
+    }
+    exchange(entry.halfedges, halfedges);
+    exchange(entry.vertices, vertices);
+    exchange(entry.edges, edges);
+    exchange(entry.faces, faces);
+    if (validation_level != ValidationLevel::LOCAL) {
+        validate_by_level();
+        return;
+    }
+    // Every changed element is on a face around the origin of some changed halfedge.
+    vector<Vertex*> seeds;
+    for (const Snapshot<Halfedge>& snapshot: entry.halfedges) {
+        if (halfedges.contains(snapshot.node)) {
+            seeds.push_back(snapshot.node->from);
+        }
+    }
+    for (const Snapshot<Vertex>& snapshot: entry.vertices) {
+        if (vertices.contains(snapshot.node)) {
+            seeds.push_back(snapshot.node);
+        }
+    }
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+    validate_locally(seeds);
+}
+
+void HalfedgeMesh::flatten(vector<float>& positions, vector<unsigned int>& indices) const
+{
+    vector<uint32_t> vertex_map(vertices.capacity());
+    positions.clear();
+    positions.reserve(3 * vertices.size);
+    for (Vertex* v: vertices) {
+        vertex_map[v->index] = static_cast<uint32_t>(positions.size() / 3);
+        positions.insert(positions.end(), v->pos.data(), v->pos.data() + 3);
+    }
+    indices.clear();
+    for (Face* f: faces) {
+        if (f->is_boundary) {
+            continue;
+        }
+        const Halfedge* h = f->halfedge;
+        do {
+            indices.push_back(vertex_map[h->from->index]);
+            h = h->next;
+        } while (h != f->halfedge);
+    }
+}
+
+void HalfedgeMesh::journal_dead_slots(
+    vector<uint32_t>& h_kept, vector<uint32_t>& v_kept, vector<uint32_t>& e_kept,
+    vector<uint32_t>& f_kept
+) const
+{
+    // Any element referred to by a saved state is either alive or saved itself, so listing the
+    // saved elements is enough.
+    const auto list_entry = [&](const JournalEntry& entry) {
+        list_dead_slots(entry.halfedges, halfedges, h_kept);
+        list_dead_slots(entry.vertices, vertices, v_kept);
+        list_dead_slots(entry.edges, edges, e_kept);
+        list_dead_slots(entry.faces, faces, f_kept);
+    };
+    std::for_each(undo_history.begin(), undo_history.end(), list_entry);
+    std::for_each(redo_history.begin(), redo_history.end(), list_entry);
+}
+
+void HalfedgeMesh::relocate_journal(
+    const vector<uint32_t>& h_map, const vector<uint32_t>& v_map, const vector<uint32_t>& e_map,
+    const vector<uint32_t>& f_map
+)
+{
+    const auto relocate_entry = [&](JournalEntry& entry) {
+        for (Snapshot<Halfedge>& snapshot: entry.halfedges) {
+            relocate(snapshot.node, h_map, halfedges);
+            if (snapshot.alive) {
+                Halfedge& h = snapshot.content;
+                relocate(h.next, h_map, halfedges);
+                relocate(h.prev, h_map, halfedges);
+                relocate(h.inv, h_map, halfedges);
+                relocate(h.from, v_map, vertices);
+                relocate(h.edge, e_map, edges);
+                relocate(h.face, f_map, faces);
+            }
+        }
+        for (Snapshot<Vertex>& snapshot: entry.vertices) {
+            relocate(snapshot.node, v_map, vertices);
+            if (snapshot.alive) {
+                relocate(snapshot.content.halfedge, h_map, halfedges);
+            }
+        }
+        for (Snapshot<Edge>& snapshot: entry.edges) {
+            relocate(snapshot.node, e_map, edges);
+            if (snapshot.alive) {
+                relocate(snapshot.content.halfedge, h_map, halfedges);
+            }
+        }
+        for (Snapshot<Face>& snapshot: entry.faces) {
+            relocate(snapshot.node, f_map, faces);
+            if (snapshot.alive) {
+                relocate(snapshot.content.halfedge, h_map, halfedges);
+            }
+        }
+    };
+    std::for_each(undo_history.begin(), undo_history.end(), relocate_entry);
+    std::for_each(redo_history.begin(), redo_history.end(), relocate_entry);
+}
@@ -0,0 +1,351 @@
+#include "halfedge.h"
+
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "../utils/logger.h"
+#include "../utils/parallel.hpp"
+
+using Eigen::Vector3f;
+using std::optional;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+using std::chrono::steady_clock;
+using duration   = std::chrono::duration<float>;
+using time_point = std::chrono::time_point<steady_clock, duration>;
+
+namespace {
+
+constexpr uint32_t NO_HALFEDGE = std::numeric_limits<uint32_t>::max();
+
+// A triangle mesh stored in flat arrays. As in the construction of HalfedgeMesh, halfedge 3f + i
+// goes from the i-th corner of face f to the next corner.
+struct TriangleMesh
+{
+    vector<Vector3f> positions;
+    // the vertex at each corner, which is also the vertex each halfedge starts from
+    vector<uint32_t> corners;
+    // the opposite halfedge of each halfedge, NO_HALFEDGE on the boundary
+    vector<uint32_t> inv;
+    // the edge of each halfedge
+    vector<uint32_t> edge;
+    // the canonical halfedge of each edge
+    vector<uint32_t> edge_halfedge;
+    // one halfedge starting from each vertex
+    vector<uint32_t> vertex_halfedge;
+};
+
+uint32_t next(uint32_t h)
+{
+    return h - h % 3 + (h + 1) % 3;
+}
+
+uint32_t prev(uint32_t h)
+{
+    return h - h % 3 + (h + 2) % 3;
+}
+
+// Each face f is split into the corner faces 4f + k (k = 0, 1, 2), which hold corner k and the
+// new vertices m_k, m_{k+2} on the two edges next to it, and the center face 4f + 3 holding
+// m_0, m_1, m_2, where m_k is the new vertex on halfedge 3f + k. Halfedge h = 3f + k is split
+// into the two halves returned below.
+uint32_t first_half(uint32_t h)
+{
+    return 3 * (4 * (h / 3) + h % 3);
+}
+
+uint32_t second_half(uint32_t h)
+{
+    const uint32_t f = h / 3;
+    const uint32_t k = h % 3;
+    return 3 * (4 * f + (k + 1) % 3) + 2;
+}
+
+// The halfedge of the center face going from m_j to m_{j+1}.
+uint32_t center_halfedge(uint32_t f, uint32_t j)
+{
+    return 12 * f + 9 + j;
+}
+
+// The halfedge of a corner face going from m_k to m_{k+2}.
+uint32_t inner_halfedge(uint32_t f, uint32_t k)
+{
+    return 12 * f + 3 * k + 1;
+}
+
+// Even vertices follow the Loop rule: an interior vertex of degree n moves to
+// (1 - n * beta) * p + beta * (sum of the neighbors), with beta = 3 / 16 if n = 3 and
+// 3 / (8n) otherwise, while a boundary vertex moves to 3/4 * p + 1/8 * (its two boundary
+// neighbors).
+Vector3f even_position(const TriangleMesh& mesh, uint32_t v)
+{
+    const vector<Vector3f>& positions = mesh.positions;
+    const uint32_t          start     = mesh.vertex_halfedge[v];
+    Vector3f                sum(0.0f, 0.0f, 0.0f);
+    uint32_t                n = 0;
+    uint32_t                h = start;
+    uint32_t                last;
+    // Turn around v until the walk returns to the start or leaves the mesh across the boundary.
+    do {
+        sum += positions[mesh.corners[next(h)]];
+        ++n;
+        last = h;
+        h    = mesh.inv[prev(h)];
+    } while (h != NO_HALFEDGE && h != start);
+    if (h == start) {
+        const float beta = n == 3 ? 3.0f / 16.0f : 3.0f / (8.0f * static_cast<float>(n));
+        return (1.0f - static_cast<float>(n) * beta) * positions[v] + beta * sum;
+    }
+    // Turn the other way round to the boundary halfedge starting from v.
+    h = start;
+    while (mesh.inv[h] != NO_HALFEDGE) {
+        h = next(mesh.inv[h]);
+    }
+    const Vector3f& a = positions[mesh.corners[prev(last)]];
+    const Vector3f& b = positions[mesh.corners[next(h)]];
+    return 0.75f * positions[v] + 0.125f * (a + b);
+}
+
+// Odd vertices are placed at 3/8 * (a + b) + 1/8 * (c + d) on an interior edge ab whose
+// adjacent faces hold the opposite vertices c and d, and at the midpoint of a boundary edge.
+Vector3f odd_position(const TriangleMesh& mesh, uint32_t e)
+{
+    const vector<Vector3f>& positions = mesh.positions;
+    const uint32_t          h         = mesh.edge_halfedge[e];
+    const Vector3f&         a         = positions[mesh.corners[h]];
+    const Vector3f&         b         = positions[mesh.corners[next(h)]];
+    const uint32_t          g         = mesh.inv[h];
+    if (g == NO_HALFEDGE) {
+        return 0.5f * (a + b);
+    }
+    const Vector3f& c = positions[mesh.corners[prev(h)]];
+    const Vector3f& d = positions[mesh.corners[prev(g)]];
+    return 0.375f * (a + b) + 0.125f * (c + d);
+}
+
+// One level of Loop subdivision. Vertex v keeps its index, the new vertex on edge e gets the
+// index n_vertices + e, edge e is split into the edges 2e and 2e + 1 and the three edges inside
+// face f get the indices 2 * n_edges + 3f + j.
+TriangleMesh subdivide(const TriangleMesh& coarse, unsigned int n_threads)
+{
+    const size_t n_vertices = coarse.positions.size();
+    const size_t n_edges    = coarse.edge_halfedge.size();
+    const size_t n_faces    = coarse.corners.size() / 3;
+    TriangleMesh fine;
+    fine.positions.resize(n_vertices + n_edges);
+    fine.corners.resize(12 * n_faces);
+    fine.inv.resize(12 * n_faces);
+    fine.edge.resize(12 * n_faces);
+    fine.edge_halfedge.resize(2 * n_edges + 3 * n_faces);
+    fine.vertex_halfedge.resize(n_vertices + n_edges);
+
+    parallel_for(
+        0, n_vertices,
+        [&](size_t v) {
+            fine.positions[v]       = even_position(coarse, static_cast<uint32_t>(v));
+            fine.vertex_halfedge[v] = first_half(coarse.vertex_halfedge[v]);
+        },
+        n_threads
+    );
+    parallel_for(
+        0, n_edges,
+        [&](size_t e) {
+            const uint32_t h                     = coarse.edge_halfedge[e];
+            fine.positions[n_vertices + e]       = odd_position(coarse, static_cast<uint32_t>(e));
+            fine.vertex_halfedge[n_vertices + e] = second_half(h);
+            fine.edge_halfedge[2 * e]            = first_half(h);
+            fine.edge_halfedge[2 * e + 1]        = second_half(h);
+        },
+        n_threads
+    );
+    parallel_for(
+        0, n_faces,
+        [&](size_t index) {
+            const uint32_t f = static_cast<uint32_t>(index);
+            uint32_t       m[3];
+            for (uint32_t k = 0; k < 3; ++k) {
+                m[k] = static_cast<uint32_t>(n_vertices) + coarse.edge[3 * f + k];
+            }
+            for (uint32_t k = 0; k < 3; ++k) {
+                const uint32_t h         = 3 * f + k;
+                const uint32_t g         = coarse.inv[h];
+                const uint32_t e         = coarse.edge[h];
+                const bool     canonical = coarse.edge_halfedge[e] == h;
+                const uint32_t first     = first_half(h);
+                const uint32_t second    = second_half(h);
+                // corner face k
+                fine.corners[12 * f + 3 * k]     = coarse.corners[h];
+                fine.corners[12 * f + 3 * k + 1] = m[k];
+                fine.corners[12 * f + 3 * k + 2] = m[(k + 2) % 3];
+                // The halves of h are opposite to the halves of g in reversed order.
+                fine.inv[first]   = g == NO_HALFEDGE ? NO_HALFEDGE : second_half(g);
+                fine.inv[second]  = g == NO_HALFEDGE ? NO_HALFEDGE : first_half(g);
+                fine.edge[first]  = canonical ? 2 * e : 2 * e + 1;
+                fine.edge[second] = canonical ? 2 * e + 1 : 2 * e;
+                // the edge from m_k to m_{k+2}, shared with the center face
+                const uint32_t inner     = inner_halfedge(f, k);
+                const uint32_t center    = center_halfedge(f, (k + 2) % 3);
+                const uint32_t edge      = static_cast<uint32_t>(2 * n_edges) + 3 * f + (k + 2) % 3;
+                fine.corners[center]     = m[(k + 2) % 3];
+                fine.inv[inner]          = center;
+                fine.inv[center]         = inner;
+                fine.edge[inner]         = edge;
+                fine.edge[center]        = edge;
+                fine.edge_halfedge[edge] = center;
+            }
+        },
+        n_threads
+    );
+    return fine;
+}
+
+} // namespace
+
+void HalfedgeMesh::parallel_loop_subdivide(size_t n_levels)
+{
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
+    if (check_result.has_value()) {
+        return;
+    }
+    time_point begin_time = steady_clock::now();
+    logger->info(
+        "subdivide object {} (ID: {}) with {} levels of parallel Loop Subdivision", object.name,
+        object.id, n_levels
+    );
+    logger->info("original mesh: {} vertices, {} faces in total", vertices.size, faces.size);
+
+    // Copy the mesh into flat arrays.
+    vector<Face*> face_list;
+    for (Face* f: faces) {
+        if (f->is_boundary) {
+            continue;
+        }
+        if (f->halfedge->next->next->next != f->halfedge) {
+            logger->warn("face {} is not a triangle, Loop Subdivision is not applicable", f->id);
+            return;
+        }
+        face_list.push_back(f);
+    }
+    vector<Vertex*>  vertex_list;
+    vector<uint32_t> vertex_map(vertices.capacity());
+    for (Vertex* v: vertices) {
+        vertex_map[v->index] = static_cast<uint32_t>(vertex_list.size());
+        vertex_list.push_back(v);
+    }
+    vector<Edge*>    edge_list;
+    vector<uint32_t> edge_map(edges.capacity());
+    for (Edge* e: edges) {
+        edge_map[e->index] = static_cast<uint32_t>(edge_list.size());
+        edge_list.push_back(e);
+    }
+    const size_t      n_faces = face_list.size();
+    TriangleMesh      flat;
+    vector<Halfedge*> halfedge_list(3 * n_faces);
+    // Halfedges on the virtual faces are left as NO_HALFEDGE.
+    vector<uint32_t> halfedge_map(halfedges.capacity(), NO_HALFEDGE);
+    flat.positions.resize(vertex_list.size());
+    flat.corners.resize(3 * n_faces);
+    flat.inv.resize(3 * n_faces);
+    flat.edge.resize(3 * n_faces);
+    flat.edge_halfedge.resize(edge_list.size());
+    flat.vertex_halfedge.resize(vertex_list.size());
+    parallel_for(0, n_faces, [&](size_t f) {
+        Halfedge* h = face_list[f]->halfedge;
+        for (size_t i = 0; i < 3; ++i) {
+            const uint32_t index   = static_cast<uint32_t>(3 * f + i);
+            halfedge_list[index]   = h;
+            halfedge_map[h->index] = index;
+            flat.corners[index]    = vertex_map[h->from->index];
+            flat.edge[index]       = edge_map[h->edge->index];
+            h                      = h->next;
+        }
+    });
+    parallel_for(0, 3 * n_faces, [&](size_t h) {
+        flat.inv[h] = halfedge_map[halfedge_list[h]->inv->index];
+    });
+    parallel_for(0, edge_list.size(), [&](size_t e) {
+        const Halfedge* h     = edge_list[e]->halfedge;
+        const uint32_t  index = halfedge_map[h->index];
+        flat.edge_halfedge[e] = index != NO_HALFEDGE ? index : halfedge_map[h->inv->index];
+    });
+    parallel_for(0, vertex_list.size(), [&](size_t v) {
+        const Vertex*   vertex = vertex_list[v];
+        const Halfedge* h      = vertex->halfedge;
+        // A halfedge on a virtual face is replaced by the next halfedge starting from v.
+        if (h->face->is_boundary) {
+            h = h->inv->next;
+        }
+        flat.positions[v]       = vertex->pos;
+        flat.vertex_halfedge[v] = halfedge_map[h->index];
+    });
+
+    for (size_t level = 0; level < n_levels; ++level) {
+        flat = subdivide(flat, 0);
+        logger->debug(
+            "level {}: {} vertices, {} faces", level + 1, flat.positions.size(),
+            flat.corners.size() / 3
+        );
+    }
+
+    // Rebuild the halfedge mesh from the flat arrays. The pools are empty, so every element gets
+    // its index in the arrays as the handle.
+    record_rebuild();
+    halfedges.clear();
+    vertices.clear();
+    edges.clear();
+    faces.clear();
+    const size_t n_vertices  = flat.positions.size();
+    const size_t n_halfedges = flat.corners.size();
+    v_pointers.resize(n_vertices);
+    v_indices.resize(n_vertices);
+    for (size_t index = 0; index < n_vertices; ++index) {
+        v_pointers[index] = new_vertex();
+    }
+    for (size_t index = 0; index < n_halfedges / 3; ++index) {
+        new_face();
+    }
+    for (size_t index = 0; index < n_halfedges; ++index) {
+        new_halfedge();
+    }
+    for (size_t index = 0; index < flat.edge_halfedge.size(); ++index) {
+        new_edge();
+    }
+    parallel_for(0, n_vertices, [&](size_t index) {
+        Vertex* v           = v_pointers[index];
+        v->pos              = flat.positions[index];
+        v->halfedge         = halfedges[flat.vertex_halfedge[index]];
+        v_indices[v->index] = static_cast<uint32_t>(index);
+    });
+    parallel_for(0, n_halfedges, [&](size_t index) {
+        const uint32_t i = static_cast<uint32_t>(index);
+        Halfedge*      h = halfedges[i];
+        h->next          = halfedges[next(i)];
+        h->prev          = halfedges[prev(i)];
+        h->from          = v_pointers[flat.corners[i]];
+        h->face          = faces[i / 3];
+        h->edge          = edges[flat.edge[i]];
+        h->inv           = flat.inv[i] == NO_HALFEDGE ? nullptr : halfedges[flat.inv[i]];
+        if (i % 3 == 0) {
+            h->face->halfedge = h;
+        }
+    });
+    parallel_for(0, flat.edge_halfedge.size(), [&](size_t index) {
+        edges[static_cast<uint32_t>(index)]->halfedge = halfedges[flat.edge_halfedge[index]];
+    });
+    create_boundary_loops();
+
+    global_inconsistent = true;
+    const duration subdivision_duration = steady_clock::now() - begin_time;
+    logger->info(
+        "subdivided mesh: {} vertices, {} faces in total ({:.3f} seconds)", vertices.size,
+        faces.size, subdivision_duration.count()
+    );
+    logger->info("Loop Subdivision done");
+    logger->info("");
+    validate_by_level();
+}
@@ -57,7 +57,7 @@ optional<Vertex*> HalfedgeMesh::collapse_edge(Edge* e)
 
 void HalfedgeMesh::loop_subdivide()
 {
-    optional<HalfedgeMeshFailure> check_result = validate();
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
     if (check_result.has_value()) {
         return;
     }
@@ -65,6 +65,8 @@ void HalfedgeMesh::loop_subdivide()
         "subdivide object {} (ID: {}) with Loop Subdivision strategy", object.name, object.id
     );
     logger->info("original mesh: {} vertices, {} faces in total", vertices.size, faces.size);
+    // Subdivision touches every element, so the whole mesh is saved compactly for undoing.
+    record_rebuild();
     // Each vertex and edge of the original mesh can be associated with a vertex
     // in the new (subdivided) mesh.
     // Therefore, our strategy for computing the subdivided vertex locations is to
@@ -103,17 +105,19 @@ void HalfedgeMesh::loop_subdivide()
     logger->info("subdivided mesh: {} vertices, {} faces in total", vertices.size, faces.size);
     logger->info("Loop Subdivision done");
     logger->info("");
-    validate();
+    validate_by_level();
 }
 
 void HalfedgeMesh::simplify()
 {
-    optional<HalfedgeMeshFailure> check_result = validate();
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
     if (check_result.has_value()) {
         return;
     }
     logger->info("simplify object {} (ID: {})", object.name, object.id);
     logger->info("original mesh: {} vertices, {} faces", vertices.size, faces.size);
+    // Simplification may touch every element, so the whole mesh is saved compactly for undoing.
+    record_rebuild();
     unordered_map<Vertex*, Matrix4f> vertex_quadrics;
     unordered_map<Face*, Matrix4f>   face_quadrics;
     unordered_map<Edge*, EdgeRecord> edge_records;
@@ -140,12 +144,12 @@ void HalfedgeMesh::simplify()
     logger->info("simplified mesh: {} vertices, {} faces", vertices.size, faces.size);
     logger->info("simplification done\n");
     global_inconsistent = true;
-    validate();
+    validate_by_level();
 }
 
 void HalfedgeMesh::isotropic_remesh()
 {
-    optional<HalfedgeMeshFailure> check_result = validate();
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
     if (check_result.has_value()) {
         return;
     }
@@ -153,6 +157,8 @@ void HalfedgeMesh::isotropic_remesh()
         "remesh the object {} (ID: {}) with strategy Isotropic Remeshing", object.name, object.id
     );
     logger->info("original mesh: {} vertices, {} faces", vertices.size, faces.size);
+    // Remeshing touches every element, so the whole mesh is saved compactly for undoing.
+    record_rebuild();
     // Compute the mean edge length.
 
     // Repeat the four main steps for 5 or 6 iterations
@@ -176,5 +182,5 @@ void HalfedgeMesh::isotropic_remesh()
     }
     logger->info("remeshed mesh: {} vertices, {} faces\n", vertices.size, faces.size);
     global_inconsistent = true;
-    validate();
+    validate_by_level();
 }
@@ -0,0 +1,843 @@
+#include "halfedge.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "../utils/logger.h"
+#include "../utils/parallel.hpp"
+
+using Eigen::Matrix3f;
+using Eigen::Vector3f;
+using std::optional;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+using std::chrono::steady_clock;
+using duration   = std::chrono::duration<float>;
+using time_point = std::chrono::time_point<steady_clock, duration>;
+
+namespace {
+
+constexpr uint32_t NO_HALFEDGE = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t REMOVED     = std::numeric_limits<uint32_t>::max();
+constexpr uint32_t NO_COLOR    = std::numeric_limits<uint32_t>::max();
+constexpr uint64_t NO_CLAIM    = std::numeric_limits<uint64_t>::max();
+// Splitting and collapsing are repeated until no edge is out of range, but at most this many
+// rounds per iteration.
+constexpr size_t MAX_ROUNDS = 16;
+
+// A triangle mesh stored in flat arrays that supports local edits. As in the construction of
+// HalfedgeMesh, halfedge 3f + i goes from the i-th corner of face f to the next corner. A removed
+// face has all its corners set to REMOVED, a removed vertex has no halfedge.
+struct RemeshMesh
+{
+    vector<Vector3f> positions;
+    // the vertex at each corner, which is also the vertex each halfedge starts from
+    vector<uint32_t> corners;
+    // the opposite halfedge of each halfedge, NO_HALFEDGE on the boundary
+    vector<uint32_t> inv;
+    // one halfedge starting from each vertex, on the boundary always the one without an opposite
+    // halfedge so that walks around the vertex can start from it
+    vector<uint32_t> vertex_halfedge;
+};
+
+uint32_t next(uint32_t h)
+{
+    return h - h % 3 + (h + 1) % 3;
+}
+
+uint32_t prev(uint32_t h)
+{
+    return h - h % 3 + (h + 2) % 3;
+}
+
+void link(RemeshMesh& mesh, uint32_t h, uint32_t g)
+{
+    if (h != NO_HALFEDGE) {
+        mesh.inv[h] = g;
+    }
+    if (g != NO_HALFEDGE) {
+        mesh.inv[g] = h;
+    }
+}
+
+float length(const RemeshMesh& mesh, uint32_t h)
+{
+    return (mesh.positions[mesh.corners[next(h)]] - mesh.positions[mesh.corners[h]]).norm();
+}
+
+// Finds the halfedge starting from v without an opposite halfedge, or returns any halfedge starting
+// from v if there is none.
+uint32_t first_outgoing(const RemeshMesh& mesh, uint32_t v)
+{
+    const uint32_t start = mesh.vertex_halfedge[v];
+    uint32_t       h     = start;
+    while (mesh.inv[h] != NO_HALFEDGE) {
+        h = next(mesh.inv[h]);
+        if (h == start) {
+            break;
+        }
+    }
+    return h;
+}
+
+bool on_boundary(const RemeshMesh& mesh, uint32_t v)
+{
+    return mesh.inv[mesh.vertex_halfedge[v]] == NO_HALFEDGE;
+}
+
+// Calls visit(h) for every halfedge h starting from v in order. Returns the last one.
+template<typename Visitor>
+uint32_t for_each_outgoing(const RemeshMesh& mesh, uint32_t v, Visitor&& visit)
+{
+    const uint32_t first = mesh.vertex_halfedge[v];
+    uint32_t       h     = first;
+    while (true) {
+        visit(h);
+        const uint32_t g = mesh.inv[prev(h)];
+        if (g == NO_HALFEDGE || g == first) {
+            return h;
+        }
+        h = g;
+    }
+}
+
+// Collects the neighbors of v, the degree of v is the size of the result.
+void one_ring(const RemeshMesh& mesh, uint32_t v, vector<uint32_t>& ring)
+{
+    ring.clear();
+    const uint32_t last = for_each_outgoing(mesh, v, [&](uint32_t h) {
+        ring.push_back(mesh.corners[next(h)]);
+    });
+    // On the boundary the last neighbor is only reached by an incoming halfedge.
+    if (mesh.inv[prev(last)] == NO_HALFEDGE) {
+        ring.push_back(mesh.corners[prev(last)]);
+    }
+}
+
+Vector3f face_normal(const RemeshMesh& mesh, uint32_t f)
+{
+    const Vector3f& a = mesh.positions[mesh.corners[3 * f]];
+    const Vector3f& b = mesh.positions[mesh.corners[3 * f + 1]];
+    const Vector3f& c = mesh.positions[mesh.corners[3 * f + 2]];
+    return (b - a).cross(c - a);
+}
+
+void atomic_min(std::atomic<uint64_t>& target, uint64_t value)
+{
+    uint64_t current = target.load(std::memory_order_relaxed);
+    while (value < current
+           && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Collects the items pushed by produce(first, last, items) for the index range [first, last) of
+// each chunk in parallel. Every chunk fills its own array and the arrays are concatenated in
+// order, so the result does not depend on the number of threads.
+template<typename Producer>
+vector<uint32_t> gather(size_t n, Producer&& produce)
+{
+    vector<vector<uint32_t>> parts(parallel_chunk_count(n, 0));
+    parallel_for_chunks(0, n, [&](size_t first, size_t last, size_t chunk) {
+        produce(first, last, parts[chunk]);
+    });
+    vector<uint32_t> items;
+    for (const vector<uint32_t>& part: parts) {
+        items.insert(items.end(), part.begin(), part.end());
+    }
+    return items;
+}
+
+// Keeps the candidates holding the smallest priority on every vertex they touch, so no two kept
+// candidates share a vertex and they can be applied concurrently. touched(candidate, vertices)
+// lists the vertices a candidate reads or writes around, priorities must be distinct.
+template<typename Touched>
+vector<uint32_t> independent_set(
+    const vector<uint32_t>& candidates, const vector<uint64_t>& priorities, size_t n_vertices,
+    Touched&& touched
+)
+{
+    vector<std::atomic<uint64_t>> claims(n_vertices);
+    parallel_for(0, n_vertices, [&](size_t v) {
+        claims[v].store(NO_CLAIM, std::memory_order_relaxed);
+    });
+    parallel_for_chunks(0, candidates.size(), [&](size_t first, size_t last, size_t) {
+        vector<uint32_t> vertices;
+        for (size_t i = first; i < last; ++i) {
+            touched(candidates[i], vertices);
+            for (const uint32_t v: vertices) {
+                atomic_min(claims[v], priorities[i]);
+            }
+        }
+    });
+    return gather(candidates.size(), [&](size_t first, size_t last, vector<uint32_t>& kept) {
+        vector<uint32_t> vertices;
+        for (size_t i = first; i < last; ++i) {
+            touched(candidates[i], vertices);
+            const bool won = std::all_of(vertices.begin(), vertices.end(), [&](uint32_t v) {
+                return claims[v].load(std::memory_order_relaxed) == priorities[i];
+            });
+            if (won) {
+                kept.push_back(candidates[i]);
+            }
+        }
+    });
+}
+
+// Colors the vertices such that vertices at most `distance` (1 or 2) edges apart get different
+// colors, by the parallel algorithm of Jones and Plassmann: in each round an uncolored vertex
+// whose priority is higher than those of all its uncolored neighbors takes the smallest free
+// color. Returns the vertices of each color.
+vector<vector<uint32_t>> color_vertices(const RemeshMesh& mesh, unsigned int distance)
+{
+    const size_t n_vertices = mesh.positions.size();
+    // The one-rings are walked in every round, so they are stored in compressed rows first.
+    vector<uint32_t> offsets(n_vertices + 1, 0);
+    parallel_for_chunks(0, n_vertices, [&](size_t first, size_t last, size_t) {
+        vector<uint32_t> ring;
+        for (size_t v = first; v < last; ++v) {
+            if (mesh.vertex_halfedge[v] != NO_HALFEDGE) {
+                one_ring(mesh, static_cast<uint32_t>(v), ring);
+                offsets[v + 1] = static_cast<uint32_t>(ring.size());
+            }
+        }
+    });
+    for (size_t v = 0; v < n_vertices; ++v) {
+        offsets[v + 1] += offsets[v];
+    }
+    vector<uint32_t> neighbors(offsets[n_vertices]);
+    parallel_for_chunks(0, n_vertices, [&](size_t first, size_t last, size_t) {
+        vector<uint32_t> ring;
+        for (size_t v = first; v < last; ++v) {
+            if (mesh.vertex_halfedge[v] != NO_HALFEDGE) {
+                one_ring(mesh, static_cast<uint32_t>(v), ring);
+                std::copy(ring.begin(), ring.end(), neighbors.begin() + offsets[v]);
+            }
+        }
+    });
+    // Visits the vertices within `distance` edges of v, possibly more than once.
+    const auto for_each_nearby = [&](uint32_t v, auto&& visit) {
+        for (uint32_t i = offsets[v]; i < offsets[v + 1]; ++i) {
+            visit(neighbors[i]);
+            if (distance > 1) {
+                for (uint32_t k = offsets[neighbors[i]]; k < offsets[neighbors[i] + 1]; ++k) {
+                    visit(neighbors[k]);
+                }
+            }
+        }
+    };
+
+    vector<uint32_t> colors(n_vertices, NO_COLOR);
+    vector<char>     selected(n_vertices, false);
+    vector<uint32_t> remaining = gather(n_vertices, [&](size_t first, size_t last, auto& alive) {
+        for (size_t v = first; v < last; ++v) {
+            if (mesh.vertex_halfedge[v] != NO_HALFEDGE) {
+                alive.push_back(static_cast<uint32_t>(v));
+            }
+        }
+    });
+    uint32_t n_colors = 0;
+    while (!remaining.empty()) {
+        parallel_for(0, remaining.size(), [&](size_t i) {
+            const uint32_t v        = remaining[i];
+            const uint64_t priority = mix_bits(v);
+            bool           highest  = true;
+            for_each_nearby(v, [&](uint32_t x) {
+                if (x != v && colors[x] == NO_COLOR && mix_bits(x) > priority) {
+                    highest = false;
+                }
+            });
+            selected[v] = highest;
+        });
+        // Selected vertices are never close to each other, so each one sees the final colors of
+        // its neighborhood.
+        parallel_for_chunks(0, remaining.size(), [&](size_t first, size_t last, size_t) {
+            vector<char> used;
+            for (size_t i = first; i < last; ++i) {
+                const uint32_t v = remaining[i];
+                if (!selected[v]) {
+                    continue;
+                }
+                used.assign(used.size(), false);
+                for_each_nearby(v, [&](uint32_t x) {
+                    if (x != v && colors[x] != NO_COLOR) {
+                        if (colors[x] >= used.size()) {
+                            used.resize(colors[x] + 1, false);
+                        }
+                        used[colors[x]] = true;
+                    }
+                });
+                colors[v] = static_cast<uint32_t>(
+                    std::find(used.begin(), used.end(), false) - used.begin()
+                );
+            }
+        });
+        vector<uint32_t> uncolored;
+        for (const uint32_t v: remaining) {
+            if (colors[v] == NO_COLOR) {
+                uncolored.push_back(v);
+            } else {
+                n_colors = std::max(n_colors, colors[v] + 1);
+            }
+        }
+        remaining.swap(uncolored);
+    }
+    vector<vector<uint32_t>> classes(n_colors);
+    for (uint32_t v = 0; v < n_vertices; ++v) {
+        if (colors[v] != NO_COLOR) {
+            classes[colors[v]].push_back(v);
+        }
+    }
+    return classes;
+}
+
+// Splits the edge of halfedge h at its midpoint into the new vertex m. The new faces F and F + 1
+// hold the halves next to the head of h, F + 1 is left removed on a boundary edge.
+void split(RemeshMesh& mesh, uint32_t h, uint32_t m, uint32_t F)
+{
+    const uint32_t g  = mesh.inv[h];
+    const uint32_t a  = mesh.corners[h];
+    const uint32_t b  = mesh.corners[next(h)];
+    const uint32_t c  = mesh.corners[prev(h)];
+    const uint32_t f1 = 3 * F;
+    const uint32_t f2 = 3 * (F + 1);
+    mesh.positions[m] = 0.5f * (mesh.positions[a] + mesh.positions[b]);
+    // face (a, b, c) becomes (a, m, c) and the new face (m, b, c)
+    const uint32_t y      = mesh.inv[next(h)];
+    mesh.corners[next(h)] = m;
+    mesh.corners[f1]      = m;
+    mesh.corners[f1 + 1]  = b;
+    mesh.corners[f1 + 2]  = c;
+    link(mesh, f1 + 1, y);
+    link(mesh, next(h), f1 + 2);
+    mesh.vertex_halfedge[m] = f1;
+    // Halfedges next(h) and g now start from m, f1 + 1 replaces next(h) on the boundary.
+    if (mesh.vertex_halfedge[b] == next(h) || mesh.vertex_halfedge[b] == g) {
+        mesh.vertex_halfedge[b] = f1 + 1;
+    }
+    if (g == NO_HALFEDGE) {
+        std::fill_n(mesh.corners.begin() + f2, 3, REMOVED);
+        std::fill_n(mesh.inv.begin() + f2, 3, NO_HALFEDGE);
+        mesh.inv[f1] = NO_HALFEDGE;
+        return;
+    }
+    // face (b, a, d) becomes (m, a, d) and the new face (b, m, d)
+    const uint32_t d     = mesh.corners[prev(g)];
+    const uint32_t z     = mesh.inv[prev(g)];
+    mesh.corners[g]      = m;
+    mesh.corners[f2]     = b;
+    mesh.corners[f2 + 1] = m;
+    mesh.corners[f2 + 2] = d;
+    link(mesh, f2 + 2, z);
+    link(mesh, prev(g), f2 + 1);
+    link(mesh, f1, f2);
+    // On the boundary f2 + 2 takes over the role of prev(g), which gets an opposite halfedge.
+    if (mesh.vertex_halfedge[d] == prev(g)) {
+        mesh.vertex_halfedge[d] = f2 + 2;
+    }
+}
+
+// Flips the edge of halfedge h, so faces (a, b, c) and (b, a, d) become (d, b, c) and (c, a, d).
+void flip(RemeshMesh& mesh, uint32_t h)
+{
+    const uint32_t g  = mesh.inv[h];
+    const uint32_t a  = mesh.corners[h];
+    const uint32_t b  = mesh.corners[next(h)];
+    const uint32_t c  = mesh.corners[prev(h)];
+    const uint32_t d  = mesh.corners[prev(g)];
+    const uint32_t x1 = mesh.inv[prev(g)];
+    const uint32_t x2 = mesh.inv[prev(h)];
+    mesh.corners[h]   = d;
+    mesh.corners[g]   = c;
+    link(mesh, h, x1);
+    link(mesh, g, x2);
+    link(mesh, prev(h), prev(g));
+    // Halfedges h and g now start from d and c, while prev(h) and prev(g) get opposite halfedges
+    // and pass their roles on the boundary to g and h.
+    const auto replace = [&](uint32_t v, uint32_t from, uint32_t to) {
+        if (mesh.vertex_halfedge[v] == from) {
+            mesh.vertex_halfedge[v] = to;
+        }
+    };
+    replace(a, h, next(g));
+    replace(b, g, next(h));
+    replace(c, prev(h), g);
+    replace(d, prev(g), h);
+}
+
+// Collapses the edge of halfedge h by removing its head b and moving its tail a to p.
+void collapse(RemeshMesh& mesh, uint32_t h, const Vector3f& p)
+{
+    const uint32_t g = mesh.inv[h];
+    const uint32_t a = mesh.corners[h];
+    const uint32_t b = mesh.corners[next(h)];
+    const uint32_t c = mesh.corners[prev(h)];
+    // Relabel b before any opposite halfedge changes, the walk around b relies on them.
+    for_each_outgoing(mesh, b, [&](uint32_t k) { mesh.corners[k] = a; });
+    // The two remaining edges of each removed face are merged into one. The opposite vertices
+    // lose a halfedge, on the boundary the merged halfedge takes over its role.
+    const uint32_t x = mesh.inv[next(h)];
+    const uint32_t y = mesh.inv[prev(h)];
+    link(mesh, x, y);
+    if (mesh.vertex_halfedge[c] == prev(h)) {
+        mesh.vertex_halfedge[c] = x != NO_HALFEDGE ? x : next(y);
+    }
+    uint32_t q = NO_HALFEDGE;
+    if (g != NO_HALFEDGE) {
+        const uint32_t d     = mesh.corners[prev(g)];
+        const uint32_t p_inv = mesh.inv[next(g)];
+        q                    = mesh.inv[prev(g)];
+        link(mesh, p_inv, q);
+        if (mesh.vertex_halfedge[d] == prev(g)) {
+            mesh.vertex_halfedge[d] = p_inv != NO_HALFEDGE ? p_inv : next(q);
+        }
+    }
+    // Only next(g) can be the boundary halfedge of a, and then q (now from a to d) replaces it.
+    if (mesh.vertex_halfedge[a] == h || (g != NO_HALFEDGE && mesh.vertex_halfedge[a] == next(g))) {
+        mesh.vertex_halfedge[a] = q != NO_HALFEDGE ? q : y;
+    }
+    for (const uint32_t k: {h, g}) {
+        if (k != NO_HALFEDGE) {
+            const uint32_t first = k - k % 3;
+            std::fill_n(mesh.corners.begin() + first, 3, REMOVED);
+            std::fill_n(mesh.inv.begin() + first, 3, NO_HALFEDGE);
+        }
+    }
+    mesh.positions[a]       = p;
+    mesh.vertex_halfedge[b] = NO_HALFEDGE;
+}
+
+// Scratch buffers for the one-rings used when checking an edit.
+struct Rings
+{
+    vector<uint32_t> a;
+    vector<uint32_t> b;
+    vector<uint32_t> other;
+};
+
+bool has_minimum_degree(const RemeshMesh& mesh, uint32_t v, vector<uint32_t>& ring)
+{
+    one_ring(mesh, v, ring);
+    return ring.size() > (on_boundary(mesh, v) ? 2u : 3u);
+}
+
+// Whether collapsing halfedge h into p keeps the mesh manifold, creates no edge longer than
+// `high` and flips no face over.
+bool collapsible(const RemeshMesh& mesh, uint32_t h, const Vector3f& p, float high, Rings& rings)
+{
+    const uint32_t g = mesh.inv[h];
+    const uint32_t a = mesh.corners[h];
+    const uint32_t b = mesh.corners[next(h)];
+    one_ring(mesh, a, rings.a);
+    one_ring(mesh, b, rings.b);
+    // The link condition: the endpoints may only share the vertices opposite to the edge.
+    size_t n_shared = 0;
+    for (const uint32_t x: rings.a) {
+        n_shared += std::count(rings.b.begin(), rings.b.end(), x);
+    }
+    if (n_shared != (g == NO_HALFEDGE ? 1u : 2u)) {
+        return false;
+    }
+    // The opposite vertices lose an edge each.
+    if (!has_minimum_degree(mesh, mesh.corners[prev(h)], rings.other)) {
+        return false;
+    }
+    if (g != NO_HALFEDGE && !has_minimum_degree(mesh, mesh.corners[prev(g)], rings.other)) {
+        return false;
+    }
+    for (const vector<uint32_t>* ring: {&rings.a, &rings.b}) {
+        for (const uint32_t x: *ring) {
+            if (x != a && x != b && (mesh.positions[x] - p).norm() > high) {
+                return false;
+            }
+        }
+    }
+    // Faces that survive the collapse must not flip or degenerate.
+    bool preserved = true;
+    for (const uint32_t v: {a, b}) {
+        for_each_outgoing(mesh, v, [&](uint32_t k) {
+            const uint32_t f = k / 3;
+            if (f == h / 3 || (g != NO_HALFEDGE && f == g / 3)) {
+                return;
+            }
+            const Vector3f& q = mesh.positions[mesh.corners[next(k)]];
+            const Vector3f& r = mesh.positions[mesh.corners[prev(k)]];
+            const Vector3f  after = (q - p).cross(r - p);
+            if (after.dot(face_normal(mesh, f)) <= 0.0f) {
+                preserved = false;
+            }
+        });
+    }
+    return preserved;
+}
+
+// Whether flipping the edge of halfedge h brings the degrees of the four vertices involved
+// closer to 6 (4 on the boundary) without folding the two faces over.
+bool improves_by_flip(const RemeshMesh& mesh, uint32_t h, Rings& rings)
+{
+    const uint32_t g = mesh.inv[h];
+    if (g == NO_HALFEDGE) {
+        return false;
+    }
+    const uint32_t vertices[4] = {
+        mesh.corners[h], mesh.corners[next(h)], mesh.corners[prev(h)], mesh.corners[prev(g)]
+    };
+    const int change[4] = {-1, -1, 1, 1};
+    if (vertices[2] == vertices[3]) {
+        return false;
+    }
+    int before = 0;
+    int after  = 0;
+    for (size_t i = 0; i < 4; ++i) {
+        one_ring(mesh, vertices[i], rings.other);
+        const int degree = static_cast<int>(rings.other.size());
+        const int target = on_boundary(mesh, vertices[i]) ? 4 : 6;
+        // The endpoints must keep enough edges.
+        if (i < 2 && degree <= (target == 4 ? 2 : 3)) {
+            return false;
+        }
+        // The new edge must not exist yet.
+        if (i == 2
+            && std::find(rings.other.begin(), rings.other.end(), vertices[3])
+                   != rings.other.end()) {
+            return false;
+        }
+        before += std::abs(degree - target);
+        after += std::abs(degree + change[i] - target);
+    }
+    if (after >= before) {
+        return false;
+    }
+    const vector<Vector3f>& positions = mesh.positions;
+    const Vector3f          normal    = face_normal(mesh, h / 3) + face_normal(mesh, g / 3);
+    const Vector3f&         a         = positions[vertices[0]];
+    const Vector3f&         b         = positions[vertices[1]];
+    const Vector3f&         c         = positions[vertices[2]];
+    const Vector3f&         d         = positions[vertices[3]];
+    return (b - d).cross(c - d).dot(normal) > 0.0f && (a - c).cross(d - c).dot(normal) > 0.0f;
+}
+
+// Splits every edge longer than `high` in rounds of independent splits.
+size_t split_long_edges(RemeshMesh& mesh, float high)
+{
+    size_t n_splits = 0;
+    for (size_t round = 0; round < MAX_ROUNDS; ++round) {
+        const size_t     n_faces    = mesh.corners.size() / 3;
+        const size_t     n_vertices = mesh.positions.size();
+        vector<uint32_t> candidates =
+            gather(3 * n_faces, [&](size_t first, size_t last, vector<uint32_t>& found) {
+                for (size_t index = first; index < last; ++index) {
+                    const uint32_t h = static_cast<uint32_t>(index);
+                    const uint32_t g = mesh.inv[h];
+                    if (mesh.corners[h] != REMOVED && (g == NO_HALFEDGE || h < g)
+                        && length(mesh, h) > high) {
+                        found.push_back(h);
+                    }
+                }
+            });
+        if (candidates.empty()) {
+            break;
+        }
+        vector<uint64_t> priorities(candidates.size());
+        parallel_for(0, candidates.size(), [&](size_t i) {
+            const uint32_t h = candidates[i];
+            priorities[i]    = mix_bits(edge_key(mesh.corners[h], mesh.corners[next(h)]));
+        });
+        // A split rewrites the faces on both sides of the edge.
+        const vector<uint32_t> winners = independent_set(
+            candidates, priorities, n_vertices,
+            [&](uint32_t h, vector<uint32_t>& touched) {
+                touched.assign({mesh.corners[h], mesh.corners[next(h)], mesh.corners[prev(h)]});
+                if (mesh.inv[h] != NO_HALFEDGE) {
+                    touched.push_back(mesh.corners[prev(mesh.inv[h])]);
+                }
+            }
+        );
+        const size_t n_winners = winners.size();
+        mesh.positions.resize(n_vertices + n_winners);
+        mesh.vertex_halfedge.resize(n_vertices + n_winners);
+        mesh.corners.resize(3 * (n_faces + 2 * n_winners));
+        mesh.inv.resize(3 * (n_faces + 2 * n_winners));
+        parallel_for(0, n_winners, [&](size_t i) {
+            split(
+                mesh, winners[i], static_cast<uint32_t>(n_vertices + i),
+                static_cast<uint32_t>(n_faces + 2 * i)
+            );
+        });
+        n_splits += n_winners;
+    }
+    return n_splits;
+}
+
+// Collapses edges shorter than `low` in rounds of independent collapses. Boundary vertices never
+// move, so an edge joining two of them is kept and an edge touching one collapses into it.
+size_t collapse_short_edges(RemeshMesh& mesh, float low, float high)
+{
+    size_t n_collapses = 0;
+    for (size_t round = 0; round < MAX_ROUNDS; ++round) {
+        const size_t n_faces    = mesh.corners.size() / 3;
+        const size_t n_vertices = mesh.positions.size();
+        // Each candidate is the halfedge pointing to the vertex to remove.
+        vector<uint32_t> candidates =
+            gather(3 * n_faces, [&](size_t first, size_t last, vector<uint32_t>& found) {
+                Rings rings;
+                for (size_t index = first; index < last; ++index) {
+                    uint32_t       h = static_cast<uint32_t>(index);
+                    const uint32_t g = mesh.inv[h];
+                    if (mesh.corners[h] == REMOVED || (g != NO_HALFEDGE && g < h)
+                        || length(mesh, h) >= low) {
+                        continue;
+                    }
+                    const bool a_on_boundary = on_boundary(mesh, mesh.corners[h]);
+                    const bool b_on_boundary = on_boundary(mesh, mesh.corners[next(h)]);
+                    if (a_on_boundary && b_on_boundary) {
+                        continue;
+                    }
+                    if (b_on_boundary) {
+                        h = g;
+                    }
+                    const Vector3f& a = mesh.positions[mesh.corners[h]];
+                    const Vector3f& b = mesh.positions[mesh.corners[next(h)]];
+                    const Vector3f  p = a_on_boundary || b_on_boundary ? a : 0.5f * (a + b);
+                    if (collapsible(mesh, h, p, high, rings)) {
+                        found.push_back(h);
+                    }
+                }
+            });
+        if (candidates.empty()) {
+            break;
+        }
+        vector<uint64_t> priorities(candidates.size());
+        parallel_for(0, candidates.size(), [&](size_t i) {
+            const uint32_t h = candidates[i];
+            priorities[i]    = mix_bits(edge_key(mesh.corners[h], mesh.corners[next(h)]));
+        });
+        // A collapse changes the faces around both endpoints and the degrees of their neighbors.
+        const vector<uint32_t> winners = independent_set(
+            candidates, priorities, n_vertices,
+            [&](uint32_t h, vector<uint32_t>& touched) {
+                vector<uint32_t> ring;
+                one_ring(mesh, mesh.corners[h], touched);
+                one_ring(mesh, mesh.corners[next(h)], ring);
+                touched.insert(touched.end(), ring.begin(), ring.end());
+                touched.push_back(mesh.corners[h]);
+                touched.push_back(mesh.corners[next(h)]);
+            }
+        );
+        parallel_for(0, winners.size(), [&](size_t i) {
+            const uint32_t  h = winners[i];
+            const Vector3f& a = mesh.positions[mesh.corners[h]];
+            const Vector3f& b = mesh.positions[mesh.corners[next(h)]];
+            const bool      fixed =
+                on_boundary(mesh, mesh.corners[h]) || on_boundary(mesh, mesh.corners[next(h)]);
+            collapse(mesh, h, fixed ? Vector3f(a) : Vector3f(0.5f * (a + b)));
+        });
+        n_collapses += winners.size();
+    }
+    return n_collapses;
+}
+
+// Flips edges to even out the degrees. Vertices are processed one color at a time, each flipping
+// the edges around it, and the coloring keeps their one-rings apart. Flips may bring two vertices
+// of a later color close to each other, so each color still claims the one-rings it touches and
+// a vertex losing the claim waits for the next iteration.
+size_t flip_edges(RemeshMesh& mesh)
+{
+    const vector<vector<uint32_t>> classes = color_vertices(mesh, 2);
+    std::atomic<size_t>            n_flips = 0;
+    for (const vector<uint32_t>& vertices: classes) {
+        vector<uint64_t> priorities(vertices.begin(), vertices.end());
+        const vector<uint32_t> winners = independent_set(
+            vertices, priorities, mesh.positions.size(),
+            [&](uint32_t v, vector<uint32_t>& touched) {
+                one_ring(mesh, v, touched);
+                touched.push_back(v);
+            }
+        );
+        parallel_for_chunks(0, winners.size(), [&](size_t first, size_t last, size_t) {
+            Rings            rings;
+            vector<uint32_t> outgoing;
+            size_t           count = 0;
+            for (size_t i = first; i < last; ++i) {
+                const uint32_t v = winners[i];
+                outgoing.clear();
+                for_each_outgoing(mesh, v, [&](uint32_t h) { outgoing.push_back(h); });
+                for (const uint32_t h: outgoing) {
+                    // An earlier flip around v may have turned h away from v.
+                    if (mesh.corners[h] == v && improves_by_flip(mesh, h, rings)) {
+                        flip(mesh, h);
+                        ++count;
+                    }
+                }
+            }
+            n_flips += count;
+        });
+    }
+    return n_flips;
+}
+
+// Moves every interior vertex towards the centroid of its neighbors within its tangent plane.
+// Vertices of one color are never adjacent, so they are moved concurrently in place.
+void smooth(RemeshMesh& mesh)
+{
+    const vector<vector<uint32_t>> classes = color_vertices(mesh, 1);
+    for (const vector<uint32_t>& vertices: classes) {
+        parallel_for_chunks(0, vertices.size(), [&](size_t first, size_t last, size_t) {
+            vector<uint32_t> ring;
+            for (size_t i = first; i < last; ++i) {
+                const uint32_t v = vertices[i];
+                if (on_boundary(mesh, v)) {
+                    continue;
+                }
+                one_ring(mesh, v, ring);
+                Vector3f centroid = Vector3f::Zero();
+                for (const uint32_t x: ring) {
+                    centroid += mesh.positions[x];
+                }
+                centroid /= static_cast<float>(ring.size());
+                Vector3f normal = Vector3f::Zero();
+                for_each_outgoing(mesh, v, [&](uint32_t h) { normal += face_normal(mesh, h / 3); });
+                if (normal.squaredNorm() == 0.0f) {
+                    continue;
+                }
+                normal.normalize();
+                const Matrix3f tangential = Matrix3f::Identity() - normal * normal.transpose();
+                mesh.positions[v] += tangential * (centroid - mesh.positions[v]);
+            }
+        });
+    }
+}
+
+} // namespace
+
+void HalfedgeMesh::parallel_isotropic_remesh(size_t n_iterations, float target_length)
+{
+    optional<HalfedgeMeshFailure> check_result = validate_by_level();
+    if (check_result.has_value()) {
+        return;
+    }
+    time_point begin_time = steady_clock::now();
+    logger->info(
+        "remesh the object {} (ID: {}) with parallel Isotropic Remeshing", object.name, object.id
+    );
+    logger->info("original mesh: {} vertices, {} faces", vertices.size, faces.size);
+
+    // Copy the mesh into flat arrays.
+    vector<Face*> face_list;
+    for (Face* f: faces) {
+        if (f->is_boundary) {
+            continue;
+        }
+        if (f->halfedge->next->next->next != f->halfedge) {
+            logger->warn("face {} is not a triangle, Isotropic Remeshing is not applicable", f->id);
+            return;
+        }
+        face_list.push_back(f);
+    }
+    vector<Vertex*>  vertex_list;
+    vector<uint32_t> vertex_map(vertices.capacity());
+    for (Vertex* v: vertices) {
+        vertex_map[v->index] = static_cast<uint32_t>(vertex_list.size());
+        vertex_list.push_back(v);
+    }
+    const size_t      n_faces = face_list.size();
+    RemeshMesh        flat;
+    vector<Halfedge*> halfedge_list(3 * n_faces);
+    // Halfedges on the virtual faces are left as NO_HALFEDGE.
+    vector<uint32_t> halfedge_map(halfedges.capacity(), NO_HALFEDGE);
+    flat.positions.resize(vertex_list.size());
+    flat.corners.resize(3 * n_faces);
+    flat.inv.resize(3 * n_faces);
+    flat.vertex_halfedge.resize(vertex_list.size());
+    parallel_for(0, n_faces, [&](size_t f) {
+        Halfedge* h = face_list[f]->halfedge;
+        for (size_t i = 0; i < 3; ++i) {
+            const uint32_t index   = static_cast<uint32_t>(3 * f + i);
+            halfedge_list[index]   = h;
+            halfedge_map[h->index] = index;
+            flat.corners[index]    = vertex_map[h->from->index];
+            h                      = h->next;
+        }
+    });
+    parallel_for(0, 3 * n_faces, [&](size_t h) {
+        flat.inv[h] = halfedge_map[halfedge_list[h]->inv->index];
+    });
+    parallel_for(0, vertex_list.size(), [&](size_t v) {
+        const Vertex*   vertex = vertex_list[v];
+        const Halfedge* h      = vertex->halfedge;
+        // A halfedge on a virtual face is replaced by the next halfedge starting from v, and then
+        // by the boundary halfedge starting from v.
+        if (h->face->is_boundary) {
+            h = h->inv->next;
+        }
+        flat.positions[v]       = vertex->pos;
+        flat.vertex_halfedge[v] = halfedge_map[h->index];
+        flat.vertex_halfedge[v] = first_outgoing(flat, static_cast<uint32_t>(v));
+    });
+
+    // The target length defaults to the mean edge length.
+    if (!(target_length > 0.0f)) {
+        double total_length = 0.0;
+        size_t n_edges      = 0;
+        for (uint32_t h = 0; h < 3 * n_faces; ++h) {
+            if (flat.inv[h] == NO_HALFEDGE || h < flat.inv[h]) {
+                total_length += length(flat, h);
+                ++n_edges;
+            }
+        }
+        target_length = static_cast<float>(total_length / static_cast<double>(n_edges));
+    }
+    const float low  = 0.8f * target_length;
+    const float high = 4.0f / 3.0f * target_length;
+    for (size_t i = 0; i < n_iterations; ++i) {
+        const size_t n_splits    = split_long_edges(flat, high);
+        const size_t n_collapses = collapse_short_edges(flat, low, high);
+        const size_t n_flips     = flip_edges(flat);
+        smooth(flat);
+        logger->debug(
+            "iteration {}: {} splits, {} collapses, {} flips", i + 1, n_splits, n_collapses,
+            n_flips
+        );
+    }
+
+    // Drop the removed elements and rebuild the halfedge mesh.
+    vector<uint32_t> new_indices(flat.positions.size(), NO_HALFEDGE);
+    vector<float>    positions;
+    for (size_t v = 0; v < flat.positions.size(); ++v) {
+        if (flat.vertex_halfedge[v] != NO_HALFEDGE) {
+            new_indices[v] = static_cast<uint32_t>(positions.size() / 3);
+            const Vector3f& p = flat.positions[v];
+            positions.insert(positions.end(), {p.x(), p.y(), p.z()});
+        }
+    }
+    vector<unsigned int> indices;
+    for (const uint32_t v: flat.corners) {
+        if (v != REMOVED) {
+            indices.push_back(new_indices[v]);
+        }
+    }
+    record_rebuild();
+    halfedges.clear();
+    vertices.clear();
+    edges.clear();
+    faces.clear();
+    build(positions, indices);
+    global_inconsistent = true;
+
+    const duration remeshing_duration = steady_clock::now() - begin_time;
+    logger->info(
+        "remeshed mesh: {} vertices, {} faces ({:.3f} seconds)", vertices.size, faces.size,
+        remeshing_duration.count()
+    );
+    logger->info("Isotropic Remeshing done");
+    logger->info("");
+    validate_by_level();
+}
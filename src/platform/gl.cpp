@@ -62,7 +62,9 @@ const Vector3f Mesh::highlight_face_color(RGB_COLOR(115, 206, 244));
 
 Mesh::Mesh() :
     vertices(GL_DYNAMIC_DRAW, vertex_position_location),
-    normals(GL_DYNAMIC_DRAW, vertex_normal_location), edges(GL_DYNAMIC_DRAW), faces(GL_DYNAMIC_DRAW)
+    normals(GL_DYNAMIC_DRAW, vertex_normal_location),
+    baked_lighting(GL_DYNAMIC_DRAW, baked_lighting_location), edges(GL_DYNAMIC_DRAW),
+    faces(GL_DYNAMIC_DRAW)
 {
     VAO.bind();
     vertices.bind();
@@ -73,7 +75,8 @@ Mesh::Mesh() :
 
 Mesh::Mesh(Mesh&& other) :
     VAO(std::move(other.VAO)), vertices(std::move(other.vertices)),
-    normals(std::move(other.normals)), edges(std::move(other.edges)), faces(std::move(other.faces)),
+    normals(std::move(other.normals)), baked_lighting(std::move(other.baked_lighting)),
+    edges(std::move(other.edges)), faces(std::move(other.faces)),
     material(std::move(other.material))
 {
     VAO.bind();
@@ -104,6 +107,11 @@ Vector3f Mesh::normal(size_t index) const
     return pack(normals.data, index);
 }
 
+bool Mesh::has_baked_lighting() const
+{
+    return baked_lighting.count() > 0 && baked_lighting.count() == vertices.count();
+}
+
 array<size_t, 2> Mesh::edge(size_t index) const
 {
     return {edges.data.at(index * 2), edges.data.at(index * 2 + 1)};
@@ -118,6 +126,7 @@ void Mesh::clear()
 {
     vertices.data.clear();
     normals.data.clear();
+    baked_lighting.data.clear();
     edges.data.clear();
     faces.data.clear();
 }
@@ -127,6 +136,7 @@ void Mesh::to_gpu()
     VAO.bind();
     vertices.to_gpu();
     normals.to_gpu();
+    baked_lighting.to_gpu();
     edges.to_gpu();
     edges.release();
     faces.to_gpu();
@@ -144,6 +154,15 @@ void Mesh::render(
         if (face_shading) {
             normals.bind();
             normals.specify_vertex_attribute();
+            // a bake that no longer matches the vertices must not be read by the shader
+            const bool use_baked_lighting = has_baked_lighting();
+            baked_lighting.bind();
+            if (use_baked_lighting) {
+                baked_lighting.specify_vertex_attribute();
+            } else {
+                baked_lighting.disable();
+            }
+            shader.set_uniform("use_baked_lighting", use_baked_lighting);
             shader.set_uniform("use_global_color", false);
             shader.set_uniform("material.ambient", material.ambient);
             shader.set_uniform("material.diffuse", material.diffuse);
@@ -152,6 +171,8 @@ void Mesh::render(
         } else {
             normals.bind();
             normals.disable();
+            baked_lighting.bind();
+            baked_lighting.disable();
             shader.set_uniform("global_color", highlight_face_color);
         }
         faces.bind();
@@ -160,6 +181,8 @@ void Mesh::render(
     } else {
         normals.bind();
         normals.disable();
+        baked_lighting.bind();
+        baked_lighting.disable();
     }
     // Render some elements with a uniform color.
     shader.set_uniform("use_global_color", true);
@@ -209,8 +232,7 @@ void LineSet::add_line_segment(const Vector3f& a, const Vector3f& b)
     lines.append(index, index + 1);
 }
 
-constexpr size_t                               n_arrow_vertices = 6;
-const static array<Vector3f, n_arrow_vertices> arrow_vertices   = {
+const static array<Vector3f, LineSet::n_arrow_vertices> arrow_vertices = {
     Vector3f(0.0f, 0.0f, 0.0f),   Vector3f(1.0f, 0.0f, 0.0f),  Vector3f(0.8f, 0.02f, 0.0f),
     Vector3f(0.8f, -0.02f, 0.0f), Vector3f(0.8f, 0.0f, 0.02f), Vector3f(0.8f, 0.0f, -0.02f)
 };
@@ -233,15 +255,23 @@ void LineSet::add_arrow(const Vector3f& from, const Vector3f& to)
 }
 
 void LineSet::update_arrow(size_t index, const Vector3f& from, const Vector3f& to)
+{
+    set_arrow(index, from, to);
+    vertices.update_range(index * n_arrow_vertices, n_arrow_vertices);
+}
+
+void LineSet::set_arrow(size_t index, const Vector3f& from, const Vector3f& to)
 {
     const Vector3f    direction = (to - from).normalized();
     const Quaternionf rotation  = Quaternionf::FromTwoVectors(base_direction, direction);
     const float       length    = (to - from).norm();
-    size_t            i         = index * n_arrow_vertices;
+    size_t            i         = index * n_arrow_vertices * 3;
     for (const Vector3f& v: arrow_vertices) {
         const Vector3f v_transformed = length * (rotation * v) + from;
-        vertices.update(i, v_transformed);
-        ++i;
+        vertices.data[i]             = v_transformed.x();
+        vertices.data[i + 1]         = v_transformed.y();
+        vertices.data[i + 2]         = v_transformed.z();
+        i += 3;
     }
 }
 
@@ -297,3 +327,74 @@ void LineSet::render(const Shader& shader)
     glDrawElements(GL_LINES, GLsizei(lines.data.size()), GL_UNSIGNED_INT, (void*)0);
     VAO.release();
 }
+
+BoxSet::BoxSet(const string& name, Vector3f color) :
+    line_color(color), vertices(GL_STATIC_DRAW, vertex_position_location),
+    lines(GL_STATIC_DRAW), instance_offsets(GL_DYNAMIC_DRAW, instance_offset_location),
+    instance_scales(GL_DYNAMIC_DRAW, instance_scale_location), name(name)
+{
+    // The i-th vertex of the unit cube is (i & 4, i & 2, i & 1) scaled to [0, 1],
+    // which is the same vertex order as LineSet::add_AABB.
+    for (unsigned int i = 0; i < 8; ++i) {
+        vertices.append(float((i >> 2) & 1u), float((i >> 1) & 1u), float(i & 1u));
+    }
+    const unsigned int cube_edges[12][2] = {
+        {0, 1}, {0, 2}, {1, 3}, {2, 3}, {4, 5}, {4, 6},
+        {5, 7}, {6, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7}
+    };
+    for (const auto& edge: cube_edges) {
+        lines.append(edge[0], edge[1]);
+    }
+    VAO.bind();
+    vertices.to_gpu();
+    lines.to_gpu();
+    glDisableVertexAttribArray(vertex_color_location);
+    glDisableVertexAttribArray(vertex_normal_location);
+    instance_offsets.to_gpu();
+    glVertexAttribDivisor(instance_offset_location, 1);
+    instance_scales.to_gpu();
+    glVertexAttribDivisor(instance_scale_location, 1);
+    VAO.release();
+}
+
+void BoxSet::add_AABB(const Eigen::Vector3f& p_min, const Eigen::Vector3f& p_max)
+{
+    const Vector3f scale = p_max - p_min;
+    instance_offsets.append(p_min.x(), p_min.y(), p_min.z());
+    instance_scales.append(scale.x(), scale.y(), scale.z());
+}
+
+size_t BoxSet::count() const
+{
+    return instance_offsets.count();
+}
+
+void BoxSet::clear()
+{
+    instance_offsets.data.clear();
+    instance_scales.data.clear();
+}
+
+void BoxSet::to_gpu()
+{
+    VAO.bind();
+    instance_offsets.to_gpu();
+    instance_scales.to_gpu();
+    VAO.release();
+}
+
+void BoxSet::render(const Shader& shader)
+{
+    if (count() == 0) {
+        return;
+    }
+    VAO.bind();
+    shader.set_uniform("use_global_color", true);
+    shader.set_uniform("global_color", line_color);
+    shader.set_uniform("use_instance_transform", true);
+    glDrawElementsInstanced(
+        GL_LINES, GLsizei(lines.data.size()), GL_UNSIGNED_INT, (void*)0, GLsizei(count())
+    );
+    shader.set_uniform("use_instance_transform", false);
+    VAO.release();
+}
@@ -123,6 +123,14 @@ struct ArrayBuffer
      * \param value 新的值
      */
     void update(size_t index, const Eigen::Vector3f& value);
+    /*!
+     * \~chinese
+     * \brief 将内存中从第 `first` 个顶点起的 `count` 个顶点的数据复制到显存中的相同位置。
+     *
+     * 只能用于 `data` 的长度与显存中的缓冲区相同（即上次 `to_gpu` 之后没有增删数据）的情况。
+     * 已经包含了绑定操作，但不包含解绑操作。
+     */
+    void update_range(std::size_t first, std::size_t count);
     /*! \~chinese
      * 统计这个 `ArrayBuffer` 中有多少个顶点的数据，也就是数据个数除以 `size`。
      */
@@ -192,6 +200,13 @@ struct ElementArrayBuffer
     /*! \~chinese 将 `size` 个数据附加到末尾。 */
     template<typename... Ts>
     void append(Ts... values);
+    /*!
+     * \~chinese
+     * \brief 将内存中从第 `first` 个基元起的 `count` 个基元的索引复制到显存中的相同位置。
+     *
+     * 使用条件与 `ArrayBuffer::update_range` 相同，已经包含了绑定操作，但不包含解绑操作。
+     */
+    void update_range(std::size_t first, std::size_t count);
     /*! \~chinese 统计总共有多少个 **基元** （而不是顶点）。 */
     std::size_t count() const;
     /*! \~chinese 绑定该 EBO。 */
@@ -276,11 +291,18 @@ struct Mesh
     Eigen::Vector3f vertex(size_t index) const;
     /*! \~chinese 读取编号为 index 的顶点法线。 */
     Eigen::Vector3f normal(size_t index) const;
+    /*!
+     * \~chinese
+     * \brief 烘焙结果是否可用。
+     *
+     * 烘焙后顶点数发生变化（例如网格被编辑）时结果失效，不再参与着色。
+     */
+    bool has_baked_lighting() const;
     /*! \~chinese 读取编号为 index 的边。 */
     std::array<size_t, 2> edge(size_t index) const;
     /*! \~chinese 读取编号为 index 的面片。 */
     std::array<size_t, 3> face(size_t index) const;
-    /*! \~chinese 清空内存中的全部数据， **显存不会随之清空** 。 */
+    /*! \~chinese 清空内存中的全部数据（包括烘焙结果）， **显存不会随之清空** 。 */
     void clear();
     /*! \~chinese 调用各成员的 `to_gpu`。 */
     void to_gpu();
@@ -317,6 +339,14 @@ struct Mesh
     VertexArrayObject            VAO;
     ArrayBuffer<float, 3>        vertices;
     ArrayBuffer<float, 3>        normals;
+    /*!
+     * \~chinese
+     * \brief 每个顶点烘焙的光照，由 `LightBaker` 计算。
+     *
+     * 前三个分量是间接光照的辐照度，与漫反射系数相乘后即为间接光照的贡献；
+     * 第四个分量是环境光遮蔽，即顶点处半球内未被遮挡的比例。未烘焙时为空。
+     */
+    ArrayBuffer<float, 4>        baked_lighting;
     ElementArrayBuffer<2>        edges;
     ElementArrayBuffer<3>        faces;
     /*! \~chinese 每个 Mesh 只能有一个材质 */
@@ -350,6 +380,14 @@ struct LineSet
     void add_arrow(const Eigen::Vector3f& from, const Eigen::Vector3f& to);
     /*! \~chinese 更新索引为 `index` 的箭头，仅当该 `LineSet` 内全部是箭头时才是安全的。 */
     void update_arrow(size_t index, const Eigen::Vector3f& from, const Eigen::Vector3f& to);
+    /*!
+     * \~chinese
+     * \brief 只修改内存中索引为 `index` 的箭头，不同步到显存，适用条件与 `update_arrow` 相同。
+     *
+     * 每个箭头占据 `vertices` 中连续的 `n_arrow_vertices` 个顶点，批量修改后可以用
+     * `vertices.update_range` 一次上传一段连续的箭头。
+     */
+    void set_arrow(size_t index, const Eigen::Vector3f& from, const Eigen::Vector3f& to);
     /*! \~chinese 加入一个轴对齐包围盒 (Axis-Aligned Bounding Box, AABB) 。 */
     void add_AABB(const Eigen::Vector3f& p_min, const Eigen::Vector3f& p_max);
     /*! \~chinese 清空所有元素，但只影响内存，不会同步到显存。 */
@@ -364,6 +402,8 @@ struct LineSet
      */
     void render(const Shader& shader);
 
+    /*! \~chinese 每个箭头的顶点数。 */
+    static constexpr std::size_t n_arrow_vertices = 6;
     /*! \~chinese 绘制的线条颜色。 */
     Eigen::Vector3f       line_color;
     VertexArrayObject     VAO;
@@ -372,6 +412,56 @@ struct LineSet
     std::string           name;
 };
 
+/*!
+ * \~chinese
+ * \brief 用实例化绘制 (instanced drawing) 的方式绘制大量轴对齐包围盒的线框。
+ *
+ * 与用 `LineSet::add_AABB` 为每个包围盒生成 8 个顶点和 12 条线段不同，这个类只存储一个单位立方体
+ * \f$[0, 1]^3\f$ 的线框，每个包围盒作为一个实例，只需要一个偏移量 (`p_min`) 和一个缩放系数
+ * (`p_max - p_min`)，在 vertex shader 中变换到实际位置。适合绘制 BVH 这种数量巨大的包围盒。
+ */
+struct BoxSet
+{
+    /*!
+     * \~chinese
+     * \brief 构造一个 BoxSet 对象，并将单位立方体的线框上传到显存。
+     * \param name 该对象的名称，用于输出日志。
+     * \param color 线框颜色。
+     */
+    BoxSet(const std::string& name, Eigen::Vector3f color = GL::Mesh::default_wireframe_color);
+    /*! \~chinese 由于 VAO 和 ArrayBuffer 不允许复制构造，BoxSet 也不允许复制构造。 */
+    BoxSet(const BoxSet& other) = delete;
+    /*! \~chinese 加入一个轴对齐包围盒实例。 */
+    void add_AABB(const Eigen::Vector3f& p_min, const Eigen::Vector3f& p_max);
+    /*! \~chinese 包围盒实例的个数。 */
+    std::size_t count() const;
+    /*! \~chinese 清空所有实例，但只影响内存，不会同步到显存。 */
+    void clear();
+    /*! \~chinese 将实例数据同步到显存。 */
+    void to_gpu();
+    /*!
+     * \~chinese
+     * \brief 渲染所有包围盒。
+     *
+     * 这个函数会设置全局颜色和 `use_instance_transform` 的 uniform 变量（绘制完成后恢复为假），
+     * 其他所有变量都需要由调用者自行设置。
+     */
+    void render(const Shader& shader);
+
+    /*! \~chinese 绘制的线框颜色。 */
+    Eigen::Vector3f       line_color;
+    VertexArrayObject     VAO;
+    /*! \~chinese 单位立方体的 8 个顶点，构造后不再改变。 */
+    ArrayBuffer<float, 3> vertices;
+    /*! \~chinese 单位立方体的 12 条棱。 */
+    ElementArrayBuffer<2> lines;
+    /*! \~chinese 每个实例的偏移量，即包围盒的 `p_min` 。 */
+    ArrayBuffer<float, 3> instance_offsets;
+    /*! \~chinese 每个实例在各轴上的缩放系数，即包围盒的对角线。 */
+    ArrayBuffer<float, 3> instance_scales;
+    std::string           name;
+};
+
 /* ---------------------------------------------------------
  * The implementation region for template class and functions.
  * ---------------------------------------------------------
@@ -448,6 +538,16 @@ void ArrayBuffer<T, size>::update(size_t index, const Eigen::Vector3f& value)
     glBufferSubData(GL_ARRAY_BUFFER, offset, 3 * sizeof(float), value.data());
 }
 
+template<typename T, std::size_t size>
+void ArrayBuffer<T, size>::update_range(std::size_t first, std::size_t count)
+{
+    bind();
+    glBufferSubData(
+        GL_ARRAY_BUFFER, first * size * sizeof(T), count * size * sizeof(T),
+        this->data.data() + first * size
+    );
+}
+
 template<typename T, std::size_t size>
 std::size_t ArrayBuffer<T, size>::count() const
 {
@@ -513,6 +613,16 @@ ElementArrayBuffer<size>::~ElementArrayBuffer()
     }
 }
 
+template<std::size_t size>
+void ElementArrayBuffer<size>::update_range(std::size_t first, std::size_t count)
+{
+    bind();
+    glBufferSubData(
+        GL_ELEMENT_ARRAY_BUFFER, first * size * sizeof(unsigned int),
+        count * size * sizeof(unsigned int), this->data.data() + first * size
+    );
+}
+
 template<std::size_t size>
 std::size_t ElementArrayBuffer<size>::count() const
 {
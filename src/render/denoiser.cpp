@@ -0,0 +1,127 @@
+#include "denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#include "../utils/parallel.hpp"
+
+using Eigen::Array4f;
+using Eigen::Vector3f;
+using std::size_t;
+using std::vector;
+
+namespace {
+
+// 一维 B3 样条核 [1/16, 1/4, 3/8, 1/4, 1/16] ，按与中心的距离索引
+constexpr float b3_spline[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+// 平方长度低于这个值的法向量没有可靠的方向，不参与法向权重
+constexpr float min_normal_squared_norm = 1e-6f;
+
+Array4f pack(const Vector3f& v)
+{
+    return Array4f(v.x(), v.y(), v.z(), 0.0f);
+}
+
+} // namespace
+
+void GBuffer::reset(size_t n_pixels)
+{
+    normal.assign(n_pixels, Vector3f::Zero());
+    depth.assign(n_pixels, -1.0f);
+    albedo.assign(n_pixels, Vector3f::Zero());
+}
+
+Denoiser::Denoiser() :
+    n_iterations(5), sigma_color(0.5f), sigma_normal(64.0f), sigma_depth(0.05f),
+    sigma_albedo(0.1f)
+{
+}
+
+void Denoiser::denoise(
+    vector<Vector3f>& image, const GBuffer& gbuffer, int width, int height, unsigned int n_threads
+) const
+{
+    const size_t n_pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+    if (n_pixels == 0 || image.size() != n_pixels || gbuffer.normal.size() != n_pixels
+        || gbuffer.depth.size() != n_pixels || gbuffer.albedo.size() != n_pixels) {
+        return;
+    }
+    vector<Array4f> current(n_pixels), next(n_pixels), normals(n_pixels), albedos(n_pixels);
+    for (size_t i = 0; i < n_pixels; ++i) {
+        current[i] = pack(image[i]);
+        normals[i] = pack(gbuffer.normal[i]);
+        albedos[i] = pack(gbuffer.albedo[i]);
+    }
+    const vector<float>& depths             = gbuffer.depth;
+    const float          inv_sigma_albedo_2 = 1.0f / (sigma_albedo * sigma_albedo);
+    const auto           has_normal         = [&](size_t k) {
+        return normals[k].matrix().squaredNorm() >= min_normal_squared_norm;
+    };
+
+    for (int iteration = 0; iteration < n_iterations; ++iteration) {
+        const int   step              = 1 << iteration;
+        const float sigma_c           = sigma_color / static_cast<float>(step);
+        const float inv_sigma_color_2 = 1.0f / (sigma_c * sigma_c);
+        parallel_for(
+            0, static_cast<size_t>(height),
+            [&](size_t row) {
+                const int j = static_cast<int>(row);
+                for (int i = 0; i < width; ++i) {
+                    const size_t   p       = row * width + i;
+                    const Array4f& color_p = current[p];
+                    const float    depth_p = depths[p];
+                    const bool     miss_p  = depth_p < 0.0f;
+                    Array4f        sum     = Array4f::Zero();
+                    float          weights = 0.0f;
+                    for (int dy = -2; dy <= 2; ++dy) {
+                        const int y = j + dy * step;
+                        if (y < 0 || y >= height) {
+                            continue;
+                        }
+                        for (int dx = -2; dx <= 2; ++dx) {
+                            const int x = i + dx * step;
+                            if (x < 0 || x >= width) {
+                                continue;
+                            }
+                            const size_t q = static_cast<size_t>(y) * width + x;
+                            // never mix pixels that hit geometry with background pixels
+                            if ((depths[q] < 0.0f) != miss_p) {
+                                continue;
+                            }
+                            float weight = b3_spline[std::abs(dx)] * b3_spline[std::abs(dy)];
+                            weight *= std::exp(
+                                -(color_p - current[q]).square().sum() * inv_sigma_color_2
+                            );
+                            if (!miss_p) {
+                                // averaged normals may cancel out, such pixels skip the normal term
+                                if (has_normal(p) && has_normal(q)) {
+                                    const float cos_normal = (normals[p] * normals[q]).sum();
+                                    weight *= std::pow(std::max(cos_normal, 0.0f), sigma_normal);
+                                }
+                                const float distance =
+                                    static_cast<float>(step * std::max(std::abs(dx), std::abs(dy)));
+                                weight *= std::exp(
+                                    -std::abs(depth_p - depths[q])
+                                    / (sigma_depth * depth_p * distance + 1e-6f)
+                                );
+                                weight *= std::exp(
+                                    -(albedos[p] - albedos[q]).square().sum() * inv_sigma_albedo_2
+                                );
+                            }
+                            sum += weight * current[q];
+                            weights += weight;
+                        }
+                    }
+                    // all weights may underflow to zero, keep the pixel unfiltered then
+                    next[p] = weights > 0.0f ? Array4f(sum / weights) : color_p;
+                }
+            },
+            n_threads
+        );
+        current.swap(next);
+    }
+    for (size_t i = 0; i < n_pixels; ++i) {
+        image[i] = current[i].head<3>().matrix();
+    }
+}
@@ -0,0 +1,77 @@
+#ifndef DANDELION_RENDER_DENOISER_H
+#define DANDELION_RENDER_DENOISER_H
+
+#include <cstddef>
+#include <vector>
+
+#include <Eigen/Core>
+
+/*!
+ * \file render/denoiser.h
+ * \ingroup rendering
+ * \~chinese
+ * \brief 对光线追踪结果做边缘保持的降噪。
+ */
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 渲染器在主光线击中点处记录的辅助缓冲区，用于引导降噪。
+ *
+ * 三个数组的长度都等于像素数，按行优先、第 0 行在图像顶部的顺序存放。
+ */
+struct GBuffer
+{
+    /*! \~chinese 将所有缓冲区调整为 `n_pixels` 个像素，并标记为未击中任何物体。 */
+    void reset(std::size_t n_pixels);
+    /*! \~chinese 世界坐标系下的单位法向量，未击中任何物体的像素为零向量。 */
+    std::vector<Eigen::Vector3f> normal;
+    /*! \~chinese 主光线击中点到相机的距离，未击中任何物体的像素为负数。 */
+    std::vector<float> depth;
+    /*! \~chinese 击中点处材质的反照率（漫反射系数或镜面反射系数）。 */
+    std::vector<Eigen::Vector3f> albedo;
+};
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 边缘保持的 à-trous 小波降噪器。
+ *
+ * 实现参考 H. Dammertz et al., "Edge-Avoiding À-Trous Wavelet Transform for fast Global
+ * Illumination Filtering", HPG 2010：每次迭代用 5x5 的 B3 样条核做一次卷积，第 i 次迭代的采样间隔
+ * 为 \f$2^i\f$ ，因此 5 次迭代就能覆盖 \f$125\times 125\f$ 的范围。每个邻域像素的权重再乘以颜色、
+ * 法向、深度和反照率的相似度，使滤波不会跨越几何或材质边缘。
+ * 每次迭代按行分给多个线程，像素数据打包成 `Eigen::Array4f` 以便 Eigen 生成 SIMD 指令。
+ */
+class Denoiser
+{
+public:
+
+    Denoiser();
+
+    /*!
+     * \~chinese
+     * \brief 原地对线性颜色图像降噪。
+     *
+     * \param image 待降噪的图像，长度为 `width * height`
+     * \param gbuffer 与图像对应的辅助缓冲区
+     * \param n_threads 使用的线程数，0 表示使用硬件支持的线程数
+     */
+    void denoise(
+        std::vector<Eigen::Vector3f>& image, const GBuffer& gbuffer, int width, int height,
+        unsigned int n_threads = 0
+    ) const;
+
+    /*! \~chinese 迭代次数。 */
+    int n_iterations;
+    /*! \~chinese 颜色差异的容忍度，每次迭代减半，使后续的大范围滤波更加保守。 */
+    float sigma_color;
+    /*! \~chinese 法向权重的指数，越大越不容易跨越法向不连续的边缘。 */
+    float sigma_normal;
+    /*! \~chinese 相对深度差异的容忍度（按每像素距离计）。 */
+    float sigma_depth;
+    /*! \~chinese 反照率差异的容忍度。 */
+    float sigma_albedo;
+};
+
+#endif // DANDELION_RENDER_DENOISER_H
@@ -0,0 +1,133 @@
+#include "dependency_grid.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+using Eigen::AlignedBox3f;
+using Eigen::Vector3f;
+using Eigen::Vector3i;
+
+namespace {
+
+constexpr int   n              = DependencyGrid::resolution;
+constexpr float infinity_float = std::numeric_limits<float>::infinity();
+
+int cell_index(const Vector3i& cell)
+{
+    return (cell.z() * n + cell.y()) * n + cell.x();
+}
+
+} // namespace
+
+DependencyGrid::DependencyGrid() : cell_size(Vector3f::Ones())
+{
+    bounds.setEmpty();
+}
+
+void DependencyGrid::reset(const AlignedBox3f& bounds)
+{
+    this->bounds = bounds;
+    // a flat scene still needs cells with a positive size
+    cell_size = (bounds.sizes() / static_cast<float>(n)).cwiseMax(1e-6f);
+}
+
+bool DependencyGrid::contains(const AlignedBox3f& box) const
+{
+    return !bounds.isEmpty() && bounds.contains(box);
+}
+
+Vector3i DependencyGrid::cell_of(const Vector3f& point) const
+{
+    Vector3i cell;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float offset = (point[axis] - bounds.min()[axis]) / cell_size[axis];
+        cell[axis]         = std::clamp(static_cast<int>(std::floor(offset)), 0, n - 1);
+    }
+    return cell;
+}
+
+void DependencyGrid::mark_segment(CellSet& cells, const Ray& ray, float t_max) const
+{
+    if (bounds.isEmpty()) {
+        return;
+    }
+    // clip the segment against the grid with the slab test
+    float t_enter = 0.0f;
+    float t_exit  = t_max;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = ray.direction[axis];
+        const float o = ray.origin[axis];
+        if (d == 0.0f) {
+            if (o < bounds.min()[axis] || o > bounds.max()[axis]) {
+                return;
+            }
+            continue;
+        }
+        float t0 = (bounds.min()[axis] - o) / d;
+        float t1 = (bounds.max()[axis] - o) / d;
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+        t_enter = std::max(t_enter, t0);
+        t_exit  = std::min(t_exit, t1);
+    }
+    if (t_enter > t_exit) {
+        return;
+    }
+
+    // walk the cells along the clipped segment (Amanatides and Woo, 1987)
+    Vector3i cell = cell_of(ray.origin + t_enter * ray.direction);
+    Vector3i step;
+    Vector3f t_next, t_delta;
+    for (int axis = 0; axis < 3; ++axis) {
+        const float d = ray.direction[axis];
+        if (d == 0.0f) {
+            step[axis]    = 0;
+            t_next[axis]  = infinity_float;
+            t_delta[axis] = infinity_float;
+            continue;
+        }
+        step[axis]            = d > 0.0f ? 1 : -1;
+        const int   next_cell = cell[axis] + (d > 0.0f ? 1 : 0);
+        const float boundary  = bounds.min()[axis] + next_cell * cell_size[axis];
+        t_next[axis]          = (boundary - ray.origin[axis]) / d;
+        t_delta[axis]         = cell_size[axis] / std::abs(d);
+    }
+    // a segment crosses at most 3n cells; the bound also guards against rounding errors
+    for (int i = 0; i < 3 * n + 1; ++i) {
+        cells.set(cell_index(cell));
+        int axis = 0;
+        if (t_next.y() < t_next[axis]) {
+            axis = 1;
+        }
+        if (t_next.z() < t_next[axis]) {
+            axis = 2;
+        }
+        if (t_next[axis] > t_exit) {
+            break;
+        }
+        cell[axis] += step[axis];
+        if (cell[axis] < 0 || cell[axis] >= n) {
+            break;
+        }
+        t_next[axis] += t_delta[axis];
+    }
+}
+
+void DependencyGrid::mark_box(CellSet& cells, const AlignedBox3f& box) const
+{
+    if (bounds.isEmpty() || box.isEmpty() || !bounds.intersects(box)) {
+        return;
+    }
+    const Vector3i low  = cell_of(box.min());
+    const Vector3i high = cell_of(box.max());
+    for (int z = low.z(); z <= high.z(); ++z) {
+        for (int y = low.y(); y <= high.y(); ++y) {
+            for (int x = low.x(); x <= high.x(); ++x) {
+                cells.set(cell_index(Vector3i(x, y, z)));
+            }
+        }
+    }
+}
@@ -0,0 +1,64 @@
+#ifndef DANDELION_RENDER_DEPENDENCY_GRID_H
+#define DANDELION_RENDER_DEPENDENCY_GRID_H
+
+#include <bitset>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "../utils/ray.h"
+
+/*!
+ * \file render/dependency_grid.h
+ * \ingroup rendering
+ * \~chinese
+ * \brief 记录光线经过的空间区域，用于增量渲染。
+ */
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 覆盖整个场景的粗粒度均匀网格。
+ *
+ * 增量渲染时，每个图像块用一个 `CellSet` 记录它的光线树（主光线、反射光线和阴影光线）中
+ * 每一段光线穿过的网格单元。一个物体移动或材质改变后，只有穿过它旧包围盒或新包围盒的光线
+ * 结果可能变化，因此只需重新追踪 `CellSet` 与这两个包围盒所占单元相交的图像块。
+ * 这是一个保守的判断：重新追踪的像素可能多于实际变化的像素，但不会遗漏。
+ */
+class DependencyGrid
+{
+public:
+
+    /*! \~chinese 每个方向上的单元数。 */
+    static constexpr int resolution = 16;
+    /*! \~chinese 一组网格单元，按 \f$(z \cdot r + y) \cdot r + x\f$ 编号。 */
+    using CellSet = std::bitset<resolution * resolution * resolution>;
+
+    DependencyGrid();
+
+    /*! \~chinese 让网格覆盖 `bounds` 。已有的 `CellSet` 在网格改变后都失效。 */
+    void reset(const Eigen::AlignedBox3f& bounds);
+    /*! \~chinese 包围盒是否完全位于网格内，只有这样它占据的单元才能被正确标记。 */
+    bool contains(const Eigen::AlignedBox3f& box) const;
+    /*!
+     * \~chinese
+     * \brief 用 3D-DDA 标记光线上 \f$t \in [0, t_{max}]\f$ 这一段穿过的所有单元。
+     *
+     * 网格之外的部分被忽略，`t_max` 可以是无穷大。
+     */
+    void mark_segment(CellSet& cells, const Ray& ray, float t_max) const;
+    /*! \~chinese 标记与包围盒重叠的所有单元。 */
+    void mark_box(CellSet& cells, const Eigen::AlignedBox3f& box) const;
+
+    /*! \~chinese 网格覆盖的范围。 */
+    Eigen::AlignedBox3f bounds;
+
+private:
+
+    /*! \~chinese 一个点所在单元的坐标（截断到网格范围内）。 */
+    Eigen::Vector3i cell_of(const Eigen::Vector3f& point) const;
+    /*! \~chinese 每个单元的边长。 */
+    Eigen::Vector3f cell_size;
+};
+
+#endif // DANDELION_RENDER_DEPENDENCY_GRID_H
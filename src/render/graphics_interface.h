@@ -10,6 +10,7 @@
 #include <spdlog/spdlog.h>
 
 #include "../scene/scene.h"
+#include "light_culling.h"
 
 /*!
  * \file render/graphics_interface.h
@@ -31,6 +32,13 @@ struct VertexShaderPayload
     Eigen::Vector4f viewport_position;
     /*! \~chinese 顶点法线 */
     Eigen::Vector3f normal;
+    /*!
+     * \~chinese
+     * \brief 顶点烘焙的光照：间接光照的辐照度和环境光遮蔽。
+     *
+     * 物体没有烘焙时为 \f$(0, 0, 0, 1)\f$ ，即没有间接光照、也没有遮蔽。
+     */
+    Eigen::Vector4f baked_lighting = Eigen::Vector4f::UnitW();
 };
 
 /*!
@@ -51,6 +59,13 @@ struct FragmentShaderPayload
     int x, y;
     /*! \~chinese 当前片元的深度 */
     float depth;
+    /*!
+     * \~chinese
+     * \brief 由三个顶点插值得到的烘焙光照。
+     *
+     * 前三个分量与漫反射系数相乘后即为间接光照，第四个分量是环境光遮蔽，可以用来缩放环境光。
+     */
+    Eigen::Vector4f baked_lighting = Eigen::Vector4f::UnitW();
     /*! \~chinese 当前片元的颜色 */
     Eigen::Vector3f color;
 };
@@ -200,6 +215,13 @@ struct Uniforms
     static GL::Material& material;
     /*! \~chinese 场景内的光源 */
     static std::list<Light>& lights;
+    /*!
+     * \~chinese
+     * \brief 当前帧各屏幕块的光源列表，为空指针时不做分块剔除。
+     *
+     * 不为空时，片元处理器只把片元所在块的光源列表传给片元着色器。
+     */
+    static const LightTiles* light_tiles;
     /*! \~chinese 当前渲染视角的相机 */
     static Camera& camera;
 };
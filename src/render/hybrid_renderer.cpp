@@ -0,0 +1,109 @@
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "render_engine.h"
+#include "../utils/ray.h"
+#include "../utils/logger.h"
+
+using std::size_t;
+using std::uint32_t;
+using std::chrono::steady_clock;
+using duration   = std::chrono::duration<float>;
+using time_point = std::chrono::time_point<steady_clock, duration>;
+using Eigen::Matrix4f;
+using Eigen::Vector3f;
+
+HybridRenderer::HybridRenderer(RenderEngine& engine) :
+    width(engine.width), height(engine.height), n_threads(engine.n_threads),
+    rendering_res(engine.rendering_res), whitted(*engine.whitted_render)
+{
+    logger = get_logger("Hybrid Renderer");
+}
+
+void HybridRenderer::render(Scene& scene)
+{
+    time_point begin_time = steady_clock::now();
+    width                 = std::floor(width);
+    height                = std::floor(height);
+    const int    w        = static_cast<int>(width);
+    const int    h        = static_cast<int>(height);
+    const size_t n_pixels = static_cast<size_t>(w) * static_cast<size_t>(h);
+    reset_traversal_counters();
+
+    // 1. primary visibility: rasterize every object into the visibility buffer
+    std::vector<const Object*> objects;
+    std::vector<Matrix4f>      models;
+    visibility.clear(w, h);
+    for (const auto& group: scene.groups) {
+        for (const auto& object: group->objects) {
+            const uint32_t index = static_cast<uint32_t>(objects.size());
+            objects.push_back(object.get());
+            models.push_back(object->model());
+            visibility.rasterize(
+                object->mesh, models.back(), index, scene.camera,
+                static_cast<unsigned int>(std::max(n_threads, 0))
+            );
+        }
+    }
+    const time_point raster_time = steady_clock::now();
+
+    // 2. rebuild the primary hit of every covered pixel and shade it with the Whitted renderer,
+    // which traces the reflection and shadow rays
+    std::vector<Vector3f> framebuffer(n_pixels, RenderEngine::background_color);
+    size_t                n_covered = 0;
+    for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+            const VisibilityBuffer::Sample& sample = visibility.at(i, j);
+            if (sample.object == VisibilityBuffer::no_object) {
+                continue;
+            }
+            ++n_covered;
+            const Object&  object = *objects[sample.object];
+            const Matrix4f model  = models[sample.object];
+            const auto     face   = object.mesh.face(sample.face);
+            Vector3f       corners[3];
+            for (int k = 0; k < 3; ++k) {
+                corners[k] = (model * object.mesh.vertex(face[k]).homogeneous()).hnormalized();
+            }
+            const Vector3f point = sample.barycentric.x() * corners[0]
+                                 + sample.barycentric.y() * corners[1]
+                                 + sample.barycentric.z() * corners[2];
+            const Ray      ray   = {
+                scene.camera.position, (point - scene.camera.position).normalized()
+            };
+            Intersection isect;
+            isect.t                 = sample.depth;
+            isect.face_index        = sample.face;
+            isect.barycentric_coord = sample.barycentric;
+            isect.normal = (corners[1] - corners[0]).cross(corners[2] - corners[0]).normalized();
+            framebuffer[static_cast<size_t>(j) * w + i] =
+                whitted.shade(ray, isect, object.mesh.material, scene, 0);
+        }
+    }
+    write_rendering_result(framebuffer, rendering_res);
+
+    const time_point end_time         = steady_clock::now();
+    const duration   raster_duration  = raster_time - begin_time;
+    const duration   shading_duration = end_time - raster_time;
+    logger->info(
+        "rendering takes {:.6f} seconds ({:.6f} rasterizing, {:.6f} shading {} of {} pixels)",
+        (end_time - begin_time).count(), raster_duration.count(), shading_duration.count(),
+        n_covered, n_pixels
+    );
+    flush_traversal_counters();
+    traversal_counters = collected_traversal_counters();
+    if (traversal_counters.rays > 0) {
+        const double rays = static_cast<double>(traversal_counters.rays);
+        logger->info(
+            "{} secondary rays, {:.2f} nodes visited, {:.2f} triangle tests and {:.2f} hits "
+            "per ray",
+            traversal_counters.rays, traversal_counters.visited_nodes / rays,
+            traversal_counters.triangle_tests / rays, traversal_counters.triangle_hits / rays
+        );
+    }
+}
@@ -0,0 +1,189 @@
+#include "light_baker.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+#include "../utils/logger.h"
+#include "../utils/math.hpp"
+#include "../utils/parallel.hpp"
+
+using Eigen::Matrix3f;
+using Eigen::Matrix4f;
+using Eigen::Vector3f;
+using Eigen::Vector4f;
+using std::optional;
+using std::size_t;
+using std::uint32_t;
+using std::chrono::steady_clock;
+using duration   = std::chrono::duration<float>;
+using time_point = std::chrono::time_point<steady_clock, duration>;
+
+// offset along the normal that keeps baking rays from hitting their own surface
+constexpr float RAY_OFFSET = 0.0001f;
+
+LightBaker::LightBaker() : n_samples(64), ao_distance(1.0f), n_threads(0)
+{
+    logger = get_logger("Light Baker");
+}
+
+void LightBaker::bake(Scene& scene)
+{
+    time_point begin_time = steady_clock::now();
+    // Model matrices are written into the BVHs here, on the calling thread, so that the worker
+    // threads only read from them.
+    objects.clear();
+    std::vector<Object*> targets;
+    for (const auto& group: scene.groups) {
+        for (const auto& object: group->objects) {
+            targets.push_back(object.get());
+            if (object->bvh == nullptr || object->bvh->root == nullptr) {
+                continue;
+            }
+            object->bvh->model = object->model();
+            objects.push_back(object.get());
+        }
+    }
+    light_bvh.build(scene.lights);
+
+    size_t n_vertices = 0;
+    for (uint32_t object_index = 0; object_index < targets.size(); ++object_index) {
+        GL::Mesh& mesh = targets[object_index]->mesh;
+        bake_mesh(mesh, targets[object_index]->model(), object_index);
+        if (mesh.has_baked_lighting()) {
+            n_vertices += mesh.vertices.count();
+        }
+    }
+
+    const duration bake_duration = steady_clock::now() - begin_time;
+    logger->info(
+        "baked {} vertices of {} objects with {} rays each in {:.3f} seconds", n_vertices,
+        targets.size(), std::max(n_samples, 1), bake_duration.count()
+    );
+}
+
+void LightBaker::bake_mesh(GL::Mesh& mesh, const Matrix4f& model, uint32_t key)
+{
+    const Matrix3f normal_transform = model.inverse().transpose().topLeftCorner<3, 3>();
+    const size_t   n                = mesh.vertices.count();
+    if (mesh.normals.count() != n) {
+        return;
+    }
+    // clamped locally, so that baking never changes the user's setting
+    const int          samples = std::max(n_samples, 1);
+    std::vector<float> baked(4 * n);
+    parallel_for_chunks(
+        0, n,
+        [&](size_t first, size_t last, size_t) {
+            std::unique_ptr<Sampler> sampler = make_sampler(SamplerType::SOBOL);
+            for (size_t i = first; i < last; ++i) {
+                const Vector3f position = (model * mesh.vertex(i).homogeneous()).head<3>();
+                const Vector3f normal   = normal_transform * mesh.normal(i);
+                Vector4f       result   = Vector4f::UnitW();
+                if (normal.squaredNorm() > 0.0f) {
+                    result = bake_vertex(
+                        position, normal.normalized(), samples, *sampler, static_cast<uint32_t>(i),
+                        key
+                    );
+                }
+                std::copy(result.data(), result.data() + 4, baked.begin() + 4 * i);
+            }
+        },
+        static_cast<unsigned int>(std::max(n_threads, 0))
+    );
+    mesh.baked_lighting.data = std::move(baked);
+    mesh.VAO.bind();
+    mesh.baked_lighting.to_gpu();
+    mesh.VAO.release();
+}
+
+void LightBaker::clear(Scene& scene)
+{
+    for (const auto& group: scene.groups) {
+        for (const auto& object: group->objects) {
+            GL::Mesh& mesh = object->mesh;
+            mesh.baked_lighting.data.clear();
+            mesh.VAO.bind();
+            mesh.baked_lighting.to_gpu();
+            mesh.VAO.release();
+        }
+    }
+}
+
+optional<std::tuple<Intersection, const GL::Material*>> LightBaker::trace(const Ray& ray) const
+{
+    optional<Intersection> payload;
+    const GL::Material*    material = nullptr;
+    for (const Object* object: objects) {
+        optional<Intersection> result = object->bvh->ray_node_intersect(object->bvh->root, ray);
+        if (result.has_value() && result->t > 0.0f
+            && (!payload.has_value() || result->t < payload->t)) {
+            payload  = result;
+            material = &object->mesh.material;
+        }
+    }
+    if (!payload.has_value()) {
+        return std::nullopt;
+    }
+    return std::make_tuple(payload.value(), material);
+}
+
+Vector3f LightBaker::direct_diffuse(
+    const Vector3f& position, const Vector3f& normal, const GL::Material& material
+) const
+{
+    float irradiance = 0.0f;
+    light_bvh.for_each_light(position, normal, 0.0f, [&](const Light& light) {
+        const Vector3f to_light = light.position - position;
+        const float    distance = to_light.norm();
+        const Vector3f l        = to_light / distance;
+        const float    cos_l    = normal.dot(l);
+        if (cos_l <= 0.0f) {
+            return;
+        }
+        auto hit = trace({position, l});
+        if (hit.has_value() && std::get<0>(hit.value()).t < distance) {
+            return;
+        }
+        irradiance += light.intensity * cos_l / (distance * distance);
+    });
+    return irradiance * material.diffuse;
+}
+
+Vector4f LightBaker::bake_vertex(
+    const Vector3f& position, const Vector3f& normal, int samples, Sampler& sampler,
+    uint32_t key_x, uint32_t key_y
+) const
+{
+    const Vector3f origin     = position + RAY_OFFSET * normal;
+    Vector3f       irradiance = Vector3f::Zero();
+    int            n_visible  = 0;
+    for (int k = 0; k < samples; ++k) {
+        sampler.start_pixel(key_x, key_y, static_cast<uint32_t>(k));
+        const Ray ray = {origin, sample_cosine_hemisphere(normal, sampler.next_2d())};
+        auto      hit = trace(ray);
+        if (!hit.has_value()) {
+            ++n_visible;
+            continue;
+        }
+        const auto& [isect, material] = hit.value();
+        if (isect.t > ao_distance) {
+            ++n_visible;
+        }
+        // With cosine-weighted directions the average radiance arriving from the hit points
+        // is the irradiance in the same units the path tracer uses for the diffuse term.
+        Vector3f hit_normal = isect.normal.normalized();
+        if (hit_normal.dot(ray.direction) > 0.0f) {
+            hit_normal = -hit_normal;
+        }
+        const Vector3f hit_position = ray.origin + isect.t * ray.direction;
+        irradiance += direct_diffuse(hit_position + RAY_OFFSET * hit_normal, hit_normal, *material);
+    }
+    irradiance /= static_cast<float>(samples);
+    return Vector4f(
+        irradiance.x(), irradiance.y(), irradiance.z(),
+        static_cast<float>(n_visible) / static_cast<float>(samples)
+    );
+}
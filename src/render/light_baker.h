@@ -0,0 +1,108 @@
+#ifndef DANDELION_RENDER_LIGHT_BAKER_H
+#define DANDELION_RENDER_LIGHT_BAKER_H
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include <Eigen/Core>
+#include <spdlog/spdlog.h>
+
+#include "../scene/scene.h"
+#include "../utils/light_bvh.h"
+#include "../utils/ray.h"
+#include "../utils/sampler.h"
+
+/*!
+ * \file render/light_baker.h
+ * \ingroup rendering
+ * \~chinese
+ * \brief 把光线追踪得到的环境光遮蔽和间接光照烘焙到网格顶点上。
+ */
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 逐顶点的光照烘焙器。
+ *
+ * 对每个物体的每个顶点，沿法线一侧按余弦分布发出 `n_samples` 条光线，用各物体的 BVH 求交：
+ *
+ * - 在 `ao_distance` 以内击中物体的光线视为被遮挡，未被遮挡的比例就是环境光遮蔽；
+ * - 击中点处的直接漫反射光照（带阴影测试）的平均值就是一次弹射的间接光照辐照度，
+ *   约定与路径追踪渲染器相同：与顶点的漫反射系数相乘即得到间接光照的贡献。
+ *
+ * 结果写入 `GL::Mesh::baked_lighting` ，场景预览的顶点着色器和光栅化渲染器都会读取它，
+ * 从而以光栅化的代价得到接近离线渲染的观感。顶点之间互不依赖，因此烘焙在多个线程中并行进行；
+ * 上传显存仍在调用 `bake` 的线程中完成，所以必须在主线程调用。
+ *
+ * 烘焙结果不会随物体移动或光源变化自动更新，需要重新调用 `bake` 。
+ */
+class LightBaker
+{
+public:
+
+    LightBaker();
+
+    /*!
+     * \~chinese
+     * \brief 为场景中所有物体烘焙光照并上传显存。
+     *
+     * 没有 BVH 的物体仍会被烘焙，但不会遮挡其他物体的光线。
+     */
+    void bake(Scene& scene);
+    /*!
+     * \~chinese
+     * \brief 烘焙一个网格并上传显存。
+     *
+     * 遮挡物和光源来自最近一次 `bake` 调用收集的场景，从未调用过 `bake` 时两者都为空。
+     *
+     * \param mesh 要烘焙的网格，顶点数与法线数不一致时不做任何修改
+     * \param model 网格的模型变换矩阵
+     * \param key 区分不同网格的整数，使不同网格上的采样序列互不相关
+     */
+    void bake_mesh(GL::Mesh& mesh, const Eigen::Matrix4f& model, std::uint32_t key);
+    /*! \~chinese 删除场景中所有物体的烘焙结果。 */
+    void clear(Scene& scene);
+
+    /*! \~chinese 每个顶点发出的光线数。 */
+    int n_samples;
+    /*! \~chinese 环境光遮蔽的最大距离，更远处的遮挡不计入。 */
+    float ao_distance;
+    /*! \~chinese 烘焙使用的线程数，为 0 时使用硬件线程数。 */
+    int n_threads;
+
+private:
+
+    /*! \~chinese 在所有物体中求最近的交点，返回交点和所在物体的材质。 */
+    std::optional<std::tuple<Intersection, const GL::Material*>> trace(const Ray& ray) const;
+    /*!
+     * \~chinese
+     * \brief 烘焙一个顶点。
+     *
+     * \param position 世界坐标系下的顶点位置
+     * \param normal 世界坐标系下的单位法向量
+     * \param samples 发出的光线数，至少为 1
+     * \param sampler 当前线程的采样器，每个样本都会重新调用 `start_pixel`
+     * \param key_x 区分不同顶点的整数，作为采样器的像素横坐标
+     * \param key_y 区分不同顶点的整数，作为采样器的像素纵坐标
+     */
+    Eigen::Vector4f bake_vertex(
+        const Eigen::Vector3f& position, const Eigen::Vector3f& normal, int samples,
+        Sampler& sampler, std::uint32_t key_x, std::uint32_t key_y
+    ) const;
+    /*! \~chinese 着色点处来自所有点光源的直接漫反射光照（带阴影测试）。 */
+    Eigen::Vector3f direct_diffuse(
+        const Eigen::Vector3f& position, const Eigen::Vector3f& normal,
+        const GL::Material& material
+    ) const;
+
+    /*! \~chinese 本次烘焙中可以遮挡光线的物体，只在主线程中修改。 */
+    std::vector<const Object*> objects;
+    /*! \~chinese 本次烘焙使用的光源层次包围盒。 */
+    LightBVH light_bvh;
+    std::shared_ptr<spdlog::logger> logger;
+};
+
+#endif // DANDELION_RENDER_LIGHT_BAKER_H
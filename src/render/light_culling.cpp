@@ -0,0 +1,136 @@
+#include "light_culling.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+using Eigen::Matrix4f;
+using Eigen::Vector3f;
+using Eigen::Vector4f;
+using std::size_t;
+using std::uint32_t;
+
+LightTiles::LightTiles() : tiles_x(0), tiles_y(0)
+{
+}
+
+void LightTiles::build(
+    const std::list<Light>& lights, const Matrix4f& view, const Matrix4f& projection, int width,
+    int height, float cutoff
+)
+{
+    tiles_x = std::max((width + tile_size - 1) / tile_size, 1);
+    tiles_y = std::max((height + tile_size - 1) / tile_size, 1);
+    tiles.assign(static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y), {0, 0});
+    sources.clear();
+    sources.reserve(lights.size());
+
+    // The first pass finds the tile rectangle of every light and counts the lights of each
+    // tile, the second pass writes the indices into the ranges given by the counts.
+    struct Rectangle
+    {
+        int first_x, last_x, first_y, last_y;
+    };
+    std::vector<Rectangle> rectangles;
+    rectangles.reserve(lights.size());
+    for (const Light& light: lights) {
+        sources.push_back(&light);
+        int first_x = 0, last_x = tiles_x - 1;
+        int first_y = 0, last_y = tiles_y - 1;
+        if (cutoff > 0.0f && light.intensity > 0.0f) {
+            // Project the 8 corners of the view-space cube around the influence sphere. The
+            // screen rectangle of the corners contains that of the sphere for both orthographic
+            // and perspective projections, as long as no corner is behind the eye.
+            const float         radius = std::sqrt(light.intensity / cutoff);
+            const Vector4f      center = view * light.position.homogeneous();
+            Eigen::AlignedBox3f ndc_bounds;
+            bool                covers_eye = false;
+            for (int k = 0; k < 8; ++k) {
+                const Vector4f corner =
+                    center + radius * Vector4f(k & 1 ? 1 : -1, k & 2 ? 1 : -1, k & 4 ? 1 : -1, 0);
+                const Vector4f clip = projection * corner;
+                if (clip.w() <= 0.0f) {
+                    covers_eye = true;
+                    break;
+                }
+                ndc_bounds.extend(Vector3f(clip.head<3>() / clip.w()));
+            }
+            if (!covers_eye) {
+                const Eigen::AlignedBox3f screen(-Vector3f::Ones(), Vector3f::Ones());
+                if (!ndc_bounds.intersects(screen)) {
+                    rectangles.push_back({0, -1, 0, -1});
+                    continue;
+                }
+                const auto to_tile = [](float ndc, int size, int n_tiles) {
+                    const float pixel = (std::clamp(ndc, -1.0f, 1.0f) + 1.0f) * 0.5f * size;
+                    return std::clamp(static_cast<int>(pixel) / tile_size, 0, n_tiles - 1);
+                };
+                first_x = to_tile(ndc_bounds.min().x(), width, tiles_x);
+                last_x  = to_tile(ndc_bounds.max().x(), width, tiles_x);
+                first_y = to_tile(ndc_bounds.min().y(), height, tiles_y);
+                last_y  = to_tile(ndc_bounds.max().y(), height, tiles_y);
+            }
+        }
+        rectangles.push_back({first_x, last_x, first_y, last_y});
+        for (int tile_y = first_y; tile_y <= last_y; ++tile_y) {
+            for (int tile_x = first_x; tile_x <= last_x; ++tile_x) {
+                ++tiles[static_cast<size_t>(tile_y) * tiles_x + tile_x].count;
+            }
+        }
+    }
+
+    uint32_t offset = 0;
+    for (TileRange& tile: tiles) {
+        tile.offset = offset;
+        offset += tile.count;
+        tile.count = 0;
+    }
+    light_indices.resize(offset);
+    for (uint32_t index = 0; index < rectangles.size(); ++index) {
+        const Rectangle& rectangle = rectangles[index];
+        for (int tile_y = rectangle.first_y; tile_y <= rectangle.last_y; ++tile_y) {
+            for (int tile_x = rectangle.first_x; tile_x <= rectangle.last_x; ++tile_x) {
+                TileRange& tile = tiles[static_cast<size_t>(tile_y) * tiles_x + tile_x];
+                light_indices[tile.offset + tile.count++] = index;
+            }
+        }
+    }
+    // Lists are reused across frames, so only tiles whose light count grows allocate nodes.
+    tile_lights.resize(tiles.size());
+    for (size_t tile = 0; tile < tiles.size(); ++tile) {
+        std::list<Light>& list = tile_lights[tile];
+        list.resize(tiles[tile].count, Light(Vector3f::Zero(), 0.0f));
+        auto target = list.begin();
+        for (uint32_t index: lights_in(tile)) {
+            *target++ = *sources[index];
+        }
+    }
+}
+
+size_t LightTiles::tile_at(int x, int y) const
+{
+    const int tile_x = std::clamp(x / tile_size, 0, tiles_x - 1);
+    const int tile_y = std::clamp(y / tile_size, 0, tiles_y - 1);
+    return static_cast<size_t>(tile_y) * tiles_x + tile_x;
+}
+
+std::span<const uint32_t> LightTiles::lights_in(size_t tile) const
+{
+    return std::span<const uint32_t>(light_indices).subspan(tiles[tile].offset, tiles[tile].count);
+}
+
+const Light& LightTiles::light(uint32_t index) const
+{
+    return *sources[index];
+}
+
+const std::list<Light>& LightTiles::lights_of(size_t tile) const
+{
+    return tile_lights[tile];
+}
+
+size_t LightTiles::n_references() const
+{
+    return light_indices.size();
+}
@@ -0,0 +1,99 @@
+#ifndef DANDELION_RENDER_LIGHT_CULLING_H
+#define DANDELION_RENDER_LIGHT_CULLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <span>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "../scene/light.h"
+
+/*!
+ * \file render/light_culling.h
+ * \ingroup rendering
+ * \~chinese
+ * \brief 光栅化渲染器的分块光源剔除。
+ */
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 按屏幕分块记录可能照亮其中片元的光源。
+ *
+ * 点光源的辐照度按 \f$I / r^2\f$ 衰减，降到 `cutoff` 以下的距离
+ * \f$\sqrt{I / \mathrm{cutoff}}\f$ 就是它的影响半径。`build` 在每帧开始前把每个光源的影响球
+ * 投影到屏幕上，只把它的序号加入投影范围覆盖的块。片元着色时只需遍历所在块的光源，
+ * 着色的代价不再与场景中的光源总数成正比。
+ *
+ * 所有块的光源序号连续存放在一个数组中，每个块只记录自己的起始位置和个数，
+ * 遍历时的访存是连续的。片元着色器以光源列表为参数，因此 `build` 还会为每个块构造一次
+ * 光源列表，片元阶段直接引用它而不必在每次切换块时复制光源。
+ *
+ * 屏幕坐标与片元的 `x, y` 一致：原点在左下角，像素 \f$(x, y)\f$ 对应 NDC 坐标
+ * \f$(2x / w - 1, 2y / h - 1)\f$ 。
+ */
+class LightTiles
+{
+public:
+
+    /*! \~chinese 块的边长（像素）。 */
+    static constexpr int tile_size = 16;
+
+    /*! \~chinese 一个块的光源序号在 `light_indices` 中的范围。 */
+    struct TileRange
+    {
+        std::uint32_t offset;
+        std::uint32_t count;
+    };
+
+    LightTiles();
+
+    /*!
+     * \~chinese
+     * \brief 为当前帧重新分配各块的光源。
+     *
+     * `lights` 中的元素在下一次调用 `build` 之前必须保持有效，`light` 通过指针访问它们。
+     *
+     * \param lights 场景中的光源
+     * \param view 相机的观察矩阵
+     * \param projection 相机的投影矩阵
+     * \param width 图像宽度
+     * \param height 图像高度
+     * \param cutoff 可以忽略的辐照度，不大于 0 时每个光源都影响整个屏幕
+     */
+    void build(
+        const std::list<Light>& lights, const Eigen::Matrix4f& view,
+        const Eigen::Matrix4f& projection, int width, int height, float cutoff
+    );
+    /*! \~chinese 屏幕坐标 \f$(x, y)\f$ 所在块的序号，超出屏幕的坐标按最近的块处理。 */
+    std::size_t tile_at(int x, int y) const;
+    /*! \~chinese 第 `tile` 个块的光源序号，按光源在场景中的顺序排列。 */
+    std::span<const std::uint32_t> lights_in(std::size_t tile) const;
+    /*! \~chinese 序号为 `index` 的光源（即 `build` 时场景中的第 `index` 个光源）。 */
+    const Light& light(std::uint32_t index) const;
+    /*! \~chinese 第 `tile` 个块的光源列表，供以光源列表为参数的片元着色器使用。 */
+    const std::list<Light>& lights_of(std::size_t tile) const;
+    /*! \~chinese 所有块的光源个数之和。 */
+    std::size_t n_references() const;
+
+    /*! \~chinese 水平方向的块数。 */
+    int tiles_x;
+    /*! \~chinese 竖直方向的块数。 */
+    int tiles_y;
+    /*! \~chinese 每个块的光源范围，按行优先、第 0 行在屏幕底部的顺序存放。 */
+    std::vector<TileRange> tiles;
+    /*! \~chinese 所有块的光源序号，第 i 个块占据 `tiles[i]` 描述的一段。 */
+    std::vector<std::uint32_t> light_indices;
+
+private:
+
+    /*! \~chinese 按序号排列的场景光源。 */
+    std::vector<const Light*> sources;
+    /*! \~chinese 每个块的光源列表，与 `light_indices` 描述的光源相同。 */
+    std::vector<std::list<Light>> tile_lights;
+};
+
+#endif // DANDELION_RENDER_LIGHT_CULLING_H
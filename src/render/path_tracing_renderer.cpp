@@ -0,0 +1,444 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "render_engine.h"
+#include "../scene/light.h"
+#include "../utils/math.hpp"
+#include "../utils/ray.h"
+#include "../utils/logger.h"
+#include "../utils/parallel.hpp"
+
+using Eigen::Vector3f;
+using std::optional;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::chrono::steady_clock;
+using duration   = std::chrono::duration<float>;
+using time_point = std::chrono::time_point<steady_clock, duration>;
+
+// offset along the normal that keeps secondary rays from hitting their own surface
+constexpr float RAY_OFFSET = 0.0001f;
+// upper bound of the russian roulette survival probability, so that every path can end
+constexpr float MAX_SURVIVAL_PROBABILITY = 0.95f;
+
+namespace {
+
+// Spread the lower 9 bits of v so that there are two zero bits between neighbouring bits.
+uint32_t expand_bits(uint32_t v)
+{
+    v = (v * 0x0001'0001u) & 0xFF00'00FFu;
+    v = (v * 0x0000'0101u) & 0x0F00'F00Fu;
+    v = (v * 0x0000'0011u) & 0xC30C'30C3u;
+    v = (v * 0x0000'0005u) & 0x4924'9249u;
+    return v;
+}
+
+// Order in which a queue of rays should be traced. Rays are grouped by the octant of their
+// direction first and then by the 27-bit Morton code of their origin inside the bounding box
+// of all origins, so that consecutive rays tend to visit the same BVH nodes.
+template<typename T>
+std::vector<uint32_t> coherent_order(const std::vector<T>& rays, unsigned int n_threads)
+{
+    Eigen::AlignedBox3f bounds;
+    for (const T& item: rays) {
+        bounds.extend(item.ray.origin);
+    }
+    const Vector3f        extent = bounds.sizes().cwiseMax(1e-6f);
+    std::vector<uint64_t> keys(rays.size());
+    parallel_for(
+        0, rays.size(),
+        [&](size_t i) {
+            const Ray&     ray    = rays[i].ray;
+            const Vector3f p      = (ray.origin - bounds.min()).cwiseQuotient(extent);
+            uint32_t       key    = 0;
+            for (int axis = 0; axis < 3; ++axis) {
+                const float    scaled = std::clamp(p[axis] * 512.0f, 0.0f, 511.0f);
+                const uint32_t cell   = static_cast<uint32_t>(scaled);
+                key |= expand_bits(cell) << (2 - axis);
+                if (ray.direction[axis] < 0.0f) {
+                    key |= 1u << (27 + axis);
+                }
+            }
+            keys[i] = (static_cast<uint64_t>(key) << 32) | static_cast<uint64_t>(i);
+        },
+        n_threads
+    );
+    std::sort(keys.begin(), keys.end());
+    std::vector<uint32_t> order(rays.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order[i] = static_cast<uint32_t>(keys[i]);
+    }
+    return order;
+}
+
+} // namespace
+
+PathTracingRenderer::PathTracingRenderer(RenderEngine& engine) :
+    width(engine.width), height(engine.height), n_threads(engine.n_threads), max_depth(32),
+    russian_roulette_depth(3), n_samples(0), sampler_type(SamplerType::SOBOL), wavefront(false),
+    light_samples(0), light_cull_threshold(0.0f), rendering_res(engine.rendering_res)
+{
+    logger = get_logger("Path Tracer");
+}
+
+void PathTracingRenderer::reset()
+{
+    accumulation.clear();
+    normal_sum.clear();
+    albedo_sum.clear();
+    depth_sum.clear();
+    hit_count.clear();
+    n_samples = 0;
+}
+
+void PathTracingRenderer::render(Scene& scene)
+{
+    time_point   begin_time = steady_clock::now();
+    const int    w          = static_cast<int>(std::floor(width));
+    const int    h          = static_cast<int>(std::floor(height));
+    const size_t n_pixels   = static_cast<size_t>(w) * static_cast<size_t>(h);
+    if (accumulation.size() != n_pixels) {
+        reset();
+        accumulation.assign(n_pixels, Vector3f::Zero());
+        normal_sum.assign(n_pixels, Vector3f::Zero());
+        albedo_sum.assign(n_pixels, Vector3f::Zero());
+        depth_sum.assign(n_pixels, 0.0f);
+        hit_count.assign(n_pixels, 0);
+    }
+
+    // Model matrices are written into the BVHs here, on a single thread, so that the worker
+    // threads only read from them.
+    objects.clear();
+    for (const auto& group: scene.groups) {
+        for (const auto& object: group->objects) {
+            if (object->bvh == nullptr || object->bvh->root == nullptr) {
+                continue;
+            }
+            object->bvh->model = object->model();
+            objects.push_back(object.get());
+        }
+    }
+    light_bvh.build(scene.lights);
+
+    pass_radiance.assign(n_pixels, Vector3f::Zero());
+    primary_hits.assign(n_pixels, PrimaryHit{-1.0f, Vector3f::Zero(), Vector3f::Zero()});
+    reset_traversal_counters();
+    if (wavefront) {
+        render_wavefront(scene, w, h);
+    } else {
+        render_depth_first(scene, w, h);
+    }
+    traversal_counters = collected_traversal_counters();
+    for (size_t i = 0; i < n_pixels; ++i) {
+        accumulation[i] += pass_radiance[i];
+        const PrimaryHit& primary = primary_hits[i];
+        if (primary.depth >= 0.0f) {
+            normal_sum[i] += primary.normal;
+            albedo_sum[i] += primary.albedo;
+            depth_sum[i] += primary.depth;
+            ++hit_count[i];
+        }
+    }
+    ++n_samples;
+
+    // Publish the running average. A pixel counts as covered in the G-buffer when at least
+    // half of its samples hit something.
+    image.resize(n_pixels);
+    gbuffer.reset(n_pixels);
+    const float scale = 1.0f / static_cast<float>(n_samples);
+    for (size_t i = 0; i < n_pixels; ++i) {
+        image[i] = accumulation[i] * scale;
+        if (2 * hit_count[i] >= n_samples && hit_count[i] > 0) {
+            const float    hit_scale = 1.0f / static_cast<float>(hit_count[i]);
+            const Vector3f normal    = normal_sum[i] * hit_scale;
+            // opposite normals may cancel out, the denoiser skips the normal term for them
+            gbuffer.normal[i] =
+                normal.squaredNorm() > 1e-6f ? normal.normalized() : Vector3f::Zero();
+            gbuffer.albedo[i] = albedo_sum[i] * hit_scale;
+            gbuffer.depth[i]  = depth_sum[i] * hit_scale;
+        }
+    }
+    write_rendering_result(image, rendering_res);
+    time_point end_time      = steady_clock::now();
+    duration   pass_duration = end_time - begin_time;
+    logger->debug("sample {} takes {:.6f} seconds", n_samples, pass_duration.count());
+}
+
+void PathTracingRenderer::render_depth_first(const Scene& scene, int w, int h)
+{
+    // Rows are dealt out round-robin so that every thread gets a similar mix of cheap (empty)
+    // and expensive rows. Samples depend only on the pixel and the sample index, so the image
+    // does not depend on the number of threads.
+    const unsigned int n_workers = parallel_chunk_count(h, n_threads);
+    parallel_for_chunks(
+        0, n_workers,
+        [&](size_t first_row, size_t, size_t) {
+            std::unique_ptr<Sampler> sampler = make_sampler(sampler_type);
+            for (size_t j = first_row; j < static_cast<size_t>(h); j += n_workers) {
+                for (int i = 0; i < w; ++i) {
+                    const size_t idx = j * w + i;
+                    sampler->start_pixel(i, static_cast<uint32_t>(j), n_samples);
+                    const Eigen::Vector2f jitter = sampler->next_2d();
+                    const float           x      = static_cast<float>(i) + jitter.x();
+                    const float           y      = static_cast<float>(j) + jitter.y();
+                    const Ray ray = generate_subpixel_ray(scene.camera, width, height, x, y);
+                    pass_radiance[idx] = radiance(ray, *sampler, primary_hits[idx]);
+                }
+            }
+            flush_traversal_counters();
+        },
+        n_workers
+    );
+}
+
+void PathTracingRenderer::render_wavefront(const Scene& scene, int w, int h)
+{
+    const size_t n_pixels = static_cast<size_t>(w) * static_cast<size_t>(h);
+    // 1. camera rays, one path per pixel
+    std::vector<PathState> paths(n_pixels);
+    parallel_for_chunks(
+        0, n_pixels,
+        [&](size_t first, size_t last, size_t) {
+            std::unique_ptr<Sampler> sampler = make_sampler(sampler_type);
+            for (size_t p = first; p < last; ++p) {
+                const uint32_t i = static_cast<uint32_t>(p % w);
+                const uint32_t j = static_cast<uint32_t>(p / w);
+                sampler->start_pixel(i, j, n_samples);
+                const Eigen::Vector2f jitter = sampler->next_2d();
+                const float           x      = static_cast<float>(i) + jitter.x();
+                const float           y      = static_cast<float>(j) + jitter.y();
+                paths[p] = {
+                    generate_subpixel_ray(scene.camera, width, height, x, y), Vector3f::Ones(),
+                    static_cast<uint32_t>(p), sampler->current_dimension()
+                };
+            }
+        },
+        n_threads
+    );
+
+    std::vector<optional<std::tuple<Intersection, GL::Material>>> hits;
+    std::vector<ShadowRay>                                         shadow_rays;
+    std::vector<unsigned char>                                     blocked;
+    for (int depth = 0; depth < max_depth && !paths.empty(); ++depth) {
+        // 2. sort the queue into a coherent order and trace it
+        {
+            const std::vector<uint32_t> order = coherent_order(paths, n_threads);
+            std::vector<PathState>      sorted(paths.size());
+            for (size_t k = 0; k < order.size(); ++k) {
+                sorted[k] = paths[order[k]];
+            }
+            paths.swap(sorted);
+        }
+        hits.assign(paths.size(), std::nullopt);
+        parallel_for_chunks(
+            0, paths.size(),
+            [&](size_t first, size_t last, size_t) {
+                for (size_t k = first; k < last; ++k) {
+                    hits[k] = trace(paths[k].ray);
+                }
+                flush_traversal_counters();
+            },
+            n_threads
+        );
+
+        // 3. shade every hit. Each pixel owns at most one path per bounce, so threads never
+        // write the same pixel.
+        const size_t n_chunks = parallel_chunk_count(paths.size(), n_threads);
+
+        std::vector<std::vector<PathState>> next_paths(n_chunks);
+        std::vector<std::vector<ShadowRay>> chunk_shadow_rays(n_chunks);
+        parallel_for_chunks(
+            0, paths.size(),
+            [&](size_t first, size_t last, size_t chunk) {
+                std::unique_ptr<Sampler> sampler = make_sampler(sampler_type);
+                for (size_t k = first; k < last; ++k) {
+                    PathState& path = paths[k];
+                    if (!hits[k].has_value()) {
+                        pass_radiance[path.pixel] +=
+                            path.throughput.cwiseProduct(RenderEngine::background_color);
+                        continue;
+                    }
+                    const auto& [isect, material] = hits[k].value();
+                    sampler->start_pixel(path.pixel % w, path.pixel / w, n_samples, path.dimension);
+                    if (scatter(
+                            path.ray, isect, material, depth, *sampler, path.throughput, path.pixel,
+                            chunk_shadow_rays[chunk], primary_hits[path.pixel]
+                        )) {
+                        path.dimension = sampler->current_dimension();
+                        next_paths[chunk].push_back(path);
+                    }
+                }
+            },
+            n_threads
+        );
+
+        // 4. trace the shadow rays in a coherent order, but add their contributions in the
+        // order they were emitted so that every pixel sums its terms like the depth-first loop
+        shadow_rays.clear();
+        for (const auto& chunk: chunk_shadow_rays) {
+            shadow_rays.insert(shadow_rays.end(), chunk.begin(), chunk.end());
+        }
+        const std::vector<uint32_t> order = coherent_order(shadow_rays, n_threads);
+        blocked.assign(shadow_rays.size(), 0);
+        parallel_for_chunks(
+            0, order.size(),
+            [&](size_t first, size_t last, size_t) {
+                for (size_t k = first; k < last; ++k) {
+                    blocked[order[k]] = occluded(shadow_rays[order[k]]);
+                }
+                flush_traversal_counters();
+            },
+            n_threads
+        );
+        for (size_t k = 0; k < shadow_rays.size(); ++k) {
+            if (!blocked[k]) {
+                pass_radiance[shadow_rays[k].pixel] += shadow_rays[k].contribution;
+            }
+        }
+
+        // 5. the surviving paths form the next queue
+        paths.clear();
+        for (const auto& chunk: next_paths) {
+            paths.insert(paths.end(), chunk.begin(), chunk.end());
+        }
+    }
+}
+
+optional<std::tuple<Intersection, GL::Material>> PathTracingRenderer::trace(const Ray& ray) const
+{
+    ++thread_traversal_counters().rays;
+    optional<Intersection> payload;
+    const GL::Material*    material = nullptr;
+    for (const Object* object: objects) {
+        optional<Intersection> result = object->bvh->ray_node_intersect(object->bvh->root, ray);
+        if (result.has_value() && result->t > 0.0f
+            && (!payload.has_value() || result->t < payload->t)) {
+            payload  = result;
+            material = &object->mesh.material;
+        }
+    }
+    if (!payload.has_value()) {
+        return std::nullopt;
+    }
+    return std::make_tuple(payload.value(), *material);
+}
+
+bool PathTracingRenderer::occluded(const ShadowRay& shadow_ray) const
+{
+    auto hit = trace(shadow_ray.ray);
+    return hit.has_value() && std::get<0>(hit.value()).t < shadow_ray.distance;
+}
+
+bool PathTracingRenderer::scatter(
+    Ray& ray, const Intersection& isect, const GL::Material& material, int depth,
+    Sampler& sampler, Vector3f& throughput, uint32_t pixel,
+    std::vector<ShadowRay>& shadow_rays, PrimaryHit& primary
+) const
+{
+    const Vector3f position = ray.origin + isect.t * ray.direction;
+    Vector3f       normal   = isect.normal.normalized();
+    if (normal.dot(ray.direction) > 0.0f) {
+        normal = -normal;
+    }
+    const Vector3f origin = position + RAY_OFFSET * normal;
+    const bool     mirror = material.shininess > WhittedRenderer::mirror_threshold;
+    if (depth == 0) {
+        primary.depth  = isect.t;
+        primary.normal = normal;
+        primary.albedo = mirror ? material.specular : material.diffuse;
+    }
+
+    if (mirror) {
+        throughput = throughput.cwiseProduct(material.specular);
+        ray        = {origin, reflect(ray.direction, normal).normalized()};
+    } else {
+        // direct lighting from point lights, to be checked with shadow rays
+        const auto add_light = [&](const Light& light, float weight) {
+            const Vector3f to_light = light.position - origin;
+            const float    distance = to_light.norm();
+            const Vector3f l        = to_light / distance;
+            const float    cos_l    = normal.dot(l);
+            if (cos_l <= 0.0f) {
+                return;
+            }
+            const float    irradiance = weight * light.intensity / (distance * distance);
+            const Vector3f half       = (l - ray.direction).normalized();
+            const float specular = std::pow(std::max(0.0f, normal.dot(half)), material.shininess);
+            const Vector3f contribution = throughput.cwiseProduct(
+                irradiance * (cos_l * material.diffuse + specular * material.specular)
+            );
+            shadow_rays.push_back({{origin, l}, distance, contribution, pixel});
+        };
+        // an upper bound of what one unit of irradiance adds to the pixel, used for culling
+        const float scale =
+            throughput.maxCoeff() * (material.diffuse.maxCoeff() + material.specular.maxCoeff());
+        if (scale > 0.0f) {
+            const float threshold = light_cull_threshold / scale;
+            if (light_samples <= 0) {
+                light_bvh.for_each_light(origin, normal, threshold, [&](const Light& light) {
+                    add_light(light, 1.0f);
+                });
+            } else {
+                for (int k = 0; k < light_samples; ++k) {
+                    const float u      = sampler.next_1d();
+                    const auto  chosen = light_bvh.sample(origin, normal, u, threshold);
+                    if (chosen.has_value()) {
+                        const float weight = 1.0f / (chosen->pmf * light_samples);
+                        add_light(light_bvh.lights[chosen->light], weight);
+                    }
+                }
+            }
+        }
+        // indirect lighting: with cosine-weighted sampling the Lambert BRDF times the cosine
+        // term divided by the pdf is exactly the diffuse color
+        throughput = throughput.cwiseProduct(material.diffuse);
+        ray        = {origin, sample_cosine_hemisphere(normal, sampler.next_2d())};
+    }
+
+    if (depth + 1 >= russian_roulette_depth) {
+        const float survival = std::min(throughput.maxCoeff(), MAX_SURVIVAL_PROBABILITY);
+        if (survival <= 0.0f || sampler.next_1d() >= survival) {
+            return false;
+        }
+        throughput /= survival;
+    }
+    return true;
+}
+
+Vector3f PathTracingRenderer::radiance(Ray ray, Sampler& sampler, PrimaryHit& primary) const
+{
+    primary.depth = -1.0f;
+    Vector3f               result     = Vector3f::Zero();
+    Vector3f               throughput = Vector3f::Ones();
+    std::vector<ShadowRay> shadow_rays;
+    for (int depth = 0; depth < max_depth; ++depth) {
+        auto hit = trace(ray);
+        if (!hit.has_value()) {
+            result += throughput.cwiseProduct(RenderEngine::background_color);
+            break;
+        }
+        const auto& [isect, material] = hit.value();
+        shadow_rays.clear();
+        const bool alive =
+            scatter(ray, isect, material, depth, sampler, throughput, 0, shadow_rays, primary);
+        for (const ShadowRay& shadow_ray: shadow_rays) {
+            if (!occluded(shadow_ray)) {
+                result += shadow_ray.contribution;
+            }
+        }
+        if (!alive) {
+            break;
+        }
+    }
+    return result;
+}
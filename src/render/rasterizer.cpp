@@ -42,17 +42,20 @@ void Rasterizer::worker_thread()
                 payload = Context::vertex_shader_output_queue.front();
                 Context::vertex_shader_output_queue.pop();
                 if (vertex_count == 0) {
-                    triangle.world_pos[0]    = payload.world_position;
-                    triangle.viewport_pos[0] = payload.viewport_position;
-                    triangle.normal[0]       = payload.normal;
+                    triangle.world_pos[0]      = payload.world_position;
+                    triangle.viewport_pos[0]   = payload.viewport_position;
+                    triangle.normal[0]         = payload.normal;
+                    triangle.baked_lighting[0] = payload.baked_lighting;
                 } else if (vertex_count == 1) {
-                    triangle.world_pos[1]    = payload.world_position;
-                    triangle.viewport_pos[1] = payload.viewport_position;
-                    triangle.normal[1]       = payload.normal;
+                    triangle.world_pos[1]      = payload.world_position;
+                    triangle.viewport_pos[1]   = payload.viewport_position;
+                    triangle.normal[1]         = payload.normal;
+                    triangle.baked_lighting[1] = payload.baked_lighting;
                 } else {
-                    triangle.world_pos[2]    = payload.world_position;
-                    triangle.viewport_pos[2] = payload.viewport_position;
-                    triangle.normal[2]       = payload.normal;
+                    triangle.world_pos[2]      = payload.world_position;
+                    triangle.viewport_pos[2]   = payload.viewport_position;
+                    triangle.normal[2]         = payload.normal;
+                    triangle.baked_lighting[2] = payload.baked_lighting;
                 }
             }
         }
@@ -117,6 +120,7 @@ void Rasterizer::rasterize_triangle(Triangle& t)
     // if current pixel is in current triange:
     // 1. interpolate depth(use projection correction algorithm)
     // 2. interpolate vertex positon & normal(use function:interpolate())
+    //    and the baked lighting (its rgb and alpha can be interpolated separately)
     // 3. push primitive into fragment queue
     std::unique_lock<std::mutex> lock(Context::rasterizer_queue_mutex);
     Context::rasterizer_output_queue.push(payload);
@@ -1,4 +1,5 @@
 #include <cstddef>
+#include <limits>
 #include <memory>
 #include <vector>
 #include <thread>
@@ -29,9 +30,10 @@ GL::Material     ini_material = GL::Material();
 std::list<Light> ini_lights   = {};
 Camera           ini_camera = Camera(Vector3f::Ones(), Vector3f::Ones(), 0.1f, 10.0f, 45.0f, 1.33f);
 
-GL::Material&     Uniforms::material = ini_material;
-std::list<Light>& Uniforms::lights   = ini_lights;
-Camera&           Uniforms::camera   = ini_camera;
+GL::Material&     Uniforms::material    = ini_material;
+std::list<Light>& Uniforms::lights      = ini_lights;
+Camera&           Uniforms::camera      = ini_camera;
+const LightTiles* Uniforms::light_tiles = nullptr;
 
 std::mutex                        Context::vertex_queue_mutex;
 std::mutex                        Context::rasterizer_queue_mutex;
@@ -60,7 +62,8 @@ RasterizerRenderer::RasterizerRenderer(
 ) :
     width(engine.width), height(engine.height), n_vertex_threads(num_vertex_threads),
     n_rasterizer_threads(num_rasterizer_threads), n_fragment_threads(num_fragment_threads),
-    vertex_processor(), rasterizer(), fragment_processor(), rendering_res(engine.rendering_res)
+    vertex_processor(), rasterizer(), fragment_processor(), rendering_res(engine.rendering_res),
+    tiled_light_culling(false), light_cutoff(0.001f)
 {
     logger = get_logger("Rasterizer Renderer");
 }
@@ -79,6 +82,22 @@ void RasterizerRenderer::render(const Scene& scene)
     Camera     cam                         = scene.camera;
     vertex_processor.vertex_shader_ptr     = vertex_shader;
     fragment_processor.fragment_shader_ptr = phong_fragment_shader;
+    // Lights and the camera are the same for every object, so the light lists of the screen
+    // tiles are built once per frame before any worker starts.
+    Uniforms::light_tiles = nullptr;
+    if (tiled_light_culling) {
+        light_tiles.build(
+            scene.lights, cam.view(), cam.projection(), Uniforms::width, Uniforms::height,
+            light_cutoff
+        );
+        Uniforms::light_tiles = &light_tiles;
+        this->logger->info(
+            "tiled light culling: {:.2f} of {} lights per tile on average",
+            static_cast<float>(light_tiles.n_references())
+                / static_cast<float>(light_tiles.tiles.size()),
+            scene.lights.size()
+        );
+    }
     for (const auto& group: scene.groups) {
         for (const auto& object: group->objects) {
             Context::vertex_finish     = false;
@@ -110,6 +129,8 @@ void RasterizerRenderer::render(const Scene& scene)
             const std::vector<float>&        vertices  = object->mesh.vertices.data;
             const std::vector<unsigned int>& faces     = object->mesh.faces.data;
             const std::vector<float>&        normals   = object->mesh.normals.data;
+            const std::vector<float>&        baked     = object->mesh.baked_lighting.data;
+            const bool                       use_baked = object->mesh.has_baked_lighting();
             size_t                           num_faces = faces.size();
 
             // process vertices
@@ -120,7 +141,8 @@ void RasterizerRenderer::render(const Scene& scene)
                         Vector4f(
                             vertices[3 * idx], vertices[3 * idx + 1], vertices[3 * idx + 2], 1.0f
                         ),
-                        Vector3f(normals[3 * idx], normals[3 * idx + 1], normals[3 * idx + 2])
+                        Vector3f(normals[3 * idx], normals[3 * idx + 1], normals[3 * idx + 2]),
+                        use_baked ? Vector4f(&baked[4 * idx]) : Vector4f::UnitW()
                     );
                 }
             }
@@ -153,12 +175,15 @@ void RasterizerRenderer::render(const Scene& scene)
     }
 }
 
-void VertexProcessor::input_vertices(const Vector4f& positions, const Vector3f& normals)
+void VertexProcessor::input_vertices(
+    const Vector4f& positions, const Vector3f& normals, const Vector4f& baked_lighting
+)
 {
     std::unique_lock<std::mutex> lock(queue_mutex);
     VertexShaderPayload          payload;
     payload.world_position = positions;
     payload.normal         = normals;
+    payload.baked_lighting = baked_lighting;
     vertex_queue.push(payload);
 }
 
@@ -212,8 +237,14 @@ void FragmentProcessor::worker_thread()
         if (fragment.depth > Context::frame_buffer.depth_buffer[index]) {
             continue;
         }
+        const std::list<Light>& lights =
+            Uniforms::light_tiles != nullptr
+                ? Uniforms::light_tiles->lights_of(
+                      Uniforms::light_tiles->tile_at(fragment.x, fragment.y)
+                  )
+                : Uniforms::lights;
         fragment.color =
-            fragment_shader_ptr(fragment, Uniforms::material, Uniforms::lights, Uniforms::camera);
+            fragment_shader_ptr(fragment, Uniforms::material, lights, Uniforms::camera);
         Context::frame_buffer.set_pixel(index, fragment.depth, fragment.color);
     }
 }
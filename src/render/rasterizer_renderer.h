@@ -27,8 +27,12 @@ public:
      *
      * \param positions 顶点位置坐标
      * \param normals 顶点法线向量
+     * \param baked_lighting 顶点烘焙的光照，含义与 `GL::Mesh::baked_lighting` 相同
      */
-    void input_vertices(const Eigen::Vector4f& positions, const Eigen::Vector3f& normals);
+    void input_vertices(
+        const Eigen::Vector4f& positions, const Eigen::Vector3f& normals,
+        const Eigen::Vector4f& baked_lighting = Eigen::Vector4f::UnitW()
+    );
     
     /*!
      * \~chinese
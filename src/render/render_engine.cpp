@@ -2,12 +2,16 @@
 
 Eigen::Vector3f RenderEngine::background_color(RGB_COLOR(100, 100, 100));
 
-RenderEngine::RenderEngine()
+RenderEngine::RenderEngine() : denoise(false)
 {
     // unique pointer to Rasterizer Renderer
     rasterizer_render = std::make_unique<RasterizerRenderer>(*this, 1, 2, 2);
     // unique pointer to Whitted Style Renderer
     whitted_render = std::make_unique<WhittedRenderer>(*this);
+    // unique pointer to Path Tracing Renderer
+    path_tracing_render = std::make_unique<PathTracingRenderer>(*this);
+    // unique pointer to Hybrid Renderer, which shades with the Whitted Style Renderer
+    hybrid_render = std::make_unique<HybridRenderer>(*this);
     // default setting of number of threads(if use multi-threads edition)
     n_threads = 4;
 }
@@ -19,8 +23,31 @@ void RenderEngine::render(Scene& scene, RendererType type)
     case RendererType::RASTERIZER: rasterizer_render->render(scene); break;
     // case RendererType::RASTERIZER_MT: rasterizer_render->render_mt(scene); break;
     case RendererType::WHITTED_STYLE: whitted_render->render(scene); break;
+    case RendererType::PATH_TRACING: path_tracing_render->render(scene); break;
+    case RendererType::HYBRID: hybrid_render->render(scene); break;
     default: break;
     }
+    if (denoise && type == RendererType::PATH_TRACING) {
+        std::vector<Eigen::Vector3f> image = path_tracing_render->image;
+        denoiser.denoise(
+            image, path_tracing_render->gbuffer, static_cast<int>(width), static_cast<int>(height),
+            static_cast<unsigned int>(n_threads)
+        );
+        write_rendering_result(image, rendering_res);
+    }
+}
+
+void write_rendering_result(
+    const std::vector<Eigen::Vector3f>& image, std::vector<unsigned char>& rendering_res
+)
+{
+    rendering_res.resize(3 * image.size());
+    for (size_t i = 0; i < image.size(); ++i) {
+        for (int c = 0; c < 3; ++c) {
+            const float value        = clamp(0.0f, 1.0f, image[i][c]);
+            rendering_res[3 * i + c] = static_cast<unsigned char>(255 * value);
+        }
+    }
 }
 
 void SpinLock::lock()
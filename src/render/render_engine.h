@@ -1,18 +1,28 @@
 #ifndef DANDELION_RENDER_RENDER_ENGINE_H
 #define DANDELION_RENDER_RENDER_ENGINE_H
 
+#include <cstdint>
 #include <memory>
 #include <functional>
 #include <queue>
+#include <unordered_map>
+#include <vector>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <spdlog/spdlog.h>
 
 #include "../scene/scene.h"
+#include "../utils/bvh_stats.h"
+#include "../utils/light_bvh.h"
+#include "../utils/sampler.h"
 #include "rasterizer.h"
 #include "graphics_interface.h"
 #include "rasterizer_renderer.h"
+#include "denoiser.h"
+#include "dependency_grid.h"
+#include "light_baker.h"
+#include "visibility_buffer.h"
 
 /*!
  * \file render/render_engine.h
@@ -23,6 +33,8 @@
 
 class RasterizerRenderer;
 class WhittedRenderer;
+class PathTracingRenderer;
+class HybridRenderer;
 
 /*!
  * \ingroup rendering
@@ -33,7 +45,9 @@ enum class RendererType
 {
     RASTERIZER,
     // RASTERIZER_MT,
-    WHITTED_STYLE
+    WHITTED_STYLE,
+    PATH_TRACING,
+    HYBRID
 };
 
 /*!
@@ -67,13 +81,32 @@ public:
     void render(Scene& scene, RendererType type);
     /*! \~chinese 渲染结果预览的背景颜色 */
     static Eigen::Vector3f background_color;
+    /*! \~chinese 是否对路径追踪的结果降噪 */
+    bool denoise;
+    /*! \~chinese 渲染后处理使用的降噪器 */
+    Denoiser denoiser;
+    /*! \~chinese 把光照烘焙到顶点上，供场景预览和光栅化渲染器使用 */
+    LightBaker light_baker;
 
     /*! \~chinese 光栅化渲染器 */
     std::unique_ptr<RasterizerRenderer> rasterizer_render;
     /*! \~chinese whitted style渲染器 */
     std::unique_ptr<WhittedRenderer> whitted_render;
+    /*! \~chinese 渐进式路径追踪渲染器 */
+    std::unique_ptr<PathTracingRenderer> path_tracing_render;
+    /*! \~chinese 光栅化主光线、光线追踪次级光线的混合渲染器 */
+    std::unique_ptr<HybridRenderer> hybrid_render;
 };
 
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 把线性颜色图像截断到 \f$[0, 1]\f$ 并转换为 `rendering_res` 使用的 8 位 RGB 格式。
+ */
+void write_rendering_result(
+    const std::vector<Eigen::Vector3f>& image, std::vector<unsigned char>& rendering_res
+);
+
 /*!
  * \ingroup rendering
  * \~chinese
@@ -107,9 +140,21 @@ public:
     FragmentProcessor fragment_processor;
 
     std::vector<unsigned char>& rendering_res;
+    /*!
+     * \~chinese
+     * \brief 是否按屏幕分块剔除光源，见 `LightTiles` 。
+     *
+     * 默认关闭：被剔除的光源贡献虽小但不为零，开启后的图像与不剔除时并不完全相同。
+     */
+    bool tiled_light_culling;
+    /*! \~chinese 分块剔除时可以忽略的辐照度，决定每个光源的影响半径 */
+    float light_cutoff;
 
 private:
 
+    /*! \~chinese 当前帧各屏幕块的光源 */
+    LightTiles light_tiles;
+
     std::shared_ptr<spdlog::logger> logger;
 };
 
@@ -133,6 +178,26 @@ public:
     /*! \~chinese 是否使用 BVH 进行加速*/
     bool                        use_bvh;
     std::vector<unsigned char>& rendering_res;
+    /*! \~chinese 上一次渲染中所有线程的求交计数 */
+    TraversalCounters traversal_counters;
+    /*!
+     * \~chinese
+     * \brief 是否统计 BVH 遍历的节点数和三角形测试数，见 `count_BVH_traversal` 。
+     *
+     * 关闭时只统计光线数。开启后每条光线都要多遍历一次 BVH ，渲染会明显变慢。
+     */
+    bool count_traversal;
+    /*! \~chinese 是否开启自适应超采样，见 `render_adaptive` */
+    bool adaptive_sampling;
+    /*! \~chinese 自适应超采样中判定颜色差异的阈值（各通道之差的最大值）*/
+    float adaptive_threshold;
+    /*!
+     * \~chinese
+     * \brief 是否开启增量渲染，见 `render_incremental` 。
+     *
+     * 开启自适应超采样时不使用增量渲染。
+     */
+    bool incremental;
 
 private:
 
@@ -146,6 +211,34 @@ private:
      *
      */
     float fresnel(const Eigen::Vector3f& I, const Eigen::Vector3f& N, const float& ior);
+
+    /*!
+     * \~chinese
+     * \brief 自适应超采样：只在图像边缘附近追加样本。
+     *
+     * 先穿过每个像素中心追踪一条光线，并记录它首先击中的物体。相邻像素击中的物体不同，
+     * 或颜色之差超过 `adaptive_threshold` 时，两个像素都会在 2x2 的网格上各追加 4 个样本；
+     * 如果这 4 个样本之间的颜色仍然相差过大，再在 4x4 的网格上追加 16 个样本。
+     * 像素颜色为所有样本的平均值。
+     *
+     * \param scene 当前渲染的场景
+     * \param framebuffer 保存渲染结果的帧缓冲
+     */
+    void render_adaptive(Scene& scene, std::vector<Eigen::Vector3f>& framebuffer);
+    /*!
+     * \~chinese
+     * \brief 增量渲染：只重新追踪受场景变化影响的图像块。
+     *
+     * 图像被切成 16x16 的块，每个块在追踪时用 `DependencyGrid::CellSet` 记录它的所有光线
+     * 经过的空间区域（由 `trace` 记录）。下一次渲染时，把每个物体的模型矩阵、材质和几何形状
+     * 与上一次渲染时的快照比较：对发生变化的物体，标记它旧包围盒和新包围盒所占的单元，
+     * 只重新追踪记录与之相交的块，其余像素沿用上一次的结果。
+     * 相机、光源、背景颜色或图像尺寸改变，以及物体移出网格范围时，退化为完整渲染。
+     *
+     * \param scene 当前渲染的场景
+     * \param framebuffer 保存渲染结果的帧缓冲
+     */
+    void render_incremental(Scene& scene, std::vector<Eigen::Vector3f>& framebuffer);
     
     /*!
      * \~chinese
@@ -156,10 +249,12 @@ private:
      * 
      * \param ray 待检测的光线
      * \param scene 当前渲染的场景
+     * \param hit_id 不为空时写入最近交点所在物体的 ID ，不相交时写入`std::nullopt`
      * 
      * \returns 如果相交，返回包含相交信息和物体材质的元组；如果不相交，返回`std::nullopt`
      */
-    std::optional<std::tuple<Intersection, GL::Material>> trace(const Ray& ray, const Scene& scene);
+    std::optional<std::tuple<Intersection, GL::Material>>
+    trace(const Ray& ray, const Scene& scene, std::optional<std::size_t>* hit_id = nullptr);
     
     /*!
      * \~chinese
@@ -168,8 +263,256 @@ private:
      * \param ray 当前追踪的光线
      * \param scene 当前渲染的场景
      * \param depth 最大反射次数
+     * \param hit_id 不为空时写入这条光线（不含反射光线）击中的物体的 ID ，见 `trace`
+     */
+    Eigen::Vector3f cast_ray(
+        const Ray& ray, const Scene& scene, int depth, std::optional<std::size_t>* hit_id = nullptr
+    );
+    /*!
+     * \~chinese
+     * \brief 计算光线击中点的颜色，反射光线和阴影光线都从这里发出
+     *
+     * \param ray 击中该点的光线
+     * \param isect 光线与物体的交点
+     * \param material 击中物体的材质
+     * \param scene 当前渲染的场景
+     * \param depth 当前的反射次数
+     */
+    Eigen::Vector3f shade(
+        const Ray& ray, const Intersection& isect, const GL::Material& material,
+        const Scene& scene, int depth
+    );
+    std::shared_ptr<spdlog::logger> logger;
+
+    /*! \~chinese 增量渲染中物体在上一次渲染时的状态。 */
+    struct ObjectSnapshot
+    {
+        Eigen::Matrix4f model;
+        GL::Material    material;
+        /*! \~chinese 世界坐标系下的包围盒。 */
+        Eigen::AlignedBox3f bounds;
+        /*! \~chinese 顶点坐标和面片的哈希值，用于发现网格编辑。 */
+        std::uint64_t geometry_hash;
+    };
+    /*! \~chinese 记录物体当前的状态。 */
+    static ObjectSnapshot take_snapshot(Object& object);
+
+    /*! \~chinese 上一次增量渲染的结果。 */
+    std::vector<Eigen::Vector3f> cached_framebuffer;
+    /*! \~chinese 上一次增量渲染时各物体的状态，以物体 ID 为键。 */
+    std::unordered_map<std::size_t, ObjectSnapshot> object_snapshots;
+    /*! \~chinese 上一次增量渲染时的相机、光源、背景颜色、图像尺寸等，任何一项改变都需要完整渲染。 */
+    std::vector<float> view_state;
+    /*! \~chinese 记录光线经过区域的网格，在每次完整渲染时按场景范围重建。 */
+    DependencyGrid dependency_grid;
+    /*! \~chinese 每个图像块的光线经过的网格单元。 */
+    std::vector<DependencyGrid::CellSet> tile_cells;
+    /*! \~chinese 正在追踪的图像块的记录，为空时 `trace` 不做记录。 */
+    DependencyGrid::CellSet* recording;
+
+    /*! \~chinese 混合渲染器用 `shade` 为可见性缓冲区中的表面点着色。 */
+    friend class HybridRenderer;
+};
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 光栅化主光线、光线追踪次级光线的混合渲染器。
+ *
+ * Whitted-Style 光线追踪中开销最大的是主光线求交，而主光线恰恰也是最规整的：
+ * 它们都从相机出发，穿过各个像素中心。混合渲染器先把所有物体光栅化到 `VisibilityBuffer` 中，
+ * 得到每个像素中心处可见的物体、面片、重心坐标和深度，再由这些信息重建主光线的交点，
+ * 交给 `WhittedRenderer::shade` 着色。反射光线和阴影光线仍然由 Whitted-Style 渲染器
+ * 通过 BVH 追踪，因此结果与关闭自适应超采样的 `WhittedRenderer` 一致，
+ * 而主光线只需要光栅化的代价。
+ */
+class HybridRenderer
+{
+public:
+
+    HybridRenderer(RenderEngine& engine);
+    /*! \~chinese 混合渲染器的渲染调用接口 */
+    void render(Scene& scene);
+    float& width;
+    float& height;
+    /*! \~chinese 光栅化可见性缓冲区使用的线程数 */
+    int&                        n_threads;
+    std::vector<unsigned char>& rendering_res;
+    /*! \~chinese 上一次渲染的可见性缓冲区 */
+    VisibilityBuffer visibility;
+    /*! \~chinese 上一次渲染中次级光线的求交计数 */
+    TraversalCounters traversal_counters;
+
+private:
+
+    /*! \~chinese 负责着色和追踪次级光线的 Whitted-Style 渲染器，二者共用 `use_bvh` 等设置 */
+    WhittedRenderer&                whitted;
+    std::shared_ptr<spdlog::logger> logger;
+};
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 渐进式路径追踪渲染器。
+ *
+ * 每次调用 `render` 为每个像素追加一个样本：样本累加在浮点缓冲区中，结束后把当前的平均值写入
+ * `rendering_res` ，因此调用者可以一边渲染一边显示，在图像足够好时随时停止。
+ * 求交直接使用各物体已经建好的 BVH 。
+ *
+ * 材质的解释与其他渲染器保持一致：漫反射项按 Lambert 模型采样间接光照，
+ * `shininess` 超过 `WhittedRenderer::mirror_threshold` 的材质视为理想镜面；
+ * 点光源只能通过直接光照采样（阴影光线）贡献亮度，其强度按 Phong 模型的约定解释；
+ * 没有击中任何物体的光线返回背景颜色，相当于一个均匀的环境光。
+ */
+class PathTracingRenderer
+{
+public:
+
+    PathTracingRenderer(RenderEngine& engine);
+    /*!
+     * \~chinese
+     * \brief 渲染一遍：为每个像素追加一个样本，并更新 `rendering_res` 。
+     *
+     * 图像尺寸与累积缓冲区不一致时会先调用 `reset` 。场景或相机发生变化后，
+     * 调用者需要自行调用 `reset` 丢弃旧的样本。
+     */
+    void render(Scene& scene);
+    /*! \~chinese 丢弃所有已累积的样本。 */
+    void reset();
+
+    float& width;
+    float& height;
+    int&   n_threads;
+    /*! \~chinese 路径的最大弹射次数，避免镜面之间无限反射。 */
+    int max_depth;
+    /*! \~chinese 从第几次弹射开始使用俄罗斯轮盘赌随机终止路径。 */
+    int russian_roulette_depth;
+    /*! \~chinese 每个像素已经累积的样本数。 */
+    unsigned int n_samples;
+    /*! \~chinese 生成像素抖动、反射方向和轮盘赌随机数的采样器类型。 */
+    SamplerType sampler_type;
+    /*!
+     * \~chinese
+     * \brief 是否按波前 (wavefront) 方式调度光线，见 `render_wavefront` 。
+     *
+     * 两种调度方式消耗采样器维度的顺序相同，因此渲染结果一致，区别只在于访存的局部性。
+     */
+    bool wavefront;
+    /*!
+     * \~chinese
+     * \brief 每个着色点按重要性抽取的光源数，为 0 时计算所有（未被剔除的）光源的直接光照。
+     *
+     * 光源很多时，抽样只需要常数条阴影光线，代价是更多的噪点。
      */
-    Eigen::Vector3f                 cast_ray(const Ray& ray, const Scene& scene, int depth);
+    int light_samples;
+    /*!
+     * \~chinese
+     * \brief 剔除光源的阈值。
+     *
+     * 一组光源对着色点贡献的上界（乘以路径吞吐量和材质系数后）低于这个值时被整体跳过。
+     * 为 0 时不剔除任何光源，结果是无偏的。
+     */
+    float light_cull_threshold;
+    std::vector<unsigned char>& rendering_res;
+    /*! \~chinese 上一遍渲染中所有线程的求交计数 */
+    TraversalCounters traversal_counters;
+    /*! \~chinese 目前为止所有样本的平均值（线性颜色，未经截断）。 */
+    std::vector<Eigen::Vector3f> image;
+    /*! \~chinese 主光线击中点的法向、深度和反照率（对所有样本取平均），供降噪使用。 */
+    GBuffer gbuffer;
+
+private:
+
+    /*! \~chinese 一条路径的主光线击中点信息，`depth` 为负数表示没有击中任何物体。 */
+    struct PrimaryHit
+    {
+        float           depth;
+        Eigen::Vector3f normal;
+        Eigen::Vector3f albedo;
+    };
+    /*! \~chinese 指向点光源的阴影光线，未被遮挡时为像素贡献 `contribution` 。 */
+    struct ShadowRay
+    {
+        Ray             ray;
+        float           distance;
+        Eigen::Vector3f contribution;
+        std::uint32_t   pixel;
+    };
+    /*! \~chinese 波前调度中一条尚未结束的路径。 */
+    struct PathState
+    {
+        Ray             ray;
+        Eigen::Vector3f throughput;
+        std::uint32_t   pixel;
+        /*! \~chinese 这条路径已经消耗的采样器维度数。 */
+        std::uint32_t dimension;
+    };
+
+    /*! \~chinese 逐像素深度优先地追踪整条路径。 */
+    void render_depth_first(const Scene& scene, int w, int h);
+    /*!
+     * \~chinese
+     * \brief 按波前方式追踪所有路径。
+     *
+     * 每次弹射时，先把所有存活路径的光线放进一个队列，按方向所在卦限和起点的 Morton 码排序，
+     * 使相邻的光线访问相近的 BVH 节点；然后多线程地对整个队列求交，再多线程地着色，
+     * 生成的阴影光线同样排序后批量求交，最后生成下一次弹射的队列。
+     */
+    void render_wavefront(const Scene& scene, int w, int h);
+    /*!
+     * \~chinese
+     * \brief 在一个击中点处着色并决定路径的去向。
+     *
+     * 用 `light_bvh` 选出的点光源生成阴影光线（由调用者负责求交），更新 `throughput` 并把 `ray`
+     * 替换为下一段光线。两种调度方式共用这个函数。
+     *
+     * \returns 路径是否继续（没有被俄罗斯轮盘赌终止）
+     */
+    bool scatter(
+        Ray& ray, const Intersection& isect, const GL::Material& material, int depth,
+        Sampler& sampler, Eigen::Vector3f& throughput, std::uint32_t pixel,
+        std::vector<ShadowRay>& shadow_rays, PrimaryHit& primary
+    ) const;
+    /*! \~chinese 阴影光线在到达光源之前是否被遮挡。 */
+    bool occluded(const ShadowRay& shadow_ray) const;
+
+    /*!
+     * \~chinese
+     * \brief 求光线与场景的最近交点。
+     *
+     * 与 `BVH::intersect` 等价，但各物体的模型矩阵在每遍渲染开始前就已写入 `BVH::model` ，
+     * 这里只调用 const 的 `BVH::ray_node_intersect` ，因此可以在多个线程中同时调用。
+     */
+    std::optional<std::tuple<Intersection, GL::Material>> trace(const Ray& ray) const;
+    /*!
+     * \~chinese
+     * \brief 沿一条路径估计相机光线带回的辐射亮度。
+     *
+     * \param ray 相机光线
+     * \param sampler 当前线程的采样器，已经定位到当前像素的当前样本
+     * \param primary 返回主光线击中点的信息
+     */
+    Eigen::Vector3f
+    radiance(Ray ray, Sampler& sampler, PrimaryHit& primary) const;
+
+    /*! \~chinese 每个像素累积的辐射亮度之和。 */
+    std::vector<Eigen::Vector3f> accumulation;
+    /*! \~chinese 当前这一遍渲染中每个像素的样本值，由 `render_*` 写入。 */
+    std::vector<Eigen::Vector3f> pass_radiance;
+    /*! \~chinese 当前这一遍渲染中每个像素的主光线击中点，由 `render_*` 写入。 */
+    std::vector<PrimaryHit> primary_hits;
+    /*! \~chinese 每个像素累积的主光线击中点法向之和。 */
+    std::vector<Eigen::Vector3f> normal_sum;
+    /*! \~chinese 每个像素累积的主光线击中点反照率之和。 */
+    std::vector<Eigen::Vector3f> albedo_sum;
+    /*! \~chinese 每个像素累积的主光线击中距离之和。 */
+    std::vector<float> depth_sum;
+    /*! \~chinese 每个像素中主光线击中物体的样本数。 */
+    std::vector<unsigned int> hit_count;
+    /*! \~chinese 本遍渲染参与求交的物体，由 `render` 在开始时收集。 */
+    std::vector<Object*> objects;
+    /*! \~chinese 场景中光源的层次包围盒，由 `render` 在开始时重建。 */
+    LightBVH light_bvh;
     std::shared_ptr<spdlog::logger> logger;
 };
 
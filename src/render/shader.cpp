@@ -50,7 +50,9 @@ Vector3f phong_fragment_shader(
 
     // Light Attenuation
 
-    // Ambient
+    // Ambient (scaled by the baked ambient occlusion payload.baked_lighting.w())
+
+    // Baked indirect lighting (kd times payload.baked_lighting.head<3>())
 
     // Diffuse
 
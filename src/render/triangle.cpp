@@ -14,4 +14,8 @@ Triangle::Triangle()
     world_pos[0] << 0, 0, 0, 1;
     world_pos[1] << 0, 0, 0, 1;
     world_pos[2] << 0, 0, 0, 1;
+
+    baked_lighting[0] << 0, 0, 0, 1;
+    baked_lighting[1] << 0, 0, 0, 1;
+    baked_lighting[2] << 0, 0, 0, 1;
 }
@@ -24,6 +24,8 @@ public:
     Eigen::Vector4f viewport_pos[3];
     /*! \~chinese 每个顶点的法向向量 */
     Eigen::Vector3f normal[3];
+    /*! \~chinese 每个顶点烘焙的光照，见 `VertexShaderPayload::baked_lighting` */
+    Eigen::Vector4f baked_lighting[3];
 
     Triangle();
 };
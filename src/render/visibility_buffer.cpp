@@ -0,0 +1,225 @@
+#include "visibility_buffer.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+#include <Eigen/Geometry>
+
+#include "../utils/math.hpp"
+#include "../utils/parallel.hpp"
+
+using Eigen::Matrix4f;
+using Eigen::Vector2f;
+using Eigen::Vector3f;
+using std::size_t;
+using std::uint32_t;
+
+namespace {
+
+// Primary rays accept any hit in front of the camera, so triangles are only clipped against a
+// plane very close to the eye rather than against the camera's near plane.
+constexpr float NEAR_CLIP = 1e-4f;
+
+// A clipped triangle ready for scan conversion. Coverage is decided in screen space, while the
+// hit point is found by intersecting the pixel's ray with the plane of the original face, which
+// keeps the depth and barycentrics as accurate as ray tracing even for clipped triangles.
+struct ScreenTriangle
+{
+    std::array<Vector2f, 3> screen;
+    // the original face in camera space (x right, y up, z forward)
+    std::array<Vector3f, 3> corners;
+    uint32_t                face;
+    int                     first_row;
+    int                     last_row;
+};
+
+// Index of the first or last pixel row / column covered by a coordinate, clamped to [-1, size]
+// before the conversion so that vertices projected far off-screen do not overflow.
+int pixel_index(float coordinate, int size)
+{
+    return static_cast<int>(std::clamp(coordinate, -1.0f, static_cast<float>(size)));
+}
+
+} // namespace
+
+VisibilityBuffer::VisibilityBuffer() : width(0), height(0)
+{
+}
+
+void VisibilityBuffer::clear(int width, int height)
+{
+    this->width  = std::max(width, 0);
+    this->height = std::max(height, 0);
+    const Sample empty{no_object, 0, Vector3f::Zero(), std::numeric_limits<float>::infinity()};
+    samples.assign(static_cast<size_t>(this->width) * static_cast<size_t>(this->height), empty);
+}
+
+const VisibilityBuffer::Sample& VisibilityBuffer::at(int x, int y) const
+{
+    return samples[static_cast<size_t>(y) * width + x];
+}
+
+void VisibilityBuffer::rasterize(
+    const GL::Mesh& mesh, const Matrix4f& model, uint32_t object, const Camera& camera,
+    unsigned int n_threads
+)
+{
+    if (width == 0 || height == 0) {
+        return;
+    }
+    // the same pinhole camera as generate_subpixel_ray
+    const Vector3f forward = (camera.target - camera.position).normalized();
+    const Vector3f right   = forward.cross(camera.world_up).normalized();
+    const Vector3f up      = right.cross(forward);
+    const float    half_h  = std::tan(radians(camera.fov_y_degrees) / 2.0f);
+    const float    half_w  = half_h * static_cast<float>(width) / static_cast<float>(height);
+    const auto     to_screen = [&](const Vector3f& p) {
+        return Vector2f(
+            (p.x() / (p.z() * half_w) + 1.0f) * 0.5f * static_cast<float>(width),
+            (1.0f - p.y() / (p.z() * half_h)) * 0.5f * static_cast<float>(height)
+        );
+    };
+
+    const std::vector<unsigned int>& faces   = mesh.faces.data;
+    const size_t                     n_faces = faces.size() / 3;
+    // 1. transform, clip and project the faces in parallel, one output list per chunk
+    const size_t                             n_chunks = parallel_chunk_count(n_faces, n_threads);
+    std::vector<std::vector<ScreenTriangle>> chunk_triangles(n_chunks);
+    parallel_for_chunks(
+        0, n_faces,
+        [&](size_t first, size_t last, size_t chunk) {
+            std::vector<ScreenTriangle>& triangles = chunk_triangles[chunk];
+            for (size_t f = first; f < last; ++f) {
+                std::array<Vector3f, 3> corners;
+                for (int k = 0; k < 3; ++k) {
+                    const Vector3f world =
+                        (model * mesh.vertex(faces[3 * f + k]).homogeneous()).hnormalized();
+                    const Vector3f offset = world - camera.position;
+                    corners[k] = Vector3f(offset.dot(right), offset.dot(up), offset.dot(forward));
+                }
+                // Sutherland-Hodgman against z >= NEAR_CLIP, which leaves at most 4 vertices
+                std::array<Vector3f, 4> polygon;
+                int                     n_polygon = 0;
+                for (int k = 0; k < 3; ++k) {
+                    const Vector3f& a        = corners[k];
+                    const Vector3f& b        = corners[(k + 1) % 3];
+                    const bool      a_inside = a.z() >= NEAR_CLIP;
+                    const bool      b_inside = b.z() >= NEAR_CLIP;
+                    if (a_inside) {
+                        polygon[n_polygon++] = a;
+                    }
+                    if (a_inside != b_inside) {
+                        const float s        = (NEAR_CLIP - a.z()) / (b.z() - a.z());
+                        polygon[n_polygon++] = a + s * (b - a);
+                    }
+                }
+                for (int k = 1; k + 1 < n_polygon; ++k) {
+                    ScreenTriangle triangle;
+                    triangle.screen = {
+                        to_screen(polygon[0]), to_screen(polygon[k]), to_screen(polygon[k + 1])
+                    };
+                    triangle.corners = corners;
+                    triangle.face    = static_cast<uint32_t>(f);
+                    const float top  = std::min(
+                        {triangle.screen[0].y(), triangle.screen[1].y(), triangle.screen[2].y()}
+                    );
+                    const float bottom = std::max(
+                        {triangle.screen[0].y(), triangle.screen[1].y(), triangle.screen[2].y()}
+                    );
+                    // rows whose centers j + 0.5 lie inside [top, bottom]
+                    triangle.first_row = std::max(pixel_index(std::ceil(top - 0.5f), height), 0);
+                    triangle.last_row =
+                        std::min(pixel_index(std::floor(bottom - 0.5f), height), height - 1);
+                    if (triangle.first_row <= triangle.last_row) {
+                        triangles.push_back(triangle);
+                    }
+                }
+            }
+        },
+        n_threads
+    );
+
+    // 2. scan-convert in horizontal bands, so that every thread owns the pixels it writes
+    const auto edge = [](const Vector2f& a, const Vector2f& b, const Vector2f& p) {
+        return (b.x() - a.x()) * (p.y() - a.y()) - (b.y() - a.y()) * (p.x() - a.x());
+    };
+    parallel_for_chunks(
+        0, static_cast<size_t>(height),
+        [&](size_t band_begin, size_t band_end, size_t) {
+            const int band_first = static_cast<int>(band_begin);
+            const int band_last  = static_cast<int>(band_end) - 1;
+            for (const auto& triangles: chunk_triangles) {
+                for (const ScreenTriangle& t: triangles) {
+                    const int first_row = std::max(t.first_row, band_first);
+                    const int last_row  = std::min(t.last_row, band_last);
+                    if (first_row > last_row) {
+                        continue;
+                    }
+                    const float area = edge(t.screen[0], t.screen[1], t.screen[2]);
+                    if (area == 0.0f) {
+                        continue;
+                    }
+                    const Vector3f e1     = t.corners[1] - t.corners[0];
+                    const Vector3f e2     = t.corners[2] - t.corners[0];
+                    const Vector3f normal = e1.cross(e2);
+                    const float    d11    = e1.dot(e1);
+                    const float    d12    = e1.dot(e2);
+                    const float    d22    = e2.dot(e2);
+                    const float    gram   = d11 * d22 - d12 * d12;
+                    if (gram == 0.0f) {
+                        continue;
+                    }
+                    const float left_x =
+                        std::min({t.screen[0].x(), t.screen[1].x(), t.screen[2].x()});
+                    const float right_x =
+                        std::max({t.screen[0].x(), t.screen[1].x(), t.screen[2].x()});
+                    const int first_column =
+                        std::max(pixel_index(std::ceil(left_x - 0.5f), width), 0);
+                    const int last_column =
+                        std::min(pixel_index(std::floor(right_x - 0.5f), width), width - 1);
+                    for (int j = first_row; j <= last_row; ++j) {
+                        for (int i = first_column; i <= last_column; ++i) {
+                            const Vector2f center(i + 0.5f, j + 0.5f);
+                            // screen-space edge functions, valid for either winding
+                            const float l0 = edge(t.screen[1], t.screen[2], center) / area;
+                            const float l1 = edge(t.screen[2], t.screen[0], center) / area;
+                            const float l2 = 1.0f - l0 - l1;
+                            if (l0 < 0.0f || l1 < 0.0f || l2 < 0.0f) {
+                                continue;
+                            }
+                            // the primary ray through the pixel center, as in
+                            // generate_subpixel_ray, intersected with the plane of the face
+                            const Vector3f direction =
+                                Vector3f(
+                                    (2.0f * center.x() / width - 1.0f) * half_w,
+                                    (1.0f - 2.0f * center.y() / height) * half_h, 1.0f
+                                )
+                                    .normalized();
+                            const float cos_n = direction.dot(normal);
+                            if (cos_n == 0.0f) {
+                                continue;
+                            }
+                            const float depth = t.corners[0].dot(normal) / cos_n;
+                            Sample&     sample =
+                                samples[static_cast<size_t>(j) * width + static_cast<size_t>(i)];
+                            if (depth <= 0.0f || depth >= sample.depth) {
+                                continue;
+                            }
+                            const Vector3f offset = depth * direction - t.corners[0];
+                            const float    d1     = offset.dot(e1);
+                            const float    d2     = offset.dot(e2);
+                            const float    beta   = (d22 * d1 - d12 * d2) / gram;
+                            const float    gamma  = (d11 * d2 - d12 * d1) / gram;
+                            sample.object         = object;
+                            sample.face           = t.face;
+                            sample.barycentric    = Vector3f(1.0f - beta - gamma, beta, gamma);
+                            sample.depth          = depth;
+                        }
+                    }
+                }
+            }
+        },
+        n_threads
+    );
+}
@@ -0,0 +1,85 @@
+#ifndef DANDELION_RENDER_VISIBILITY_BUFFER_H
+#define DANDELION_RENDER_VISIBILITY_BUFFER_H
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "../platform/gl.hpp"
+#include "../scene/camera.h"
+
+/*!
+ * \file render/visibility_buffer.h
+ * \ingroup rendering
+ * \~chinese
+ * \brief 用光栅化求主光线可见性的可见性缓冲区。
+ */
+
+/*!
+ * \ingroup rendering
+ * \~chinese
+ * \brief 记录每个像素中心处最近的表面：所在物体、面片、重心坐标和深度。
+ *
+ * 光栅化使用与 `generate_subpixel_ray` 完全相同的透视相机：像素 \f$(i, j)\f$ 的样本位于
+ * \f$(i + 0.5, j + 0.5)\f$ ，第 0 行位于图像顶部。因此每个样本都与穿过像素中心的主光线
+ * 在场景中的第一个交点一致，光线追踪渲染器可以直接从这些表面点出发追踪次级光线，
+ * 省去开销最大的主光线求交。
+ *
+ * 三角形在光栅化前被贴近相机的平面裁剪。覆盖测试在屏幕空间中进行，交点则由像素中心的主光线
+ * 与原始面片所在平面求交得到，因此深度和重心坐标不受裁剪和透视插值误差的影响。深度为交点到
+ * 相机的距离，即单位方向的主光线的 \f$t\f$ 值。
+ */
+class VisibilityBuffer
+{
+public:
+
+    /*! \~chinese 一个像素的可见性样本。 */
+    struct Sample
+    {
+        /*! \~chinese 物体的编号（由调用者指定），没有覆盖任何物体时为 `no_object` 。 */
+        std::uint32_t object;
+        /*! \~chinese 面片的序号，可用作 `GL::Mesh::face` 方法的参数。 */
+        std::uint32_t face;
+        /*! \~chinese 交点关于面片三个顶点的重心坐标。 */
+        Eigen::Vector3f barycentric;
+        /*! \~chinese 交点到相机的距离，没有覆盖任何物体时为正无穷。 */
+        float depth;
+    };
+
+    /*! \~chinese 表示像素没有被任何物体覆盖。 */
+    static constexpr std::uint32_t no_object = std::numeric_limits<std::uint32_t>::max();
+
+    VisibilityBuffer();
+
+    /*! \~chinese 把缓冲区调整为 `width` x `height` 个像素，并清空所有样本。 */
+    void clear(int width, int height);
+    /*!
+     * \~chinese
+     * \brief 把一个网格光栅化到缓冲区中，只保留比已有样本更近的表面。
+     *
+     * 图像按行分成若干条带，由不同线程并行处理，每个线程只写自己的条带。
+     *
+     * \param mesh 要光栅化的网格
+     * \param model 网格的模型变换矩阵
+     * \param object 写入样本的物体编号
+     * \param camera 观察场景的相机
+     * \param n_threads 最多使用的线程数，为 0 表示使用硬件线程数
+     */
+    void rasterize(
+        const GL::Mesh& mesh, const Eigen::Matrix4f& model, std::uint32_t object,
+        const Camera& camera, unsigned int n_threads = 0
+    );
+    /*! \~chinese 像素 \f$(x, y)\f$ 的样本，第 0 行位于图像顶部。 */
+    const Sample& at(int x, int y) const;
+
+    /*! \~chinese 缓冲区的宽度（以像素计）。 */
+    int width;
+    /*! \~chinese 缓冲区的高度（以像素计）。 */
+    int height;
+    /*! \~chinese 所有样本，按行优先、第 0 行在图像顶部的顺序存放。 */
+    std::vector<Sample> samples;
+};
+
+#endif // DANDELION_RENDER_VISIBILITY_BUFFER_H
@@ -1,11 +1,14 @@
 #include <algorithm>
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <memory>
 #include <vector>
 #include <optional>
 #include <iostream>
 #include <chrono>
+#include <cstring>
+#include <unordered_map>
 
 #include <Eigen/Core>
 #include <Eigen/Geometry>
@@ -20,12 +23,18 @@ using std::chrono::steady_clock;
 using duration   = std::chrono::duration<float>;
 using time_point = std::chrono::time_point<steady_clock, duration>;
 using Eigen::Vector3f;
+using std::optional;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
 
 // 最大的反射次数
 constexpr int   MAX_DEPTH      = 5;
 constexpr float INFINITY_FLOAT = std::numeric_limits<float>::max();
 // 考虑物体与光线相交点的偏移值
 constexpr float EPSILON = 0.00001f;
+// 增量渲染中图像块的边长
+constexpr int TILE_SIZE = 16;
 
 // 当前物体的材质类型，根据不同材质类型光线会有不同的反射情况
 enum class MaterialType
@@ -54,17 +63,55 @@ void update_progress(float progress)
 
 WhittedRenderer::WhittedRenderer(RenderEngine& engine) :
     width(engine.width), height(engine.height), n_threads(engine.n_threads), use_bvh(false),
-    rendering_res(engine.rendering_res)
+    rendering_res(engine.rendering_res), count_traversal(false), adaptive_sampling(false),
+    adaptive_threshold(0.1f), incremental(false), recording(nullptr)
 {
     logger = get_logger("Whitted Renderer");
 }
 
+namespace {
+
+uint64_t fnv1a(uint64_t hash, uint32_t value)
+{
+    return (hash ^ value) * 1099511628211ull;
+}
+
+// 任何一项改变都会使所有像素失效的渲染参数
+std::vector<float> collect_view_state(const Scene& scene, float width, float height, bool use_bvh)
+{
+    const Camera&      camera = scene.camera;
+    std::vector<float> state  = {
+        width, height, use_bvh ? 1.0f : 0.0f, camera.fov_y_degrees, camera.aspect_ratio,
+        camera.near_plane, camera.far_plane
+    };
+    const Vector3f* vectors[] = {
+        &camera.position, &camera.target, &camera.world_up, &RenderEngine::background_color
+    };
+    for (const Vector3f* v: vectors) {
+        state.insert(state.end(), v->data(), v->data() + 3);
+    }
+    for (const Light& light: scene.lights) {
+        state.insert(state.end(), light.position.data(), light.position.data() + 3);
+        state.push_back(light.intensity);
+    }
+    return state;
+}
+
+bool same_material(const GL::Material& a, const GL::Material& b)
+{
+    return a.ambient == b.ambient && a.diffuse == b.diffuse && a.specular == b.specular
+        && a.shininess == b.shininess;
+}
+
+} // namespace
+
 // whitted-style渲染的实现
 void WhittedRenderer::render(Scene& scene)
 {
     time_point begin_time = steady_clock::now();
     width                 = std::floor(width);
     height                = std::floor(height);
+    reset_traversal_counters();
 
     // initialize frame buffer
     std::vector<Vector3f> framebuffer(static_cast<size_t>(width * height));
@@ -72,17 +119,25 @@ void WhittedRenderer::render(Scene& scene)
         v = Vector3f(0.0f, 0.0f, 0.0f);
     }
 
-    int idx = 0;
-    for (int j = 0; j < height; j++) {
-        for (int i = 0; i < width; i++) {
-            // generate ray
-            Ray ray = generate_ray(
-                static_cast<int>(width), static_cast<int>(height), i, j, scene.camera, 1.0f
-            );
-            // cast ray
-            framebuffer[idx++] = cast_ray(ray, scene, 0);
+    if (adaptive_sampling) {
+        render_adaptive(scene, framebuffer);
+        tile_cells.clear();
+    } else if (incremental) {
+        render_incremental(scene, framebuffer);
+    } else {
+        tile_cells.clear();
+        int idx = 0;
+        for (int j = 0; j < height; j++) {
+            for (int i = 0; i < width; i++) {
+                // generate ray
+                Ray ray = generate_ray(
+                    static_cast<int>(width), static_cast<int>(height), i, j, scene.camera, 1.0f
+                );
+                // cast ray
+                framebuffer[idx++] = cast_ray(ray, scene, 0);
+            }
+            update_progress(j / height);
         }
-        update_progress(j / height);
     }
     static unsigned char color_res[3];
     rendering_res.clear();
@@ -97,6 +152,216 @@ void WhittedRenderer::render(Scene& scene)
     time_point end_time           = steady_clock::now();
     duration   rendering_duration = end_time - begin_time;
     logger->info("rendering takes {:.6f} seconds", rendering_duration.count());
+    // the rays were traced on this thread, so flushing its thread-local counters collects all of
+    // them into the statistics of this render
+    flush_traversal_counters();
+    traversal_counters = collected_traversal_counters();
+    if (traversal_counters.rays > 0) {
+        const double rays = static_cast<double>(traversal_counters.rays);
+        logger->info(
+            "{} rays, {:.2f} nodes visited, {:.2f} triangle tests and {:.2f} hits per ray",
+            traversal_counters.rays, traversal_counters.visited_nodes / rays,
+            traversal_counters.triangle_tests / rays, traversal_counters.triangle_hits / rays
+        );
+    }
+}
+
+// 自适应超采样：先每个像素一个样本，再只对边缘像素追加样本
+void WhittedRenderer::render_adaptive(Scene& scene, std::vector<Vector3f>& framebuffer)
+{
+    const int    w        = static_cast<int>(width);
+    const int    h        = static_cast<int>(height);
+    const size_t n_pixels = static_cast<size_t>(w) * static_cast<size_t>(h);
+    size_t       n_rays   = 0;
+
+    const auto sample = [&](float x, float y) {
+        ++n_rays;
+        return cast_ray(generate_subpixel_ray(scene.camera, width, height, x, y), scene, 0);
+    };
+    const auto differs = [&](const Vector3f& a, const Vector3f& b) {
+        return (a - b).cwiseAbs().maxCoeff() > adaptive_threshold;
+    };
+
+    // one sample through each pixel center, remembering which object it hits
+    std::vector<std::optional<size_t>> hit_ids(n_pixels);
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            const size_t idx = static_cast<size_t>(j) * w + i;
+            const Ray    ray =
+                generate_subpixel_ray(scene.camera, width, height, i + 0.5f, j + 0.5f);
+            ++n_rays;
+            framebuffer[idx] = cast_ray(ray, scene, 0, &hit_ids[idx]);
+        }
+        update_progress(0.5f * j / height);
+    }
+
+    // mark both pixels of every neighboring pair that lies across an edge
+    std::vector<bool> refine(n_pixels, false);
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            const size_t idx = static_cast<size_t>(j) * w + i;
+            for (const size_t neighbor: {i + 1 < w ? idx + 1 : idx, j + 1 < h ? idx + w : idx}) {
+                if (neighbor != idx
+                    && (hit_ids[idx] != hit_ids[neighbor]
+                        || differs(framebuffer[idx], framebuffer[neighbor]))) {
+                    refine[idx]      = true;
+                    refine[neighbor] = true;
+                }
+            }
+        }
+    }
+
+    size_t n_refined = 0;
+    for (int j = 0; j < h; j++) {
+        for (int i = 0; i < w; i++) {
+            const size_t idx = static_cast<size_t>(j) * w + i;
+            if (!refine[idx]) {
+                continue;
+            }
+            ++n_refined;
+            Vector3f sum  = framebuffer[idx];
+            int      n    = 1;
+            Vector3f low  = Vector3f::Constant(INFINITY_FLOAT);
+            Vector3f high = Vector3f::Constant(-INFINITY_FLOAT);
+            for (int k = 0; k < 4; ++k) {
+                const Vector3f color =
+                    sample(i + 0.25f + 0.5f * (k % 2), j + 0.25f + 0.5f * (k / 2));
+                sum += color;
+                low  = low.cwiseMin(color);
+                high = high.cwiseMax(color);
+            }
+            n += 4;
+            if (differs(low, high)) {
+                for (int k = 0; k < 16; ++k) {
+                    sum += sample(i + 0.125f + 0.25f * (k % 4), j + 0.125f + 0.25f * (k / 4));
+                }
+                n += 16;
+            }
+            framebuffer[idx] = sum / static_cast<float>(n);
+        }
+        update_progress(0.5f + 0.5f * j / height);
+    }
+    logger->info(
+        "adaptive sampling refines {} of {} pixels, {:.2f} primary rays per pixel", n_refined,
+        n_pixels, static_cast<float>(n_rays) / static_cast<float>(n_pixels)
+    );
+}
+
+// 增量渲染：比较物体的快照，只重新追踪光线经过了变化区域的图像块
+void WhittedRenderer::render_incremental(Scene& scene, std::vector<Vector3f>& framebuffer)
+{
+    const int    w        = static_cast<int>(width);
+    const int    h        = static_cast<int>(height);
+    const size_t n_pixels = static_cast<size_t>(w) * static_cast<size_t>(h);
+    const int    tiles_x  = (w + TILE_SIZE - 1) / TILE_SIZE;
+    const int    tiles_y  = (h + TILE_SIZE - 1) / TILE_SIZE;
+    const size_t n_tiles  = static_cast<size_t>(tiles_x) * static_cast<size_t>(tiles_y);
+
+    std::unordered_map<size_t, ObjectSnapshot> snapshots;
+    for (const auto& group: scene.groups) {
+        for (const auto& object: group->objects) {
+            snapshots.emplace(object->id, take_snapshot(*object));
+        }
+    }
+    std::vector<float> state = collect_view_state(scene, width, height, use_bvh);
+    bool full = state != view_state || cached_framebuffer.size() != n_pixels
+             || tile_cells.size() != n_tiles;
+
+    // cells occupied by every changed object, both before and after the change
+    DependencyGrid::CellSet dirty;
+    const auto changed = [](const ObjectSnapshot& a, const ObjectSnapshot& b) {
+        return a.model != b.model || !same_material(a.material, b.material)
+            || a.geometry_hash != b.geometry_hash;
+    };
+    for (const auto& [id, snapshot]: snapshots) {
+        if (full) {
+            break;
+        }
+        auto previous = object_snapshots.find(id);
+        if (previous != object_snapshots.end() && !changed(previous->second, snapshot)) {
+            continue;
+        }
+        // rays were only recorded inside the grid, so an object leaving it invalidates everything
+        if (!dependency_grid.contains(snapshot.bounds)) {
+            full = true;
+            break;
+        }
+        dependency_grid.mark_box(dirty, snapshot.bounds);
+        if (previous != object_snapshots.end()) {
+            dependency_grid.mark_box(dirty, previous->second.bounds);
+        }
+    }
+    for (const auto& [id, snapshot]: object_snapshots) {
+        if (snapshots.count(id) == 0) {
+            dependency_grid.mark_box(dirty, snapshot.bounds);
+        }
+    }
+
+    if (full) {
+        // the grid covers the scene with some margin, so that small edits stay inside it
+        Eigen::AlignedBox3f bounds(scene.camera.position);
+        for (const auto& [id, snapshot]: snapshots) {
+            bounds.extend(snapshot.bounds);
+        }
+        for (const Light& light: scene.lights) {
+            bounds.extend(light.position);
+        }
+        const Vector3f margin = Vector3f::Constant(0.25f * bounds.sizes().maxCoeff() + EPSILON);
+        dependency_grid.reset(Eigen::AlignedBox3f(bounds.min() - margin, bounds.max() + margin));
+        cached_framebuffer.assign(n_pixels, Vector3f::Zero());
+        tile_cells.assign(n_tiles, DependencyGrid::CellSet());
+    }
+
+    size_t n_retraced = 0;
+    for (int tile_y = 0; tile_y < tiles_y; ++tile_y) {
+        for (int tile_x = 0; tile_x < tiles_x; ++tile_x) {
+            DependencyGrid::CellSet& cells = tile_cells[tile_y * tiles_x + tile_x];
+            if (!full && (cells & dirty).none()) {
+                continue;
+            }
+            ++n_retraced;
+            cells.reset();
+            recording = &cells;
+            for (int j = tile_y * TILE_SIZE; j < std::min(h, (tile_y + 1) * TILE_SIZE); ++j) {
+                for (int i = tile_x * TILE_SIZE; i < std::min(w, (tile_x + 1) * TILE_SIZE); ++i) {
+                    const Ray ray = generate_ray(w, h, i, j, scene.camera, 1.0f);
+                    cached_framebuffer[static_cast<size_t>(j) * w + i] = cast_ray(ray, scene, 0);
+                }
+            }
+            recording = nullptr;
+        }
+        update_progress(static_cast<float>(tile_y + 1) / static_cast<float>(tiles_y));
+    }
+    framebuffer      = cached_framebuffer;
+    object_snapshots = std::move(snapshots);
+    view_state       = std::move(state);
+    logger->info("incremental rendering re-traces {} of {} tiles", n_retraced, n_tiles);
+}
+
+WhittedRenderer::ObjectSnapshot WhittedRenderer::take_snapshot(Object& object)
+{
+    ObjectSnapshot snapshot{object.model(), object.mesh.material, {}, 14695981039346656037ull};
+    const std::vector<float>& vertices = object.mesh.vertices.data;
+    Eigen::AlignedBox3f       local;
+    for (size_t i = 0; i + 2 < vertices.size(); i += 3) {
+        local.extend(Vector3f(vertices[i], vertices[i + 1], vertices[i + 2]));
+    }
+    for (float coordinate: vertices) {
+        uint32_t bits;
+        std::memcpy(&bits, &coordinate, sizeof(bits));
+        snapshot.geometry_hash = fnv1a(snapshot.geometry_hash, bits);
+    }
+    for (unsigned int index: object.mesh.faces.data) {
+        snapshot.geometry_hash = fnv1a(snapshot.geometry_hash, index);
+    }
+    snapshot.bounds.setEmpty();
+    if (!local.isEmpty()) {
+        for (int k = 0; k < 8; ++k) {
+            const Vector3f corner = local.corner(static_cast<Eigen::AlignedBox3f::CornerType>(k));
+            snapshot.bounds.extend((snapshot.model * corner.homogeneous()).hnormalized());
+        }
+    }
+    return snapshot;
 }
 
 // 菲涅尔定理计算反射光线
@@ -112,16 +377,23 @@ float WhittedRenderer::fresnel(const Vector3f& I, const Vector3f& N, const float
 
 // 如果相交返回Intersection结构体，如果不相交则返回false
 std::optional<std::tuple<Intersection, GL::Material>>
-WhittedRenderer::trace(const Ray& ray, const Scene& scene)
+WhittedRenderer::trace(const Ray& ray, const Scene& scene, optional<size_t>* hit_id)
 {
+    ++thread_traversal_counters().rays;
     // this line below is just for compiling and can be deleted
     (void)ray;
 
     std::optional<Intersection> payload;
     Eigen::Matrix4f             M;
     GL::Material                material;
+    optional<size_t>            hit_object;
     for (const auto& group: scene.groups) {
         for (const auto& object: group->objects) {
+            const float nearest = payload.has_value() ? payload->t : INFINITY_FLOAT;
+            // the BVH library does not touch the counters, so replay the traversal for them
+            if (count_traversal && use_bvh && object->bvh != nullptr) {
+                count_BVH_traversal(*object->bvh, ray, object->model());
+            }
 
             // this line below is just for compiling and can be deleted
             (void)object;
@@ -129,9 +401,22 @@ WhittedRenderer::trace(const Ray& ray, const Scene& scene)
             // if use bvh(exercise 2.4): use object->bvh->intersect
             // else(exercise 2.3): use naive_intersect()
             // pay attention to the range of payload->t
+
+            // remember which object the nearest hit so far belongs to
+            if (payload.has_value() && payload->t < nearest) {
+                hit_object = object->id;
+            }
         }
     }
+    if (hit_id != nullptr) {
+        *hit_id = hit_object;
+    }
 
+    if (recording != nullptr) {
+        dependency_grid.mark_segment(
+            *recording, ray, payload.has_value() ? payload->t : INFINITY_FLOAT
+        );
+    }
     if (!payload.has_value()) {
         return std::nullopt;
     }
@@ -139,20 +424,38 @@ WhittedRenderer::trace(const Ray& ray, const Scene& scene)
 }
 
 // Whitted-style的光线传播算法实现
-Vector3f WhittedRenderer::cast_ray(const Ray& ray, const Scene& scene, int depth)
+Vector3f
+WhittedRenderer::cast_ray(const Ray& ray, const Scene& scene, int depth, optional<size_t>* hit_id)
 {
     if (depth > MAX_DEPTH) {
         return Vector3f(0.0f, 0.0f, 0.0f);
     }
-    // initialize hit color
-    Vector3f hitcolor = RenderEngine::background_color;
     // get the result of trace()
-    auto result = trace(ray, scene);
+    auto result = trace(ray, scene, hit_id);
+    if (!result.has_value()) {
+        return RenderEngine::background_color;
+    }
+    const auto& [isect, material] = result.value();
+    return shade(ray, isect, material, scene, depth);
+}
 
-    // this line below is just for compiling and can be deleted
-    (void)result;
+// 计算光线击中点的颜色，混合渲染器也从可见性缓冲区给出的主光线击中点调用它
+Vector3f WhittedRenderer::shade(
+    const Ray& ray, const Intersection& isect, const GL::Material& material, const Scene& scene,
+    int depth
+)
+{
+    // these lines below are just for compiling and can be deleted
+    (void)ray;
+    (void)isect;
+    (void)material;
+    (void)scene;
+    (void)depth;
+    // these lines above are just for compiling and can be deleted
+
+    // initialize hit color
+    Vector3f hitcolor = RenderEngine::background_color;
 
-    // if result.has_value():
     // 1.judge the material_type
     // 2.if REFLECTION:
     //(1)use fresnel() to get kr
@@ -1,5 +1,7 @@
 #include "group.h"
 
+#include <filesystem>
+#include <optional>
 #include <set>
 #include <utility>
 
@@ -13,7 +15,11 @@
 
 #include "../utils/logger.h"
 #include "../utils/json_serialize.hpp"
+#include "../utils/parallel.hpp"
+#include "../utils/bvh_cache.h"
+#include "../utils/vertex_clustering.h"
 
+namespace fs = std::filesystem;
 using Eigen::Vector3f;
 using std::make_pair;
 using std::make_unique;
@@ -52,7 +58,8 @@ bool Group::load_models(const string& file_path)
         return false;
     }
 
-    objects.reserve(n_meshes);
+    const size_t first_new_object = objects.size();
+    objects.reserve(first_new_object + n_meshes);
     logger->info("load into group \"{}\"", this->name);
     for (size_t mesh_id = 0; mesh_id < n_meshes; ++mesh_id) {
         const aiMesh*             mesh       = scene->mMeshes[mesh_id];
@@ -123,10 +130,33 @@ bool Group::load_models(const string& file_path)
             "summary: {} vertices, {} edges, {} faces", mesh->mNumVertices, edges.size(),
             object.mesh.faces.count()
         );
-        object.rebuild_BVH();
+    }
+
+    // BVHs of different objects are independent and can be built (or restored from the cache
+    // file saved along with the model) concurrently. Logging is kept on the calling thread.
+    const BVHCache     BVH_cache(fs::path(file_path).replace_extension(".bvh").generic_string());
+    const unsigned int n_threads = resolve_thread_count(0);
+    const unsigned int threads_per_object =
+        std::max(1u, n_threads / static_cast<unsigned int>(n_meshes));
+    std::vector<char> restored(n_meshes, false);
+    parallel_for(
+        0, n_meshes,
+        [&](size_t mesh_id) {
+            Object& object = *(objects[first_new_object + mesh_id]);
+            if (BVH_cache.valid() && object.restore_BVH(BVH_cache, mesh_id)) {
+                restored[mesh_id] = true;
+                return;
+            }
+            object.build_BVH(threads_per_object);
+        },
+        n_threads
+    );
+    for (size_t mesh_id = 0; mesh_id < n_meshes; ++mesh_id) {
+        Object& object = *(objects[first_new_object + mesh_id]);
+        object.update_BVH_boxes();
         logger->info(
-            "The BVH structure of {} (ID: {}) has {} boxes", object.name, object.id,
-            object.bvh->count_nodes(object.bvh->root)
+            "The BVH structure of {} (ID: {}) has {} boxes{}", object.name, object.id,
+            object.bvh->count_nodes(object.bvh->root), restored[mesh_id] ? " (cached)" : ""
         );
         object.modified = true;
     }
@@ -134,6 +164,64 @@ bool Group::load_models(const string& file_path)
     return true;
 }
 
+bool Group::load_simplified_model(const string& file_path, size_t resolution)
+{
+    std::optional<ClusteredMesh> clustered = cluster_vertices(file_path, resolution);
+    if (!clustered.has_value() || clustered->faces.empty()) {
+        return false;
+    }
+    logger->info("file {} simplified from {} faces", file_path, clustered->n_input_faces);
+    logger->info("load into group \"{}\"", this->name);
+
+    objects.push_back(make_unique<Object>(fs::path(file_path).stem().generic_string()));
+    Object&                   object     = *(objects.back());
+    const std::vector<float>& vertices   = clustered->vertices;
+    const size_t              n_vertices = vertices.size() / 3;
+    const size_t              n_faces    = clustered->faces.size() / 3;
+    set<pair<size_t, size_t>> edges;
+    // Vertex normals are averaged from the area-weighted face normals.
+    std::vector<Vector3f> normals(n_vertices, Vector3f::Zero());
+    for (size_t face_id = 0; face_id < n_faces; ++face_id) {
+        const unsigned int* face = clustered->faces.data() + 3 * face_id;
+        const Vector3f      a(vertices.data() + 3 * face[0]);
+        const Vector3f      b(vertices.data() + 3 * face[1]);
+        const Vector3f      c(vertices.data() + 3 * face[2]);
+        const Vector3f      normal = (b - a).cross(c - a);
+        for (size_t current_vertex = 0; current_vertex < 3; ++current_vertex) {
+            normals[face[current_vertex]] += normal;
+            object.mesh.faces.data.push_back(face[current_vertex]);
+
+            size_t vertex_id      = face[current_vertex];
+            size_t next_vertex_id = face[(current_vertex + 1) % 3];
+            edges.insert(
+                make_pair(std::min(vertex_id, next_vertex_id), std::max(vertex_id, next_vertex_id))
+            );
+        }
+    }
+    for (size_t vertex_id = 0; vertex_id < n_vertices; ++vertex_id) {
+        const Vector3f normal = normals[vertex_id].normalized();
+        object.mesh.vertices.append(
+            vertices[3 * vertex_id], vertices[3 * vertex_id + 1], vertices[3 * vertex_id + 2]
+        );
+        object.mesh.normals.append(normal.x(), normal.y(), normal.z());
+    }
+    for (const auto& edge: edges) {
+        object.mesh.edges.append((unsigned int)edge.first, (unsigned int)edge.second);
+    }
+    logger->info(
+        "summary: {} vertices, {} edges, {} faces", n_vertices, edges.size(),
+        object.mesh.faces.count()
+    );
+
+    object.rebuild_BVH();
+    logger->info(
+        "The BVH structure of {} (ID: {}) has {} boxes", object.name, object.id,
+        object.bvh->count_nodes(object.bvh->root)
+    );
+    object.modified = true;
+    return true;
+}
+
 bool Group::save_models(const string& file_path)
 {
     size_t num_objects = objects.size();
@@ -238,6 +326,21 @@ bool Group::save_models(const string& file_path)
     return false;
 }
 
+bool Group::save_BVHs(const string& file_path)
+{
+    std::vector<const BVH*> bvhs;
+    bvhs.reserve(objects.size());
+    for (const auto& object: objects) {
+        bvhs.push_back(object->bvh.get());
+    }
+    if (!BVHCache::write(file_path, bvhs)) {
+        logger->warn("failed to write BVH cache file {}", file_path);
+        return false;
+    }
+    logger->info("BVHs of group {} saved to {}", this->name, file_path);
+    return true;
+}
+
 void Group::load_metadata(const json& metadata)
 {
     // load name
@@ -47,11 +47,23 @@ public:
     /*!
      * \~chinese
      * 被 `Scene::load` 调用，真正加载模型数据的函数。
-     * 这个函数只加载模型 mesh 数据，不包括变换、物理属性等 `Object` 层面的信息
+     * 这个函数只加载模型 mesh 数据，不包括变换、物理属性等 `Object` 层面的信息。
+     * 如果模型文件旁边有同名的 `.bvh` 缓存文件（见 `save_BVHs`），拓扑一致的物体
+     * 会直接从缓存中恢复 BVH ，其余物体照常构建。
      * \param file_path 要加载模型的文件路径
      * \returns 是否加载成功
      */
     bool load_models(const std::string& file_path);
+    /*!
+     * \~chinese
+     * 流式读取一个可能无法整体载入内存的模型文件，用顶点聚类（见 `cluster_vertices`）
+     * 简化后作为组中的一个物体加载。简化得到的物体与 `load_models` 加载的物体没有区别，
+     * 同样可以保存、编辑。
+     * \param file_path 要加载的 obj 或 stl 文件路径
+     * \param resolution 聚类网格在包围盒最长边方向上的单元数
+     * \returns 是否加载成功
+     */
+    bool load_simplified_model(const std::string& file_path, std::size_t resolution);
     /*!
      * \~chinese
      * 将 `Group` 保存为单个 obj 文件，包括 mesh、材质等信息
@@ -59,6 +71,13 @@ public:
      * \returns 是否保存成功
      */
     bool save_models(const std::string& file_path);
+    /*!
+     * \~chinese
+     * 将组内所有物体的 BVH 保存为一个二进制缓存文件，格式见 `BVHCache`
+     * \param file_path 保存的文件路径，应当与 `save_models` 保存的文件同名、扩展名为 `.bvh`
+     * \returns 是否保存成功
+     */
+    bool save_BVHs(const std::string& file_path);
     /*!
      * \~chinese
      * 加载以 JSON 格式保存的除 mesh 和材质以外的数据，如变换、物理属性
@@ -1,6 +1,7 @@
 #include "object.h"
 
 #include <array>
+#include <chrono>
 #include <optional>
 
 #ifdef _WIN32
@@ -22,17 +23,21 @@ using std::array;
 using std::make_unique;
 using std::optional;
 using std::string;
+using std::string_view;
 using std::vector;
+using std::chrono::steady_clock;
 
-bool   Object::BVH_for_collision = false;
-size_t Object::next_available_id = 0;
+bool   Object::BVH_for_collision     = false;
+float  Object::BVH_rebuild_threshold = 1.5f;
+size_t Object::next_available_id     = 0;
 std::function<KineticState(const KineticState&, const KineticState&)> Object::step =
     forward_euler_step;
 
 Object::Object(const string& object_name) :
     name(object_name), center(0.0f, 0.0f, 0.0f), scaling(1.0f, 1.0f, 1.0f),
     rotation(1.0f, 0.0f, 0.0f, 0.0f), velocity(0.0f, 0.0f, 0.0f), force(0.0f, 0.0f, 0.0f),
-    mass(1.0f), BVH_boxes("BVH", GL::Mesh::highlight_wireframe_color)
+    mass(1.0f), BVH_boxes("BVH", GL::Mesh::highlight_wireframe_color), BVH_build_time(0.0f),
+    BVH_face_count(0), BVH_built_cost(0.0f), BVH_boxes_outdated(true), BVH_boxes_depth(0)
 {
     visible  = true;
     modified = false;
@@ -115,19 +120,104 @@ void Object::render(const Shader& shader, WorkingMode mode, bool selected)
 
 void Object::rebuild_BVH()
 {
+    build_BVH();
+    update_BVH_boxes();
+}
+
+void Object::build_BVH(unsigned int n_threads)
+{
+    const steady_clock::time_point begin_time = steady_clock::now();
     bvh->recursively_delete(bvh->root);
-    bvh->build();
-    BVH_boxes.clear();
-    refresh_BVH_boxes(bvh->root);
-    BVH_boxes.to_gpu();
+    bvh->root = nullptr;
+    if (mesh.faces.count() >= BVH::parallel_build_threshold) {
+        bvh->parallel_build(n_threads);
+    } else {
+        bvh->build();
+    }
+    BVH_face_count = mesh.faces.count();
+    BVH_built_cost = bvh->sah_cost();
+    BVH_build_time = std::chrono::duration<float>(steady_clock::now() - begin_time).count();
+}
+
+bool Object::restore_BVH(const BVHCache& cache, size_t index)
+{
+    const steady_clock::time_point begin_time = steady_clock::now();
+    bvh->recursively_delete(bvh->root);
+    bvh->root  = nullptr;
+    float cost = 0.0f;
+    if (!cache.restore(index, *bvh, cost)) {
+        return false;
+    }
+    bvh->refit();
+    if (bvh->sah_cost() > cost * BVH_rebuild_threshold) {
+        bvh->recursively_delete(bvh->root);
+        bvh->root = nullptr;
+        return false;
+    }
+    BVH_face_count = mesh.faces.count();
+    BVH_built_cost = cost;
+    BVH_build_time = std::chrono::duration<float>(steady_clock::now() - begin_time).count();
+    return true;
+}
+
+bool Object::update_BVH()
+{
+    if (bvh->root == nullptr || mesh.faces.count() != BVH_face_count) {
+        rebuild_BVH();
+        return true;
+    }
+    bvh->refit();
+    const float cost = bvh->sah_cost();
+    if (cost > BVH_built_cost * BVH_rebuild_threshold) {
+        logger->info(
+            "SAH cost of the refitted BVH grows from {:.3f} to {:.3f}, rebuild it", BVH_built_cost,
+            cost
+        );
+        rebuild_BVH();
+        return true;
+    }
+    update_BVH_boxes();
+    return false;
+}
+
+void Object::update_BVH_boxes()
+{
+    BVH_boxes_outdated = true;
+}
+
+void Object::render_BVH(const Shader& shader, int max_depth, string_view subtree)
+{
+    if (BVH_boxes_outdated || max_depth != BVH_boxes_depth || subtree != BVH_boxes_subtree) {
+        // Walk down to the root of the selected subtree, stopping early if the path goes
+        // beyond a leaf.
+        BVHNode* subtree_root = bvh->root;
+        for (char direction: subtree) {
+            if (subtree_root == nullptr) {
+                break;
+            }
+            BVHNode* child = direction == 'L' ? subtree_root->left : subtree_root->right;
+            if (child == nullptr) {
+                break;
+            }
+            subtree_root = child;
+        }
+        BVH_boxes.clear();
+        refresh_BVH_boxes(subtree_root, max_depth);
+        BVH_boxes.to_gpu();
+        BVH_boxes_outdated = false;
+        BVH_boxes_depth    = max_depth;
+        BVH_boxes_subtree  = subtree;
+    }
+    shader.set_uniform("model", model());
+    BVH_boxes.render(shader);
 }
 
-void Object::refresh_BVH_boxes(BVHNode* node)
+void Object::refresh_BVH_boxes(BVHNode* node, int remaining_depth)
 {
-    if (node == nullptr) {
+    if (node == nullptr || remaining_depth <= 0) {
         return;
     }
     BVH_boxes.add_AABB(node->aabb.p_min, node->aabb.p_max);
-    refresh_BVH_boxes(node->left);
-    refresh_BVH_boxes(node->right);
+    refresh_BVH_boxes(node->left, remaining_depth - 1);
+    refresh_BVH_boxes(node->right, remaining_depth - 1);
 }
@@ -3,6 +3,7 @@
 
 #include <cstddef>
 #include <string>
+#include <string_view>
 #include <memory>
 #include <vector>
 #include <functional>
@@ -15,6 +16,7 @@
 #include "../platform/shader.hpp"
 #include "../utils/rendering.hpp"
 #include "../utils/bvh.h"
+#include "../utils/bvh_cache.h"
 #include "../utils/kinetic_state.h"
 
 /*!
@@ -85,9 +87,66 @@ public:
      * \~chinese
      * \brief 重新构建 BVH 。
      *
-     * 原先没有构建过 BVH 的情况下调用这个函数也是安全的。
+     * 原先没有构建过 BVH 的情况下调用这个函数也是安全的。等价于依次调用 `build_BVH` 和
+     * `update_BVH_boxes` 。
      */
     void rebuild_BVH();
+    /*!
+     * \~chinese
+     * \brief 删除原先的 BVH 并在 CPU 上重新构建，不更新 `BVH_boxes` 。
+     *
+     * 面片数不少于 `BVH::parallel_build_threshold` 时使用并行的 `BVH::parallel_build` ，
+     * 否则使用 `BVH::build` 。这个函数不调用 OpenGL API ，因此 `Group::load_models`
+     * 可以在多个线程中同时为不同物体构建 BVH 。
+     *
+     * \param n_threads 并行构建时使用的线程数，为 0 时使用硬件线程数
+     */
+    void build_BVH(unsigned int n_threads = 0);
+    /*!
+     * \~chinese
+     * \brief 标记 `BVH_boxes` 已经过时。
+     *
+     * 这个函数不生成任何线框，也不调用 OpenGL API ：线框数据推迟到下一次 `render_BVH`
+     * 时才按需生成，因此在不显示 BVH 时重建 BVH 不会有额外开销。
+     */
+    void update_BVH_boxes();
+    /*!
+     * \~chinese
+     * \brief 绘制 BVH 的包围盒线框。
+     *
+     * 只绘制从 `subtree` 指定的子树根节点开始、不超过 `max_depth` 层的节点。
+     * BVH 被重建或参数发生变化时才重新生成实例数据并上传，否则直接绘制。
+     *
+     * \param shader 对一个 `Shader` 对象的引用，函数会设置其中的 `model` 矩阵
+     * \param max_depth 绘制的最大层数，为 1 时只绘制子树根节点
+     * \param subtree 从根节点到子树根节点的路径，每个字符为 `L` (左子节点) 或 `R` (右子节点)，
+     * 为空时从整个 BVH 的根节点开始；路径超出叶节点时停在叶节点处
+     */
+    void render_BVH(const Shader& shader, int max_depth, std::string_view subtree);
+    /*!
+     * \~chinese
+     * \brief 在 mesh 发生形变后更新 BVH 。
+     *
+     * 如果面片数量与构建 BVH 时相同，先用 `BVH::refit` 更新所有包围盒；只有 refit 后的 SAH
+     * 代价超过构建时代价的 `BVH_rebuild_threshold` 倍，或者面片数量发生变化时才完整重建。
+     * 无论哪种情况都会更新 `BVH_boxes` 。
+     *
+     * \returns 如果进行了完整重建返回 `true` ，只做了 refit 返回 `false`
+     */
+    bool update_BVH();
+    /*!
+     * \~chinese
+     * \brief 尝试从 BVH 缓存文件中恢复 BVH ，不更新 `BVH_boxes` 。
+     *
+     * 恢复成功后会用当前的顶点坐标 refit 一次；如果 refit 后的 SAH 代价超过保存时的
+     * `BVH_rebuild_threshold` 倍，则视为恢复失败并删除恢复出的 BVH 。与 `build_BVH`
+     * 一样，这个函数不调用 OpenGL API 。
+     *
+     * \param cache 已经映射的缓存文件
+     * \param index 这个物体在缓存文件中的记录序号
+     * \returns 是否恢复成功，失败时调用者应当调用 `build_BVH`
+     */
+    bool restore_BVH(const BVHCache& cache, std::size_t index);
 
     /*!
      * \~chinese
@@ -98,6 +157,8 @@ public:
     static std::function<KineticState(const KineticState&, const KineticState&)> step;
     /*! \~chinese 是否启用 BVH 加速碰撞检测。 */
     static bool BVH_for_collision;
+    /*! \~chinese refit 后的 SAH 代价与构建时之比超过这个值时，`update_BVH` 将重建 BVH 。 */
+    static float BVH_rebuild_threshold;
     /*! \~chinese 物体的 ID，不会与其他物体重复。 */
     std::size_t id;
     /*! \~chinese 物体的名称，来自加载文件时的 mesh 名称（文件中未定义会创建一个默认名称）。 */
@@ -136,11 +197,13 @@ public:
      *
      * 物体的 mesh 数据都在模型坐标系下，因此 BVH 也是建立在模型坐标系下的。这意味着物体的平移、
      * 旋转和缩放都不改变 BVH 的结构，只有物体发生形变时才需要更新 BVH 。目前的实现是：
-     * 每次退出建模模式时，不加检查地删除原先的 BVH 并重新构建。
+     * 每次退出建模模式时调用 `update_BVH` ，优先 refit ，质量下降过多时才重新构建。
      */
     std::unique_ptr<BVH> bvh;
-    /*! \~chinese 代表 BVH 所有包围盒的线框。 */
-    GL::LineSet BVH_boxes;
+    /*! \~chinese 代表 BVH 包围盒的线框，只包含最近一次 `render_BVH` 选中的节点。 */
+    GL::BoxSet BVH_boxes;
+    /*! \~chinese 最近一次构建或从缓存恢复 BVH 所用的时间（秒）。 */
+    float BVH_build_time;
 
 private:
 
@@ -148,9 +211,20 @@ private:
      * \~chinese
      * \brief 将新的 BVH 线框添加到 `BVH_boxes` 中
      *
-     * \param node 初始 BVH 结点，函数会递归更新子结点，将所有 BVH 包围盒都添加为线框
+     * \param node 初始 BVH 结点，函数会递归更新子结点，将这些 BVH 包围盒添加为线框
+     * \param remaining_depth 包括 `node` 在内还要添加的层数
      */
-    void refresh_BVH_boxes(BVHNode* node);
+    void refresh_BVH_boxes(BVHNode* node, int remaining_depth);
+    /*! \~chinese 上一次完整构建 BVH 时的面片数。 */
+    std::size_t BVH_face_count;
+    /*! \~chinese 上一次完整构建 BVH 后的 SAH 代价，作为判断 refit 质量的基准。 */
+    float BVH_built_cost;
+    /*! \~chinese `BVH_boxes` 是否需要在下一次绘制前重新生成。 */
+    bool BVH_boxes_outdated;
+    /*! \~chinese 生成 `BVH_boxes` 时使用的最大层数。 */
+    int BVH_boxes_depth;
+    /*! \~chinese 生成 `BVH_boxes` 时使用的子树路径。 */
+    std::string BVH_boxes_subtree;
     /*! \~chinese 下一个可用的物体 ID 。 */
     static std::size_t next_available_id;
     /*! \~chinese 日志记录器。 */
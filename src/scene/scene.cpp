@@ -209,6 +209,22 @@ bool Scene::import_model(const string& file_path)
     return true;
 }
 
+bool Scene::import_simplified_model(const string& file_path, size_t resolution)
+{
+    fs::path path(file_path);
+    string   group_name = path.stem().generic_string();
+    groups.push_back(make_unique<Group>(group_name));
+    Group& group   = *(groups.back());
+    bool   success = group.load_simplified_model(file_path, resolution);
+    if (!success) {
+        logger->warn("fail to import the specified file into current scene");
+        groups.erase(groups.end() - 1);
+        return false;
+    }
+    logger->debug("group \"{}\" has beed added into the current scene", group_name);
+    return true;
+}
+
 bool Scene::save(const string_view directory)
 {
     logger->info("saving scene data to {}", directory);
@@ -249,8 +265,12 @@ bool Scene::save(const string_view directory)
         string group_filename = fmt::format("{:02d}_{}.obj", i, group->name);
         // save mesh and material to external obj file
         bool result = group->save_models((base_path / group_filename).generic_string());
-        if (result)
+        if (result) {
             ++n_saved_groups;
+            // save built BVHs next to the model file so that loading can skip building them
+            fs::path BVH_path = (base_path / group_filename).replace_extension(".bvh");
+            group->save_BVHs(BVH_path.generic_string());
+        }
         // record other attributes in json
         json group_metadata = group->dump_metadata();
         metadata["groups"].push_back({
@@ -385,8 +405,8 @@ void Scene::render(const Shader& shader, WorkingMode mode)
     if (mode != WorkingMode::MODEL && halfedge_mesh) {
         logger->info("the halfedge mesh is destructed.");
         halfedge_mesh.reset(nullptr);
-        logger->info("re-build BVH for the edited object");
-        selected_object->rebuild_BVH();
+        const bool rebuilt = selected_object->update_BVH();
+        logger->info("{} BVH for the edited object", rebuilt ? "re-build" : "refit");
         logger->info(
             "The BVH structure of {} (ID: {}) has {} boxes", selected_object->name,
             selected_object->id, selected_object->bvh->count_nodes(selected_object->bvh->root)
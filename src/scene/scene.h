@@ -1,6 +1,7 @@
 #ifndef DANDELION_SCENE_SCENE_H
 #define DANDELION_SCENE_SCENE_H
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <vector>
@@ -68,6 +69,18 @@ public:
      * \returns 加载是否成功
      */
     bool import_model(const std::string& file_path);
+    /*!
+     * \~chinese
+     * \brief 从指定路径导入一个大模型文件，简化后作为一个组加入场景。
+     *
+     * 与 `import_model` 不同，模型文件不会被整体载入内存，而是由 `Group::load_simplified_model`
+     * 流式读取并用顶点聚类简化。
+     *
+     * \param file_path 要导入的 obj 或 stl 文件路径
+     * \param resolution 聚类网格在包围盒最长边方向上的单元数
+     * \returns 加载是否成功
+     */
+    bool import_simplified_model(const std::string& file_path, std::size_t resolution = 256);
     /*!
      * \~chinese
      * \brief 保存所有场景数据到指定的目录中。
@@ -374,8 +374,10 @@ void Controller::render_debug_helpers(const Shader& shader)
     if (debug_options.show_BVH) {
         for (auto& group: scene->groups) {
             for (auto& object: group->objects) {
-                shader.set_uniform("model", object->model());
-                object->BVH_boxes.render(shader);
+                // Only the selected object can be narrowed down to a subtree.
+                const bool       selected = object.get() == scene->selected_object;
+                std::string_view subtree  = selected ? debug_options.BVH_subtree : "";
+                object->render_BVH(shader, debug_options.BVH_depth, subtree);
             }
         }
     }
@@ -481,8 +483,9 @@ void Controller::select_object(Object* object)
 
 void Controller::select_halfedge(const Halfedge* halfedge)
 {
-    selected_element = halfedge;
-    auto [from, to]  = HalfedgeMesh::halfedge_arrow_endpoints(halfedge);
+    selected_element                           = halfedge;
+    scene->halfedge_mesh->inconsistent_element = halfedge;
+    auto [from, to]                            = HalfedgeMesh::halfedge_arrow_endpoints(halfedge);
     highlighted_halfedge.add_arrow(from, to);
     highlighted_halfedge.to_gpu();
 }
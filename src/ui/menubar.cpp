@@ -27,7 +27,7 @@ const char* usage_title               = "Usage";
 const char* about_title               = "About Us";
 const char* debug_options_panel_title = "Debug Options";
 
-DebugOptions::DebugOptions() : show_picking_ray(false), show_BVH(false)
+DebugOptions::DebugOptions() : show_picking_ray(false), show_BVH(false), BVH_depth(8)
 {
 }
 
@@ -67,6 +67,14 @@ void Menubar::render(Scene& scene)
                     scene.import_model(result[0].c_str());
                 }
             }
+            if (ImGui::MenuItem("Import Large File as a Simplified Group")) {
+                pfd::open_file file_dialog =
+                    pfd::open_file("Choose a file", ".", {"Triangle Mesh", "*.obj *.stl"});
+                vector<string> result = file_dialog.result();
+                if (!result.empty()) {
+                    scene.import_simplified_model(result[0].c_str());
+                }
+            }
             ImGui::Separator();
             if (ImGui::MenuItem("New Scene")) {
                 pfd::button button =
@@ -216,6 +224,24 @@ void Menubar::debug_options_panel()
         ImGui::SetWindowSize(ImVec2(px(300.0f), px(200.0f)));
         ImGui::Checkbox("Show Picking Ray", &debug_options.show_picking_ray);
         ImGui::Checkbox("Show BVH", &debug_options.show_BVH);
+        ImGui::SliderInt("BVH Depth", &debug_options.BVH_depth, 1, 24);
+        std::string& subtree = debug_options.BVH_subtree;
+        ImGui::Text("BVH Subtree: root%s", subtree.c_str());
+        if (ImGui::Button("Root")) {
+            subtree.clear();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Parent") && !subtree.empty()) {
+            subtree.pop_back();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Left")) {
+            subtree.push_back('L');
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Right")) {
+            subtree.push_back('R');
+        }
         ImGui::EndPopup();
     }
 }
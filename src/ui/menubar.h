@@ -2,6 +2,7 @@
 #define DANDELION_UI_MENUBAR_H
 
 #include <functional>
+#include <string>
 
 #include "../scene/scene.h"
 
@@ -25,6 +26,15 @@ struct DebugOptions
     bool show_picking_ray;
     /*! \~chinese 显示所有物体的 BVH 结构。 */
     bool show_BVH;
+    /*! \~chinese 显示 BVH 结构时绘制的最大层数，避免节点过多时生成大量线框。 */
+    int BVH_depth;
+    /*!
+     * \~chinese
+     * \brief 选中物体的 BVH 只显示这个路径指向的子树。
+     *
+     * 路径由 `L` (左子节点) 和 `R` (右子节点) 组成，为空表示整个 BVH 。
+     */
+    std::string BVH_subtree;
 };
 
 /*!
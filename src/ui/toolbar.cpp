@@ -1,9 +1,11 @@
 #include "toolbar.h"
 
+#include <algorithm>
 #include <cmath>
 #include <cstdio>
 #include <limits>
 #include <string>
+#include <vector>
 #include <variant>
 #include <optional>
 #include <filesystem>
@@ -47,7 +49,8 @@ constexpr float SCALING_UNIT  = 0.1f;
 constexpr float PHYSICS_UNIT  = 0.01f;
 
 Toolbar::Toolbar(WorkingMode& mode, const SelectableType& selected_element) :
-    mode(mode), selected_element(selected_element)
+    mode(mode), selected_element(selected_element), BVH_stats_object_id(0),
+    position_drag_active(false)
 {
     mode = WorkingMode::LAYOUT;
     glGenTextures(1, &gl_rendered_texture);
@@ -129,6 +132,42 @@ void Toolbar::xyz_drag(float* x, float* y, float* z, float v_speed, const char*
     ImGui::PopItemWidth();
 }
 
+void Toolbar::begin_position_drag(HalfedgeMesh& mesh, const std::vector<Vertex*>& vertices)
+{
+    // A drag whose widget disappeared before it was released is still open.
+    end_position_drag(mesh);
+    mesh.begin_edit();
+    for (Vertex* v: vertices) {
+        mesh.record_position(v);
+    }
+    position_drag_active = true;
+}
+
+void Toolbar::end_position_drag(HalfedgeMesh& mesh)
+{
+    if (!position_drag_active) {
+        return;
+    }
+    mesh.end_edit();
+    position_drag_active = false;
+}
+
+bool Toolbar::end_local_edit(HalfedgeMesh& mesh, optional<HalfedgeMeshFailure> failure)
+{
+    if (!failure.has_value()) {
+        mesh.end_edit();
+        return true;
+    }
+    on_selection_canceled();
+    if (mesh.cancel_edit()) {
+        spdlog::error("the local operation breaks the halfedge mesh and has been reverted");
+    } else {
+        mesh.end_edit();
+        spdlog::error("the local operation breaks the halfedge mesh and cannot be reverted");
+    }
+    return false;
+}
+
 void Toolbar::material_editor(GL::Material& material)
 {
     static constexpr ImGuiColorEditFlags flags = ImGuiColorEditFlags_NoInputs;
@@ -151,6 +190,39 @@ void Toolbar::material_editor(GL::Material& material)
     }
 }
 
+void Toolbar::BVH_statistics(Object& object)
+{
+    ImGui::SeparatorText("BVH");
+    if (BVH_stats.has_value() && BVH_stats_object_id != object.id) {
+        BVH_stats.reset();
+    }
+    if (ImGui::Button("Analyze")) {
+        BVH_stats           = compute_BVH_stats(*object.bvh);
+        BVH_stats_object_id = object.id;
+    }
+    ImGui::SameLine();
+    ImGui::Text("built in %.3f ms", object.BVH_build_time * 1000.0f);
+    if (!BVH_stats.has_value()) {
+        return;
+    }
+    const BVHStats& stats = BVH_stats.value();
+    ImGui::Text(
+        "%zu nodes, %zu leaves, max depth %zu", stats.n_nodes, stats.n_leaves, stats.max_depth
+    );
+    ImGui::Text("SAH cost: %.3f", stats.sah_cost);
+    // ImGui only plots float arrays
+    std::vector<float> depths(stats.depth_histogram.begin(), stats.depth_histogram.end());
+    std::vector<float> ratios(stats.area_ratio_histogram.begin(), stats.area_ratio_histogram.end());
+    ImGui::PlotHistogram(
+        "Leaf Depth", depths.data(), static_cast<int>(depths.size()), 0, nullptr, 0.0f, FLOAT_INF,
+        ImVec2(0.0f, 60.0f)
+    );
+    ImGui::PlotHistogram(
+        "Area Ratio", ratios.data(), static_cast<int>(ratios.size()), 0, "child / parent, 0 to 1",
+        0.0f, FLOAT_INF, ImVec2(0.0f, 60.0f)
+    );
+}
+
 void Toolbar::layout_mode(Scene& scene)
 {
     if (ImGui::BeginTabItem("Layout")) {
@@ -199,6 +271,7 @@ void Toolbar::layout_mode(Scene& scene)
             selected_object->rotation = AngleAxisf(radians(x_angle), Vector3f::UnitX())
                                       * AngleAxisf(radians(y_angle), Vector3f::UnitY())
                                       * AngleAxisf(radians(z_angle), Vector3f::UnitZ());
+            BVH_statistics(*selected_object);
         }
         ImGui::EndTabItem();
     }
@@ -259,14 +332,26 @@ void Toolbar::model_mode(Scene& scene)
         } else if (holds_alternative<Vertex*>(selected_element)) {
             Vertex* v = std::get<Vertex*>(selected_element);
             ImGui::Text("Vertex (ID: %zu)", v->id);
-            Vector3f& position = v->pos;
+            // Drag a copy so that the old position can be recorded before it is overwritten.
+            Vector3f position = v->pos;
             if (ImGui::Button("Halfedge")) {
                 on_element_selected(v->halfedge);
             }
             ImGui::Text("Position");
             ImGui::PushID("Selected Vertex##");
+            // the group is active while any of the three fields is being dragged
+            ImGui::BeginGroup();
             xyz_drag(&position.x(), &position.y(), &position.z(), POSITION_UNIT);
+            ImGui::EndGroup();
+            if (ImGui::IsItemActivated()) {
+                begin_position_drag(*scene.halfedge_mesh, {v});
+            }
+            const bool drag_deactivated = ImGui::IsItemDeactivated();
             ImGui::PopID();
+            v->pos = position;
+            if (drag_deactivated) {
+                end_position_drag(*scene.halfedge_mesh);
+            }
         } else if (holds_alternative<Edge*>(selected_element)) {
             Edge* e = std::get<Edge*>(selected_element);
             ImGui::Text("Edge (ID: %zu)", e->id);
@@ -275,43 +360,78 @@ void Toolbar::model_mode(Scene& scene)
                 on_element_selected(e->halfedge);
             }
             if (ImGui::Button("Flip")) {
+                scene.halfedge_mesh->begin_edit();
+                scene.halfedge_mesh->record_around(e);
                 optional<Edge*> result = scene.halfedge_mesh->flip_edge(e);
                 if (result.has_value()) {
                     scene.halfedge_mesh->global_inconsistent = true;
+                    end_local_edit(
+                        *scene.halfedge_mesh, scene.halfedge_mesh->validate_around(result.value())
+                    );
+                } else {
+                    scene.halfedge_mesh->end_edit();
                 }
             }
             ImGui::SameLine();
             if (ImGui::Button("Split")) {
                 on_selection_canceled();
+                scene.halfedge_mesh->begin_edit();
+                scene.halfedge_mesh->record_around(e);
                 optional<Vertex*> result = scene.halfedge_mesh->split_edge(e);
                 if (result.has_value()) {
                     scene.halfedge_mesh->global_inconsistent = true;
-                    on_element_selected(result.value());
+                    if (end_local_edit(
+                            *scene.halfedge_mesh,
+                            scene.halfedge_mesh->validate_around(result.value())
+                        )) {
+                        on_element_selected(result.value());
+                    }
+                } else {
+                    scene.halfedge_mesh->end_edit();
                 }
             }
             ImGui::SameLine();
             if (ImGui::Button("Collapse")) {
                 on_selection_canceled();
+                scene.halfedge_mesh->begin_edit();
+                scene.halfedge_mesh->record_around(e);
                 optional<Vertex*> result = scene.halfedge_mesh->collapse_edge(e);
                 if (result.has_value()) {
                     scene.halfedge_mesh->global_inconsistent = true;
-                    on_element_selected(result.value());
+                    if (end_local_edit(
+                            *scene.halfedge_mesh,
+                            scene.halfedge_mesh->validate_around(result.value())
+                        )) {
+                        on_element_selected(result.value());
+                    }
+                } else {
+                    scene.halfedge_mesh->end_edit();
                 }
             }
             ImGui::Text("Position");
             ImGui::PushID("Selected Edge##");
+            ImGui::BeginGroup();
             xyz_drag(&center.x(), &center.y(), &center.z(), POSITION_UNIT);
+            ImGui::EndGroup();
+            const bool drag_activated   = ImGui::IsItemActivated();
+            const bool drag_deactivated = ImGui::IsItemDeactivated();
             ImGui::PopID();
             // Only sync the positions of endpoints if no local operation has been performed.
             // Because an local operation makes the halfedge mesh and the mesh inconsistent,
             // and no modification should take place at the inconsistent state.
             if (!scene.halfedge_mesh->global_inconsistent) {
+                Vertex* v1 = e->halfedge->from;
+                Vertex* v2 = e->halfedge->inv->from;
+                if (drag_activated) {
+                    begin_position_drag(*scene.halfedge_mesh, {v1, v2});
+                }
                 Vector3f delta = center - e->center();
-                Vertex*  v1    = e->halfedge->from;
-                Vertex*  v2    = e->halfedge->inv->from;
                 v1->pos += delta;
                 v2->pos += delta;
             }
+            if (drag_deactivated) {
+                end_position_drag(*scene.halfedge_mesh);
+            }
         } else if (holds_alternative<Face*>(selected_element)) {
             Face* f = std::get<Face*>(selected_element);
             ImGui::Text("Face (ID: %zu)", f->id);
@@ -321,34 +441,125 @@ void Toolbar::model_mode(Scene& scene)
             }
             ImGui::Text("Position");
             ImGui::PushID("Selected Face##");
-            xyz_drag(&center.x(), &center.y(), &center.z(), POSITION_UNIT);
-            ImGui::PopID();
-            Vector3f  delta = center - f->center();
-            Halfedge* h     = f->halfedge;
+            std::vector<Vertex*> face_vertices;
+            Halfedge*            h = f->halfedge;
             do {
-                h->from->pos += delta;
+                face_vertices.push_back(h->from);
                 h = h->next;
             } while (h != f->halfedge);
+            ImGui::BeginGroup();
+            xyz_drag(&center.x(), &center.y(), &center.z(), POSITION_UNIT);
+            ImGui::EndGroup();
+            if (ImGui::IsItemActivated()) {
+                begin_position_drag(*scene.halfedge_mesh, face_vertices);
+            }
+            const bool drag_deactivated = ImGui::IsItemDeactivated();
+            ImGui::PopID();
+            Vector3f delta = center - f->center();
+            for (Vertex* v: face_vertices) {
+                v->pos += delta;
+            }
+            if (drag_deactivated) {
+                end_position_drag(*scene.halfedge_mesh);
+            }
         }
 
         ImGui::SeparatorText("Global Operations");
+        // 0 stands for the default budget (a quarter of the faces) and no error bound
+        static int   simplify_target_faces = 0;
+        static float simplify_max_error    = 0.0f;
+        // Global operations record the elements they touch themselves.
         if (ImGui::Button("Loop Subdivide")) {
+            scene.halfedge_mesh->begin_edit();
             scene.halfedge_mesh->loop_subdivide();
+            scene.halfedge_mesh->end_edit();
         }
         ImGui::SameLine();
         if (ImGui::Button("Simplify")) {
+            scene.halfedge_mesh->begin_edit();
             scene.halfedge_mesh->simplify();
+            scene.halfedge_mesh->end_edit();
         }
         ImGui::SameLine();
         if (ImGui::Button("Isotropic Remesh")) {
+            scene.halfedge_mesh->begin_edit();
             scene.halfedge_mesh->isotropic_remesh();
+            scene.halfedge_mesh->end_edit();
+        }
+        static int subdivision_levels = 1;
+        // Parallel operations rebuild the whole halfedge mesh, so nothing can stay selected.
+        if (ImGui::Button("Parallel Loop Subdivide")) {
+            on_selection_canceled();
+            scene.halfedge_mesh->begin_edit();
+            scene.halfedge_mesh->parallel_loop_subdivide(
+                static_cast<std::size_t>(subdivision_levels)
+            );
+            scene.halfedge_mesh->end_edit();
+        }
+        ImGui::SameLine();
+        ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+        ImGui::InputInt("Levels", &subdivision_levels);
+        subdivision_levels = std::clamp(subdivision_levels, 1, 4);
+        // Collapsing edges may erase the selected element.
+        if (ImGui::Button("Heap Simplify")) {
+            on_selection_canceled();
+            scene.halfedge_mesh->begin_edit();
+            scene.halfedge_mesh->heap_simplify(
+                static_cast<std::size_t>(simplify_target_faces),
+                simplify_max_error > 0.0f ? simplify_max_error
+                                          : std::numeric_limits<float>::infinity()
+            );
+            scene.halfedge_mesh->end_edit();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Parallel Simplify")) {
+            on_selection_canceled();
+            scene.halfedge_mesh->begin_edit();
+            scene.halfedge_mesh->parallel_simplify(
+                static_cast<std::size_t>(simplify_target_faces),
+                simplify_max_error > 0.0f ? simplify_max_error
+                                          : std::numeric_limits<float>::infinity()
+            );
+            scene.halfedge_mesh->end_edit();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Parallel Isotropic Remesh")) {
+            on_selection_canceled();
+            scene.halfedge_mesh->begin_edit();
+            scene.halfedge_mesh->parallel_isotropic_remesh();
+            scene.halfedge_mesh->end_edit();
+        }
+        ImGui::InputInt("Target Faces", &simplify_target_faces);
+        simplify_target_faces = std::max(simplify_target_faces, 0);
+        ImGui::InputFloat("Max Error", &simplify_max_error, 0.0f, 0.0f, "%.3e");
+        simplify_max_error = std::max(simplify_max_error, 0.0f);
+        // the order must match ValidationLevel
+        static const char* validation_level_names[] = {"Full", "Local", "Off"};
+        int validation_level_index = static_cast<int>(HalfedgeMesh::validation_level);
+        if (ImGui::Combo("Validation", &validation_level_index, validation_level_names, 3)) {
+            HalfedgeMesh::validation_level = static_cast<ValidationLevel>(validation_level_index);
+        }
+
+        ImGui::SeparatorText("History");
+        // Undoing may erase the selected element.
+        if (ImGui::Button("Undo") && scene.halfedge_mesh->can_undo()) {
+            on_selection_canceled();
+            scene.halfedge_mesh->undo();
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Redo") && scene.halfedge_mesh->can_redo()) {
+            on_selection_canceled();
+            scene.halfedge_mesh->redo();
         }
 
         ImGui::EndTabItem();
     }
 }
 
-const char* renderer_names[] = {"Rasterizer Renderer", "Whitted-Style Ray-Tracer"};
+const char* renderer_names[] = {
+    "Rasterizer Renderer", "Whitted-Style Ray-Tracer", "Progressive Path Tracer",
+    "Hybrid Ray-Tracer"
+};
 
 void Toolbar::render_mode(Scene& scene)
 {
@@ -365,19 +576,109 @@ void Toolbar::render_mode(Scene& scene)
         static bool         rendering_ready  = false;
         static int          renderer_index   = 0;
         static RendererType current_renderer = RendererType::RASTERIZER;
+        // the path tracer keeps refining the image until it is paused or reaches max_samples
+        static bool path_tracing_paused = false;
+        static int  max_samples         = 256;
 
-        ImGui::Combo("Renderer", &renderer_index, renderer_names, 2);
+        ImGui::Combo("Renderer", &renderer_index, renderer_names, 4);
         switch (renderer_index) {
         case 0: current_renderer = RendererType::RASTERIZER; break;
         case 1: current_renderer = RendererType::WHITTED_STYLE; break;
+        case 2: current_renderer = RendererType::PATH_TRACING; break;
+        case 3: current_renderer = RendererType::HYBRID; break;
         default: break;
         }
-        if (current_renderer == RendererType::RASTERIZER) {
+        if (current_renderer == RendererType::RASTERIZER
+            || current_renderer == RendererType::PATH_TRACING
+            || current_renderer == RendererType::HYBRID) {
             ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
             ImGui::InputInt("Number of Threads", &render_engine.n_threads);
         }
+        if (current_renderer == RendererType::RASTERIZER) {
+            ImGui::Checkbox(
+                "Tiled Light Culling", &render_engine.rasterizer_render->tiled_light_culling
+            );
+            if (render_engine.rasterizer_render->tiled_light_culling) {
+                ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+                ImGui::InputFloat(
+                    "Light Cutoff", &render_engine.rasterizer_render->light_cutoff, 0.0001f,
+                    0.001f, "%.4f"
+                );
+                render_engine.rasterizer_render->light_cutoff =
+                    std::max(render_engine.rasterizer_render->light_cutoff, 0.0f);
+            }
+        }
         if (current_renderer == RendererType::WHITTED_STYLE) {
             ImGui::Checkbox("Use BVH for Acceleration", &render_engine.whitted_render->use_bvh);
+            ImGui::Checkbox(
+                "Adaptive Supersampling", &render_engine.whitted_render->adaptive_sampling
+            );
+            ImGui::Checkbox(
+                "Incremental Re-rendering", &render_engine.whitted_render->incremental
+            );
+            if (render_engine.whitted_render->adaptive_sampling) {
+                ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+                ImGui::SliderFloat(
+                    "Color Threshold", &render_engine.whitted_render->adaptive_threshold, 0.01f,
+                    0.5f, "%.2f", ImGuiSliderFlags_AlwaysClamp
+                );
+            }
+        }
+        if (current_renderer == RendererType::HYBRID) {
+            // secondary rays are traced by the Whitted renderer and share its settings
+            ImGui::Checkbox("Use BVH for Acceleration", &render_engine.whitted_render->use_bvh);
+        }
+        if (current_renderer == RendererType::WHITTED_STYLE
+            || current_renderer == RendererType::HYBRID) {
+            // the BVH library does not count nodes, so the renderer replays the traversal
+            ImGui::Checkbox("Count BVH Traversal", &render_engine.whitted_render->count_traversal);
+            const TraversalCounters& counters =
+                current_renderer == RendererType::HYBRID
+                    ? render_engine.hybrid_render->traversal_counters
+                    : render_engine.whitted_render->traversal_counters;
+            if (counters.rays > 0 && counters.visited_nodes == 0) {
+                ImGui::Text("%llu rays", static_cast<unsigned long long>(counters.rays));
+            } else if (counters.rays > 0) {
+                const double rays = static_cast<double>(counters.rays);
+                ImGui::Text(
+                    "Per ray: %.1f nodes, %.1f triangle tests, %.2f hits",
+                    counters.visited_nodes / rays, counters.triangle_tests / rays,
+                    counters.triangle_hits / rays
+                );
+            }
+        }
+        if (current_renderer == RendererType::PATH_TRACING) {
+            ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+            ImGui::InputInt("Max Samples", &max_samples);
+            max_samples = std::max(max_samples, 1);
+            // the order must match SamplerType
+            static const char* sampler_names[] = {
+                "Independent", "Owen-Scrambled Sobol", "Blue Noise"
+            };
+            int sampler_index = static_cast<int>(render_engine.path_tracing_render->sampler_type);
+            ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+            if (ImGui::Combo("Sampler", &sampler_index, sampler_names, 3)) {
+                render_engine.path_tracing_render->sampler_type =
+                    static_cast<SamplerType>(sampler_index);
+            }
+            ImGui::Checkbox(
+                "Wavefront Scheduling", &render_engine.path_tracing_render->wavefront
+            );
+            ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+            ImGui::InputInt("Light Samples", &render_engine.path_tracing_render->light_samples);
+            if (ImGui::IsItemHovered()) {
+                ImGui::SetTooltip("0 evaluates every light that is not culled");
+            }
+            render_engine.path_tracing_render->light_samples =
+                std::max(render_engine.path_tracing_render->light_samples, 0);
+            ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+            ImGui::InputFloat(
+                "Light Cull Threshold", &render_engine.path_tracing_render->light_cull_threshold,
+                0.0001f, 0.001f, "%.4f"
+            );
+            render_engine.path_tracing_render->light_cull_threshold =
+                std::max(render_engine.path_tracing_render->light_cull_threshold, 0.0f);
+            ImGui::Checkbox("Denoise", &render_engine.denoise);
         }
         ImGui::ColorEdit3(
             "Background Color", RenderEngine::background_color.data(), ImGuiColorEditFlags_NoInputs
@@ -388,6 +689,25 @@ void Toolbar::render_mode(Scene& scene)
             rendering_ready     = false;
         }
 
+        ImGui::SeparatorText("Baked Lighting");
+        ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+        ImGui::InputInt("Rays per Vertex", &render_engine.light_baker.n_samples);
+        render_engine.light_baker.n_samples = std::max(render_engine.light_baker.n_samples, 1);
+        ImGui::SetNextItemWidth(0.5f * ImGui::CalcItemWidth());
+        ImGui::InputFloat(
+            "AO Distance", &render_engine.light_baker.ao_distance, 0.1f, 1.0f, "%.2f"
+        );
+        render_engine.light_baker.ao_distance =
+            std::max(render_engine.light_baker.ao_distance, 0.0f);
+        render_engine.light_baker.n_threads = render_engine.n_threads;
+        if (ImGui::Button("Bake")) {
+            render_engine.light_baker.bake(scene);
+        }
+        ImGui::SameLine();
+        if (ImGui::Button("Clear Bake")) {
+            render_engine.light_baker.clear(scene);
+        }
+
         ImGui::SeparatorText("Lights");
         Light* const* result         = get_if<Light*>(&selected_element);
         Light*        selected_light = result != nullptr ? *result : nullptr;
@@ -472,7 +792,18 @@ void Toolbar::render_mode(Scene& scene)
             const ImVec2    image_size(image_width, image_width / scene.camera.aspect_ratio);
             render_engine.width  = std::floor(image_size.x);
             render_engine.height = std::floor(image_size.y);
-            if (!rendering_ready) {
+            bool render_pass = !rendering_ready;
+            if (current_renderer == RendererType::PATH_TRACING) {
+                PathTracingRenderer& path_tracer = *render_engine.path_tracing_render;
+                if (!rendering_ready) {
+                    path_tracer.reset();
+                    path_tracing_paused = false;
+                }
+                render_pass = render_pass
+                           || (!path_tracing_paused
+                               && path_tracer.n_samples < static_cast<unsigned int>(max_samples));
+            }
+            if (render_pass) {
                 render_engine.render(scene, current_renderer);
                 glBindTexture(GL_TEXTURE_2D, gl_rendered_texture);
                 glTexImage2D(
@@ -509,6 +840,16 @@ void Toolbar::render_mode(Scene& scene)
                     spdlog::info("rendered image saved to {}", target_file);
                 }
             }
+            if (current_renderer == RendererType::PATH_TRACING) {
+                ImGui::SameLine();
+                if (ImGui::Button(path_tracing_paused ? "Continue" : "Stop")) {
+                    path_tracing_paused = !path_tracing_paused;
+                }
+                ImGui::SameLine();
+                ImGui::Text(
+                    "%u / %d samples", render_engine.path_tracing_render->n_samples, max_samples
+                );
+            }
             ImGui::EndPopup();
         }
 
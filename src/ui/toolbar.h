@@ -4,10 +4,12 @@
 #include <cstddef>
 #include <optional>
 #include <functional>
+#include <vector>
 
 #include "selection_helper.h"
 #include "../scene/scene.h"
 #include "../utils/rendering.hpp"
+#include "../utils/bvh_stats.h"
 
 /*!
  * \file ui/toolbar.h
@@ -59,8 +61,35 @@ private:
     void scene_hierarchies(Scene& scene);
     /*! \~chinese 显示标签分别为 x, y, z 的三个 `ImGui::DragFloat` 控件。 */
     void xyz_drag(float* x, float* y, float* z, float v_speed, const char* format = "%.2f");
+    /*!
+     * \~chinese
+     * \brief 在拖动半边网格元素位置的控件刚被激活时调用，开始把这次拖动记录为一次编辑操作。
+     *
+     * 一次拖动持续很多帧，只在拖动开始的那一帧保存 `vertices` 的当前状态，
+     * 使整个拖动成为一条撤销记录。
+     */
+    void begin_position_drag(HalfedgeMesh& mesh, const std::vector<Vertex*>& vertices);
+    /*!
+     * \~chinese
+     * \brief 在控件结束激活的那一帧修改完顶点坐标之后调用，结束这次拖动的记录。
+     *
+     * 没有移动任何顶点的拖动不会留下记录。
+     */
+    void end_position_drag(HalfedgeMesh& mesh);
+    /*!
+     * \~chinese
+     * \brief 在局部操作成功执行之后调用，根据检查结果结束这次操作的记录。
+     *
+     * 检查通过时正常结束记录；否则取消选中，并用 `HalfedgeMesh::cancel_edit` 撤销这次操作，
+     * 不记录时无法撤销，只输出错误。
+     * \param failure 局部操作之后 `HalfedgeMesh::validate_around` 的返回值
+     * \returns 操作是否被保留
+     */
+    bool end_local_edit(HalfedgeMesh& mesh, std::optional<HalfedgeMeshFailure> failure);
     /*! \~chinese 显示并编辑单个物体的材质属性。 */
     void material_editor(GL::Material& material);
+    /*! \~chinese 显示单个物体 BVH 的结构统计信息，统计在点击按钮时才计算。 */
+    void BVH_statistics(Object& object);
     /*! \~chinese 布局模式对应的标签页。 */
     void layout_mode(Scene& scene);
     /*! \~chinese 建模模式对应的标签页。 */
@@ -76,6 +105,12 @@ private:
     const SelectableType& selected_element;
     /*! \~chinese 用于在渲染模式下展示渲染结果的 OpenGL 纹理描述符。 */
     unsigned int gl_rendered_texture;
+    /*! \~chinese 最近一次统计的 BVH 信息，切换物体后失效。 */
+    std::optional<BVHStats> BVH_stats;
+    /*! \~chinese `BVH_stats` 对应物体的 ID 。 */
+    std::size_t BVH_stats_object_id;
+    /*! \~chinese 是否正在拖动半边网格元素的位置，此时拖动开始时的记录仍未结束。 */
+    bool position_drag_active;
 };
 
 } // namespace UI
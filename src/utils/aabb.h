@@ -68,6 +68,16 @@ AABB union_AABB(const AABB& b1, const AABB& b2);
  */
 AABB union_AABB(const AABB& b, const Eigen::Vector3f& p);
 
+/*!
+ * \~chinese
+ * \brief AABB 的表面积，SAH 代价和 BVH 质量统计都以它为权重。
+ */
+inline float surface_area(const AABB& box)
+{
+    const Eigen::Vector3f d = box.diagonal();
+    return 2.0f * (d.x() * d.y() + d.y() * d.z() + d.z() * d.x());
+}
+
 /*!
  * \~chinese
  * \brief BVH加速求交的函数调用接口
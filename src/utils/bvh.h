@@ -64,6 +64,45 @@ public:
     /*! \~chinese 建立整个object的bvh的函数调用接口 */
     void build();
 
+    /*!
+     * \~chinese
+     * \brief 并行建立 LBVH (Linear BVH) 的函数调用接口
+     *
+     * 先计算所有面片重心的 30 位 Morton 码并做并行基数排序，再按 Karras (2012)
+     * 的方法并行生成二叉基数树 (binary radix tree)，最后自底向上合并包围盒。
+     * 得到的树与 `build` 的结果形式相同（每个叶节点恰好覆盖一个面片），
+     * 同样用 `recursively_delete` 删除。`primitives` 会被设为排序后的面片顺序。
+     *
+     * 这个函数不调用任何 OpenGL API，可以在工作线程中执行。
+     *
+     * \param n_threads 使用的线程数，为 0 时使用硬件线程数
+     * \param refine_depth 用树旋转按表面积启发式 (SAH) 优化的顶部层数，为 0 时不优化
+     */
+    void parallel_build(unsigned int n_threads = 0, int refine_depth = 8);
+
+    /*! \~chinese 面片数不少于这个值时，`Object::build_BVH` 改用 `parallel_build` 建立 BVH */
+    static constexpr std::size_t parallel_build_threshold = 1 << 16;
+
+    /*!
+     * \~chinese
+     * \brief 在树结构不变的前提下，自底向上重新计算所有节点的包围盒 (refit) 。
+     *
+     * 每个叶节点按自己的 `face_idx` 从 `mesh` 中重新读取面片的包围盒，内部节点取两个子节点
+     * 包围盒的并集。只要面片数量不变，即使顶点坐标或面片的顶点索引发生了变化，refit
+     * 之后的 BVH 仍然正确，只是划分质量可能下降，可以用 `sah_cost` 判断是否需要重建。
+     */
+    void refit();
+    /*!
+     * \~chinese
+     * \brief 按表面积启发式 (SAH) 估计当前 BVH 的求交代价。
+     *
+     * 代价为所有节点的表面积与根节点表面积之比的加权和，内部节点的权重是遍历代价
+     * `sah_traversal_cost` ，叶节点的权重是与一个面片求交的代价 1 。空树的代价为 0 。
+     */
+    float sah_cost() const;
+    /*! \~chinese 计算 SAH 代价时访问一个内部节点的代价（以一次面片求交的代价为单位）。 */
+    static constexpr float sah_traversal_cost = 1.0f;
+
     /*! \~chinese 删除建立的整个bvh */
     void recursively_delete(BVHNode* node);
 
@@ -0,0 +1,345 @@
+#include "bvh_cache.h"
+
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include <Eigen/Core>
+
+#ifdef _WIN32
+    // CMake only defines NOMINMAX for MSVC, but std::numeric_limits<T>::max must also survive
+    // the Windows headers on MinGW.
+    #ifndef NOMINMAX
+        #define NOMINMAX
+    #endif
+    #ifndef WIN32_LEAN_AND_MEAN
+        #define WIN32_LEAN_AND_MEAN
+    #endif
+    #include <Windows.h>
+#else
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #include <unistd.h>
+#endif
+
+using Eigen::Vector3f;
+using std::size_t;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+namespace {
+
+constexpr std::array<char, 8> magic      = {'D', 'D', 'L', 'N', 'B', 'V', 'H', '\0'};
+constexpr uint32_t            no_child   = std::numeric_limits<uint32_t>::max();
+constexpr uint64_t            fnv_offset = 0xcbf29ce484222325ULL;
+constexpr uint64_t            fnv_prime  = 0x100000001b3ULL;
+
+struct FileHeader
+{
+    std::array<char, 8> magic;
+    uint32_t            version;
+    uint32_t            n_records;
+};
+
+struct RecordHeader
+{
+    uint64_t hash;
+    uint64_t n_faces;
+    uint64_t n_primitives;
+    uint64_t n_nodes;
+    float    built_cost;
+    uint32_t reserved;
+};
+
+struct NodeRecord
+{
+    float    p_min[3];
+    float    p_max[3];
+    uint32_t left;
+    uint32_t right;
+    uint32_t face_idx;
+    uint32_t reserved;
+};
+
+static_assert(sizeof(FileHeader) == 16);
+static_assert(sizeof(RecordHeader) == 40);
+static_assert(sizeof(NodeRecord) == 40);
+
+// primitives 数组补齐到 8 字节之后的长度
+size_t primitives_bytes(uint64_t n_primitives)
+{
+    return static_cast<size_t>((n_primitives * sizeof(uint32_t) + 7) / 8 * 8);
+}
+
+uint64_t fnv1a(uint64_t hash, uint32_t value)
+{
+    for (int byte = 0; byte < 4; ++byte) {
+        hash ^= (value >> (8 * byte)) & 0xFFu;
+        hash *= fnv_prime;
+    }
+    return hash;
+}
+
+// 先序展开以 node 为根的子树，返回 node 在 records 中的下标
+uint32_t flatten(const BVHNode* node, vector<NodeRecord>& records)
+{
+    if (node == nullptr) {
+        return no_child;
+    }
+    const uint32_t index = static_cast<uint32_t>(records.size());
+    NodeRecord     record{};
+    for (int axis = 0; axis < 3; ++axis) {
+        record.p_min[axis] = node->aabb.p_min[axis];
+        record.p_max[axis] = node->aabb.p_max[axis];
+    }
+    record.face_idx = static_cast<uint32_t>(node->face_idx);
+    records.push_back(record);
+    const uint32_t left  = flatten(node->left, records);
+    const uint32_t right = flatten(node->right, records);
+    records[index].left  = left;
+    records[index].right = right;
+    return index;
+}
+
+} // namespace
+
+uint64_t topology_hash(const GL::Mesh& mesh)
+{
+    const vector<unsigned int>& faces   = mesh.faces.data;
+    const uint64_t              n_faces = mesh.faces.count();
+    uint64_t                    hash    = fnv_offset;
+    hash = fnv1a(hash, static_cast<uint32_t>(n_faces));
+    hash = fnv1a(hash, static_cast<uint32_t>(n_faces >> 32));
+    vector<uint32_t> canonical_ids(mesh.vertices.count(), no_child);
+    uint32_t         next_id = 0;
+    for (unsigned int vertex_id: faces) {
+        if (vertex_id >= canonical_ids.size()) {
+            hash = fnv1a(hash, no_child);
+            continue;
+        }
+        if (canonical_ids[vertex_id] == no_child) {
+            canonical_ids[vertex_id] = next_id;
+            ++next_id;
+        }
+        hash = fnv1a(hash, canonical_ids[vertex_id]);
+    }
+    return hash;
+}
+
+BVHCache::BVHCache(const std::string& file_path) :
+    data(nullptr), length(0), mapping_handle(nullptr)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(
+        file_path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL, nullptr
+    );
+    if (file == INVALID_HANDLE_VALUE) {
+        return;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+        CloseHandle(file);
+        return;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (mapping == nullptr) {
+        return;
+    }
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr) {
+        CloseHandle(mapping);
+        return;
+    }
+    mapping_handle = mapping;
+    data           = static_cast<const unsigned char*>(view);
+    length         = static_cast<size_t>(file_size.QuadPart);
+#else
+    int fd = open(file_path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return;
+    }
+    struct stat file_stat;
+    if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+        close(fd);
+        return;
+    }
+    const size_t file_size = static_cast<size_t>(file_stat.st_size);
+    void*        view      = mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        return;
+    }
+    data   = static_cast<const unsigned char*>(view);
+    length = file_size;
+#endif
+
+    // 检查文件头，并确认每条记录都完整地位于文件内
+    FileHeader header;
+    if (length < sizeof(FileHeader)) {
+        return;
+    }
+    std::memcpy(&header, data, sizeof(FileHeader));
+    if (header.magic != magic || header.version != version) {
+        return;
+    }
+    size_t offset = sizeof(FileHeader);
+    record_offsets.reserve(header.n_records);
+    for (uint32_t i = 0; i < header.n_records; ++i) {
+        RecordHeader record;
+        if (length - offset < sizeof(RecordHeader)) {
+            record_offsets.clear();
+            return;
+        }
+        std::memcpy(&record, data + offset, sizeof(RecordHeader));
+        const size_t remaining = length - offset - sizeof(RecordHeader);
+        if (record.n_primitives > remaining / sizeof(uint32_t)
+            || record.n_nodes > remaining / sizeof(NodeRecord)
+            || primitives_bytes(record.n_primitives) + record.n_nodes * sizeof(NodeRecord)
+                   > remaining) {
+            record_offsets.clear();
+            return;
+        }
+        record_offsets.push_back(offset);
+        offset += sizeof(RecordHeader) + primitives_bytes(record.n_primitives)
+                + static_cast<size_t>(record.n_nodes) * sizeof(NodeRecord);
+    }
+}
+
+BVHCache::~BVHCache()
+{
+    if (data == nullptr) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(data);
+    CloseHandle(static_cast<HANDLE>(mapping_handle));
+#else
+    munmap(const_cast<unsigned char*>(data), length);
+#endif
+}
+
+bool BVHCache::valid() const
+{
+    return data != nullptr && record_offsets.size() > 0;
+}
+
+size_t BVHCache::size() const
+{
+    return record_offsets.size();
+}
+
+bool BVHCache::restore(size_t index, BVH& bvh, float& built_cost) const
+{
+    if (index >= record_offsets.size()) {
+        return false;
+    }
+    const unsigned char* record_data = data + record_offsets[index];
+    RecordHeader         record;
+    std::memcpy(&record, record_data, sizeof(RecordHeader));
+    const size_t n_faces = bvh.mesh.faces.count();
+    if (record.n_nodes == 0 || record.n_faces != n_faces || record.n_primitives != n_faces
+        || record.hash != topology_hash(bvh.mesh)) {
+        return false;
+    }
+    const unsigned char* primitives_data = record_data + sizeof(RecordHeader);
+    const unsigned char* nodes_data      = primitives_data + primitives_bytes(record.n_primitives);
+    const size_t         n_nodes         = static_cast<size_t>(record.n_nodes);
+
+    // 先检查节点间的引用关系：子节点必须排在父节点之后，除根节点外的每个节点恰好被引用一次，
+    // 叶节点与图元列表中的面片序号都有效
+    vector<NodeRecord> nodes(n_nodes);
+    std::memcpy(nodes.data(), nodes_data, n_nodes * sizeof(NodeRecord));
+    vector<bool> referenced(n_nodes, false);
+    for (size_t i = 0; i < n_nodes; ++i) {
+        const NodeRecord& node = nodes[i];
+        for (uint32_t child: {node.left, node.right}) {
+            if (child == no_child) {
+                continue;
+            }
+            if (child <= i || child >= n_nodes || referenced[child]) {
+                return false;
+            }
+            referenced[child] = true;
+        }
+        if (node.left == no_child && node.right == no_child && node.face_idx >= n_faces) {
+            return false;
+        }
+    }
+    for (size_t i = 1; i < n_nodes; ++i) {
+        if (!referenced[i]) {
+            return false;
+        }
+    }
+    vector<uint32_t> primitives(static_cast<size_t>(record.n_primitives));
+    std::memcpy(primitives.data(), primitives_data, primitives.size() * sizeof(uint32_t));
+    for (uint32_t face_idx: primitives) {
+        if (face_idx >= n_faces) {
+            return false;
+        }
+    }
+
+    vector<BVHNode*> tree(n_nodes);
+    for (size_t i = 0; i < n_nodes; ++i) {
+        const NodeRecord& node = nodes[i];
+        tree[i]                = new BVHNode();
+        tree[i]->aabb.p_min    = Vector3f(node.p_min[0], node.p_min[1], node.p_min[2]);
+        tree[i]->aabb.p_max    = Vector3f(node.p_max[0], node.p_max[1], node.p_max[2]);
+        tree[i]->face_idx      = node.face_idx;
+    }
+    for (size_t i = 0; i < n_nodes; ++i) {
+        tree[i]->left  = nodes[i].left == no_child ? nullptr : tree[nodes[i].left];
+        tree[i]->right = nodes[i].right == no_child ? nullptr : tree[nodes[i].right];
+    }
+    bvh.primitives.assign(primitives.begin(), primitives.end());
+    bvh.root   = tree[0];
+    built_cost = record.built_cost;
+    return true;
+}
+
+bool BVHCache::write(const std::string& file_path, const vector<const BVH*>& bvhs)
+{
+    std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+    FileHeader header{magic, version, static_cast<uint32_t>(bvhs.size())};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(FileHeader));
+    for (const BVH* bvh: bvhs) {
+        const size_t       n_faces = bvh->mesh.faces.count();
+        vector<NodeRecord> nodes;
+        vector<uint32_t>   primitives;
+        // 面片数不一致说明 BVH 已经过时，只写出记录头
+        if (bvh->primitives.size() == n_faces) {
+            flatten(bvh->root, nodes);
+            primitives.assign(bvh->primitives.begin(), bvh->primitives.end());
+        }
+        RecordHeader record{};
+        record.hash         = topology_hash(bvh->mesh);
+        record.n_faces      = n_faces;
+        record.n_primitives = primitives.size();
+        record.n_nodes      = nodes.size();
+        record.built_cost   = bvh->sah_cost();
+        file.write(reinterpret_cast<const char*>(&record), sizeof(RecordHeader));
+        file.write(
+            reinterpret_cast<const char*>(primitives.data()),
+            static_cast<std::streamsize>(primitives.size() * sizeof(uint32_t))
+        );
+        const std::array<char, 8> padding{};
+        file.write(
+            padding.data(), static_cast<std::streamsize>(
+                                primitives_bytes(primitives.size())
+                                - primitives.size() * sizeof(uint32_t)
+                            )
+        );
+        file.write(
+            reinterpret_cast<const char*>(nodes.data()),
+            static_cast<std::streamsize>(nodes.size() * sizeof(NodeRecord))
+        );
+    }
+    return file.good();
+}
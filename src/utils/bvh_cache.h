@@ -0,0 +1,102 @@
+#ifndef DANDELION_UTILS_BVH_CACHE_H
+#define DANDELION_UTILS_BVH_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "../platform/gl.hpp"
+#include "bvh.h"
+
+/*!
+ * \file utils/bvh_cache.h
+ * \ingroup utils
+ * \~chinese
+ * \brief 将建好的 BVH 保存为二进制文件，并在加载场景时通过内存映射直接读取。
+ *
+ * 一个 BVH 缓存文件对应一个物体组的模型文件，按组内物体的顺序依次存放每个物体的 BVH 。
+ * 文件格式（所有数值均为小端序）：
+ * - 文件头：8 字节魔数 `DDLNBVH` 、`std::uint32_t` 格式版本号、`std::uint32_t` 记录数
+ * - 每条记录：拓扑哈希、面片数、图元数、节点数、保存时的 SAH 代价，之后是 `primitives`
+ *   （`std::uint32_t` 数组，补齐到 8 字节）和按先序排列的节点数组
+ */
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 计算 mesh 拓扑结构的哈希值，作为 BVH 缓存的键。
+ *
+ * 哈希值只与面片数以及每个面片的顶点连接关系有关：顶点按它们在面片数组中首次出现的顺序
+ * 重新编号后再参与计算。保存场景时写出的 obj 文件在重新导入后顶点顺序和坐标的末位都可能变化，
+ * 但面片顺序和连接关系不变，因此这个哈希值在保存、加载前后保持一致。
+ * 坐标的变化由加载后的 `BVH::refit` 处理。
+ */
+std::uint64_t topology_hash(const GL::Mesh& mesh);
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 以只读内存映射方式打开的 BVH 缓存文件。
+ *
+ * 构造时映射整个文件并检查文件头和所有记录的长度，任何一项不符都会使 `valid` 返回假，
+ * 此时调用者应当照常构建 BVH 。映射在对象析构时解除。
+ */
+class BVHCache
+{
+public:
+
+    /*! \~chinese 当前的文件格式版本号，格式发生不兼容的变化时需要增加。 */
+    static constexpr std::uint32_t version = 1;
+
+    /*! \~chinese 映射指定的缓存文件，文件不存在或格式不正确时得到一个无效的缓存。 */
+    BVHCache(const std::string& file_path);
+    BVHCache(const BVHCache& other)            = delete;
+    BVHCache& operator=(const BVHCache& other) = delete;
+    ~BVHCache();
+
+    /*! \~chinese 文件是否成功映射且格式正确。 */
+    bool valid() const;
+    /*! \~chinese 文件中的记录数，即保存时组内的物体数。 */
+    std::size_t size() const;
+    /*!
+     * \~chinese
+     * \brief 用第 `index` 条记录恢复 BVH 。
+     *
+     * 只有记录的拓扑哈希和面片数都与 `bvh.mesh` 一致时才会恢复，恢复前不会删除 `bvh`
+     * 中原有的节点。恢复出的包围盒来自保存时的坐标，调用者应当再调用一次 `BVH::refit` 。
+     * 这个函数不调用 OpenGL API ，可以在多个线程中同时恢复不同的记录。
+     *
+     * \param index 记录的序号
+     * \param bvh 要恢复的 BVH ，其 `mesh` 应当已经加载完成
+     * \param built_cost 返回保存时记录的 SAH 代价
+     * \returns 是否恢复成功
+     */
+    bool restore(std::size_t index, BVH& bvh, float& built_cost) const;
+
+    /*!
+     * \~chinese
+     * \brief 将一组 BVH 按顺序写入缓存文件。
+     *
+     * 如果某个 BVH 与它的 mesh 面片数不一致（例如在建模模式下编辑后尚未更新），
+     * 对应的记录不包含节点，加载时会重新构建。
+     *
+     * \param file_path 缓存文件路径
+     * \param bvhs 要保存的 BVH ，顺序与组内物体的顺序一致
+     * \returns 是否写入成功
+     */
+    static bool write(const std::string& file_path, const std::vector<const BVH*>& bvhs);
+
+private:
+
+    /*! \~chinese 映射得到的文件内容，映射失败时为空指针。 */
+    const unsigned char* data;
+    /*! \~chinese 文件长度（字节）。 */
+    std::size_t length;
+    /*! \~chinese Windows 下的文件映射对象句柄，其他平台不使用。 */
+    void* mapping_handle;
+    /*! \~chinese 各条记录在文件中的起始偏移量。 */
+    std::vector<std::size_t> record_offsets;
+};
+
+#endif // DANDELION_UTILS_BVH_CACHE_H
@@ -0,0 +1,63 @@
+#include "bvh.h"
+
+#include <Eigen/Core>
+
+// BVH 的增量更新 (refit) 与质量估计。这部分与 bvh.cpp 分开编译，不依赖 BVH::build 的实现。
+
+namespace {
+
+void refit_node(BVHNode* node, const GL::Mesh& mesh)
+{
+    if (node->left == nullptr && node->right == nullptr) {
+        node->aabb = get_aabb(mesh, node->face_idx);
+        return;
+    }
+    // 对 build 得到的树，内部节点总有两个子节点；这里仍然允许子节点为空
+    AABB aabb;
+    if (node->left != nullptr) {
+        refit_node(node->left, mesh);
+        aabb = union_AABB(aabb, node->left->aabb);
+    }
+    if (node->right != nullptr) {
+        refit_node(node->right, mesh);
+        aabb = union_AABB(aabb, node->right->aabb);
+    }
+    node->aabb = aabb;
+}
+
+// 返回以 node 为根的子树中所有节点加权表面积之和
+float weighted_area(const BVHNode* node)
+{
+    if (node == nullptr) {
+        return 0.0f;
+    }
+    const float area = surface_area(node->aabb);
+    if (node->left == nullptr && node->right == nullptr) {
+        return area;
+    }
+    return BVH::sah_traversal_cost * area + weighted_area(node->left)
+         + weighted_area(node->right);
+}
+
+} // namespace
+
+void BVH::refit()
+{
+    if (root == nullptr) {
+        return;
+    }
+    refit_node(root, mesh);
+}
+
+float BVH::sah_cost() const
+{
+    if (root == nullptr) {
+        return 0.0f;
+    }
+    const float root_area = surface_area(root->aabb);
+    // 所有面片退化到同一条线段或同一个点上时根节点表面积为 0 ，无法按面积比较
+    if (root_area <= 0.0f) {
+        return 0.0f;
+    }
+    return weighted_area(root) / root_area;
+}
@@ -0,0 +1,131 @@
+#include "bvh_stats.h"
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+using std::size_t;
+
+namespace {
+
+std::mutex        collected_counters_mutex;
+TraversalCounters collected_counters;
+
+void collect_node_stats(const BVHNode* node, size_t depth, BVHStats& stats)
+{
+    ++stats.n_nodes;
+    stats.max_depth = std::max(stats.max_depth, depth);
+    if (node->left == nullptr && node->right == nullptr) {
+        ++stats.n_leaves;
+        if (stats.depth_histogram.size() <= depth) {
+            stats.depth_histogram.resize(depth + 1, 0);
+        }
+        ++stats.depth_histogram[depth];
+        return;
+    }
+    const float parent_area = surface_area(node->aabb);
+    for (const BVHNode* child: {node->left, node->right}) {
+        if (child == nullptr) {
+            continue;
+        }
+        if (parent_area > 0.0f) {
+            const float ratio  = std::clamp(surface_area(child->aabb) / parent_area, 0.0f, 1.0f);
+            size_t      bucket = static_cast<size_t>(ratio * BVHStats::n_area_ratio_buckets);
+            bucket             = std::min(bucket, BVHStats::n_area_ratio_buckets - 1);
+            ++stats.area_ratio_histogram[bucket];
+        }
+        collect_node_stats(child, depth + 1, stats);
+    }
+}
+
+// 与参考实现的遍历顺序相同：先检查节点的包围盒，击中后叶节点与面片求交，内部节点访问两个子节点
+void count_node_traversal(
+    const BVH& bvh, const BVHNode* node, const Ray& ray, const Eigen::Vector3f& inv_dir,
+    const std::array<int, 3>& dir_is_neg, TraversalCounters& counters
+)
+{
+    ++counters.visited_nodes;
+    // AABB::intersect 不是 const 成员函数
+    AABB box = node->aabb;
+    if (!box.intersect(ray, inv_dir, dir_is_neg)) {
+        return;
+    }
+    if (node->left == nullptr && node->right == nullptr) {
+        ++counters.triangle_tests;
+        if (ray_triangle_intersect(ray, bvh.mesh, node->face_idx).has_value()) {
+            ++counters.triangle_hits;
+        }
+        return;
+    }
+    for (const BVHNode* child: {node->left, node->right}) {
+        if (child != nullptr) {
+            count_node_traversal(bvh, child, ray, inv_dir, dir_is_neg, counters);
+        }
+    }
+}
+
+} // namespace
+
+BVHStats compute_BVH_stats(const BVH& bvh)
+{
+    BVHStats stats;
+    stats.area_ratio_histogram.assign(BVHStats::n_area_ratio_buckets, 0);
+    if (bvh.root == nullptr) {
+        return stats;
+    }
+    collect_node_stats(bvh.root, 0, stats);
+    stats.sah_cost = bvh.sah_cost();
+    return stats;
+}
+
+TraversalCounters& TraversalCounters::operator+=(const TraversalCounters& other)
+{
+    rays += other.rays;
+    visited_nodes += other.visited_nodes;
+    triangle_tests += other.triangle_tests;
+    triangle_hits += other.triangle_hits;
+    return *this;
+}
+
+void reset_traversal_counters()
+{
+    std::lock_guard<std::mutex> lock(collected_counters_mutex);
+    collected_counters          = TraversalCounters();
+    thread_traversal_counters() = TraversalCounters();
+}
+
+void flush_traversal_counters()
+{
+    TraversalCounters&          local = thread_traversal_counters();
+    std::lock_guard<std::mutex> lock(collected_counters_mutex);
+    collected_counters += local;
+    local = TraversalCounters();
+}
+
+TraversalCounters collected_traversal_counters()
+{
+    std::lock_guard<std::mutex> lock(collected_counters_mutex);
+    return collected_counters;
+}
+
+void count_BVH_traversal(const BVH& bvh, const Ray& ray, const Eigen::Matrix4f& model)
+{
+    if (bvh.root == nullptr) {
+        return;
+    }
+    // 与 BVH 求交一样在模型坐标系中遍历
+    const Eigen::Matrix4f inv_model = model.inverse();
+    Ray                   local_ray;
+    local_ray.origin    = (inv_model * ray.origin.homogeneous()).head<3>();
+    local_ray.direction = inv_model.topLeftCorner<3, 3>() * ray.direction;
+    const Eigen::Vector3f    inv_dir    = local_ray.direction.cwiseInverse();
+    const std::array<int, 3> dir_is_neg = {
+        local_ray.direction.x() < 0.0f, local_ray.direction.y() < 0.0f,
+        local_ray.direction.z() < 0.0f
+    };
+    TraversalCounters& counters = thread_traversal_counters();
+    count_node_traversal(bvh, bvh.root, local_ray, inv_dir, dir_is_neg, counters);
+}
@@ -0,0 +1,126 @@
+#ifndef DANDELION_UTILS_BVH_STATS_H
+#define DANDELION_UTILS_BVH_STATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "bvh.h"
+
+/*!
+ * \file utils/bvh_stats.h
+ * \ingroup utils
+ * \~chinese
+ * \brief 统计 BVH 的结构质量和求交时的遍历开销，用于判断渲染慢是否因为 BVH 退化。
+ */
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 一棵 BVH 的结构统计信息。
+ */
+struct BVHStats
+{
+    /*! \~chinese 节点总数。 */
+    std::size_t n_nodes = 0;
+    /*! \~chinese 叶节点数。 */
+    std::size_t n_leaves = 0;
+    /*! \~chinese 最大深度，根节点的深度为 0 。 */
+    std::size_t max_depth = 0;
+    /*! \~chinese SAH 代价，见 `BVH::sah_cost` 。 */
+    float sah_cost = 0.0f;
+    /*! \~chinese 第 i 个元素是深度为 i 的叶节点个数。 */
+    std::vector<std::size_t> depth_histogram;
+    /*!
+     * \~chinese
+     * \brief 子节点与父节点表面积之比的分布，共 `n_area_ratio_buckets` 个区间。
+     *
+     * 本框架中每个叶节点恰好包含一个面片，叶节点大小的分布没有意义，因此改为统计表面积之比：
+     * 比值集中在 1 附近说明子节点几乎没有缩小，划分质量很差。
+     */
+    std::vector<std::size_t> area_ratio_histogram;
+    /*! \~chinese `area_ratio_histogram` 把 \f$[0, 1]\f$ 均分成的区间数。 */
+    static constexpr std::size_t n_area_ratio_buckets = 10;
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 遍历整棵 BVH ，计算它的结构统计信息。
+ */
+BVHStats compute_BVH_stats(const BVH& bvh);
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 光线求交过程中的计数器。
+ *
+ * 每个线程都有自己的一份计数器（见 `thread_traversal_counters`），求交代码直接修改它而不需要
+ * 任何同步；线程结束工作前调用 `flush_traversal_counters` 把计数合并到全局统计中。
+ */
+struct TraversalCounters
+{
+    /*! \~chinese 发射（求交）的光线数。 */
+    std::uint64_t rays = 0;
+    /*! \~chinese 访问的 BVH 节点数。 */
+    std::uint64_t visited_nodes = 0;
+    /*! \~chinese 光线与三角形求交测试的次数。 */
+    std::uint64_t triangle_tests = 0;
+    /*! \~chinese 光线与三角形相交的次数。 */
+    std::uint64_t triangle_hits = 0;
+
+    TraversalCounters& operator+=(const TraversalCounters& other);
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 返回当前线程的计数器。
+ */
+inline TraversalCounters& thread_traversal_counters()
+{
+    thread_local TraversalCounters counters;
+    return counters;
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 清空全局统计和当前线程的计数器，在开始一次渲染前调用。
+ */
+void reset_traversal_counters();
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 把当前线程的计数器合并到全局统计中并清零。
+ *
+ * 每个线程每次渲染只需调用一次，因此这里使用互斥锁也不会造成竞争。
+ */
+void flush_traversal_counters();
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 返回自上一次 `reset_traversal_counters` 以来所有线程合并的计数。
+ */
+TraversalCounters collected_traversal_counters();
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 重放一条光线在 BVH 中的遍历过程，把访问的节点数和三角形测试数累加到当前线程的计数器。
+ *
+ * BVH 求交由预编译的库完成，库中的代码不会修改计数器，所以渲染器在开启遍历统计时对每条光线
+ * 额外调用一次这个函数。每个被检查包围盒的节点计一次访问，包围盒被击中的叶节点计一次三角形
+ * 测试。它不影响求交结果，但会让求交的开销大约翻倍。
+ *
+ * \param bvh 要统计的 BVH
+ * \param ray 世界坐标系下的光线
+ * \param model BVH 所在物体的 model 矩阵
+ */
+void count_BVH_traversal(const BVH& bvh, const Ray& ray, const Eigen::Matrix4f& model);
+
+#endif // DANDELION_UTILS_BVH_STATS_H
@@ -0,0 +1,409 @@
+#ifndef DANDELION_UTILS_ELEMENT_POOL_HPP
+#define DANDELION_UTILS_ELEMENT_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*!
+ * \file utils/element_pool.hpp
+ * \ingroup utils
+ */
+
+// ------------------- Declarations ----------------------
+
+/*!
+ * \~chinese
+ * \brief 元素池中元素类型的基类。
+ *
+ * 若需要构造 `Node` 类型的元素池，则 `Node` 类型应该继承这个类，从而获得由元素池维护的
+ * 32 位句柄 `index` 。
+ */
+struct PoolElement
+{
+    PoolElement();
+    /*!
+     * \~chinese
+     * \brief 元素在所属元素池中的槽位编号（句柄）。
+     *
+     * 同一个池中存活元素的句柄互不相同，可以直接作为数组下标来存放与元素相关的数据。
+     * 句柄只在元素池被压缩 (`ElementPool::compact`) 之前保持不变。
+     */
+    std::uint32_t index;
+};
+
+/*!
+ * \~chinese
+ * \brief 连续存储、可复用槽位的元素池。
+ *
+ * 元素按句柄顺序存放在若干固定大小的内存块中，每个块都是一段连续内存，
+ * 因此遍历所有元素只是一次线性扫描；块一经分配就不再移动，所以元素的地址在压缩前保持稳定，
+ * 可以放心地用指针相互引用。
+ *
+ * 删除元素时只将其标记为已删除，内存和内容都会保留到 `recycle` 被调用为止，
+ * 这样仍然指向它的悬垂指针可以被 `contains` 检测出来；`recycle` 之后这些槽位进入空闲链表，
+ * 供之后创建的元素复用。`compact` 则把所有存活元素移动到最前面的槽位上，消除删除留下的空洞。
+ * 已删除的元素还可以用 `restore` 在原来的槽位上恢复，撤销操作依赖这一点。
+ *
+ * \tparam Node 元素类型，必须继承 `PoolElement` 并且可以复制构造
+ */
+template<typename Node>
+class ElementPool
+{
+    static_assert(
+        std::is_base_of_v<PoolElement, Node>, "Type Node must inherit from PoolElement"
+    );
+
+public:
+
+    /*! \~chinese 无效句柄。 */
+    static constexpr std::uint32_t invalid_index = std::numeric_limits<std::uint32_t>::max();
+
+    /*! \~chinese 按句柄顺序遍历所有存活元素的迭代器，解引用得到元素指针。 */
+    class Iterator
+    {
+    public:
+
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = Node*;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = Node**;
+        using reference         = Node*;
+
+        Iterator(const ElementPool* pool, std::uint32_t index);
+        Node*     operator*() const;
+        Iterator& operator++();
+        bool      operator==(const Iterator& other) const;
+        bool      operator!=(const Iterator& other) const;
+
+    private:
+
+        /*! \~chinese 跳过已删除的槽位。 */
+        void skip_erased();
+        const ElementPool* pool;
+        std::uint32_t      index;
+    };
+
+    ElementPool();
+    ElementPool(const ElementPool& other) = delete;
+    ~ElementPool();
+    /*!
+     * \~chinese
+     * \brief 创建一个元素，使用 `std::forward` 转发参数原地构造。
+     *
+     * 优先复用空闲链表中的槽位，没有空闲槽位时在末尾追加。
+     */
+    template<typename... Args>
+    Node* emplace(Args&&... args);
+    /*! \~chinese 将元素标记为已删除，在 `recycle` 之前它的内存不会被复用。 */
+    void erase(Node* node);
+    /*! \~chinese 将所有已删除元素的槽位放入空闲链表。 */
+    void recycle();
+    /*!
+     * \~chinese
+     * \brief 用 `content` 覆盖 `node` 所在槽位上的元素，并将它标记为存活。
+     *
+     * `node` 可以是存活的元素，也可以是已删除或位于空闲链表中的槽位，恢复后的句柄不变。
+     * 空闲链表中的槽位不会被立即移出，`emplace` 取出槽位时会跳过已经恢复的槽位。
+     */
+    Node* restore(Node* node, const Node& content);
+    /*! \~chinese 销毁所有元素并释放全部内存，之后新建的元素从句柄 0 开始编号。 */
+    void clear();
+    /*! \~chinese 指针是否指向这个池中的一个存活元素。 */
+    bool contains(const Node* node) const;
+    /*! \~chinese 句柄对应的槽位上是否是一个存活元素。 */
+    bool is_alive(std::uint32_t index) const;
+    /*! \~chinese 句柄对应的元素，不检查元素是否存活。 */
+    Node* operator[](std::uint32_t index) const;
+    /*! \~chinese 槽位总数（存活、已删除和空闲的槽位都计算在内），所有句柄都小于这个值。 */
+    std::uint32_t capacity() const;
+    /*!
+     * \~chinese
+     * \brief 计算压缩后每个槽位的新句柄。
+     *
+     * 存活元素和 `kept` 中列出的已删除槽位按原有顺序依次获得新句柄 \f$0, 1, \ldots\f$ ，
+     * 其余槽位对应 `invalid_index` 。
+     * 压缩会移动元素，调用者应先用返回的映射修正所有指向元素的指针，再调用 `compact` 。
+     *
+     * \param kept 需要保留的已删除槽位，它们压缩后仍是已删除的槽位，可以用 `restore` 恢复
+     */
+    std::vector<std::uint32_t> compaction_map(const std::vector<std::uint32_t>& kept = {}) const;
+    /*!
+     * \~chinese
+     * \brief 按 `compaction_map` 给出的映射移动元素。
+     *
+     * 被保留的已删除槽位压缩后进入空闲链表，其他已删除的槽位都被释放。
+     */
+    void compact(const std::vector<std::uint32_t>& new_indices);
+    Iterator begin() const;
+    Iterator end() const;
+    /*! \~chinese 存活元素的数量。 */
+    std::size_t size;
+
+private:
+
+    /*! \~chinese 每个内存块能容纳的元素数量的以 2 为底的对数。 */
+    static constexpr std::uint32_t block_shift = 12;
+    static constexpr std::uint32_t block_size  = 1u << block_shift;
+    static constexpr std::uint32_t block_mask  = block_size - 1;
+
+    /*! \~chinese 一个元素的未初始化存储空间。 */
+    struct alignas(Node) Slot
+    {
+        std::byte bytes[sizeof(Node)];
+    };
+
+    /*! \~chinese 句柄对应的槽位地址。 */
+    Node* slot(std::uint32_t index) const;
+
+    /*! \~chinese 所有内存块，`capacity()` 之前的每个槽位上都有一个已构造的元素。 */
+    std::vector<std::unique_ptr<Slot[]>> blocks;
+    /*! \~chinese 每个槽位上的元素是否存活。 */
+    std::vector<bool> alive;
+    /*! \~chinese 已删除但尚未回收的槽位。 */
+    std::vector<std::uint32_t> erased;
+    /*! \~chinese 可以复用的空闲槽位。 */
+    std::vector<std::uint32_t> free_slots;
+};
+
+// ------------------- Definitions ----------------------
+
+inline PoolElement::PoolElement() : index(std::numeric_limits<std::uint32_t>::max())
+{
+}
+
+template<typename Node>
+ElementPool<Node>::Iterator::Iterator(const ElementPool* pool, std::uint32_t index) :
+    pool(pool), index(index)
+{
+    skip_erased();
+}
+
+template<typename Node>
+Node* ElementPool<Node>::Iterator::operator*() const
+{
+    return pool->slot(index);
+}
+
+template<typename Node>
+typename ElementPool<Node>::Iterator& ElementPool<Node>::Iterator::operator++()
+{
+    ++index;
+    skip_erased();
+    return *this;
+}
+
+template<typename Node>
+bool ElementPool<Node>::Iterator::operator==(const Iterator& other) const
+{
+    return index == other.index;
+}
+
+template<typename Node>
+bool ElementPool<Node>::Iterator::operator!=(const Iterator& other) const
+{
+    return index != other.index;
+}
+
+template<typename Node>
+void ElementPool<Node>::Iterator::skip_erased()
+{
+    const std::uint32_t end = pool->capacity();
+    while (index < end && !pool->alive[index]) {
+        ++index;
+    }
+}
+
+template<typename Node>
+ElementPool<Node>::ElementPool() : size(0)
+{
+}
+
+template<typename Node>
+ElementPool<Node>::~ElementPool()
+{
+    clear();
+}
+
+template<typename Node>
+template<typename... Args>
+Node* ElementPool<Node>::emplace(Args&&... args)
+{
+    std::uint32_t index;
+    Node*         node;
+    // Slots restored after they were recycled are still in the free list.
+    while (!free_slots.empty() && alive[free_slots.back()]) {
+        free_slots.pop_back();
+    }
+    if (!free_slots.empty()) {
+        index = free_slots.back();
+        free_slots.pop_back();
+        node = slot(index);
+        node->~Node();
+        alive[index] = true;
+    } else {
+        index = capacity();
+        if ((index >> block_shift) == blocks.size()) {
+            blocks.push_back(std::make_unique<Slot[]>(block_size));
+        }
+        node = slot(index);
+        alive.push_back(true);
+    }
+    ::new (static_cast<void*>(node)) Node(std::forward<Args>(args)...);
+    node->index = index;
+    ++size;
+    return node;
+}
+
+template<typename Node>
+void ElementPool<Node>::erase(Node* node)
+{
+    if (!contains(node)) {
+        return;
+    }
+    alive[node->index] = false;
+    erased.push_back(node->index);
+    --size;
+}
+
+template<typename Node>
+void ElementPool<Node>::recycle()
+{
+    free_slots.insert(free_slots.end(), erased.begin(), erased.end());
+    erased.clear();
+}
+
+template<typename Node>
+Node* ElementPool<Node>::restore(Node* node, const Node& content)
+{
+    const std::uint32_t index = node->index;
+    node->~Node();
+    ::new (static_cast<void*>(node)) Node(content);
+    node->index = index;
+    if (!alive[index]) {
+        alive[index] = true;
+        ++size;
+    }
+    return node;
+}
+
+template<typename Node>
+void ElementPool<Node>::clear()
+{
+    const std::uint32_t n = capacity();
+    for (std::uint32_t i = 0; i < n; ++i) {
+        slot(i)->~Node();
+    }
+    blocks.clear();
+    alive.clear();
+    erased.clear();
+    free_slots.clear();
+    size = 0;
+}
+
+template<typename Node>
+bool ElementPool<Node>::contains(const Node* node) const
+{
+    return node != nullptr && node->index < capacity() && alive[node->index]
+        && slot(node->index) == node;
+}
+
+template<typename Node>
+bool ElementPool<Node>::is_alive(std::uint32_t index) const
+{
+    return index < capacity() && alive[index];
+}
+
+template<typename Node>
+Node* ElementPool<Node>::operator[](std::uint32_t index) const
+{
+    return slot(index);
+}
+
+template<typename Node>
+std::uint32_t ElementPool<Node>::capacity() const
+{
+    return static_cast<std::uint32_t>(alive.size());
+}
+
+template<typename Node>
+std::vector<std::uint32_t>
+ElementPool<Node>::compaction_map(const std::vector<std::uint32_t>& kept) const
+{
+    const std::uint32_t        n = capacity();
+    std::vector<std::uint32_t> new_indices(n, invalid_index);
+    std::vector<bool>          is_kept(alive);
+    for (const std::uint32_t index: kept) {
+        is_kept[index] = true;
+    }
+    std::uint32_t counter = 0;
+    for (std::uint32_t i = 0; i < n; ++i) {
+        if (is_kept[i]) {
+            new_indices[i] = counter;
+            ++counter;
+        }
+    }
+    return new_indices;
+}
+
+template<typename Node>
+void ElementPool<Node>::compact(const std::vector<std::uint32_t>& new_indices)
+{
+    const std::uint32_t n = capacity();
+    std::vector<bool>   new_alive;
+    erased.clear();
+    free_slots.clear();
+    // New indices never exceed old ones, so moving in ascending order never overwrites a kept
+    // element that has not been moved yet.
+    for (std::uint32_t i = 0; i < n; ++i) {
+        const std::uint32_t target = new_indices[i];
+        if (target == invalid_index) {
+            continue;
+        }
+        new_alive.push_back(alive[i]);
+        if (!alive[i]) {
+            free_slots.push_back(target);
+        }
+        if (target == i) {
+            continue;
+        }
+        Node* destination = slot(target);
+        destination->~Node();
+        ::new (static_cast<void*>(destination)) Node(*slot(i));
+        destination->index = target;
+    }
+    const std::uint32_t n_kept = static_cast<std::uint32_t>(new_alive.size());
+    for (std::uint32_t i = n_kept; i < n; ++i) {
+        slot(i)->~Node();
+    }
+    alive = std::move(new_alive);
+    blocks.resize((n_kept + block_mask) >> block_shift);
+}
+
+template<typename Node>
+typename ElementPool<Node>::Iterator ElementPool<Node>::begin() const
+{
+    return Iterator(this, 0);
+}
+
+template<typename Node>
+typename ElementPool<Node>::Iterator ElementPool<Node>::end() const
+{
+    return Iterator(this, capacity());
+}
+
+template<typename Node>
+Node* ElementPool<Node>::slot(std::uint32_t index) const
+{
+    return std::launder(
+        reinterpret_cast<Node*>(blocks[index >> block_shift][index & block_mask].bytes)
+    );
+}
+
+#endif // DANDELION_UTILS_ELEMENT_POOL_HPP
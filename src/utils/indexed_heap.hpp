@@ -0,0 +1,220 @@
+#ifndef DANDELION_UTILS_INDEXED_HEAP_HPP
+#define DANDELION_UTILS_INDEXED_HEAP_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+/*!
+ * \file utils/indexed_heap.hpp
+ * \ingroup utils
+ */
+
+// ------------------- Declarations ----------------------
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 支持按编号修改和删除元素的二叉最小堆。
+ *
+ * 堆中的每个元素由一个整数编号（例如元素池的句柄）标识，值按编号存放在连续数组中，
+ * 同时记录每个编号在堆中的位置。因此除了取出最小值之外，还可以在 \f$O(\log n)\f$
+ * 时间内修改任意元素的值（无论变大还是变小）或删除任意元素，而不必像 `std::set`
+ * 那样为每次修改分配、释放一个树节点。
+ *
+ * \tparam T 值的类型，按 `operator<` 比较，值最小的元素位于堆顶
+ */
+template<typename T>
+class IndexedHeap
+{
+public:
+
+    /*! \~chinese 不在堆中的编号对应的位置。 */
+    static constexpr std::uint32_t npos = std::numeric_limits<std::uint32_t>::max();
+
+    /*! \~chinese 堆是否为空。 */
+    bool empty() const;
+    /*! \~chinese 堆中元素的数量。 */
+    std::size_t size() const;
+    /*! \~chinese 编号为 `item` 的元素是否在堆中。 */
+    bool contains(std::uint32_t item) const;
+    /*! \~chinese 编号为 `item` 的元素的值，仅当该元素在堆中时有意义。 */
+    const T& value(std::uint32_t item) const;
+    /*! \~chinese 值最小的元素的编号，堆不能为空。 */
+    std::uint32_t top() const;
+    /*! \~chinese 删除值最小的元素，堆不能为空。 */
+    void pop();
+    /*! \~chinese 插入编号为 `item` 的元素，如果它已经在堆中则修改它的值。 */
+    void push(std::uint32_t item, const T& value);
+    /*! \~chinese 如果编号为 `item` 的元素在堆中，则删除它。 */
+    void erase(std::uint32_t item);
+    /*!
+     * \~chinese
+     * \brief 用一组元素重建整个堆，只需线性时间。
+     *
+     * \param items 所有元素的编号，不能重复
+     * \param values 按编号存放的值，长度应大于所有编号
+     */
+    void assign(std::vector<std::uint32_t> items, std::vector<T> values);
+
+private:
+
+    /*! \~chinese 把堆中第 `i` 个位置上的元素向上移动到合适的位置。 */
+    void sift_up(std::size_t i);
+    /*! \~chinese 把堆中第 `i` 个位置上的元素向下移动到合适的位置。 */
+    void sift_down(std::size_t i);
+    /*! \~chinese 交换堆中两个位置上的元素。 */
+    void swap_nodes(std::size_t i, std::size_t j);
+    /*! \~chinese 堆中位置 `i` 上的元素是否小于位置 `j` 上的元素。 */
+    bool less(std::size_t i, std::size_t j) const;
+
+    /*! \~chinese 按堆的顺序排列的元素编号。 */
+    std::vector<std::uint32_t> heap;
+    /*! \~chinese 按编号存放的值。 */
+    std::vector<T> values;
+    /*! \~chinese 按编号存放的、元素在 `heap` 中的位置，不在堆中的元素为 `npos` 。 */
+    std::vector<std::uint32_t> positions;
+};
+
+// ------------------- Definitions ----------------------
+
+template<typename T>
+bool IndexedHeap<T>::empty() const
+{
+    return heap.empty();
+}
+
+template<typename T>
+std::size_t IndexedHeap<T>::size() const
+{
+    return heap.size();
+}
+
+template<typename T>
+bool IndexedHeap<T>::contains(std::uint32_t item) const
+{
+    return item < positions.size() && positions[item] != npos;
+}
+
+template<typename T>
+const T& IndexedHeap<T>::value(std::uint32_t item) const
+{
+    return values[item];
+}
+
+template<typename T>
+std::uint32_t IndexedHeap<T>::top() const
+{
+    return heap.front();
+}
+
+template<typename T>
+void IndexedHeap<T>::pop()
+{
+    erase(heap.front());
+}
+
+template<typename T>
+void IndexedHeap<T>::push(std::uint32_t item, const T& value)
+{
+    if (item >= positions.size()) {
+        positions.resize(item + 1, npos);
+        values.resize(item + 1);
+    }
+    values[item] = value;
+    if (positions[item] == npos) {
+        positions[item] = static_cast<std::uint32_t>(heap.size());
+        heap.push_back(item);
+        sift_up(heap.size() - 1);
+        return;
+    }
+    // The value may either increase or decrease, at most one of the sifts moves the element.
+    sift_up(positions[item]);
+    sift_down(positions[item]);
+}
+
+template<typename T>
+void IndexedHeap<T>::erase(std::uint32_t item)
+{
+    if (!contains(item)) {
+        return;
+    }
+    const std::size_t i    = positions[item];
+    const std::size_t last = heap.size() - 1;
+    if (i != last) {
+        swap_nodes(i, last);
+    }
+    heap.pop_back();
+    positions[item] = npos;
+    if (i != last) {
+        sift_up(i);
+        sift_down(i);
+    }
+}
+
+template<typename T>
+void IndexedHeap<T>::assign(std::vector<std::uint32_t> items, std::vector<T> values)
+{
+    this->values = std::move(values);
+    heap         = std::move(items);
+    positions.assign(this->values.size(), npos);
+    for (std::size_t i = 0; i < heap.size(); ++i) {
+        positions[heap[i]] = static_cast<std::uint32_t>(i);
+    }
+    for (std::size_t i = heap.size() / 2; i > 0; --i) {
+        sift_down(i - 1);
+    }
+}
+
+template<typename T>
+void IndexedHeap<T>::sift_up(std::size_t i)
+{
+    while (i > 0) {
+        const std::size_t parent = (i - 1) / 2;
+        if (!less(i, parent)) {
+            break;
+        }
+        swap_nodes(i, parent);
+        i = parent;
+    }
+}
+
+template<typename T>
+void IndexedHeap<T>::sift_down(std::size_t i)
+{
+    const std::size_t n = heap.size();
+    while (true) {
+        const std::size_t left     = 2 * i + 1;
+        const std::size_t right    = left + 1;
+        std::size_t       smallest = i;
+        if (left < n && less(left, smallest)) {
+            smallest = left;
+        }
+        if (right < n && less(right, smallest)) {
+            smallest = right;
+        }
+        if (smallest == i) {
+            break;
+        }
+        swap_nodes(i, smallest);
+        i = smallest;
+    }
+}
+
+template<typename T>
+void IndexedHeap<T>::swap_nodes(std::size_t i, std::size_t j)
+{
+    std::swap(heap[i], heap[j]);
+    positions[heap[i]] = static_cast<std::uint32_t>(i);
+    positions[heap[j]] = static_cast<std::uint32_t>(j);
+}
+
+template<typename T>
+bool IndexedHeap<T>::less(std::size_t i, std::size_t j) const
+{
+    return values[heap[i]] < values[heap[j]];
+}
+
+#endif // DANDELION_UTILS_INDEXED_HEAP_HPP
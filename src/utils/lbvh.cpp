@@ -0,0 +1,252 @@
+#include "bvh.h"
+
+#include <atomic>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "parallel.hpp"
+
+using Eigen::Vector3f;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+// 线性 BVH (LBVH) 的并行构建，参考 T. Karras, "Maximizing Parallelism in the Construction of
+// BVHs, Octrees, and k-d Trees", HPG 2012.
+// 这部分与 bvh.cpp 分开编译，不依赖 BVH::build 的实现。
+
+namespace {
+
+// 把 10 位整数的每一位之间插入两个 0，用于交错三个坐标轴的位
+uint32_t expand_bits(uint32_t v)
+{
+    v = (v * 0x0001'0001u) & 0xFF00'00FFu;
+    v = (v * 0x0000'0101u) & 0x0F00'F00Fu;
+    v = (v * 0x0000'0011u) & 0xC30C'30C3u;
+    v = (v * 0x0000'0005u) & 0x4924'9249u;
+    return v;
+}
+
+// 计算单位立方体内一点的 30 位 Morton 码
+uint32_t morton_code(const Vector3f& p)
+{
+    const auto quantize = [](float x) {
+        return static_cast<uint32_t>(std::min(std::max(x * 1024.0f, 0.0f), 1023.0f));
+    };
+    return (expand_bits(quantize(p.x())) << 2) | (expand_bits(quantize(p.y())) << 1)
+         | expand_bits(quantize(p.z()));
+}
+
+// 有序 Morton 码 i 与 j 的最长公共前缀长度，j 越界时返回 -1 ；码相同时用下标区分
+int common_prefix(const vector<uint32_t>& codes, int64_t i, int64_t j)
+{
+    if (j < 0 || j >= static_cast<int64_t>(codes.size())) {
+        return -1;
+    }
+    if (codes[i] == codes[j]) {
+        return 32 + std::countl_zero(static_cast<uint32_t>(i ^ j));
+    }
+    return std::countl_zero(codes[i] ^ codes[j]);
+}
+
+bool is_leaf(const BVHNode* node)
+{
+    return node->left == nullptr && node->right == nullptr;
+}
+
+// 尝试把 node 的一个孙节点与另一侧的子节点交换。交换不改变 node 覆盖的面片集合，
+// 只改变被修改的那个子节点的包围盒，所以只需比较该子节点的表面积（即 SAH 代价的变化）。
+void rotate(BVHNode* node)
+{
+    float        best_area  = 0.0f;
+    BVHNode**    best_outer = nullptr;
+    BVHNode**    best_inner = nullptr;
+    BVHNode*     best_child = nullptr;
+    BVHNode*     children[2] = {node->left, node->right};
+    BVHNode**    siblings[2] = {&node->right, &node->left};
+    for (int side = 0; side < 2; ++side) {
+        BVHNode* child = children[side];
+        if (is_leaf(child)) {
+            continue;
+        }
+        const float area = surface_area(child->aabb);
+        // 与 child 的左孩子交换时，child 变为 (sibling, child->right)，反之亦然
+        BVHNode** grandchildren[2] = {&child->left, &child->right};
+        BVHNode** kept[2]          = {&child->right, &child->left};
+        for (int k = 0; k < 2; ++k) {
+            const float new_area =
+                surface_area(union_AABB((*siblings[side])->aabb, (*kept[k])->aabb));
+            if (area - new_area > best_area) {
+                best_area  = area - new_area;
+                best_outer = siblings[side];
+                best_inner = grandchildren[k];
+                best_child = child;
+            }
+        }
+    }
+    if (best_child == nullptr) {
+        return;
+    }
+    std::swap(*best_outer, *best_inner);
+    best_child->aabb = union_AABB(best_child->left->aabb, best_child->right->aabb);
+}
+
+// 后序遍历顶部 depth 层，自底向上做贪心树旋转
+void refine(BVHNode* node, int depth)
+{
+    if (depth <= 0 || node == nullptr || is_leaf(node)) {
+        return;
+    }
+    refine(node->left, depth - 1);
+    refine(node->right, depth - 1);
+    rotate(node);
+}
+
+} // namespace
+
+void BVH::parallel_build(unsigned int n_threads, int refine_depth)
+{
+    root           = nullptr;
+    const size_t n = mesh.faces.count();
+    primitives.clear();
+    if (n == 0) {
+        return;
+    }
+
+    // 1. 计算面片重心及其包围盒（各线程先求局部包围盒再合并）
+    vector<Vector3f> centroids(n);
+    vector<AABB>     centroid_bounds(parallel_chunk_count(n, n_threads));
+    parallel_for_chunks(
+        0, n,
+        [&](size_t begin, size_t end, size_t chunk) {
+            AABB bounds;
+            for (size_t i = begin; i < end; ++i) {
+                AABB face_aabb = get_aabb(mesh, i);
+                centroids[i]   = face_aabb.centroid();
+                bounds         = union_AABB(bounds, centroids[i]);
+            }
+            centroid_bounds[chunk] = bounds;
+        },
+        n_threads
+    );
+    AABB bounds;
+    for (const AABB& chunk_bounds: centroid_bounds) {
+        bounds = union_AABB(bounds, chunk_bounds);
+    }
+    Vector3f extent = bounds.diagonal();
+    for (int axis = 0; axis < 3; ++axis) {
+        if (extent[axis] <= 0.0f) {
+            extent[axis] = 1.0f;
+        }
+    }
+
+    // 2. 计算 Morton 码并排序
+    vector<uint32_t> codes(n), order(n);
+    parallel_for(
+        0, n,
+        [&](size_t i) {
+            const Vector3f normalized = (centroids[i] - bounds.p_min).cwiseQuotient(extent);
+            codes[i]                  = morton_code(normalized);
+            order[i]                  = static_cast<uint32_t>(i);
+        },
+        n_threads
+    );
+    centroids = vector<Vector3f>();
+    radix_sort(codes, order, 30, n_threads);
+    primitives.assign(order.begin(), order.end());
+
+    // 3. 分配节点：n 个叶节点和 n - 1 个内部节点
+    vector<BVHNode*> leaves(n), internals(n - 1);
+    constexpr size_t no_parent = std::numeric_limits<size_t>::max();
+    vector<size_t>   leaf_parent(n, no_parent), internal_parent(n - 1, no_parent);
+    parallel_for(
+        0, n,
+        [&](size_t i) {
+            leaves[i]           = new BVHNode();
+            leaves[i]->face_idx = order[i];
+            if (i + 1 < n) {
+                internals[i] = new BVHNode();
+            }
+        },
+        n_threads
+    );
+
+    // 4. 每个内部节点独立确定自己覆盖的区间和分割位置
+    parallel_for(
+        0, n - 1,
+        [&](size_t index) {
+            const int64_t i = static_cast<int64_t>(index);
+            const int64_t d =
+                common_prefix(codes, i, i + 1) - common_prefix(codes, i, i - 1) >= 0 ? 1 : -1;
+            // 区间另一端的搜索
+            const int min_prefix = common_prefix(codes, i, i - d);
+            int64_t   max_length = 2;
+            while (common_prefix(codes, i, i + max_length * d) > min_prefix) {
+                max_length *= 2;
+            }
+            int64_t length = 0;
+            for (int64_t t = max_length / 2; t >= 1; t /= 2) {
+                if (common_prefix(codes, i, i + (length + t) * d) > min_prefix) {
+                    length += t;
+                }
+            }
+            const int64_t j           = i + length * d;
+            const int     node_prefix = common_prefix(codes, i, j);
+            // 二分查找分割位置
+            int64_t split   = 0;
+            int64_t divisor = 2;
+            for (int64_t t = (length + divisor - 1) / divisor; t >= 1;
+                 divisor *= 2, t = (length + divisor - 1) / divisor) {
+                if (common_prefix(codes, i, i + (split + t) * d) > node_prefix) {
+                    split += t;
+                }
+                if (t == 1) {
+                    break;
+                }
+            }
+            const size_t gamma = static_cast<size_t>(i + split * d + std::min<int64_t>(d, 0));
+            BVHNode*     node  = internals[index];
+            if (static_cast<size_t>(std::min(i, j)) == gamma) {
+                node->left         = leaves[gamma];
+                leaf_parent[gamma] = index;
+            } else {
+                node->left             = internals[gamma];
+                internal_parent[gamma] = index;
+            }
+            if (static_cast<size_t>(std::max(i, j)) == gamma + 1) {
+                node->right            = leaves[gamma + 1];
+                leaf_parent[gamma + 1] = index;
+            } else {
+                node->right                = internals[gamma + 1];
+                internal_parent[gamma + 1] = index;
+            }
+        },
+        n_threads
+    );
+
+    // 5. 自底向上合并包围盒：每个内部节点由第二个到达的线程计算
+    vector<std::atomic<int>> visits(n - 1);
+    parallel_for(
+        0, n,
+        [&](size_t i) {
+            leaves[i]->aabb = get_aabb(mesh, order[i]);
+            size_t parent   = leaf_parent[i];
+            while (parent != no_parent) {
+                if (visits[parent].fetch_add(1, std::memory_order_acq_rel) == 0) {
+                    break;
+                }
+                BVHNode* node = internals[parent];
+                node->aabb    = union_AABB(node->left->aabb, node->right->aabb);
+                parent        = internal_parent[parent];
+            }
+        },
+        n_threads
+    );
+
+    root = n == 1 ? leaves[0] : internals[0];
+    refine(root, refine_depth);
+}
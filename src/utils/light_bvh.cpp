@@ -0,0 +1,177 @@
+#include "light_bvh.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+
+using Eigen::AlignedBox3f;
+using Eigen::Vector3f;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+namespace {
+
+// 距离平方的下限，避免着色点恰好位于光源上时出现除以 0
+constexpr float MIN_SQUARED_DISTANCE = 1e-8f;
+// 小于 1 的最大单精度浮点数
+constexpr float ONE_MINUS_EPSILON = 0x1.fffffep-1f;
+
+} // namespace
+
+void LightBVH::build(const std::list<Light>& scene_lights)
+{
+    const vector<Light> source(scene_lights.begin(), scene_lights.end());
+    lights.clear();
+    nodes.clear();
+    if (source.empty()) {
+        return;
+    }
+    lights.reserve(source.size());
+    nodes.reserve(2 * source.size() - 1);
+    vector<uint32_t> indices(source.size());
+    std::iota(indices.begin(), indices.end(), 0u);
+    build_recursively(indices, 0, indices.size(), source);
+}
+
+uint32_t LightBVH::build_recursively(
+    vector<uint32_t>& indices, size_t begin, size_t end, const vector<Light>& source
+)
+{
+    const uint32_t index = static_cast<uint32_t>(nodes.size());
+    const uint32_t first = static_cast<uint32_t>(lights.size());
+    const uint32_t count = static_cast<uint32_t>(end - begin);
+    nodes.push_back({AlignedBox3f(), 0.0f, 0, first, count});
+    AlignedBox3f bounds;
+    float        intensity = 0.0f;
+    for (size_t i = begin; i < end; ++i) {
+        bounds.extend(source[indices[i]].position);
+        intensity += source[indices[i]].intensity;
+    }
+    if (end - begin == 1) {
+        nodes[index] = {bounds, intensity, 0, first, count};
+        lights.push_back(source[indices[begin]]);
+        return index;
+    }
+    // 沿最长轴按中位数划分，树的深度是光源数的对数
+    int axis = 0;
+    bounds.sizes().maxCoeff(&axis);
+    const size_t middle = begin + (end - begin) / 2;
+    std::nth_element(
+        indices.begin() + begin, indices.begin() + middle, indices.begin() + end,
+        [&](uint32_t a, uint32_t b) { return source[a].position[axis] < source[b].position[axis]; }
+    );
+    build_recursively(indices, begin, middle, source);
+    const uint32_t right = build_recursively(indices, middle, end, source);
+    nodes[index]         = {bounds, intensity, right, first, count};
+    return index;
+}
+
+bool LightBVH::behind(const Node& node, const Vector3f& point, const Vector3f& normal) const
+{
+    // 包围盒沿法向最远的顶点
+    const Vector3f farthest = (normal.array() > 0.0f).select(node.bounds.max(), node.bounds.min());
+    return normal.dot(farthest - point) <= 0.0f;
+}
+
+float LightBVH::upper_bound(const Node& node, const Vector3f& point) const
+{
+    const float distance_2 = node.bounds.squaredExteriorDistance(point);
+    return node.intensity / std::max(distance_2, MIN_SQUARED_DISTANCE);
+}
+
+std::optional<LightBVH::LightSample> LightBVH::sample(
+    const Vector3f& point, const Vector3f& normal, float u, float threshold
+) const
+{
+    if (nodes.empty()) {
+        return std::nullopt;
+    }
+
+    // 单个光源的重要性：余弦加权的辐照度，被剔除或位于背面时为 0
+    const auto light_importance = [&](uint32_t i) {
+        const Vector3f to_light   = lights[i].position - point;
+        const float    distance_2 = std::max(to_light.squaredNorm(), MIN_SQUARED_DISTANCE);
+        const float    irradiance = lights[i].intensity / distance_2;
+        const float    cos_l      = normal.dot(to_light);
+        if (cos_l <= 0.0f || irradiance < threshold) {
+            return 0.0f;
+        }
+        return irradiance * cos_l / std::sqrt(distance_2);
+    };
+    const auto importance = [&](const Node& node) {
+        if (behind(node, point, normal) || upper_bound(node, point) < threshold) {
+            return 0.0f;
+        }
+        if (node.n_lights <= exact_subtree_size) {
+            float sum = 0.0f;
+            for (uint32_t i = node.first_light; i < node.first_light + node.n_lights; ++i) {
+                sum += light_importance(i);
+            }
+            return sum;
+        }
+        // 包围球半径为 r ，中心到着色点的距离为 d 。球内任意一点与法向夹角不小于
+        // theta - theta_b ，其中 sin(theta_b) = r / d ，由此得到余弦项的上界
+        const Vector3f to_center = node.bounds.center() - point;
+        const float    radius    = 0.5f * node.bounds.diagonal().norm();
+        const float    distance  = to_center.norm();
+        float          cos_bound = 1.0f;
+        if (distance > radius) {
+            const float cos_theta = std::clamp(normal.dot(to_center) / distance, -1.0f, 1.0f);
+            const float sin_theta = std::sqrt(1.0f - cos_theta * cos_theta);
+            const float sin_b     = radius / distance;
+            const float cos_b     = std::sqrt(1.0f - sin_b * sin_b);
+            if (cos_theta < cos_b) {
+                cos_bound = std::max(cos_theta * cos_b + sin_theta * sin_b, 0.0f);
+            }
+        }
+        const float distance_2 = std::max(distance * distance, radius * radius);
+        return node.intensity * cos_bound / std::max(distance_2, MIN_SQUARED_DISTANCE);
+    };
+
+    // 从根节点向下，直到子树足够小
+    uint32_t index = 0;
+    float    pmf   = 1.0f;
+    while (nodes[index].n_lights > exact_subtree_size) {
+        const float left  = importance(nodes[index + 1]);
+        const float right = importance(nodes[nodes[index].right]);
+        if (left + right <= 0.0f) {
+            return std::nullopt;
+        }
+        const float p_left = left / (left + right);
+        // 把选中的那一段重新映射到 [0, 1) ，同一个随机数可以继续用于下一层
+        if (u < p_left) {
+            u = std::min(u / p_left, ONE_MINUS_EPSILON);
+            pmf *= p_left;
+            index = index + 1;
+        } else {
+            u = std::min((u - p_left) / (1.0f - p_left), ONE_MINUS_EPSILON);
+            pmf *= 1.0f - p_left;
+            index = nodes[index].right;
+        }
+    }
+
+    // 在小子树中按各光源的重要性直接选择
+    const Node&                           node = nodes[index];
+    float                                 sum  = 0.0f;
+    std::array<float, exact_subtree_size> weights;
+    for (uint32_t k = 0; k < node.n_lights; ++k) {
+        weights[k] = light_importance(node.first_light + k);
+        sum += weights[k];
+    }
+    if (sum <= 0.0f) {
+        return std::nullopt;
+    }
+    float    target = u * sum;
+    uint32_t chosen = 0;
+    // 跳过重要性为 0 的光源，舍入误差也不会选中它们
+    while (chosen + 1 < node.n_lights && (weights[chosen] <= 0.0f || target >= weights[chosen])) {
+        target -= weights[chosen];
+        ++chosen;
+    }
+    while (weights[chosen] <= 0.0f) {
+        --chosen;
+    }
+    return LightSample{node.first_light + chosen, pmf * weights[chosen] / sum};
+}
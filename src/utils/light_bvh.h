@@ -0,0 +1,146 @@
+#ifndef DANDELION_UTILS_LIGHT_BVH_H
+#define DANDELION_UTILS_LIGHT_BVH_H
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <vector>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "../scene/light.h"
+
+/*!
+ * \file utils/light_bvh.h
+ * \ingroup utils
+ * \~chinese
+ * \brief 用于大量点光源的光源层次包围盒。
+ */
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 光源的层次包围盒 (light BVH)。
+ *
+ * `build` 把场景中的光源链表展开为数组 `lights` ，并在其上建立二叉树：每个节点记录所覆盖光源的
+ * 包围盒和总强度。着色点可以用它做两件事：
+ *
+ * - `for_each_light` 逐个访问贡献可能不低于阈值的光源，整棵子树的贡献上界低于阈值时直接跳过；
+ * - `sample` 从根节点出发，按两个子节点对着色点的重要性随机选择一侧，最终选出一个光源，
+ *   并返回选中它的概率，从而只用一条阴影光线估计所有光源的直接光照。
+ *
+ * 两种方式都会跳过完全位于着色点切平面背面的子树，这些光源对 Lambert 漫反射和
+ * Blinn-Phong 高光的贡献都是 0 。
+ */
+class LightBVH
+{
+public:
+
+    /*! \~chinese 树中的一个节点，左子节点紧跟在父节点之后。 */
+    struct Node
+    {
+        /*! \~chinese 所覆盖光源位置的包围盒。 */
+        Eigen::AlignedBox3f bounds;
+        /*! \~chinese 所覆盖光源的强度之和。 */
+        float intensity;
+        /*! \~chinese 右子节点的下标，叶节点为 0 。 */
+        std::uint32_t right;
+        /*! \~chinese 子树中第一个光源在 `lights` 中的下标，子树的光源在 `lights` 中是连续的。 */
+        std::uint32_t first_light;
+        /*! \~chinese 子树中的光源数。 */
+        std::uint32_t n_lights;
+    };
+
+    /*! \~chinese `sample` 的结果。 */
+    struct LightSample
+    {
+        /*! \~chinese 选中的光源在 `lights` 中的下标。 */
+        std::uint32_t light;
+        /*! \~chinese 选中这个光源的概率。 */
+        float pmf;
+    };
+
+    /*! \~chinese 用场景中的光源重建整棵树。 */
+    void build(const std::list<Light>& scene_lights);
+    /*!
+     * \~chinese
+     * \brief 按重要性随机选择一个光源。
+     *
+     * 子树的重要性为总强度乘以包围球内光源入射余弦的上界，再除以着色点到包围盒中心距离的平方
+     * （不小于包围球半径的平方）；完全位于切平面背面或贡献上界低于 `threshold` 的子树重要性为 0 。
+     * 包围盒给出的余弦上界比较宽松，光源全部位于背面的子树也可能得到正的重要性，
+     * 因此光源数不超过 `exact_subtree_size` 的子树直接用各光源余弦加权的辐照度之和作为重要性，
+     * 这样底层的选择概率是精确的，也几乎不会走进没有可用光源的子树。
+     *
+     * \param point 着色点
+     * \param normal 着色点处朝向入射光线一侧的法向量
+     * \param u \f$[0, 1)\f$ 内的随机数
+     * \param threshold 贡献上界的阈值，为 0 时不剔除任何光源，估计是无偏的
+     * \returns 选中的光源及其概率，所有光源都被剔除时返回 `std::nullopt`
+     */
+    std::optional<LightSample> sample(
+        const Eigen::Vector3f& point, const Eigen::Vector3f& normal, float u, float threshold
+    ) const;
+    /*!
+     * \~chinese
+     * \brief 对贡献上界不低于 `threshold` 、且不在切平面背面的每个光源调用 `func(light)` 。
+     *
+     * 贡献上界为子树总强度除以着色点到包围盒距离的平方，即所有光源的辐照度之和的上界。
+     */
+    template<typename Func>
+    void for_each_light(
+        const Eigen::Vector3f& point, const Eigen::Vector3f& normal, float threshold, Func&& func
+    ) const;
+
+    /*! \~chinese 光源数不超过这个值的子树精确计算重要性。 */
+    static constexpr std::uint32_t exact_subtree_size = 32;
+
+    /*! \~chinese 按树中叶节点顺序排列的光源。 */
+    std::vector<Light> lights;
+    /*! \~chinese 所有节点，根节点的下标为 0 。 */
+    std::vector<Node> nodes;
+
+private:
+
+    /*! \~chinese 递归地为 `indices` 中 \f$[begin, end)\f$ 范围内的光源建树，返回节点下标。 */
+    std::uint32_t build_recursively(
+        std::vector<std::uint32_t>& indices, std::size_t begin, std::size_t end,
+        const std::vector<Light>& source
+    );
+    /*! \~chinese 节点是否完全位于切平面背面。 */
+    bool
+    behind(const Node& node, const Eigen::Vector3f& point, const Eigen::Vector3f& normal) const;
+    /*! \~chinese 节点中所有光源在着色点处辐照度之和的上界。 */
+    float upper_bound(const Node& node, const Eigen::Vector3f& point) const;
+};
+
+template<typename Func>
+void LightBVH::for_each_light(
+    const Eigen::Vector3f& point, const Eigen::Vector3f& normal, float threshold, Func&& func
+) const
+{
+    if (nodes.empty()) {
+        return;
+    }
+    // 树是按中位数划分建立的，64 层足以容纳任意数量的光源
+    std::array<std::uint32_t, 64> stack;
+    std::size_t                   top = 0;
+    stack[top++]                      = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (behind(node, point, normal) || upper_bound(node, point) < threshold) {
+            continue;
+        }
+        if (node.right == 0) {
+            func(lights[node.first_light]);
+            continue;
+        }
+        const std::uint32_t index = static_cast<std::uint32_t>(&node - nodes.data());
+        stack[top++]              = node.right;
+        stack[top++]              = index + 1;
+    }
+}
+
+#endif // DANDELION_UTILS_LIGHT_BVH_H
@@ -1,10 +1,12 @@
 #ifndef DANDELION_UTILS_MATH_HPP
 #define DANDELION_UTILS_MATH_HPP
 
+#include <algorithm>
 #include <cmath>
 #include <tuple>
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 
 /*!
  * \ingroup utils
@@ -103,6 +105,27 @@ inline Eigen::Vector3f reflect(const Eigen::Vector3f& I, const Eigen::Vector3f&
     return I - 2 * I.dot(N) * N;
 }
 
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 把 \f$[0, 1)^2\f$ 上的均匀样本映射为法线一侧半球上的方向，概率密度为
+ * \f$\cos\theta / \pi\f$ 。
+ * \param normal 半球的法线（必须是单位向量）
+ * \param u 二维均匀样本
+ */
+inline Eigen::Vector3f
+sample_cosine_hemisphere(const Eigen::Vector3f& normal, const Eigen::Vector2f& u)
+{
+    const float           r      = std::sqrt(u.x());
+    const float           phi    = 2.0f * pi<float>() * u.y();
+    const Eigen::Vector3f helper =
+        std::abs(normal.x()) > 0.9f ? Eigen::Vector3f::UnitY() : Eigen::Vector3f::UnitX();
+    const Eigen::Vector3f tangent   = normal.cross(helper).normalized();
+    const Eigen::Vector3f bitangent = normal.cross(tangent);
+    const float           z         = std::sqrt(std::max(0.0f, 1.0f - r * r));
+    return (r * std::cos(phi) * tangent + r * std::sin(phi) * bitangent + z * normal).normalized();
+}
+
 /*!
  * \ingroup utils
  * \~chinese
@@ -0,0 +1,217 @@
+#ifndef DANDELION_UTILS_PARALLEL_HPP
+#define DANDELION_UTILS_PARALLEL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <algorithm>
+#include <array>
+#include <thread>
+#include <vector>
+
+/*!
+ * \file utils/parallel.hpp
+ * \ingroup utils
+ * \~chinese
+ * \brief 提供简单的数据并行工具函数。
+ *
+ * Dandelion 没有全局线程池，需要并行的地方都直接创建 `std::thread` 。
+ * 这个文件把“将一个下标区间切块、每块交给一个线程”的常见写法封装起来，
+ * 各线程处理的块互不重叠，调用者只需保证不同下标的处理过程之间没有数据竞争。
+ */
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 将指定的线程数转换为实际使用的线程数。
+ *
+ * \param n_threads 期望的线程数，为 0 表示使用硬件线程数
+ * \returns 实际使用的线程数，至少为 1
+ */
+inline unsigned int resolve_thread_count(unsigned int n_threads)
+{
+    if (n_threads == 0) {
+        n_threads = std::thread::hardware_concurrency();
+    }
+    return std::max(n_threads, 1u);
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 返回 `parallel_for_chunks` 对长度为 `count` 的区间切出的块数。
+ *
+ * 块数不超过线程数，也不超过区间长度，调用者可以据此预先分配每个块的局部数据
+ * （例如基数排序中每个线程的直方图）。
+ */
+inline std::size_t parallel_chunk_count(std::size_t count, unsigned int n_threads)
+{
+    return std::min(static_cast<std::size_t>(resolve_thread_count(n_threads)), count);
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 把区间 \f$[begin, end)\f$ 均匀切成连续的块，每块由一个线程执行。
+ *
+ * `func` 的调用形式为 `func(chunk_begin, chunk_end, chunk_index)`，其中
+ * `chunk_index` 从 0 开始，小于 `parallel_chunk_count(end - begin, n_threads)` 。
+ * 最后一块在调用者线程上执行，函数返回时所有块都已执行完毕。
+ *
+ * \param begin 区间起点
+ * \param end 区间终点（不包含）
+ * \param func 处理一个块的函数
+ * \param n_threads 最多使用的线程数，为 0 表示使用硬件线程数
+ */
+template<typename Func>
+void parallel_for_chunks(std::size_t begin, std::size_t end, Func&& func, unsigned int n_threads = 0)
+{
+    if (end <= begin) {
+        return;
+    }
+    const std::size_t count       = end - begin;
+    const std::size_t n_chunks    = parallel_chunk_count(count, n_threads);
+    const auto        chunk_begin = [&](std::size_t chunk) {
+        return begin + count * chunk / n_chunks;
+    };
+    std::vector<std::thread> workers;
+    workers.reserve(n_chunks - 1);
+    for (std::size_t chunk = 0; chunk + 1 < n_chunks; ++chunk) {
+        const std::size_t first = chunk_begin(chunk);
+        const std::size_t last  = chunk_begin(chunk + 1);
+        workers.emplace_back([&func, first, last, chunk]() { func(first, last, chunk); });
+    }
+    func(chunk_begin(n_chunks - 1), end, n_chunks - 1);
+    for (auto& worker: workers) {
+        worker.join();
+    }
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 对区间 \f$[begin, end)\f$ 中的每个下标并行地调用 `func(index)` 。
+ *
+ * \param begin 区间起点
+ * \param end 区间终点（不包含）
+ * \param func 处理单个下标的函数
+ * \param n_threads 最多使用的线程数，为 0 表示使用硬件线程数
+ */
+template<typename Func>
+void parallel_for(std::size_t begin, std::size_t end, Func&& func, unsigned int n_threads = 0)
+{
+    parallel_for_chunks(
+        begin, end,
+        [&func](std::size_t chunk_begin, std::size_t chunk_end, std::size_t) {
+            for (std::size_t i = chunk_begin; i < chunk_end; ++i) {
+                func(i);
+            }
+        },
+        n_threads
+    );
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 把两个顶点序号打包成无向边的键，较小的序号在高 32 位，因此边的两个方向得到同一个键。
+ */
+inline std::uint64_t edge_key(std::uint32_t a, std::uint32_t b)
+{
+    return (static_cast<std::uint64_t>(std::min(a, b)) << 32) | std::max(a, b);
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief SplitMix64 的最终混合函数，是 64 位整数上的双射。
+ *
+ * 并行算法用它把序号或边的键打散成伪随机的优先级，使优先级相同的元素不会按空间顺序聚集。
+ */
+inline std::uint64_t mix_bits(std::uint64_t key)
+{
+    key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ull;
+    key = (key ^ (key >> 27)) * 0x94d049bb133111ebull;
+    return key ^ (key >> 31);
+}
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 对 (键, 值) 对做稳定的并行 LSD 基数排序，每趟处理 8 位。
+ *
+ * 每个线程统计自己负责的块的直方图，再按块的顺序分配写入位置，因此排序是稳定的。
+ * 所有键在某一趟的数字都相同时这一趟会被跳过。
+ *
+ * \param keys 无符号整数键，排序后按升序排列
+ * \param values 与键一一对应的值，随键一起移动
+ * \param key_bits 键的有效位数，只对低 `key_bits` 位排序
+ * \param n_threads 最多使用的线程数，为 0 表示使用硬件线程数
+ */
+template<typename Key>
+void radix_sort(
+    std::vector<Key>& keys, std::vector<std::uint32_t>& values, unsigned int key_bits,
+    unsigned int n_threads = 0
+)
+{
+    constexpr std::size_t n_buckets = 256;
+    using Histogram                 = std::array<std::size_t, n_buckets>;
+    const std::size_t          n        = keys.size();
+    const std::size_t          n_chunks = parallel_chunk_count(n, n_threads);
+    std::vector<Key>           keys_out(n);
+    std::vector<std::uint32_t> values_out(n);
+    std::vector<Histogram>     histograms(n_chunks);
+
+    for (unsigned int shift = 0; shift < key_bits; shift += 8) {
+        parallel_for_chunks(
+            0, n,
+            [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+                Histogram& histogram = histograms[chunk];
+                histogram.fill(0);
+                for (std::size_t i = begin; i < end; ++i) {
+                    ++histogram[(keys[i] >> shift) & 0xFFu];
+                }
+            },
+            n_threads
+        );
+        // 所有键在这一趟的数字都相同时无需移动数据
+        bool single_bucket = false;
+        for (std::size_t bucket = 0; bucket < n_buckets; ++bucket) {
+            std::size_t total = 0;
+            for (std::size_t chunk = 0; chunk < n_chunks; ++chunk) {
+                total += histograms[chunk][bucket];
+            }
+            if (total == n) {
+                single_bucket = true;
+                break;
+            }
+        }
+        if (single_bucket) {
+            continue;
+        }
+        // 把直方图原地改写成每个块、每个桶的起始写入位置
+        std::size_t offset = 0;
+        for (std::size_t bucket = 0; bucket < n_buckets; ++bucket) {
+            for (std::size_t chunk = 0; chunk < n_chunks; ++chunk) {
+                const std::size_t count   = histograms[chunk][bucket];
+                histograms[chunk][bucket] = offset;
+                offset += count;
+            }
+        }
+        parallel_for_chunks(
+            0, n,
+            [&](std::size_t begin, std::size_t end, std::size_t chunk) {
+                Histogram& position = histograms[chunk];
+                for (std::size_t i = begin; i < end; ++i) {
+                    const std::size_t target = position[(keys[i] >> shift) & 0xFFu]++;
+                    keys_out[target]         = keys[i];
+                    values_out[target]       = values[i];
+                }
+            },
+            n_threads
+        );
+        keys.swap(keys_out);
+        values.swap(values_out);
+    }
+}
+
+#endif // DANDELION_UTILS_PARALLEL_HPP
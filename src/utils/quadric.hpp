@@ -0,0 +1,155 @@
+#ifndef DANDELION_UTILS_QUADRIC_HPP
+#define DANDELION_UTILS_QUADRIC_HPP
+
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <optional>
+
+#include <Eigen/Core>
+#include <Eigen/LU>
+
+/*!
+ * \file utils/quadric.hpp
+ * \ingroup utils
+ */
+
+// ------------------- Declarations ----------------------
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 二次误差度量 (Quadric Error Metric, QEM) 使用的二次误差矩阵。
+ *
+ * 二次误差矩阵是一个 4x4 的对称矩阵 \f$Q\f$ ，点 \f$v\f$ 的误差为
+ * \f$\tilde{v}^T Q \tilde{v}\f$ ，其中 \f$\tilde{v}\f$ 是 \f$v\f$ 的齐次坐标。
+ * 由于矩阵对称，这里只按行存储上三角部分的 10 个元素，比 `Eigen::Matrix4f` 节省近一半的内存，
+ * 适合按句柄存放在连续数组中。
+ */
+struct Quadric
+{
+    /*! \~chinese 构造零矩阵。 */
+    Quadric();
+    /*!
+     * \~chinese
+     * \brief 构造到一个平面的距离平方对应的矩阵 \f$pp^T\f$ 。
+     *
+     * \param plane 平面方程 \f$ax + by + cz + d = 0\f$ 的系数 \f$(a, b, c, d)\f$ ，
+     * 其中 \f$(a, b, c)\f$ 应为单位向量
+     */
+    explicit Quadric(const Eigen::Vector4f& plane);
+    Quadric& operator+=(const Quadric& other);
+    Quadric  operator+(const Quadric& other) const;
+    /*! \~chinese 乘以一个权重，例如按面片面积加权。 */
+    Quadric& operator*=(float weight);
+    /*! \~chinese 点 `p` 处的误差，总是非负。 */
+    float error(const Eigen::Vector3f& p) const;
+    /*! \~chinese 误差最小的点，如果这样的点不唯一（矩阵的左上 3x3 部分不可逆）则返回空值。 */
+    std::optional<Eigen::Vector3f> minimizer() const;
+    /*!
+     * \~chinese
+     * \brief 把线段 \f$ab\f$ 坍缩成一个点时的最佳位置。
+     *
+     * 误差最小的点唯一时返回这个点，否则在两个端点和中点中选择误差最小的一个。
+     */
+    Eigen::Vector3f optimal_point(const Eigen::Vector3f& a, const Eigen::Vector3f& b) const;
+
+    /*!
+     * \~chinese
+     * \brief 上三角部分的元素，依次为
+     * \f$q_{00}, q_{01}, q_{02}, q_{03}, q_{11}, q_{12}, q_{13}, q_{22}, q_{23}, q_{33}\f$ 。
+     */
+    std::array<float, 10> coefficients;
+};
+
+// ------------------- Definitions ----------------------
+
+inline Quadric::Quadric()
+{
+    coefficients.fill(0.0f);
+}
+
+inline Quadric::Quadric(const Eigen::Vector4f& plane)
+{
+    const float a = plane.x();
+    const float b = plane.y();
+    const float c = plane.z();
+    const float d = plane.w();
+    coefficients  = {a * a, a * b, a * c, a * d, b * b, b * c, b * d, c * c, c * d, d * d};
+}
+
+inline Quadric& Quadric::operator+=(const Quadric& other)
+{
+    for (std::size_t i = 0; i < coefficients.size(); ++i) {
+        coefficients[i] += other.coefficients[i];
+    }
+    return *this;
+}
+
+inline Quadric Quadric::operator+(const Quadric& other) const
+{
+    Quadric result = *this;
+    result += other;
+    return result;
+}
+
+inline Quadric& Quadric::operator*=(float weight)
+{
+    for (float& coefficient: coefficients) {
+        coefficient *= weight;
+    }
+    return *this;
+}
+
+inline float Quadric::error(const Eigen::Vector3f& p) const
+{
+    const std::array<float, 10>& q = coefficients;
+    const float                  x = p.x();
+    const float                  y = p.y();
+    const float                  z = p.z();
+
+    const float result = q[0] * x * x + 2.0f * q[1] * x * y + 2.0f * q[2] * x * z
+                       + 2.0f * q[3] * x + q[4] * y * y + 2.0f * q[5] * y * z + 2.0f * q[6] * y
+                       + q[7] * z * z + 2.0f * q[8] * z + q[9];
+    // rounding errors may make the sum of squares slightly negative
+    return result > 0.0f ? result : 0.0f;
+}
+
+inline std::optional<Eigen::Vector3f> Quadric::minimizer() const
+{
+    const std::array<float, 10>& q = coefficients;
+    Eigen::Matrix3f              A;
+    A << q[0], q[1], q[2], q[1], q[4], q[5], q[2], q[5], q[7];
+    // The determinant scales with the cube of the entries, so the threshold does too: scaling
+    // the quadric by an area weight never changes whether it counts as invertible.
+    const float     scale = A.cwiseAbs().maxCoeff();
+    Eigen::Matrix3f inverse;
+    bool            invertible = false;
+    A.computeInverseWithCheck(inverse, invertible, 1e-6f * scale * scale * scale);
+    if (!invertible) {
+        return std::nullopt;
+    }
+    return -(inverse * Eigen::Vector3f(q[3], q[6], q[8]));
+}
+
+inline Eigen::Vector3f Quadric::optimal_point(
+    const Eigen::Vector3f& a, const Eigen::Vector3f& b
+) const
+{
+    const std::optional<Eigen::Vector3f> point = minimizer();
+    if (point.has_value()) {
+        return point.value();
+    }
+    Eigen::Vector3f best       = 0.5f * (a + b);
+    float           best_error = error(best);
+    for (const Eigen::Vector3f& candidate: {a, b}) {
+        const float candidate_error = error(candidate);
+        if (candidate_error < best_error) {
+            best       = candidate;
+            best_error = candidate_error;
+        }
+    }
+    return best;
+}
+
+#endif // DANDELION_UTILS_QUADRIC_HPP
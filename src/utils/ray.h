@@ -8,13 +8,16 @@
  * \brief 提供生成射线、判定相交的工具函数。
  */
 
+#include <cmath>
 #include <cstddef>
 #include <optional>
 
 #include <Eigen/Core>
+#include <Eigen/Geometry>
 
 #include "../platform/gl.hpp"
 #include "../scene/camera.h"
+#include "math.hpp"
 
 /*!
  * \ingroup rendering
@@ -65,6 +68,37 @@ struct Intersection
  */
 Ray generate_ray(int width, int height, int x, int y, Camera& camera, float depth);
 
+/*!
+ * \ingroup rendering
+ * \ingroup utils
+ * \~chinese
+ * \brief 生成从相机出发、穿过成像平面上任意一点（可以位于像素内部）的射线。
+ *
+ * 与 `generate_ray` 不同，这里的坐标是连续的：图像左上角为 \f$(0, 0)\f$ ，像素 \f$(i, j)\f$
+ * 覆盖 \f$[i, i+1) \times [j, j+1)\f$ ，第 0 行位于图像顶部。超采样和路径追踪需要在像素内取多个点。
+ *
+ * \param camera 指定的相机
+ * \param width 成像平面的宽度（以像素计）
+ * \param height 成像平面的高度（以像素计）
+ * \param x 成像平面上指定点的 x 坐标
+ * \param y 成像平面上指定点的 y 坐标
+ *
+ * \returns 构造出的射线，方向为单位向量
+ */
+inline Ray generate_subpixel_ray(const Camera& camera, float width, float height, float x, float y)
+{
+    const Eigen::Vector3f forward = (camera.target - camera.position).normalized();
+    const Eigen::Vector3f right   = forward.cross(camera.world_up).normalized();
+    const Eigen::Vector3f up      = right.cross(forward);
+    const float           half_h  = std::tan(radians(camera.fov_y_degrees) / 2.0f);
+    const float           half_w  = half_h * width / height;
+    const float           ndc_x   = 2.0f * x / width - 1.0f;
+    const float           ndc_y   = 1.0f - 2.0f * y / height;
+    const Eigen::Vector3f direction =
+        (forward + ndc_x * half_w * right + ndc_y * half_h * up).normalized();
+    return {camera.position, direction};
+}
+
 /*!
  * \ingroup rendering
  * \ingroup utils
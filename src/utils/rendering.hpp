@@ -29,6 +29,9 @@
 constexpr unsigned int vertex_position_location = 0;
 constexpr unsigned int vertex_color_location    = 1;
 constexpr unsigned int vertex_normal_location   = 2;
+constexpr unsigned int instance_offset_location = 3;
+constexpr unsigned int instance_scale_location  = 4;
+constexpr unsigned int baked_lighting_location  = 5;
 ///@}
 
 /*!
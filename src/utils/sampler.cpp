@@ -0,0 +1,224 @@
+#include "sampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+using Eigen::Vector2f;
+using std::size_t;
+using std::uint32_t;
+
+namespace {
+
+// 蓝噪声纹理的边长（必须是 2 的幂）
+constexpr uint32_t tile_size = 64;
+// 小于 1 的最大单精度浮点数
+constexpr float one_minus_epsilon = 0x1.fffffep-1f;
+
+// 32 位整数哈希 (lowbias32, https://nullprogram.com/blog/2018/07/31/)
+uint32_t mix(uint32_t x)
+{
+    x ^= x >> 16;
+    x *= 0x7feb352du;
+    x ^= x >> 15;
+    x *= 0x846ca68bu;
+    x ^= x >> 16;
+    return x;
+}
+
+uint32_t hash_combine(uint32_t seed, uint32_t value)
+{
+    return mix(seed ^ (value + 0x9e3779b9u + (seed << 6) + (seed >> 2)));
+}
+
+// 取高 24 位转换为 [0, 1) 内的浮点数
+float to_float(uint32_t x)
+{
+    return static_cast<float>(x >> 8) * 0x1p-24f;
+}
+
+uint32_t reverse_bits(uint32_t x)
+{
+    x = ((x >> 1) & 0x5555'5555u) | ((x & 0x5555'5555u) << 1);
+    x = ((x >> 2) & 0x3333'3333u) | ((x & 0x3333'3333u) << 2);
+    x = ((x >> 4) & 0x0F0F'0F0Fu) | ((x & 0x0F0F'0F0Fu) << 4);
+    x = ((x >> 8) & 0x00FF'00FFu) | ((x & 0x00FF'00FFu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+// Sobol 序列的第二个维度（第一个维度就是 reverse_bits 得到的 van der Corput 序列）
+uint32_t sobol_second(uint32_t index)
+{
+    uint32_t result = 0;
+    for (uint32_t v = 1u << 31; index != 0; index >>= 1, v ^= v >> 1) {
+        if (index & 1u) {
+            result ^= v;
+        }
+    }
+    return result;
+}
+
+// Laine-Karras 置换：每一位只受更低位影响，作用在反转后的位上就等价于 Owen 置乱
+uint32_t laine_karras_permutation(uint32_t x, uint32_t seed)
+{
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return x;
+}
+
+uint32_t nested_uniform_scramble(uint32_t x, uint32_t seed)
+{
+    return reverse_bits(laine_karras_permutation(reverse_bits(x), seed));
+}
+
+// 把 value 折回 [0, 1)
+float wrap(float value)
+{
+    return std::min(value - std::floor(value), one_minus_epsilon);
+}
+
+// 用 void-and-cluster 方法的填充阶段生成蓝噪声纹理：每次把下一个名次分配给
+// 能量（到已分配像素的高斯加权距离之和）最低的像素，最后按名次均匀映射到 (0, 1)
+std::vector<float> generate_blue_noise_tile()
+{
+    constexpr size_t n_pixels = tile_size * tile_size;
+    constexpr int    radius   = 6;
+    constexpr float  sigma    = 1.9f;
+    float            kernel[2 * radius + 1][2 * radius + 1];
+    for (int dy = -radius; dy <= radius; ++dy) {
+        for (int dx = -radius; dx <= radius; ++dx) {
+            kernel[dy + radius][dx + radius] =
+                std::exp(-static_cast<float>(dx * dx + dy * dy) / (2.0f * sigma * sigma));
+        }
+    }
+    std::vector<float> energy(n_pixels, 0.0f);
+    std::vector<bool>  assigned(n_pixels, false);
+    std::vector<float> tile(n_pixels, 0.0f);
+    for (size_t rank = 0; rank < n_pixels; ++rank) {
+        size_t pick       = 0;
+        float  min_energy = std::numeric_limits<float>::max();
+        for (size_t i = 0; i < n_pixels; ++i) {
+            if (!assigned[i] && energy[i] < min_energy) {
+                min_energy = energy[i];
+                pick       = i;
+            }
+        }
+        assigned[pick] = true;
+        tile[pick]     = (static_cast<float>(rank) + 0.5f) / static_cast<float>(n_pixels);
+        const int px   = static_cast<int>(pick % tile_size);
+        const int py   = static_cast<int>(pick / tile_size);
+        for (int dy = -radius; dy <= radius; ++dy) {
+            for (int dx = -radius; dx <= radius; ++dx) {
+                const size_t x = static_cast<size_t>(px + dx) & (tile_size - 1);
+                const size_t y = static_cast<size_t>(py + dy) & (tile_size - 1);
+                energy[y * tile_size + x] += kernel[dy + radius][dx + radius];
+            }
+        }
+    }
+    return tile;
+}
+
+const std::vector<float>& blue_noise_tile()
+{
+    static const std::vector<float> tile = generate_blue_noise_tile();
+    return tile;
+}
+
+} // namespace
+
+Sampler::Sampler(uint32_t seed) :
+    seed(seed), pixel_x(0), pixel_y(0), pixel_seed(0), sample_index(0), dimension(0)
+{
+}
+
+void Sampler::start_pixel(uint32_t x, uint32_t y, uint32_t sample_index, uint32_t dimension)
+{
+    pixel_x            = x;
+    pixel_y            = y;
+    pixel_seed         = hash_combine(hash_combine(seed, x), y);
+    this->sample_index = sample_index;
+    this->dimension    = dimension;
+}
+
+uint32_t Sampler::current_dimension() const
+{
+    return dimension;
+}
+
+float IndependentSampler::next_1d()
+{
+    const uint32_t value = hash_combine(hash_combine(pixel_seed, sample_index), dimension);
+    ++dimension;
+    return to_float(value);
+}
+
+Vector2f IndependentSampler::next_2d()
+{
+    const float x = next_1d();
+    const float y = next_1d();
+    return {x, y};
+}
+
+float SobolSampler::next_1d()
+{
+    const uint32_t dimension_seed = hash_combine(pixel_seed, dimension);
+    const uint32_t index          = nested_uniform_scramble(sample_index, dimension_seed);
+    ++dimension;
+    return to_float(nested_uniform_scramble(reverse_bits(index), mix(dimension_seed)));
+}
+
+Vector2f SobolSampler::next_2d()
+{
+    const uint32_t dimension_seed = hash_combine(pixel_seed, dimension);
+    const uint32_t index          = nested_uniform_scramble(sample_index, dimension_seed);
+    const uint32_t x = nested_uniform_scramble(reverse_bits(index), hash_combine(dimension_seed, 0));
+    const uint32_t y = nested_uniform_scramble(sobol_second(index), hash_combine(dimension_seed, 1));
+    dimension += 2;
+    return {to_float(x), to_float(y)};
+}
+
+float BlueNoiseSampler::next_1d()
+{
+    // 样本序号的置乱只与维度有关，所有像素使用同一个序列，差别只在蓝噪声平移上
+    const uint32_t dimension_seed = hash_combine(seed, dimension);
+    const uint32_t index          = nested_uniform_scramble(sample_index, dimension_seed);
+    const uint32_t shift          = mix(dimension_seed);
+    const uint32_t x              = (pixel_x + shift) & (tile_size - 1);
+    const uint32_t y              = (pixel_y + (shift >> 8)) & (tile_size - 1);
+    ++dimension;
+    return wrap(to_float(reverse_bits(index)) + blue_noise_tile()[y * tile_size + x]);
+}
+
+Vector2f BlueNoiseSampler::next_2d()
+{
+    const std::vector<float>& tile = blue_noise_tile();
+
+    const uint32_t dimension_seed = hash_combine(seed, dimension);
+    const uint32_t index          = nested_uniform_scramble(sample_index, dimension_seed);
+    float          offsets[2];
+    for (uint32_t axis = 0; axis < 2; ++axis) {
+        const uint32_t shift = hash_combine(dimension_seed, axis);
+        const uint32_t x     = (pixel_x + shift) & (tile_size - 1);
+        const uint32_t y     = (pixel_y + (shift >> 8)) & (tile_size - 1);
+        offsets[axis]        = tile[y * tile_size + x];
+    }
+    dimension += 2;
+    return {
+        wrap(to_float(reverse_bits(index)) + offsets[0]),
+        wrap(to_float(sobol_second(index)) + offsets[1])
+    };
+}
+
+std::unique_ptr<Sampler> make_sampler(SamplerType type, uint32_t seed)
+{
+    switch (type) {
+    case SamplerType::INDEPENDENT: return std::make_unique<IndependentSampler>(seed);
+    case SamplerType::BLUE_NOISE: return std::make_unique<BlueNoiseSampler>(seed);
+    case SamplerType::SOBOL:
+    default: return std::make_unique<SobolSampler>(seed);
+    }
+}
@@ -0,0 +1,140 @@
+#ifndef DANDELION_UTILS_SAMPLER_H
+#define DANDELION_UTILS_SAMPLER_H
+
+#include <cstdint>
+#include <memory>
+
+#include <Eigen/Core>
+
+/*!
+ * \file utils/sampler.h
+ * \ingroup utils
+ * \~chinese
+ * \brief 光线追踪使用的采样器。
+ *
+ * 采样器按“像素、样本序号、维度”生成 \f$[0, 1)\f$ 内的随机数：调用 `Sampler::start_pixel`
+ * 选定像素和样本后，每次调用 `next_1d` 或 `next_2d` 都会消耗一个或两个维度。
+ * 生成的数只由像素坐标、样本序号、维度和 `Sampler::seed` 决定，与调用它的线程无关，
+ * 因此渲染结果在不同线程数下完全一致。采样器不共享任何可变状态，每个线程应当持有自己的采样器。
+ */
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 可用的采样器类型。
+ */
+enum class SamplerType
+{
+    /*! \~chinese 每个维度独立的均匀随机数（基于哈希，仅作对照）。 */
+    INDEPENDENT,
+    /*! \~chinese 经过 Owen 置乱的 Sobol 序列，收敛最快。 */
+    SOBOL,
+    /*! \~chinese 屏幕空间误差呈蓝噪声分布的 Sobol 序列，低样本数时噪点更不显眼。 */
+    BLUE_NOISE
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 确定性采样器的公共接口。
+ */
+class Sampler
+{
+public:
+
+    Sampler(std::uint32_t seed);
+    virtual ~Sampler() = default;
+
+    /*!
+     * \~chinese
+     * \brief 开始生成某个像素的第 `sample_index` 个样本，维度从 `dimension` 开始计数。
+     *
+     * 中断后从记录的维度继续，得到的值与不中断时完全相同，因此波前调度的渲染器可以
+     * 在不同的弹射之间用同一个采样器处理不同的像素。
+     */
+    void start_pixel(
+        std::uint32_t x, std::uint32_t y, std::uint32_t sample_index, std::uint32_t dimension = 0
+    );
+    /*! \~chinese 当前样本已经消耗的维度数。 */
+    std::uint32_t current_dimension() const;
+    /*! \~chinese 生成当前样本的下一个维度。 */
+    virtual float next_1d() = 0;
+    /*! \~chinese 生成当前样本的下两个维度，两个维度之间保持低差异性。 */
+    virtual Eigen::Vector2f next_2d() = 0;
+
+    /*! \~chinese 全局种子，改变它可以得到另一组互不相关的样本。 */
+    std::uint32_t seed;
+
+protected:
+
+    /*! \~chinese 当前像素的横坐标。 */
+    std::uint32_t pixel_x;
+    /*! \~chinese 当前像素的纵坐标。 */
+    std::uint32_t pixel_y;
+    /*! \~chinese 由像素坐标和全局种子得到的哈希值。 */
+    std::uint32_t pixel_seed;
+    /*! \~chinese 当前样本在像素内的序号。 */
+    std::uint32_t sample_index;
+    /*! \~chinese 当前样本已经消耗的维度数。 */
+    std::uint32_t dimension;
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 每个维度都由哈希函数独立生成的随机采样器。
+ */
+class IndependentSampler : public Sampler
+{
+public:
+
+    using Sampler::Sampler;
+    float           next_1d() override;
+    Eigen::Vector2f next_2d() override;
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief Owen 置乱的 Sobol 采样器。
+ *
+ * 实现参考 B. Burley, "Practical Hash-based Owen Scrambling", JCGT 2020：
+ * 每两个维度使用同一组二维 Sobol 点，先用基于哈希的嵌套置乱打乱样本序号（使不同维度对、
+ * 不同像素之间互不相关），再对每个坐标做 Owen 置乱。
+ */
+class SobolSampler : public Sampler
+{
+public:
+
+    using Sampler::Sampler;
+    float           next_1d() override;
+    Eigen::Vector2f next_2d() override;
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 误差在屏幕空间呈蓝噪声分布的采样器。
+ *
+ * 所有像素共用同一个未置乱的二维 Sobol 序列，每个像素再按一张 64x64 蓝噪声纹理做
+ * Cranley-Patterson 平移（不同维度使用纹理的不同平移副本）。相邻像素的平移量差异很大，
+ * 因此低样本数时的误差表现为高频的蓝噪声，而不是成片的色块。
+ * 蓝噪声纹理在第一次使用时用 void-and-cluster 方法的填充阶段生成。
+ */
+class BlueNoiseSampler : public Sampler
+{
+public:
+
+    using Sampler::Sampler;
+    float           next_1d() override;
+    Eigen::Vector2f next_2d() override;
+};
+
+/*!
+ * \ingroup utils
+ * \~chinese
+ * \brief 创建指定类型的采样器。
+ */
+std::unique_ptr<Sampler> make_sampler(SamplerType type, std::uint32_t seed = 0);
+
+#endif // DANDELION_UTILS_SAMPLER_H
@@ -0,0 +1,491 @@
+#include "vertex_clustering.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <Eigen/Core>
+#include <Eigen/Geometry>
+
+#include "logger.h"
+#include "quadric.hpp"
+
+namespace fs = std::filesystem;
+using Eigen::Vector3f;
+using Eigen::Vector4f;
+using std::size_t;
+using std::string;
+using std::uint32_t;
+using std::uint64_t;
+using std::vector;
+
+namespace {
+
+using Triangle = std::array<Vector3f, 3>;
+
+// the number of triangles passed to each visit
+constexpr size_t chunk_size = 4096;
+// Cell coordinates and cell IDs are 21-bit integers, so three of them fit in a 64-bit key.
+constexpr uint32_t coordinate_bits = 21;
+constexpr uint64_t coordinate_mask = (uint64_t(1) << coordinate_bits) - 1;
+constexpr uint32_t no_vertex       = std::numeric_limits<uint32_t>::max();
+
+// A binary STL file has an 80-byte header and a 4-byte triangle count, followed by 50 bytes per
+// triangle: 12 floats for the normal and the three vertices, and a 2-byte attribute.
+constexpr size_t STL_header_bytes   = 84;
+constexpr size_t STL_triangle_bytes = 50;
+
+// Passes the triangles gathered in chunk to visit.
+template<typename Visitor>
+void flush(vector<Triangle>& chunk, Visitor& visit)
+{
+    if (!chunk.empty()) {
+        visit(chunk);
+        chunk.clear();
+    }
+}
+
+template<typename Visitor>
+bool read_binary_STL(std::ifstream& file, uint64_t n_triangles, Visitor& visit)
+{
+    vector<char>     buffer(chunk_size * STL_triangle_bytes);
+    vector<Triangle> chunk;
+    chunk.reserve(chunk_size);
+    file.seekg(STL_header_bytes);
+    for (uint64_t first = 0; first < n_triangles; first += chunk_size) {
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(chunk_size, n_triangles - first));
+        if (!file.read(buffer.data(), static_cast<std::streamsize>(n * STL_triangle_bytes))) {
+            return false;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            // skip the normal at the beginning of each record
+            const char* record = buffer.data() + i * STL_triangle_bytes + 3 * sizeof(float);
+            Triangle    triangle;
+            for (size_t k = 0; k < 3; ++k) {
+                std::memcpy(triangle[k].data(), record + 3 * k * sizeof(float), 3 * sizeof(float));
+            }
+            chunk.push_back(triangle);
+        }
+        flush(chunk, visit);
+    }
+    return true;
+}
+
+// Parses 3 floats starting from text, returns false if any of them fails to parse.
+bool parse_position(const char* text, Vector3f& position)
+{
+    for (int k = 0; k < 3; ++k) {
+        char* end   = nullptr;
+        position[k] = std::strtof(text, &end);
+        if (end == text) {
+            return false;
+        }
+        text = end;
+    }
+    return true;
+}
+
+template<typename Visitor>
+bool read_ASCII_STL(std::ifstream& file, Visitor& visit)
+{
+    vector<Triangle> chunk;
+    chunk.reserve(chunk_size);
+    Triangle triangle;
+    size_t   n_corners = 0;
+    string   line;
+    while (std::getline(file, line)) {
+        const size_t begin = line.find_first_not_of(" \t");
+        if (begin == string::npos || line.compare(begin, 6, "vertex") != 0) {
+            continue;
+        }
+        if (!parse_position(line.c_str() + begin + 6, triangle[n_corners])) {
+            return false;
+        }
+        n_corners = (n_corners + 1) % 3;
+        if (n_corners == 0) {
+            chunk.push_back(triangle);
+            if (chunk.size() == chunk_size) {
+                flush(chunk, visit);
+            }
+        }
+    }
+    flush(chunk, visit);
+    return true;
+}
+
+// Faces in an OBJ file refer to earlier vertices by index, so all vertex positions are kept and
+// the memory used here grows with the input rather than the output.
+// Polygons are split into triangle fans, texture coordinate and normal indices are ignored.
+template<typename Visitor>
+bool read_OBJ(std::ifstream& file, Visitor& visit)
+{
+    vector<Vector3f> positions;
+    vector<Triangle> chunk;
+    chunk.reserve(chunk_size);
+    vector<uint32_t> corners;
+    string           line;
+    while (std::getline(file, line)) {
+        if (line.size() < 2 || (line[1] != ' ' && line[1] != '\t')) {
+            continue;
+        }
+        if (line[0] == 'v') {
+            Vector3f position;
+            if (!parse_position(line.c_str() + 1, position)) {
+                return false;
+            }
+            positions.push_back(position);
+            continue;
+        }
+        if (line[0] != 'f') {
+            continue;
+        }
+        corners.clear();
+        const char* text = line.c_str() + 1;
+        while (true) {
+            char*      end   = nullptr;
+            const long index = std::strtol(text, &end, 10);
+            if (end == text) {
+                break;
+            }
+            // positive indices start from 1, negative ones count back from the last vertex
+            const long n_positions = static_cast<long>(positions.size());
+            const long resolved    = index > 0 ? index - 1 : n_positions + index;
+            if (index == 0 || resolved < 0 || resolved >= n_positions) {
+                return false;
+            }
+            corners.push_back(static_cast<uint32_t>(resolved));
+            // skip the "/vt/vn" part
+            text = end;
+            while (*text != '\0' && *text != ' ' && *text != '\t') {
+                ++text;
+            }
+        }
+        for (size_t k = 2; k < corners.size(); ++k) {
+            chunk.push_back(
+                {positions[corners[0]], positions[corners[k - 1]], positions[corners[k]]}
+            );
+            if (chunk.size() == chunk_size) {
+                flush(chunk, visit);
+            }
+        }
+    }
+    flush(chunk, visit);
+    return true;
+}
+
+// Reads all triangles of the file in chunks and calls visit(const vector<Triangle>&) once per
+// chunk.
+template<typename Visitor>
+bool read_triangles(const fs::path& path, Visitor&& visit)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        return false;
+    }
+    string extension = path.extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    if (extension == ".obj") {
+        return read_OBJ(file, visit);
+    }
+    if (extension != ".stl") {
+        return false;
+    }
+    // ASCII STL files may also start with "solid", so the two formats are told apart by file size.
+    std::error_code error;
+    const uintmax_t file_size   = fs::file_size(path, error);
+    uint32_t        n_triangles = 0;
+    if (!error && file_size >= STL_header_bytes) {
+        file.seekg(STL_header_bytes - sizeof(uint32_t));
+        file.read(reinterpret_cast<char*>(&n_triangles), sizeof(uint32_t));
+        if (file && file_size == STL_header_bytes + n_triangles * uint64_t(STL_triangle_bytes)) {
+            return read_binary_STL(file, n_triangles, visit);
+        }
+    }
+    file.clear();
+    file.seekg(0);
+    return read_ASCII_STL(file, visit);
+}
+
+struct Cell
+{
+    Quadric  quadric;
+    Vector3f position_sum = Vector3f::Zero();
+    uint32_t n_vertices   = 0;
+};
+
+// A uniform grid over the bounding box that only stores the occupied cells.
+class CellGrid
+{
+public:
+
+    CellGrid(const Vector3f& origin, float cell_size, size_t resolution, size_t max_cells);
+    void          add(const Triangle& triangle);
+    ClusteredMesh extract() const;
+    size_t        resolution() const;
+
+private:
+
+    // the cell coordinates (x, y, z) packed into a key
+    uint64_t cell_key(const Vector3f& position) const;
+    uint32_t cell_id(uint64_t key);
+    // halves the resolution by merging every 8 neighboring cells
+    void coarsen();
+    // the position of the vertex representing a cell
+    Vector3f representative(uint32_t id) const;
+
+    Vector3f origin;
+    float    cell_size;
+    size_t   full_resolution;
+    // the current cells are 2^shift times as large as cell_size
+    uint32_t shift;
+    size_t   max_cells;
+
+    std::unordered_map<uint64_t, uint32_t> ids;
+    vector<uint64_t>                       keys;
+    vector<Cell>                           cells;
+    // output triangles as three 21-bit cell IDs, the smallest one first so that duplicates match
+    std::unordered_set<uint64_t> triangles;
+};
+
+uint64_t pack(uint64_t a, uint64_t b, uint64_t c)
+{
+    return (a << (2 * coordinate_bits)) | (b << coordinate_bits) | c;
+}
+
+std::array<uint32_t, 3> unpack(uint64_t key)
+{
+    return {
+        static_cast<uint32_t>(key >> (2 * coordinate_bits)),
+        static_cast<uint32_t>((key >> coordinate_bits) & coordinate_mask),
+        static_cast<uint32_t>(key & coordinate_mask)
+    };
+}
+
+// Rotates the smallest cell ID to the front while keeping the orientation.
+uint64_t triangle_key(uint32_t a, uint32_t b, uint32_t c)
+{
+    if (b < a && b < c) {
+        return pack(b, c, a);
+    }
+    if (c < a && c < b) {
+        return pack(c, a, b);
+    }
+    return pack(a, b, c);
+}
+
+CellGrid::CellGrid(const Vector3f& origin, float cell_size, size_t resolution, size_t max_cells) :
+    origin(origin), cell_size(cell_size), full_resolution(resolution), shift(0),
+    max_cells(max_cells)
+{
+}
+
+size_t CellGrid::resolution() const
+{
+    return ((full_resolution - 1) >> shift) + 1;
+}
+
+uint64_t CellGrid::cell_key(const Vector3f& position) const
+{
+    uint64_t key = 0;
+    for (int k = 0; k < 3; ++k) {
+        const float    offset     = std::floor((position[k] - origin[k]) / cell_size);
+        const float    last       = static_cast<float>(full_resolution - 1);
+        const uint64_t coordinate = static_cast<uint64_t>(std::clamp(offset, 0.0f, last));
+        key                       = (key << coordinate_bits) | (coordinate >> shift);
+    }
+    return key;
+}
+
+uint32_t CellGrid::cell_id(uint64_t key)
+{
+    const auto [it, inserted] = ids.try_emplace(key, static_cast<uint32_t>(cells.size()));
+    if (inserted) {
+        keys.push_back(key);
+        cells.emplace_back();
+    }
+    return it->second;
+}
+
+void CellGrid::add(const Triangle& triangle)
+{
+    const Vector3f normal = (triangle[1] - triangle[0]).cross(triangle[2] - triangle[0]);
+    const float    length = normal.norm();
+    // degenerate triangles have no plane
+    if (!(length > 0.0f) || !std::isfinite(length)) {
+        return;
+    }
+    // make sure all three corners of the triangle can get a cell
+    while (cells.size() + 3 > max_cells && resolution() > 1) {
+        coarsen();
+    }
+    const Vector3f unit_normal = normal / length;
+    const Vector4f plane(
+        unit_normal.x(), unit_normal.y(), unit_normal.z(), -unit_normal.dot(triangle[0])
+    );
+    Quadric quadric(plane);
+    // weighted by area
+    quadric *= 0.5f * length;
+    uint32_t corner_ids[3];
+    for (size_t k = 0; k < 3; ++k) {
+        corner_ids[k] = cell_id(cell_key(triangle[k]));
+        Cell& cell    = cells[corner_ids[k]];
+        cell.quadric += quadric;
+        cell.position_sum += triangle[k];
+        ++cell.n_vertices;
+    }
+    const uint32_t a = corner_ids[0];
+    const uint32_t b = corner_ids[1];
+    const uint32_t c = corner_ids[2];
+    if (a != b && b != c && c != a) {
+        triangles.insert(triangle_key(a, b, c));
+    }
+}
+
+void CellGrid::coarsen()
+{
+    ++shift;
+    std::unordered_map<uint64_t, uint32_t> new_ids;
+    vector<uint64_t>                       new_keys;
+    vector<Cell>                           new_cells;
+    vector<uint32_t>                       id_map(cells.size());
+    for (size_t i = 0; i < cells.size(); ++i) {
+        const std::array<uint32_t, 3> coordinates = unpack(keys[i]);
+        const uint64_t                key =
+            pack(coordinates[0] >> 1, coordinates[1] >> 1, coordinates[2] >> 1);
+        const auto [it, inserted] =
+            new_ids.try_emplace(key, static_cast<uint32_t>(new_cells.size()));
+        if (inserted) {
+            new_keys.push_back(key);
+            new_cells.emplace_back();
+        }
+        Cell& merged = new_cells[it->second];
+        merged.quadric += cells[i].quadric;
+        merged.position_sum += cells[i].position_sum;
+        merged.n_vertices += cells[i].n_vertices;
+        id_map[i] = it->second;
+    }
+    std::unordered_set<uint64_t> new_triangles;
+    for (const uint64_t key: triangles) {
+        const std::array<uint32_t, 3> corner_ids = unpack(key);
+        const uint32_t                a          = id_map[corner_ids[0]];
+        const uint32_t                b          = id_map[corner_ids[1]];
+        const uint32_t                c          = id_map[corner_ids[2]];
+        if (a != b && b != c && c != a) {
+            new_triangles.insert(triangle_key(a, b, c));
+        }
+    }
+    ids       = std::move(new_ids);
+    keys      = std::move(new_keys);
+    cells     = std::move(new_cells);
+    triangles = std::move(new_triangles);
+}
+
+Vector3f CellGrid::representative(uint32_t id) const
+{
+    const Cell&                   cell        = cells[id];
+    const std::array<uint32_t, 3> coordinates = unpack(keys[id]);
+    const Vector3f                corner(
+        static_cast<float>(coordinates[0]), static_cast<float>(coordinates[1]),
+        static_cast<float>(coordinates[2])
+    );
+    const float    extent = cell_size * static_cast<float>(uint64_t(1) << shift);
+    const Vector3f lower  = origin + extent * corner;
+    // When the minimizer lies outside the cell (usually because the quadric is nearly singular),
+    // fall back to the mean position of the vertices in the cell.
+    const std::optional<Vector3f> minimizer = cell.quadric.minimizer();
+    if (minimizer.has_value() && (minimizer.value() - lower).minCoeff() >= 0.0f
+        && (minimizer.value() - lower).maxCoeff() <= extent) {
+        return minimizer.value();
+    }
+    return cell.position_sum / static_cast<float>(cell.n_vertices);
+}
+
+ClusteredMesh CellGrid::extract() const
+{
+    ClusteredMesh mesh;
+    mesh.resolution = resolution();
+    // sorting makes the output independent of the iteration order of the hash set
+    vector<uint64_t> sorted_triangles(triangles.begin(), triangles.end());
+    std::sort(sorted_triangles.begin(), sorted_triangles.end());
+    vector<uint32_t> vertex_ids(cells.size(), no_vertex);
+    mesh.faces.reserve(3 * sorted_triangles.size());
+    for (const uint64_t key: sorted_triangles) {
+        for (const uint32_t id: unpack(key)) {
+            if (vertex_ids[id] == no_vertex) {
+                vertex_ids[id]          = static_cast<uint32_t>(mesh.vertices.size() / 3);
+                const Vector3f position = representative(id);
+                mesh.vertices.insert(mesh.vertices.end(), position.data(), position.data() + 3);
+            }
+            mesh.faces.push_back(vertex_ids[id]);
+        }
+    }
+    return mesh;
+}
+
+} // namespace
+
+std::optional<ClusteredMesh> cluster_vertices(
+    const string& file_path, size_t resolution, size_t max_cells
+)
+{
+    auto           logger = get_logger("Vertex Clustering");
+    const fs::path path(file_path);
+    resolution = std::clamp<size_t>(resolution, 1, size_t(1) << coordinate_bits);
+    max_cells  = std::clamp<size_t>(max_cells, 4, max_clustering_cells);
+
+    // First pass: compute the bounding box.
+    Vector3f lower         = Vector3f::Constant(std::numeric_limits<float>::infinity());
+    Vector3f upper         = -lower;
+    size_t   n_input_faces = 0;
+
+    const bool bounded = read_triangles(path, [&](const vector<Triangle>& chunk) {
+        for (const Triangle& triangle: chunk) {
+            for (const Vector3f& position: triangle) {
+                lower = lower.cwiseMin(position);
+                upper = upper.cwiseMax(position);
+            }
+        }
+        n_input_faces += chunk.size();
+    });
+    if (!bounded) {
+        logger->warn("failed to read triangles from {}", file_path);
+        return std::nullopt;
+    }
+    if (n_input_faces == 0 || !lower.allFinite() || !upper.allFinite()) {
+        logger->warn("{} does not contain any valid triangle", file_path);
+        return std::nullopt;
+    }
+    logger->info("{}: {} triangles", file_path, n_input_faces);
+
+    // Second pass: accumulate the triangles into the grid cells.
+    const float longest   = (upper - lower).maxCoeff();
+    const float cell_size = longest > 0.0f ? longest / static_cast<float>(resolution) : 1.0f;
+    CellGrid    grid(lower, cell_size, resolution, max_cells);
+    read_triangles(path, [&](const vector<Triangle>& chunk) {
+        for (const Triangle& triangle: chunk) {
+            grid.add(triangle);
+        }
+    });
+    ClusteredMesh mesh = grid.extract();
+    mesh.n_input_faces = n_input_faces;
+    if (mesh.resolution < resolution) {
+        logger->info(
+            "more than {} cells occupied, resolution reduced from {} to {}", max_cells,
+            resolution, mesh.resolution
+        );
+    }
+    logger->info(
+        "simplified to {} vertices, {} faces", mesh.vertices.size() / 3, mesh.faces.size() / 3
+    );
+    return mesh;
+}
@@ -0,0 +1,128 @@
+#ifndef DANDELION_UTILS_VERTEX_CLUSTERING_H
+#define DANDELION_UTILS_VERTEX_CLUSTERING_H
+
+#include <cstddef>
+#include <optional>
+#include <string>
+#include <vector>
+
+/*!
+ * \file utils/vertex_clustering.h
+ * \ingroup utils
+ * \~english
+ * \brief Out-of-core simplification that streams model files and simplifies them by vertex
+ * clustering.
+ *
+ * Scanned models may be too large to be loaded into memory as a whole, let alone to build a
+ * halfedge mesh from. Following P. Lindstrom, "Out-of-Core Simplification of Large Polygonal
+ * Models", SIGGRAPH 2000, triangles are read in chunks and the quadric of each triangle's plane is
+ * added to the grid cells of its three vertices. Triangles whose vertices fall into three
+ * different cells are kept as output triangles, and each cell is finally represented by the point
+ * with the least error. For STL input, memory usage only grows with the number of output cells
+ * and triangles; OBJ input additionally keeps every input vertex position (see
+ * `cluster_vertices`).
+ *
+ * \~chinese
+ * \brief 流式读取模型文件、用顶点聚类简化的外存 (out-of-core) 简化算法。
+ *
+ * 扫描得到的模型可能大到无法整体载入内存（更不用说构造半边网格），
+ * 因此这里参考 P. Lindstrom, "Out-of-Core Simplification of Large Polygonal Models",
+ * SIGGRAPH 2000 ：按块读取三角形，把每个三角形的平面二次误差矩阵累加到它三个顶点所在的网格单元上，
+ * 三个顶点落在不同单元的三角形保留为输出三角形，最后每个单元用误差最小的点代表。
+ * 对于 stl 文件，内存占用只与输出的单元数和三角形数成正比；obj 文件还需要保存所有输入顶点的坐标
+ * （见 `cluster_vertices` ）。
+ */
+
+/*!
+ * \ingroup utils
+ * \~english
+ * \brief The result of vertex clustering, which can be filled into a `GL::Mesh` directly.
+ * \~chinese
+ * \brief 顶点聚类的结果，可以直接填入 `GL::Mesh` 。
+ */
+struct ClusteredMesh
+{
+    /*!
+     * \~english Vertex positions stored one after another, 3 floats per vertex.
+     * \~chinese 依次存放的顶点坐标，每个顶点 3 个数。
+     */
+    std::vector<float> vertices;
+    /*!
+     * \~english Triangle vertex indices stored one after another, 3 indices per face.
+     * \~chinese 依次存放的三角形顶点索引，每个面片 3 个数。
+     */
+    std::vector<unsigned int> faces;
+    /*!
+     * \~english The number of triangles read, counted after polygons are split into fans.
+     * \~chinese 读入的三角形数（多边形按扇形拆分后计算）。
+     */
+    std::size_t n_input_faces = 0;
+    /*!
+     * \~english
+     * The resolution of the final grid (the number of cells along the longest side), which may be
+     * lower than requested if too many cells are occupied.
+     * \~chinese
+     * 最终网格的分辨率（最长边方向上的单元数），可能因单元数超出上限而低于要求的值。
+     */
+    std::size_t resolution = 0;
+};
+
+/*!
+ * \ingroup utils
+ * \~english
+ * \brief The default limit of occupied cells, for which three cell IDs just fit in a 64-bit
+ * integer.
+ * \~chinese
+ * \brief 单元数上限的默认值，三个单元编号恰好能压缩进一个 64 位整数。
+ */
+inline constexpr std::size_t max_clustering_cells = std::size_t(1) << 21;
+
+/*!
+ * \ingroup utils
+ * \~english
+ * \brief Streams a model file and simplifies it by vertex clustering.
+ *
+ * OBJ and STL (binary or ASCII) files are supported. The file is read twice: the first pass
+ * computes the bounding box, the second reads triangles in chunks and accumulates them into the
+ * grid cells. An STL file is a plain sequence of triangles, so only the current chunk is kept in
+ * memory; faces in an OBJ file refer to vertices by index, so the positions of all input vertices
+ * are kept as well (12 bytes per vertex, far less than the corresponding halfedge mesh).
+ *
+ * \warning For OBJ files the peak memory therefore grows with the number of input vertices, not
+ * only with the size of the output. An OBJ model whose vertex positions alone do not fit in memory
+ * cannot be simplified this way and should be converted to STL first.
+ *
+ * Whenever more than `max_cells` cells are occupied, the resolution is halved and every 8
+ * neighboring cells are merged into one, so the hash table stays bounded.
+ *
+ * \param file_path path of the model file
+ * \param resolution the number of cells along the longest side of the bounding box
+ * \param max_cells limit of occupied cells, no more than `max_clustering_cells`
+ * \returns the simplified mesh, or `std::nullopt` if the file cannot be opened or its format is
+ * not supported
+ *
+ * \~chinese
+ * \brief 流式读取模型文件并用顶点聚类简化。
+ *
+ * 支持 obj 和 stl （二进制或文本格式）文件。文件会被读取两遍：第一遍计算包围盒，
+ * 第二遍按块读取三角形并累加到网格单元中。stl 文件本身就是三角形的序列，读取时只保留当前块；
+ * obj 文件的面片按编号引用顶点，因此需要额外保存所有输入顶点的坐标（每个顶点 12 字节，
+ * 远小于对应的半边网格）。
+ *
+ * \warning 因此读取 obj 文件时，内存占用的峰值随输入顶点数增长，而不只与输出的大小有关。
+ * 仅顶点坐标就无法放入内存的 obj 模型不能用这种方法简化，应当先转换为 stl 文件。
+ *
+ * 被占用的单元数超过 `max_cells` 时，网格的分辨率减半、相邻的 8 个单元合并成一个，
+ * 因此哈希表的大小始终有界。
+ *
+ * \param file_path 模型文件路径
+ * \param resolution 包围盒最长边方向上的单元数
+ * \param max_cells 单元数上限，不能超过 `max_clustering_cells`
+ * \returns 简化结果，文件无法打开或格式不支持时返回空值
+ */
+std::optional<ClusteredMesh> cluster_vertices(
+    const std::string& file_path, std::size_t resolution,
+    std::size_t max_cells = max_clustering_cells
+);
+
+#endif // DANDELION_UTILS_VERTEX_CLUSTERING_H
@@ -0,0 +1,336 @@
+#include <filesystem>
+#include <list>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <Eigen/Core>
+
+#include "../src/platform/gl.hpp"
+#include "../src/scene/object.h"
+#include "../src/utils/aabb.h"
+#include "../src/utils/bvh.h"
+#include "../src/utils/bvh_cache.h"
+#include "../src/utils/bvh_stats.h"
+#include "../src/utils/light_bvh.h"
+
+using Eigen::Vector3f;
+using std::default_random_engine;
+using std::size_t;
+using std::uniform_real_distribution;
+using std::vector;
+
+namespace {
+
+bool contains(const AABB& outer, const AABB& inner)
+{
+    return (outer.p_min.array() <= inner.p_min.array()).all()
+        && (outer.p_max.array() >= inner.p_max.array()).all();
+}
+
+// 检查每个内部节点都有两个子节点且包围盒覆盖子节点、叶节点包围盒覆盖对应面片，
+// 同时统计各面片出现在叶节点中的次数
+void check_node(const BVHNode* node, const GL::Mesh& mesh, vector<size_t>& leaf_counts)
+{
+    REQUIRE(node != nullptr);
+    if (node->left == nullptr && node->right == nullptr) {
+        REQUIRE(node->face_idx < leaf_counts.size());
+        REQUIRE(contains(node->aabb, get_aabb(mesh, node->face_idx)));
+        ++leaf_counts[node->face_idx];
+        return;
+    }
+    REQUIRE(node->left != nullptr);
+    REQUIRE(node->right != nullptr);
+    REQUIRE(contains(node->aabb, node->left->aabb));
+    REQUIRE(contains(node->aabb, node->right->aabb));
+    check_node(node->left, mesh, leaf_counts);
+    check_node(node->right, mesh, leaf_counts);
+}
+
+// 在 [-10, 10]^3 中随机放置 n_faces 个直角边长为 0.1 的小三角形，每个三角形使用各自的 3 个顶点；
+// 最后 n_coincident 个三角形都位于同一位置
+void make_triangle_soup(
+    size_t n_faces, unsigned int seed, GL::Mesh& mesh, size_t n_coincident = 0
+)
+{
+    default_random_engine            engine(seed);
+    uniform_real_distribution<float> coord(-10.0f, 10.0f);
+    for (size_t i = 0; i < n_faces; ++i) {
+        const Vector3f p = i + n_coincident < n_faces
+                             ? Vector3f(coord(engine), coord(engine), coord(engine))
+                             : Vector3f(1.0f, 2.0f, 3.0f);
+        mesh.vertices.append(p.x(), p.y(), p.z());
+        mesh.vertices.append(p.x() + 0.1f, p.y(), p.z());
+        mesh.vertices.append(p.x(), p.y() + 0.1f, p.z());
+        const unsigned int first = static_cast<unsigned int>(3 * i);
+        mesh.faces.append(first, first + 1, first + 2);
+    }
+}
+
+// 按先序遍历记录每个节点的地址，用于判断 refit 前后树结构是否相同
+void collect_nodes(const BVHNode* node, vector<const BVHNode*>& nodes)
+{
+    if (node == nullptr) {
+        return;
+    }
+    nodes.push_back(node);
+    collect_nodes(node->left, nodes);
+    collect_nodes(node->right, nodes);
+}
+
+} // namespace
+
+TEST_CASE("Parallel LBVH Construction", "[bvh]")
+{
+    for (size_t n_faces: {1, 2, 17, 1000}) {
+        // 最后一半面片重合，用于检查 Morton 码相同时的处理
+        GL::Mesh mesh;
+        make_triangle_soup(n_faces, 42, mesh, n_faces - n_faces / 2);
+
+        BVH bvh(mesh);
+        bvh.parallel_build(4);
+        vector<size_t> leaf_counts(n_faces, 0);
+        check_node(bvh.root, mesh, leaf_counts);
+        for (size_t count: leaf_counts) {
+            REQUIRE(count == 1);
+        }
+        REQUIRE(bvh.count_nodes(bvh.root) == 2 * n_faces - 1);
+        bvh.recursively_delete(bvh.root);
+    }
+}
+
+TEST_CASE("BVH Refit", "[bvh]")
+{
+    default_random_engine            engine(7);
+    uniform_real_distribution<float> coord(-10.0f, 10.0f);
+    constexpr size_t                 n_faces = 500;
+
+    GL::Mesh mesh;
+    make_triangle_soup(n_faces, 7, mesh);
+    BVH bvh(mesh);
+    bvh.parallel_build(2);
+    const float built_cost = bvh.sah_cost();
+    REQUIRE(built_cost > 0.0f);
+
+    // 移动一部分顶点后 refit ，所有包围盒仍应覆盖各自的面片和子节点
+    for (size_t i = 0; i < 3 * n_faces; i += 5) {
+        mesh.vertices.update(i, Vector3f(coord(engine), coord(engine), coord(engine)));
+    }
+    bvh.refit();
+    vector<size_t> leaf_counts(n_faces, 0);
+    check_node(bvh.root, mesh, leaf_counts);
+    for (size_t i = 0; i < n_faces; ++i) {
+        REQUIRE(leaf_counts[i] == 1);
+    }
+    REQUIRE(bvh.sah_cost() > 0.0f);
+    bvh.recursively_delete(bvh.root);
+
+    // 面片数达到并行构建的阈值，使 Object::build_BVH 使用 BVH::parallel_build
+    const size_t object_faces = BVH::parallel_build_threshold;
+    Object       object("Triangle Soup");
+    make_triangle_soup(object_faces, 17, object.mesh);
+    REQUIRE(object.update_BVH());
+    vector<const BVHNode*> built_nodes;
+    collect_nodes(object.bvh->root, built_nodes);
+    REQUIRE(built_nodes.size() == 2 * object_faces - 1);
+
+    // 微小扰动只需 refit ：树结构（每个节点的地址和左右孩子）保持不变
+    uniform_real_distribution<float> jitter(-0.01f, 0.01f);
+    vector<float>&                   positions = object.mesh.vertices.data;
+    for (float& x: positions) {
+        x += jitter(engine);
+    }
+    REQUIRE_FALSE(object.update_BVH());
+    vector<const BVHNode*> refitted_nodes;
+    collect_nodes(object.bvh->root, refitted_nodes);
+    REQUIRE(refitted_nodes == built_nodes);
+    leaf_counts.assign(object_faces, 0);
+    check_node(object.bvh->root, object.mesh, leaf_counts);
+
+    // 把每个三角形整体移到随机位置，refit 后的 SAH 代价远超阈值，应当完整重建
+    for (size_t i = 0; i < object_faces; ++i) {
+        const Vector3f offset(coord(engine), coord(engine), coord(engine));
+        const Vector3f first = object.mesh.vertex(3 * i);
+        for (size_t j = 0; j < 3; ++j) {
+            const Vector3f p = object.mesh.vertex(3 * i + j) - first + offset;
+            positions[3 * (3 * i + j)]     = p.x();
+            positions[3 * (3 * i + j) + 1] = p.y();
+            positions[3 * (3 * i + j) + 2] = p.z();
+        }
+    }
+    REQUIRE(object.update_BVH());
+    leaf_counts.assign(object_faces, 0);
+    check_node(object.bvh->root, object.mesh, leaf_counts);
+    for (size_t count: leaf_counts) {
+        REQUIRE(count == 1);
+    }
+
+    // 面片数量变化后无法 refit ，同样需要完整重建
+    object.mesh.vertices.append(0.0f, 0.0f, 0.0f);
+    object.mesh.vertices.append(0.1f, 0.0f, 0.0f);
+    object.mesh.vertices.append(0.0f, 0.1f, 0.0f);
+    const unsigned int first = static_cast<unsigned int>(3 * object_faces);
+    object.mesh.faces.append(first, first + 1, first + 2);
+    REQUIRE(object.update_BVH());
+    REQUIRE(object.bvh->count_nodes(object.bvh->root) == 2 * (object_faces + 1) - 1);
+}
+
+TEST_CASE("BVH Cache", "[bvh]")
+{
+    constexpr size_t n_faces = 300;
+    GL::Mesh         mesh;
+    make_triangle_soup(n_faces, 11, mesh);
+    BVH bvh(mesh);
+    bvh.parallel_build(2);
+
+    const std::filesystem::path cache_path =
+        std::filesystem::temp_directory_path() / "dandelion_bvh_cache_test.bvh";
+    REQUIRE(BVHCache::write(cache_path.generic_string(), {&bvh}));
+    {
+        BVHCache cache(cache_path.generic_string());
+        REQUIRE(cache.valid());
+        REQUIRE(cache.size() == 1);
+
+        BVH   restored(mesh);
+        float cost = 0.0f;
+        REQUIRE(cache.restore(0, restored, cost));
+        REQUIRE(cost == Catch::Approx(bvh.sah_cost()));
+        REQUIRE(restored.primitives == bvh.primitives);
+        vector<size_t> leaf_counts(n_faces, 0);
+        check_node(restored.root, mesh, leaf_counts);
+        for (size_t count: leaf_counts) {
+            REQUIRE(count == 1);
+        }
+        REQUIRE(restored.count_nodes(restored.root) == bvh.count_nodes(bvh.root));
+        restored.recursively_delete(restored.root);
+
+        // 拓扑不同的 mesh 不能使用这个缓存
+        GL::Mesh other;
+        other.vertices.append(0.0f, 0.0f, 0.0f);
+        other.vertices.append(1.0f, 0.0f, 0.0f);
+        other.vertices.append(0.0f, 1.0f, 0.0f);
+        other.faces.append(0u, 1u, 2u);
+        BVH other_bvh(other);
+        REQUIRE_FALSE(cache.restore(0, other_bvh, cost));
+        REQUIRE(other_bvh.root == nullptr);
+    }
+    std::filesystem::remove(cache_path);
+    bvh.recursively_delete(bvh.root);
+}
+
+TEST_CASE("BVH Statistics", "[bvh]")
+{
+    constexpr size_t n_faces = 200;
+    GL::Mesh         mesh;
+    make_triangle_soup(n_faces, 13, mesh);
+    BVH bvh(mesh);
+    REQUIRE(compute_BVH_stats(bvh).n_nodes == 0);
+    bvh.parallel_build(2);
+
+    const BVHStats stats = compute_BVH_stats(bvh);
+    REQUIRE(stats.n_nodes == 2 * n_faces - 1);
+    REQUIRE(stats.n_leaves == n_faces);
+    REQUIRE(stats.depth_histogram.size() == stats.max_depth + 1);
+    size_t n_histogram_leaves = 0;
+    for (size_t count: stats.depth_histogram) {
+        n_histogram_leaves += count;
+    }
+    REQUIRE(n_histogram_leaves == n_faces);
+    REQUIRE(stats.area_ratio_histogram.size() == BVHStats::n_area_ratio_buckets);
+    REQUIRE(stats.sah_cost == Catch::Approx(bvh.sah_cost()));
+    bvh.recursively_delete(bvh.root);
+
+    // 各线程的计数在 flush 后合并
+    reset_traversal_counters();
+    vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+        threads.emplace_back([]() {
+            for (int i = 0; i < 1000; ++i) {
+                ++thread_traversal_counters().rays;
+                thread_traversal_counters().visited_nodes += 3;
+            }
+            flush_traversal_counters();
+        });
+    }
+    for (std::thread& thread: threads) {
+        thread.join();
+    }
+    const TraversalCounters counters = collected_traversal_counters();
+    REQUIRE(counters.rays == 4000);
+    REQUIRE(counters.visited_nodes == 12000);
+    REQUIRE(counters.triangle_tests == 0);
+}
+
+TEST_CASE("Light BVH", "[bvh]")
+{
+    default_random_engine            engine(11);
+    uniform_real_distribution<float> position(-10.0f, 10.0f);
+    uniform_real_distribution<float> intensity(0.1f, 5.0f);
+    std::list<Light>                 scene_lights;
+    for (int i = 0; i < 300; ++i) {
+        scene_lights.emplace_back(
+            Vector3f(position(engine), position(engine), position(engine)), intensity(engine)
+        );
+    }
+    LightBVH light_bvh;
+    light_bvh.build(scene_lights);
+    REQUIRE(light_bvh.lights.size() == scene_lights.size());
+    REQUIRE(light_bvh.nodes.size() == 2 * scene_lights.size() - 1);
+
+    const Vector3f point(0.5f, -1.0f, 2.0f);
+    const Vector3f normal = Vector3f(0.3f, 1.0f, -0.2f).normalized();
+    const auto     irradiance = [&](const Light& light) {
+        return light.intensity / (light.position - point).squaredNorm();
+    };
+
+    // 阈值为 0 时恰好访问切平面正面的所有光源；有阈值时不会漏掉辐照度不低于阈值的光源
+    for (const float threshold: {0.0f, 0.05f}) {
+        vector<bool> visited(light_bvh.lights.size(), false);
+        light_bvh.for_each_light(point, normal, threshold, [&](const Light& light) {
+            visited[&light - light_bvh.lights.data()] = true;
+        });
+        size_t n_visited = 0;
+        for (size_t i = 0; i < light_bvh.lights.size(); ++i) {
+            const Light& light = light_bvh.lights[i];
+            const bool   front = normal.dot(light.position - point) > 0.0f;
+            if (front && irradiance(light) >= threshold) {
+                REQUIRE(visited[i]);
+            }
+            if (!front) {
+                REQUIRE_FALSE(visited[i]);
+            }
+            n_visited += visited[i];
+        }
+        if (threshold > 0.0f) {
+            REQUIRE(n_visited < light_bvh.lights.size() / 2);
+        }
+    }
+
+    // 抽样得到的频率与返回的概率一致。包含着色点的大子树即使所有光源都在背面，包围盒也无法
+    // 排除它，走进这样的子树时抽样失败；失败的比例与所有光源的概率之和为 1
+    constexpr int n_samples = 200000;
+    int           n_failed  = 0;
+    vector<int>   counts(light_bvh.lights.size(), 0);
+    vector<float> pmfs(light_bvh.lights.size(), 0.0f);
+    for (int k = 0; k < n_samples; ++k) {
+        const float u      = (static_cast<float>(k) + 0.5f) / static_cast<float>(n_samples);
+        const auto  chosen = light_bvh.sample(point, normal, u, 0.0f);
+        if (!chosen.has_value()) {
+            ++n_failed;
+            continue;
+        }
+        REQUIRE(normal.dot(light_bvh.lights[chosen->light].position - point) > 0.0f);
+        ++counts[chosen->light];
+        pmfs[chosen->light] = chosen->pmf;
+    }
+    float pmf_sum = 0.0f;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        pmf_sum += pmfs[i];
+        const float frequency = static_cast<float>(counts[i]) / static_cast<float>(n_samples);
+        REQUIRE(frequency == Catch::Approx(pmfs[i]).margin(1e-4));
+    }
+    const float failed_fraction = static_cast<float>(n_failed) / static_cast<float>(n_samples);
+    REQUIRE(failed_fraction < 0.2f);
+    REQUIRE(pmf_sum + failed_fraction == Catch::Approx(1.0f).epsilon(1e-3));
+}
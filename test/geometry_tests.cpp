@@ -1,7 +1,10 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
+#include <algorithm>
 #include <catch2/catch_amalgamated.hpp>
+#include <filesystem>
 #include <fstream>
+#include <numeric>
 #include <random>
 #include <spdlog/spdlog.h>
 
@@ -9,7 +12,10 @@
 #include "../src/scene/group.h"
 #include "../src/scene/object.h"
 #include "../src/utils/formatter.hpp"
+#include "../src/utils/indexed_heap.hpp"
 #include "../src/utils/math.hpp"
+#include "../src/utils/quadric.hpp"
+#include "../src/utils/vertex_clustering.h"
 
 using Eigen::AngleAxisf;
 using Eigen::Matrix4f;
@@ -25,11 +31,41 @@ using std::pair;
 using std::set;
 using std::string;
 using std::unordered_map;
+using std::uint32_t;
 using std::vector;
 
 constexpr float threshold     = 1e-3f;
 constexpr float threshold_squ = threshold * threshold;
 
+// Index of the vertex (i, j) in a grid built by make_grid.
+static unsigned int grid_vertex_index(unsigned int n, unsigned int i, unsigned int j)
+{
+    return j * (n + 1) + i;
+}
+
+// Appends an n x n grid of unit quads in the z = 0 plane to the mesh, each quad split into two
+// triangles: an open surface with one boundary.
+static void make_grid(unsigned int n, GL::Mesh& mesh)
+{
+    for (unsigned int j = 0; j <= n; ++j) {
+        for (unsigned int i = 0; i <= n; ++i) {
+            mesh.vertices.append(static_cast<float>(i), static_cast<float>(j), 0.0f);
+        }
+    }
+    for (unsigned int j = 0; j < n; ++j) {
+        for (unsigned int i = 0; i < n; ++i) {
+            mesh.faces.append(
+                grid_vertex_index(n, i, j), grid_vertex_index(n, i + 1, j),
+                grid_vertex_index(n, i + 1, j + 1)
+            );
+            mesh.faces.append(
+                grid_vertex_index(n, i, j), grid_vertex_index(n, i + 1, j + 1),
+                grid_vertex_index(n, i, j + 1)
+            );
+        }
+    }
+}
+
 TEST_CASE("Loop Subdivision", "[geometry]")
 {
 
@@ -88,7 +124,7 @@ TEST_CASE("Loop Subdivision", "[geometry]")
 
         unordered_map<Vertex*, size_t> test_vertex_id;
 
-        for (Vertex* v = test_mesh.vertices.head; v != nullptr; v = v->next_node) {
+        for (Vertex* v : test_mesh.vertices) {
             std::optional<size_t> id = std::nullopt;
             for (size_t i = 0; i < test_vertex_count; i++) {
                 if ((v->pos - std_vertices[i]).squaredNorm() < threshold_squ) {
@@ -106,7 +142,7 @@ TEST_CASE("Loop Subdivision", "[geometry]")
         INFO("Edge count: Test: " << test_edge_count << ", Expected: " << std_edge_count);
         REQUIRE(test_edge_count == std_edge_count);
 
-        for (Edge* e = test_mesh.edges.head; e != nullptr; e = e->next_node) {
+        for (Edge* e : test_mesh.edges) {
             Vertex* v1 = e->halfedge->from;
             Vertex* v2 = e->halfedge->inv->from;
             size_t id1 = test_vertex_id[v1];
@@ -125,3 +161,544 @@ TEST_CASE("Loop Subdivision", "[geometry]")
         spdlog::info("Test Pass: loop subdivision of: {}", model_path);
     }
 }
+
+TEST_CASE("Element Pool", "[geometry]")
+{
+    struct Element : PoolElement
+    {
+        Element(int value) : value(value) {}
+        int value;
+    };
+
+    // Enough elements to span several memory blocks.
+    constexpr int        n_elements = 10000;
+    ElementPool<Element> pool;
+    vector<Element*>     elements;
+    for (int i = 0; i < n_elements; ++i) {
+        elements.push_back(pool.emplace(i));
+        REQUIRE(elements.back()->index == static_cast<uint32_t>(i));
+    }
+    REQUIRE(pool.size == n_elements);
+    // Addresses stay stable while the pool grows.
+    for (int i = 0; i < n_elements; ++i) {
+        REQUIRE(pool[static_cast<uint32_t>(i)] == elements[i]);
+        REQUIRE(elements[i]->value == i);
+    }
+
+    // Erased elements stay detectable until they are recycled.
+    for (int i = 0; i < n_elements; i += 2) {
+        pool.erase(elements[i]);
+    }
+    REQUIRE(pool.size == n_elements / 2);
+    REQUIRE_FALSE(pool.contains(elements[0]));
+    REQUIRE(pool.contains(elements[1]));
+    REQUIRE(elements[0]->value == 0);
+    Element* appended = pool.emplace(-1);
+    REQUIRE(appended->index == static_cast<uint32_t>(n_elements));
+    pool.recycle();
+    Element* reused = pool.emplace(-2);
+    REQUIRE(reused->index % 2 == 0);
+    REQUIRE(reused->index < static_cast<uint32_t>(n_elements));
+
+    // Iteration visits live elements in handle order.
+    vector<int> values;
+    for (Element* element : pool) {
+        values.push_back(element->value);
+    }
+    REQUIRE(values.size() == pool.size);
+
+    // Compaction keeps that order and makes the handles dense.
+    const vector<uint32_t> new_indices = pool.compaction_map();
+    pool.compact(new_indices);
+    REQUIRE(pool.capacity() == pool.size);
+    uint32_t counter = 0;
+    for (Element* element : pool) {
+        REQUIRE(element->index == counter);
+        REQUIRE(element->value == values[counter]);
+        ++counter;
+    }
+    REQUIRE(counter == pool.size);
+
+    // An erased slot kept by compaction can be restored, and is not handed out again.
+    Element* first = pool[0];
+    pool.erase(first);
+    pool.recycle();
+    pool.compact(pool.compaction_map({0}));
+    REQUIRE(pool.capacity() == pool.size + 1);
+    REQUIRE_FALSE(pool.is_alive(0));
+    REQUIRE(pool.restore(first, Element(42)) == first);
+    REQUIRE(pool.contains(first));
+    REQUIRE(first->index == 0);
+    REQUIRE(first->value == 42);
+    const Element* last = pool.emplace(43);
+    REQUIRE(last->index == pool.capacity() - 1);
+}
+
+TEST_CASE("Indexed Heap", "[geometry]")
+{
+    std::mt19937                          generator(42);
+    std::uniform_real_distribution<float> distribution(0.0f, 1.0f);
+    constexpr uint32_t                    n_items = 1000;
+    vector<float>                         values(n_items);
+    vector<uint32_t>                      items(n_items);
+    for (uint32_t i = 0; i < n_items; ++i) {
+        values[i] = distribution(generator);
+        items[i]  = i;
+    }
+    IndexedHeap<float> heap;
+    heap.assign(items, values);
+    REQUIRE(heap.size() == n_items);
+
+    // Change some values in either direction and erase some items.
+    for (uint32_t i = 0; i < n_items; i += 3) {
+        values[i] = distribution(generator);
+        heap.push(i, values[i]);
+    }
+    for (uint32_t i = 1; i < n_items; i += 7) {
+        heap.erase(i);
+        values[i] = -1.0f;
+    }
+    REQUIRE_FALSE(heap.contains(1));
+    REQUIRE(heap.contains(2));
+
+    // Popping yields the remaining values in ascending order.
+    float  previous = -1.0f;
+    size_t n_popped = 0;
+    while (!heap.empty()) {
+        const uint32_t item = heap.top();
+        REQUIRE(heap.value(item) == values[item]);
+        REQUIRE(values[item] >= previous);
+        previous = values[item];
+        heap.pop();
+        ++n_popped;
+    }
+    REQUIRE(n_popped == n_items - (n_items - 1 + 6) / 7);
+}
+
+TEST_CASE("Quadric", "[geometry]")
+{
+    // The planes x = 1, y = 2 and z = 3 meet at a single point.
+    Quadric q(Vector4f(1.0f, 0.0f, 0.0f, -1.0f));
+    q += Quadric(Vector4f(0.0f, 1.0f, 0.0f, -2.0f));
+    q += Quadric(Vector4f(0.0f, 0.0f, 1.0f, -3.0f));
+    REQUIRE(q.error(Vector3f::Zero()) == Catch::Approx(14.0f));
+    const std::optional<Vector3f> minimizer = q.minimizer();
+    REQUIRE(minimizer.has_value());
+    REQUIRE((minimizer.value() - Vector3f(1.0f, 2.0f, 3.0f)).norm() < threshold);
+    REQUIRE(q.error(minimizer.value()) == Catch::Approx(0.0f).margin(threshold));
+    // Two parallel planes leave a whole plane of minimizers.
+    const Quadric slab = Quadric(Vector4f(1.0f, 0.0f, 0.0f, 0.0f))
+                       + Quadric(Vector4f(1.0f, 0.0f, 0.0f, -1.0f));
+    REQUIRE_FALSE(slab.minimizer().has_value());
+    REQUIRE(slab.error(Vector3f(0.5f, 7.0f, -3.0f)) == Catch::Approx(0.5f));
+    // Whether the minimizer exists does not depend on the overall weight, and a tiny weight on
+    // the other directions still counts as degenerate.
+    Quadric light = q;
+    light *= 1e-5f;
+    REQUIRE(light.minimizer().has_value());
+    Quadric heavy_slab = slab;
+    heavy_slab *= 1e6f;
+    Quadric thin = Quadric(Vector4f(0.0f, 1.0f, 0.0f, 0.0f));
+    thin += Quadric(Vector4f(0.0f, 0.0f, 1.0f, 0.0f));
+    thin *= 1e-3f;
+    REQUIRE_FALSE((heavy_slab + thin).minimizer().has_value());
+}
+
+TEST_CASE("Halfedge Mesh Construction", "[geometry]")
+{
+    constexpr unsigned int n = 64;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+
+    HalfedgeMesh mesh(grid);
+    REQUIRE_FALSE(mesh.error_info.has_value());
+    const size_t n_edges = 3 * n * n + 2 * n;
+    REQUIRE(mesh.vertices.size == (n + 1) * (n + 1));
+    REQUIRE(mesh.edges.size == n_edges);
+    // The real faces and one virtual face for the boundary loop.
+    REQUIRE(mesh.faces.size == 2 * n * n + 1);
+    REQUIRE(mesh.halfedges.size == 2 * n_edges);
+    size_t n_boundary_vertices = 0;
+    for (Vertex* v : mesh.vertices) {
+        REQUIRE(v == mesh.v_pointers[v->index]);
+        REQUIRE(v->halfedge->from == v);
+        // Boundary vertices point to a halfedge whose inversion lies on the virtual face.
+        if (v->halfedge->inv->is_boundary()) {
+            ++n_boundary_vertices;
+        }
+    }
+    REQUIRE(n_boundary_vertices == 4 * n);
+    for (Halfedge* h : mesh.halfedges) {
+        REQUIRE(h->inv->inv == h);
+        REQUIRE(h->inv->from == h->next->from);
+        REQUIRE(h->edge == h->inv->edge);
+        REQUIRE(h->next->prev == h);
+    }
+
+    // Flipping one triangle makes the surface inconsistently oriented.
+    Object flipped("Flipped");
+    flipped.mesh.vertices.append(0.0f, 0.0f, 0.0f);
+    flipped.mesh.vertices.append(1.0f, 0.0f, 0.0f);
+    flipped.mesh.vertices.append(1.0f, 1.0f, 0.0f);
+    flipped.mesh.vertices.append(0.0f, 1.0f, 0.0f);
+    flipped.mesh.faces.append(0u, 1u, 2u);
+    flipped.mesh.faces.append(0u, 3u, 2u);
+    HalfedgeMesh flipped_mesh(flipped);
+    REQUIRE(flipped_mesh.error_info == HalfedgeMeshFailure::MULTIPLE_ORIENTED_EDGES);
+}
+
+TEST_CASE("Halfedge Mesh Synchronization", "[geometry]")
+{
+    constexpr unsigned int n = 8;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    HalfedgeMesh mesh(grid);
+    REQUIRE_FALSE(mesh.error_info.has_value());
+
+    // Moving one vertex only synchronizes the data around it, which must agree with a full
+    // synchronization of the same geometry.
+    Vertex* v = mesh.v_pointers[grid_vertex_index(n, 4, 4)];
+    v->pos.z() = 1.0f;
+    mesh.inconsistent_element = v;
+    mesh.sync();
+    REQUIRE(grid.mesh.vertex(grid_vertex_index(n, 4, 4)).z() == 1.0f);
+    const std::vector<float> normals = grid.mesh.normals.data;
+    mesh.inconsistent_element        = std::monostate();
+    mesh.global_inconsistent         = true;
+    mesh.sync();
+    REQUIRE(normals.size() == grid.mesh.normals.data.size());
+    for (size_t i = 0; i < normals.size(); ++i) {
+        REQUIRE(normals[i] == Catch::Approx(grid.mesh.normals.data[i]).margin(1e-6));
+    }
+}
+
+TEST_CASE("Parallel Loop Subdivision", "[geometry]")
+{
+    constexpr unsigned int n = 4;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    HalfedgeMesh mesh(grid);
+    mesh.parallel_loop_subdivide(2);
+    REQUIRE_FALSE(mesh.validate().has_value());
+    constexpr unsigned int m = 4 * n;
+    REQUIRE(mesh.vertices.size == (m + 1) * (m + 1));
+    REQUIRE(mesh.edges.size == 3 * m * m + 2 * m);
+    // The real faces and one virtual face for the boundary loop.
+    REQUIRE(mesh.faces.size == 2 * m * m + 1);
+
+    // Loop subdivision reproduces linear functions on a regular grid, so every vertex away from
+    // the four cut corners lies on the grid refined four times.
+    size_t n_off_grid = 0;
+    for (Vertex* v : mesh.vertices) {
+        const Vector3f scaled  = static_cast<float>(m / n) * v->pos;
+        const Vector3f rounded = scaled.array().round();
+        REQUIRE(v->pos.z() == 0.0f);
+        if ((scaled - rounded).norm() > 1e-4f) {
+            ++n_off_grid;
+            REQUIRE(std::min(v->pos.x(), n - v->pos.x()) < 1.0f);
+            REQUIRE(std::min(v->pos.y(), n - v->pos.y()) < 1.0f);
+        }
+    }
+    REQUIRE(n_off_grid > 0);
+}
+
+TEST_CASE("Validation Levels", "[geometry]")
+{
+    constexpr unsigned int n = 8;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    const ValidationLevel level = HalfedgeMesh::validation_level;
+    HalfedgeMesh          mesh(grid);
+    Vertex*               center = mesh.v_pointers[grid_vertex_index(n, n / 2, n / 2)];
+    Vertex*               corner = mesh.v_pointers[grid_vertex_index(n, 0, 0)];
+    Edge*                 edge   = center->halfedge->edge;
+    HalfedgeMesh::validation_level = ValidationLevel::LOCAL;
+    REQUIRE_FALSE(mesh.validate_around(center).has_value());
+    REQUIRE_FALSE(mesh.validate_around(edge).has_value());
+
+    // A vertex pointing to a halfedge of its neighbor is found around it, but not far away.
+    Halfedge* halfedge = center->halfedge;
+    center->halfedge   = halfedge->next;
+    REQUIRE(mesh.validate_around(center) == HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY);
+    REQUIRE(mesh.validate_around(edge) == HalfedgeMeshFailure::INVALID_VERTEX_CONNECTIVITY);
+    REQUIRE_FALSE(mesh.validate_around(corner).has_value());
+    REQUIRE(mesh.validate().has_value());
+    HalfedgeMesh::validation_level = ValidationLevel::OFF;
+    REQUIRE_FALSE(mesh.validate_around(center).has_value());
+    HalfedgeMesh::validation_level = ValidationLevel::FULL;
+    REQUIRE(mesh.validate_around(corner).has_value());
+
+    // A neighbor whose halfedge was erased is found from the vertex next to it.
+    center->halfedge               = halfedge;
+    HalfedgeMesh::validation_level = ValidationLevel::LOCAL;
+    REQUIRE_FALSE(mesh.validate_around(center).has_value());
+    mesh.halfedges.erase(halfedge->next);
+    REQUIRE(mesh.validate_around(center).has_value());
+    REQUIRE_FALSE(mesh.validate_around(corner).has_value());
+    HalfedgeMesh::validation_level = level;
+}
+
+TEST_CASE("Heap Simplification", "[geometry]")
+{
+    constexpr unsigned int n = 16;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    HalfedgeMesh     mesh(grid);
+    constexpr size_t target_faces = n * n / 2;
+    mesh.heap_simplify(target_faces);
+    REQUIRE_FALSE(mesh.validate().has_value());
+    // The real faces and one virtual face for the boundary loop. Collapsing an interior edge
+    // removes two faces, so the count may fall one below the target.
+    REQUIRE(mesh.faces.size - 1 <= target_faces);
+    REQUIRE(mesh.faces.size - 1 >= target_faces - 1);
+    const auto on_side = [](float coordinate) {
+        return std::abs(coordinate) < threshold
+            || std::abs(coordinate - static_cast<float>(n)) < threshold;
+    };
+    for (Vertex* v : mesh.vertices) {
+        REQUIRE(v->pos.z() == Catch::Approx(0.0f).margin(threshold));
+        // The boundary planes keep every boundary vertex on the edges of the square.
+        bool      on_boundary = false;
+        Halfedge* h           = v->halfedge;
+        do {
+            on_boundary = on_boundary || h->inv->is_boundary();
+            h           = h->inv->next;
+        } while (h != v->halfedge);
+        if (on_boundary) {
+            REQUIRE((on_side(v->pos.x()) || on_side(v->pos.y())));
+        }
+    }
+}
+
+TEST_CASE("Parallel Simplification", "[geometry]")
+{
+    constexpr unsigned int n = 16;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    HalfedgeMesh     mesh(grid);
+    constexpr size_t target_faces = n * n / 2;
+    mesh.parallel_simplify(target_faces);
+    REQUIRE_FALSE(mesh.validate().has_value());
+    // The real faces and one virtual face for the boundary loop, a round may overshoot the
+    // target by the faces of its last independent set.
+    REQUIRE(mesh.faces.size - 1 <= target_faces);
+    REQUIRE(mesh.faces.size - 1 >= target_faces / 2);
+    // Every collapse on a plane has zero error, so the simplified mesh stays in the plane.
+    for (Vertex* v : mesh.vertices) {
+        REQUIRE(v->pos.z() == 0.0f);
+        REQUIRE(v->pos.x() >= 0.0f);
+        REQUIRE(v->pos.x() <= static_cast<float>(n));
+    }
+}
+
+TEST_CASE("Parallel Isotropic Remeshing", "[geometry]")
+{
+    constexpr unsigned int n = 8;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    HalfedgeMesh mesh(grid);
+    const auto   edge_lengths = [&mesh]() {
+        vector<float> lengths;
+        for (Edge* e : mesh.edges) {
+            lengths.push_back((e->halfedge->from->pos - e->halfedge->inv->from->pos).norm());
+        }
+        return lengths;
+    };
+    const auto check_square = [&mesh]() {
+        REQUIRE_FALSE(mesh.validate().has_value());
+        // Smoothing is tangential and boundary vertices stay, so the square stays in place.
+        for (Vertex* v : mesh.vertices) {
+            REQUIRE(v->pos.z() == 0.0f);
+            REQUIRE(v->pos.x() >= 0.0f);
+            REQUIRE(v->pos.x() <= static_cast<float>(n));
+            REQUIRE(v->pos.y() >= 0.0f);
+            REQUIRE(v->pos.y() <= static_cast<float>(n));
+        }
+    };
+    // Refining to half the edge length splits every original edge.
+    mesh.parallel_isotropic_remesh(5, 0.5f);
+    check_square();
+    REQUIRE(mesh.faces.size - 1 >= 4 * 2 * n * n);
+    const vector<float> lengths     = edge_lengths();
+    const float         mean_length = std::accumulate(lengths.begin(), lengths.end(), 0.0f)
+                                / static_cast<float>(lengths.size());
+    REQUIRE(mean_length >= 0.8f * 0.5f);
+    REQUIRE(mean_length <= 4.0f / 3.0f * 0.5f);
+    REQUIRE(*std::max_element(lengths.begin(), lengths.end()) < 1.0f);
+    // Coarsening can only collapse edges with an interior endpoint, the boundary stays fine.
+    const size_t n_faces = mesh.faces.size;
+    mesh.parallel_isotropic_remesh(5, 2.0f);
+    check_square();
+    REQUIRE(mesh.faces.size < n_faces / 4);
+}
+
+TEST_CASE("Undo and Redo", "[geometry]")
+{
+    constexpr unsigned int n = 4;
+    Object                 grid("Grid");
+    make_grid(n, grid.mesh);
+    HalfedgeMesh mesh(grid);
+    // HalfedgeMesh::flip_edge is left as an exercise, so the edge is flipped by hand here.
+    const auto flip = [](Edge* e) {
+        Halfedge* h  = e->halfedge;
+        Halfedge* t  = h->inv;
+        Halfedge* h1 = h->next;
+        Halfedge* h2 = h1->next;
+        Halfedge* t1 = t->next;
+        Halfedge* t2 = t1->next;
+        h->set_neighbors(h2, t1, t, t2->from, e, h->face);
+        t->set_neighbors(t2, h1, h, h2->from, e, t->face);
+        h1->set_neighbors(t, t2, h1->inv, h1->from, h1->edge, t->face);
+        h2->set_neighbors(t1, h, h2->inv, h2->from, h2->edge, h->face);
+        t1->set_neighbors(h, h2, t1->inv, t1->from, t1->edge, h->face);
+        t2->set_neighbors(h1, t, t2->inv, t2->from, t2->edge, t->face);
+        h->face->halfedge  = h;
+        t->face->halfedge  = t;
+        t1->from->halfedge = t1;
+        h1->from->halfedge = h1;
+    };
+    const auto endpoints = [](const Edge* e) {
+        return std::minmax({e->halfedge->from, e->halfedge->inv->from});
+    };
+    Vertex*    center = mesh.v_pointers[grid_vertex_index(n, n / 2, n / 2)];
+    Edge*      e      = center->halfedge->edge;
+    const auto before = endpoints(e);
+    mesh.begin_edit();
+    mesh.record_around(e);
+    flip(e);
+    center->pos.z() = 1.0f;
+    mesh.end_edit();
+    REQUIRE_FALSE(mesh.validate().has_value());
+    const auto after = endpoints(e);
+    REQUIRE(after != before);
+    // An edit that changes nothing leaves no entry.
+    mesh.begin_edit();
+    mesh.record_around(e);
+    mesh.end_edit();
+
+    // Compacting the pools during a global synchronization also updates the journal.
+    mesh.global_inconsistent = true;
+    mesh.sync();
+    REQUIRE(mesh.undo());
+    REQUIRE_FALSE(mesh.can_undo());
+    REQUIRE_FALSE(mesh.validate().has_value());
+    REQUIRE(endpoints(e) == before);
+    REQUIRE(center->pos.z() == 0.0f);
+    REQUIRE(mesh.redo());
+    REQUIRE_FALSE(mesh.can_redo());
+    REQUIRE_FALSE(mesh.validate().has_value());
+    REQUIRE(endpoints(e) == after);
+    REQUIRE(center->pos.z() == 1.0f);
+
+    // Canceling an edit restores the mesh without touching the history.
+    mesh.begin_edit();
+    mesh.record_around(e);
+    flip(e);
+    REQUIRE(mesh.cancel_edit());
+    REQUIRE_FALSE(mesh.cancel_edit());
+    REQUIRE_FALSE(mesh.validate().has_value());
+    REQUIRE(endpoints(e) == after);
+    REQUIRE(mesh.can_undo());
+    REQUIRE_FALSE(mesh.can_redo());
+
+    // An operation that rebuilds the mesh is undone from the triangles saved before it, and the
+    // entries before it are dropped.
+    const size_t n_vertices = mesh.vertices.size;
+    const size_t n_faces    = mesh.faces.size;
+    mesh.begin_edit();
+    mesh.parallel_simplify();
+    mesh.end_edit();
+    REQUIRE(mesh.faces.size < n_faces);
+    REQUIRE(mesh.undo());
+    REQUIRE_FALSE(mesh.can_undo());
+    REQUIRE_FALSE(mesh.validate().has_value());
+    REQUIRE(mesh.vertices.size == n_vertices);
+    REQUIRE(mesh.faces.size == n_faces);
+    float max_z = 0.0f;
+    for (const Vertex* v : mesh.vertices) {
+        max_z = std::max(max_z, v->pos.z());
+    }
+    REQUIRE(max_z == 1.0f);
+    REQUIRE(mesh.redo());
+    REQUIRE(mesh.faces.size < n_faces);
+}
+
+TEST_CASE("Vertex Clustering", "[geometry]")
+{
+    // A finely tessellated tilted square saved as both obj and binary stl.
+    constexpr unsigned int n = 64;
+
+    const auto position = [](unsigned int i, unsigned int j) {
+        const float x = static_cast<float>(i) / n;
+        const float y = static_cast<float>(j) / n;
+        return Vector3f(x, y, 0.5f * x);
+    };
+    const auto vertex_index = [](unsigned int i, unsigned int j) { return j * (n + 1) + i + 1; };
+    const std::filesystem::path directory = std::filesystem::temp_directory_path();
+    const string                obj_path  = (directory / "dandelion_clustering.obj").string();
+    const string                stl_path  = (directory / "dandelion_clustering.stl").string();
+    {
+        std::ofstream obj(obj_path);
+        obj.precision(9);
+        for (unsigned int j = 0; j <= n; ++j) {
+            for (unsigned int i = 0; i <= n; ++i) {
+                const Vector3f p = position(i, j);
+                obj << "v " << p.x() << " " << p.y() << " " << p.z() << "\n";
+            }
+        }
+        std::ofstream stl(stl_path, std::ios::binary);
+        const char    header[80]  = {};
+        uint32_t      n_triangles = n * n * 2;
+        stl.write(header, sizeof(header));
+        stl.write(reinterpret_cast<const char*>(&n_triangles), sizeof(n_triangles));
+        const auto write_triangle = [&](std::array<pair<unsigned int, unsigned int>, 3> corners) {
+            obj << "f";
+            float record[12] = {};
+            for (size_t k = 0; k < 3; ++k) {
+                const auto [i, j] = corners[k];
+                obj << " " << vertex_index(i, j);
+                const Vector3f p = position(i, j);
+                std::copy(p.data(), p.data() + 3, record + 3 * (k + 1));
+            }
+            obj << "\n";
+            const uint16_t attribute = 0;
+            stl.write(reinterpret_cast<const char*>(record), sizeof(record));
+            stl.write(reinterpret_cast<const char*>(&attribute), sizeof(attribute));
+        };
+        for (unsigned int j = 0; j < n; ++j) {
+            for (unsigned int i = 0; i < n; ++i) {
+                write_triangle({{{i, j}, {i + 1, j}, {i + 1, j + 1}}});
+                write_triangle({{{i, j}, {i + 1, j + 1}, {i, j + 1}}});
+            }
+        }
+    }
+
+    std::optional<ClusteredMesh> from_obj = cluster_vertices(obj_path, 8);
+    std::optional<ClusteredMesh> from_stl = cluster_vertices(stl_path, 8);
+    REQUIRE(from_obj.has_value());
+    REQUIRE(from_stl.has_value());
+    REQUIRE(from_obj->n_input_faces == 2 * n * n);
+    REQUIRE(from_obj->resolution == 8);
+    REQUIRE(from_obj->vertices == from_stl->vertices);
+    REQUIRE(from_obj->faces == from_stl->faces);
+    const size_t n_vertices = from_obj->vertices.size() / 3;
+    REQUIRE(n_vertices <= 9 * 9);
+    REQUIRE(from_obj->faces.size() >= 3 * 2 * 6 * 6);
+    for (const unsigned int index: from_obj->faces) {
+        REQUIRE(index < n_vertices);
+    }
+    // Every cell is planar, so its representative stays on the plane.
+    for (size_t i = 0; i < n_vertices; ++i) {
+        const Vector3f p(from_obj->vertices.data() + 3 * i);
+        REQUIRE(std::abs(p.z() - 0.5f * p.x()) < threshold);
+    }
+
+    // Too few cells allowed: the grid is coarsened until the occupied cells fit.
+    std::optional<ClusteredMesh> coarse = cluster_vertices(obj_path, 8, 16);
+    REQUIRE(coarse.has_value());
+    REQUIRE(coarse->resolution < 8);
+    REQUIRE(coarse->vertices.size() / 3 <= 16);
+
+    std::filesystem::remove(obj_path);
+    std::filesystem::remove(stl_path);
+}
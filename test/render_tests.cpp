@@ -0,0 +1,281 @@
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <optional>
+#include <random>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <Eigen/Core>
+
+#include "../src/render/denoiser.h"
+#include "../src/render/dependency_grid.h"
+#include "../src/render/light_baker.h"
+#include "../src/render/light_culling.h"
+#include "../src/render/visibility_buffer.h"
+#include "../src/scene/camera.h"
+#include "../src/utils/ray.h"
+
+using Eigen::AlignedBox3f;
+using Eigen::Vector3f;
+using std::size_t;
+using std::uint32_t;
+using std::vector;
+
+TEST_CASE("Denoiser", "[render]")
+{
+    constexpr int                   width  = 64;
+    constexpr int                   height = 32;
+    constexpr size_t                n      = width * height;
+    std::default_random_engine      engine(3);
+    std::normal_distribution<float> noise(0.0f, 0.1f);
+
+    // 左右两半是法向和反照率都不同的两个平面，颜色的均值分别为 0.2 和 0.8
+    vector<Vector3f> image(n);
+    GBuffer          gbuffer;
+    gbuffer.reset(n);
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            const size_t idx    = static_cast<size_t>(j) * width + i;
+            const bool   left   = i < width / 2;
+            image[idx]          = Vector3f::Constant((left ? 0.2f : 0.8f) + noise(engine));
+            gbuffer.normal[idx] = left ? Vector3f::UnitZ() : Vector3f::UnitX();
+            gbuffer.albedo[idx] = Vector3f::Constant(left ? 0.2f : 0.8f);
+            gbuffer.depth[idx]  = 5.0f;
+        }
+    }
+
+    const auto error = [&](const vector<Vector3f>& result) {
+        float sum = 0.0f;
+        for (int j = 0; j < height; ++j) {
+            for (int i = 0; i < width; ++i) {
+                const float expected = i < width / 2 ? 0.2f : 0.8f;
+                sum += std::abs(result[static_cast<size_t>(j) * width + i].x() - expected);
+            }
+        }
+        return sum / static_cast<float>(n);
+    };
+    const float noisy_error = error(image);
+    Denoiser    denoiser;
+    denoiser.denoise(image, gbuffer, width, height, 4);
+    REQUIRE(error(image) < 0.3f * noisy_error);
+
+    // 边缘两侧的像素不会互相混合
+    for (int j = 0; j < height; ++j) {
+        const size_t idx = static_cast<size_t>(j) * width + width / 2;
+        REQUIRE(image[idx - 1].x() < 0.3f);
+        REQUIRE(image[idx].x() > 0.7f);
+    }
+
+    // 法向互相抵消的像素（零法向）不参与法向权重，结果不会出现 NaN
+    for (size_t idx = 0; idx < n; idx += 7) {
+        gbuffer.normal[idx] = Vector3f::Zero();
+    }
+    denoiser.denoise(image, gbuffer, width, height, 4);
+    for (const Vector3f& color: image) {
+        REQUIRE(color.allFinite());
+    }
+}
+
+TEST_CASE("Dependency Grid", "[render]")
+{
+    DependencyGrid grid;
+    grid.reset(AlignedBox3f(Vector3f(-8.0f, -8.0f, -8.0f), Vector3f(8.0f, 8.0f, 8.0f)));
+    REQUIRE(grid.contains(AlignedBox3f(Vector3f::Constant(-1.0f), Vector3f::Constant(1.0f))));
+    REQUIRE_FALSE(
+        grid.contains(AlignedBox3f(Vector3f(7.0f, 0.0f, 0.0f), Vector3f::Constant(9.0f)))
+    );
+
+    // 从网格外射入、沿 x 轴穿过整个网格的光线经过一整行单元
+    DependencyGrid::CellSet row;
+    grid.mark_segment(row, {Vector3f(-20.0f, 0.5f, 0.5f), Vector3f(1.0f, 0.0f, 0.0f)}, 1e30f);
+    REQUIRE(row.count() == DependencyGrid::resolution);
+
+    // 线段只标记它到达的单元：终点前的盒子与之相交，终点之后的盒子不相交
+    DependencyGrid::CellSet segment, before, after;
+    grid.mark_segment(segment, {Vector3f(-7.5f, 0.5f, 0.5f), Vector3f(2.0f, 0.0f, 0.0f)}, 3.0f);
+    grid.mark_box(before, AlignedBox3f(Vector3f(-3.0f, 0.2f, 0.2f), Vector3f(-2.0f, 0.8f, 0.8f)));
+    grid.mark_box(after, AlignedBox3f(Vector3f(2.0f, 0.2f, 0.2f), Vector3f(3.0f, 0.8f, 0.8f)));
+    REQUIRE((segment & before).any());
+    REQUIRE((segment & after).none());
+
+    // 斜向的光线经过的单元是连通的，数量不超过 3 倍分辨率
+    DependencyGrid::CellSet diagonal;
+    const Vector3f          direction = Vector3f(1.0f, 0.7f, 0.3f).normalized();
+    grid.mark_segment(diagonal, {Vector3f(-7.9f, -7.9f, -7.9f), direction}, 1e30f);
+    REQUIRE(diagonal.count() >= static_cast<size_t>(DependencyGrid::resolution));
+    REQUIRE(diagonal.count() <= static_cast<size_t>(3 * DependencyGrid::resolution));
+    REQUIRE(diagonal.test(0));
+}
+
+TEST_CASE("Tiled Light Culling", "[render]")
+{
+    constexpr int width  = 160;
+    constexpr int height = 96;
+    Camera camera(
+        Vector3f(0.0f, 0.0f, 10.0f), Vector3f::Zero(), 0.1f, 100.0f, 45.0f, 5.0f / 3.0f
+    );
+    // 截断值 0.01 下，强度 1 的光源影响半径为 10 ，强度 0.0004 的光源影响半径为 0.2
+    std::list<Light> lights;
+    lights.emplace_back(Vector3f(0.0f, 0.0f, 0.0f), 1.0f);
+    lights.emplace_back(Vector3f(2.0f, 1.0f, 0.0f), 0.0004f);
+    lights.emplace_back(Vector3f(500.0f, 0.0f, 0.0f), 0.0004f);
+
+    LightTiles light_tiles;
+    light_tiles.build(lights, camera.view(), camera.projection(), width, height, 0.01f);
+    REQUIRE(light_tiles.tiles_x == width / LightTiles::tile_size);
+    REQUIRE(light_tiles.tiles_y == height / LightTiles::tile_size);
+
+    // 把世界坐标投影到与片元相同的屏幕坐标
+    const auto to_screen = [&](const Vector3f& p) {
+        const Eigen::Vector4f clip = camera.projection() * camera.view() * p.homogeneous();
+        return Eigen::Vector2i(
+            static_cast<int>((clip.x() / clip.w() + 1.0f) * 0.5f * width),
+            static_cast<int>((clip.y() / clip.w() + 1.0f) * 0.5f * height)
+        );
+    };
+    const Eigen::Vector2i small = to_screen(Vector3f(2.0f, 1.0f, 0.0f));
+    REQUIRE(light_tiles.lights_in(light_tiles.tile_at(small.x(), small.y())).size() == 2);
+    size_t n_small = 0;
+    for (size_t tile = 0; tile < light_tiles.tiles.size(); ++tile) {
+        // 影响整个屏幕的光源出现在每个块中，屏幕外的光源不出现在任何块中
+        const auto indices = light_tiles.lights_in(tile);
+        REQUIRE(indices.front() == 0);
+        REQUIRE(light_tiles.light(indices.front()).intensity == 1.0f);
+        for (const uint32_t index: indices) {
+            REQUIRE(light_tiles.light(index).position.x() < 100.0f);
+        }
+        n_small += indices.size() - 1;
+    }
+    REQUIRE(n_small >= 1);
+    REQUIRE(light_tiles.n_references() == light_tiles.tiles.size() + n_small);
+    REQUIRE(n_small <= 4);
+
+    // 每个块都有片元着色器使用的光源列表
+    const std::list<Light>& tile_lights =
+        light_tiles.lights_of(light_tiles.tile_at(small.x(), small.y()));
+    REQUIRE(tile_lights.size() == 2);
+    REQUIRE(tile_lights.back().intensity == 0.0004f);
+
+    // 不设截断值时每个光源都影响所有块
+    light_tiles.build(lights, camera.view(), camera.projection(), width, height, 0.0f);
+    REQUIRE(light_tiles.n_references() == 3 * light_tiles.tiles.size());
+    const size_t top_left = static_cast<size_t>(light_tiles.tiles_y - 1) * light_tiles.tiles_x;
+    REQUIRE(light_tiles.tile_at(-5, 1000) == top_left);
+}
+
+TEST_CASE("Light Baking", "[render]")
+{
+    GL::Mesh mesh;
+    mesh.vertices.append(0.0f, 0.0f, 0.0f);
+    mesh.vertices.append(1.0f, 0.0f, 0.0f);
+    mesh.vertices.append(0.0f, 1.0f, 0.0f);
+    for (int i = 0; i < 3; ++i) {
+        mesh.normals.append(0.0f, 0.0f, 1.0f);
+    }
+    mesh.faces.append(0u, 1u, 2u);
+    REQUIRE_FALSE(mesh.has_baked_lighting());
+
+    // 没有遮挡物和光源时没有遮蔽，也没有间接光照
+    LightBaker baker;
+    baker.n_samples = 16;
+    baker.bake_mesh(mesh, Eigen::Matrix4f::Identity(), 0);
+    REQUIRE(mesh.has_baked_lighting());
+    for (size_t i = 0; i < 3; ++i) {
+        const Eigen::Vector4f baked(&mesh.baked_lighting.data[4 * i]);
+        REQUIRE(baked.head<3>().isZero());
+        REQUIRE(baked.w() == 1.0f);
+    }
+
+    // 顶点数变化后烘焙结果失效
+    mesh.vertices.append(1.0f, 1.0f, 0.0f);
+    REQUIRE_FALSE(mesh.has_baked_lighting());
+    mesh.clear();
+    REQUIRE(mesh.baked_lighting.data.empty());
+}
+
+TEST_CASE("Visibility Buffer", "[render]")
+{
+    constexpr int width  = 64;
+    constexpr int height = 48;
+    const Camera  camera(
+        Vector3f(0.0f, 0.0f, 5.0f), Vector3f::Zero(), 0.1f, 100.0f, 45.0f, 4.0f / 3.0f
+    );
+    // 一个正对相机的大三角形，和一个穿过相机所在平面、需要被裁剪的斜三角形
+    GL::Mesh mesh;
+    mesh.vertices.append(-2.0f, -1.5f, 0.0f);
+    mesh.vertices.append(2.0f, -1.5f, 0.0f);
+    mesh.vertices.append(0.0f, 2.0f, 0.0f);
+    mesh.vertices.append(-1.0f, 0.5f, 1.0f);
+    mesh.vertices.append(-1.0f, 0.5f, 8.0f);
+    mesh.vertices.append(-0.2f, 0.9f, 1.0f);
+    mesh.faces.append(0u, 1u, 2u);
+    mesh.faces.append(3u, 4u, 5u);
+    Eigen::Matrix4f model = Eigen::Matrix4f::Identity();
+    model.block<3, 1>(0, 3) << 0.1f, 0.0f, 0.0f;
+
+    VisibilityBuffer visibility;
+    visibility.clear(width, height);
+    visibility.rasterize(mesh, model, 7, camera, 4);
+
+    // 用光线求交作为参照：像素中心的主光线击中的面片和距离应与可见性缓冲区一致
+    const auto intersect = [&](const Ray& ray, size_t f) -> std::optional<float> {
+        Vector3f v[3];
+        for (int k = 0; k < 3; ++k) {
+            v[k] = (model * mesh.vertex(mesh.face(f)[k]).homogeneous()).hnormalized();
+        }
+        const Vector3f e1 = v[1] - v[0];
+        const Vector3f e2 = v[2] - v[0];
+        const Vector3f p  = ray.direction.cross(e2);
+        const float    d  = e1.dot(p);
+        const Vector3f s  = ray.origin - v[0];
+        const float    u  = s.dot(p) / d;
+        const Vector3f q  = s.cross(e1);
+        const float    w  = ray.direction.dot(q) / d;
+        const float    t  = e2.dot(q) / d;
+        if (u < 0.0f || w < 0.0f || u + w > 1.0f || t <= 0.0f) {
+            return std::nullopt;
+        }
+        return t;
+    };
+    int n_covered  = 0;
+    int n_mismatch = 0;
+    for (int j = 0; j < height; ++j) {
+        for (int i = 0; i < width; ++i) {
+            const Ray ray = generate_subpixel_ray(camera, width, height, i + 0.5f, j + 0.5f);
+            std::optional<size_t> face;
+            float                 nearest = std::numeric_limits<float>::infinity();
+            for (size_t f = 0; f < 2; ++f) {
+                const auto t = intersect(ray, f);
+                if (t.has_value() && *t < nearest) {
+                    nearest = *t;
+                    face    = f;
+                }
+            }
+            const VisibilityBuffer::Sample& sample = visibility.at(i, j);
+            const bool covered = sample.object != VisibilityBuffer::no_object;
+            if (covered != face.has_value() || (covered && sample.face != *face)) {
+                // 只允许恰好落在边上的像素不一致
+                ++n_mismatch;
+                continue;
+            }
+            if (!covered) {
+                continue;
+            }
+            ++n_covered;
+            REQUIRE(sample.object == 7);
+            REQUIRE(std::abs(sample.depth - nearest) < 1e-3f * nearest);
+            // 由重心坐标重建的点位于这条主光线上
+            Vector3f point = Vector3f::Zero();
+            for (int k = 0; k < 3; ++k) {
+                point += sample.barycentric[k]
+                       * (model * mesh.vertex(mesh.face(sample.face)[k]).homogeneous())
+                             .hnormalized();
+            }
+            REQUIRE((point - (ray.origin + nearest * ray.direction)).norm() < 1e-3f * nearest);
+        }
+    }
+    REQUIRE(n_covered > width * height / 4);
+    REQUIRE(n_mismatch <= 4);
+}
@@ -0,0 +1,66 @@
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <catch2/catch_amalgamated.hpp>
+#include <Eigen/Core>
+
+#include "../src/utils/sampler.h"
+
+using Eigen::Vector2f;
+using std::size_t;
+using std::uint32_t;
+
+TEST_CASE("Sampler", "[sampler]")
+{
+    for (SamplerType type:
+         {SamplerType::INDEPENDENT, SamplerType::SOBOL, SamplerType::BLUE_NOISE}) {
+        std::unique_ptr<Sampler> sampler = make_sampler(type, 5);
+        std::unique_ptr<Sampler> other   = make_sampler(type, 5);
+
+        // 相同的像素、样本和维度总是得到相同的值，与之前生成过什么无关
+        sampler->start_pixel(3, 7, 11);
+        const Vector2f first  = sampler->next_2d();
+        const float    second = sampler->next_1d();
+        other->start_pixel(100, 20, 0);
+        other->next_2d();
+        other->start_pixel(3, 7, 11);
+        REQUIRE(other->next_2d() == first);
+        REQUIRE(other->next_1d() == second);
+
+        // 记录维度后中断，再从记录的维度继续，与不中断时得到相同的值
+        other->start_pixel(3, 7, 11);
+        other->next_2d();
+        const uint32_t dimension = other->current_dimension();
+        REQUIRE(dimension == 2);
+        other->start_pixel(8, 8, 1);
+        other->next_1d();
+        other->start_pixel(3, 7, 11, dimension);
+        REQUIRE(other->next_1d() == second);
+
+        // 前 16 个样本的每个二维投影都落在 [0, 1) 内，Sobol 类的采样器在 4x4 网格中各占一格
+        for (uint32_t dimension_pair = 0; dimension_pair < 3; ++dimension_pair) {
+            std::array<int, 16> strata{};
+            for (uint32_t i = 0; i < 16; ++i) {
+                sampler->start_pixel(9, 4, i);
+                for (uint32_t d = 0; d < dimension_pair; ++d) {
+                    sampler->next_2d();
+                }
+                const Vector2f u = sampler->next_2d();
+                REQUIRE(u.x() >= 0.0f);
+                REQUIRE(u.x() < 1.0f);
+                REQUIRE(u.y() >= 0.0f);
+                REQUIRE(u.y() < 1.0f);
+                const size_t row    = static_cast<size_t>(4.0f * u.y());
+                const size_t column = static_cast<size_t>(4.0f * u.x());
+                ++strata[row * 4 + column];
+            }
+            if (type == SamplerType::SOBOL) {
+                for (int count: strata) {
+                    REQUIRE(count == 1);
+                }
+            }
+        }
+    }
+}